@@ -1,26 +1,143 @@
 #include "service_factory.h"
+#include "service_plugin.h"
 #include <algorithm>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <fstream>
 #include <iostream>
 
 namespace ServiceFramework {
 
+namespace {
+
+// A plugin's shared object, opened on first use
+struct PluginLibrary {
+    std::string path;
+    std::once_flag opened;
+    IService *(*create)(const char *serviceType) = nullptr;
+};
+
+void openPlugin(PluginLibrary &library) {
+    void *handle = dlopen(library.path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        std::cerr << "Failed to load plugin '" << library.path
+                  << "': " << dlerror() << std::endl;
+        return;
+    }
+
+    // Never closed: its code backs every instance and creator
+    void *entry = dlsym(handle, SERVICE_PLUGIN_ENTRY_POINT);
+    if (!entry) {
+        std::cerr << "Plugin '" << library.path << "' has no "
+                  << SERVICE_PLUGIN_ENTRY_POINT << std::endl;
+        return;
+    }
+    library.create = reinterpret_cast<IService *(*)(const char *)>(entry);
+    std::cout << "Plugin '" << library.path << "' loaded" << std::endl;
+}
+
+std::string trim(const std::string &text) {
+    size_t begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) {
+        return std::string();
+    }
+    size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(begin, end - begin + 1);
+}
+
+} // namespace
+
 ServiceFactory &ServiceFactory::getInstance() {
+    // Registrars run during static initialization and the factory logs
+    // through std::cout, so construct the streams before first use
+    static const std::ios_base::Init streams;
     static ServiceFactory instance;
     return instance;
 }
 
-bool ServiceFactory::registerService(const std::string &serviceName,
+ServiceFactory::ServiceFactory() {
+    publish(std::make_unique<Registry>());
+}
+
+ServiceFactory::~ServiceFactory() = default;
+
+uint32_t ServiceFactory::intern(Registry &next, std::string_view name) {
+    auto it = next.ids.find(name);
+    if (it != next.ids.end()) {
+        return it->second;
+    }
+
+    m_names.emplace_back(name);
+    std::string_view stored = m_names.back();
+    uint32_t index = static_cast<uint32_t>(next.names.size());
+    next.ids.emplace(stored, index);
+    next.names.push_back(stored);
+    next.creators.emplace_back();
+    next.pools.emplace_back();
+    if (const StaticServiceEntry *entry = findStatic(next, stored)) {
+        next.creators[index] = entry->create;
+    }
+    return index;
+}
+
+const StaticServiceEntry *
+ServiceFactory::findStatic(const Registry &registry, std::string_view name) {
+    for (const auto &services : registry.statics) {
+        if (const StaticServiceEntry *entry = services.find(name)) {
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+void ServiceFactory::publish(std::unique_ptr<Registry> next) {
+    // Readers reload on their next lookup and drop the replaced snapshot
+    std::atomic_store_explicit(&m_registry,
+                               std::shared_ptr<const Registry>(std::move(next)),
+                               std::memory_order_release);
+    m_generation.fetch_add(1, std::memory_order_release);
+}
+
+ServiceFactory::ReaderCache &ServiceFactory::readerCache() {
+    thread_local ReaderCache cache;
+    return cache;
+}
+
+ServiceFactory::Reader::Reader(const ServiceFactory &factory) {
+    ReaderCache &cache = readerCache();
+    if (cache.depth++ == 0) {
+        // Only the atomic_load of a new snapshot takes the library's lock
+        uint64_t generation =
+            factory.m_generation.load(std::memory_order_acquire);
+        if (generation != cache.generation || !cache.registry) {
+            cache.registry = std::atomic_load_explicit(
+                &factory.m_registry, std::memory_order_acquire);
+            cache.generation = generation;
+        }
+    }
+    m_registry = cache.registry.get();
+}
+
+ServiceFactory::Reader::~Reader() { --readerCache().depth; }
+
+bool ServiceFactory::registerService(std::string_view serviceName,
                                      ServiceCreator creator) {
     if (serviceName.empty() || !creator) {
         std::cerr << "Invalid service name or creator function" << std::endl;
         return false;
     }
 
-    auto result = m_serviceCreators.emplace(serviceName, std::move(creator));
-    if (!result.second) {
-        std::cerr << "Service '" << serviceName << "' is already registered"
-                  << std::endl;
-        return false;
+    {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        auto next = std::make_unique<Registry>(current());
+        uint32_t index = intern(*next, serviceName);
+        if (next->creators[index]) {
+            std::cerr << "Service '" << serviceName
+                      << "' is already registered" << std::endl;
+            return false;
+        }
+        next->creators[index] = std::move(creator);
+        publish(std::move(next));
     }
 
     std::cout << "Service '" << serviceName << "' registered successfully"
@@ -28,16 +145,311 @@ bool ServiceFactory::registerService(const std::string &serviceName,
     return true;
 }
 
-ServicePtr ServiceFactory::createService(const std::string &serviceName) {
-    auto it = m_serviceCreators.find(serviceName);
-    if (it == m_serviceCreators.end()) {
+bool ServiceFactory::registerService(std::string_view serviceName,
+                                     ArenaServiceCreator creator) {
+    if (!creator) {
+        return registerService(serviceName, ServiceCreator());
+    }
+    return registerService(
+        serviceName, [creator = std::move(creator)]() -> ServicePtr {
+            auto account = ServiceMemory::current();
+            return creator(account ? account.get()
+                                   : std::pmr::get_default_resource());
+        });
+}
+
+bool ServiceFactory::addStaticServices(const StaticServiceView &services) {
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    for (size_t i = 0; i < services.size(); ++i) {
+        std::string_view name = services.entry(i).name;
+        if (isServiceRegistered(name)) {
+            std::cerr << "Service '" << name << "' is already registered"
+                      << std::endl;
+            return false;
+        }
+    }
+
+    // Creators are only filled in for names already interned; the rest
+    // are found through the table or when interned later
+    auto next = std::make_unique<Registry>(current());
+    next->statics.push_back(services);
+    for (size_t i = 0; i < services.size(); ++i) {
+        auto it = next->ids.find(services.entry(i).name);
+        if (it != next->ids.end()) {
+            next->creators[it->second] = services.entry(i).create;
+        }
+    }
+    publish(std::move(next));
+    return true;
+}
+
+size_t ServiceFactory::loadPlugins(const std::string &directory) {
+    DIR *dir = opendir(directory.c_str());
+    if (!dir) {
+        std::cerr << "Cannot open plugin directory '" << directory << "'"
+                  << std::endl;
+        return 0;
+    }
+    std::vector<std::string> manifests;
+    while (dirent *entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.size() > 7 && name.compare(name.size() - 7, 7, ".plugin") == 0) {
+            manifests.push_back(directory + "/" + name);
+        }
+    }
+    closedir(dir);
+    std::sort(manifests.begin(), manifests.end());
+
+    size_t registered = 0;
+    for (const auto &manifest : manifests) {
+        std::ifstream file(manifest);
+        auto library = std::make_shared<PluginLibrary>();
+        std::vector<std::string> services;
+        std::string line;
+        while (std::getline(file, line)) {
+            line = trim(line);
+            size_t equals = line.find('=');
+            if (line.empty() || line[0] == '#' || equals == std::string::npos) {
+                continue;
+            }
+            std::string key = trim(line.substr(0, equals));
+            std::string value = trim(line.substr(equals + 1));
+            if (key == "library") {
+                library->path = !value.empty() && value[0] == '/'
+                                    ? value
+                                    : directory + "/" + value;
+            } else if (key == "service") {
+                services.push_back(value);
+            }
+        }
+        if (library->path.empty()) {
+            std::cerr << "Plugin manifest '" << manifest
+                      << "' names no library" << std::endl;
+            continue;
+        }
+
+        for (const auto &serviceName : services) {
+            bool ok = registerService(serviceName, [library, serviceName]() -> ServicePtr {
+                std::call_once(library->opened,
+                               [&library] { openPlugin(*library); });
+                if (!library->create) {
+                    return nullptr;
+                }
+                return ServicePtr(library->create(serviceName.c_str()));
+            });
+            registered += ok ? 1 : 0;
+        }
+    }
+    return registered;
+}
+
+ServiceTypeId ServiceFactory::typeId(std::string_view serviceName) {
+    if (serviceName.empty()) {
+        return ServiceTypeId();
+    }
+
+    Reader registry(*this);
+    auto it = registry->ids.find(serviceName);
+    if (it != registry->ids.end()) {
+        return ServiceTypeId(it->second);
+    }
+
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    it = current().ids.find(serviceName);
+    if (it != current().ids.end()) {
+        return ServiceTypeId(it->second); // interned meanwhile
+    }
+    auto next = std::make_unique<Registry>(current());
+    uint32_t index = intern(*next, serviceName);
+    publish(std::move(next));
+    return ServiceTypeId(index);
+}
+
+std::string_view ServiceFactory::typeName(ServiceTypeId type) const {
+    Reader registry(*this);
+    if (type.index() >= registry->names.size()) {
+        return std::string_view();
+    }
+    return registry->names[type.index()];
+}
+
+ServicePtr ServiceFactory::createService(std::string_view serviceName) {
+    Reader registry(*this);
+    if (const StaticServiceEntry *entry = findStatic(*registry, serviceName)) {
+        return create(entry->name, entry->create);
+    }
+
+    auto it = registry->ids.find(serviceName);
+    if (it == registry->ids.end() || !registry->creators[it->second]) {
         std::cerr << "Service '" << serviceName << "' not found in registry"
                   << std::endl;
         return nullptr;
     }
+    return create(registry->names[it->second], registry->creators[it->second]);
+}
+
+bool ServiceFactory::setServicePool(std::string_view serviceName,
+                                    const ServicePoolOptions &options) {
+    ServiceTypeId type = typeId(serviceName);
+    std::shared_ptr<ServicePool> pool;
+    {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        if (!isServiceRegistered(type)) {
+            std::cerr << "Service '" << serviceName
+                      << "' not found in registry" << std::endl;
+            return false;
+        }
+        pool = current().pools[type.index()];
+        if (!pool) {
+            auto next = std::make_unique<Registry>(current());
+            pool = std::make_shared<ServicePool>();
+            next->pools[type.index()] = pool;
+            publish(std::move(next));
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->options = options;
+        pool->options.maxIdle = std::max(options.maxIdle, options.warmInstances);
+        if (pool->idle.size() > pool->options.maxIdle) {
+            pool->idle.resize(pool->options.maxIdle);
+        }
+    }
+    return warm(serviceName, *pool);
+}
+
+bool ServiceFactory::warmServicePool(std::string_view serviceName) {
+    std::shared_ptr<ServicePool> pool = findPool(serviceName);
+    return pool != nullptr && warm(serviceName, *pool);
+}
 
+bool ServiceFactory::warm(std::string_view serviceName, ServicePool &pool) {
+    size_t missing = 0;
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        if (pool.options.warmInstances > pool.idle.size()) {
+            missing = pool.options.warmInstances - pool.idle.size();
+        }
+    }
+
+    // Construction and initialize() run without the pool lock
+    for (; missing > 0; --missing) {
+        ServicePtr service = createService(serviceName);
+        if (!service || !service->initialize()) {
+            std::cerr << "Failed to warm pool of service '" << serviceName
+                      << "'" << std::endl;
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        if (pool.retired || pool.idle.size() >= pool.options.maxIdle) {
+            break; // filled or unregistered concurrently
+        }
+        pool.idle.push_back(std::move(service));
+    }
+    return true;
+}
+
+ServicePtr ServiceFactory::acquirePooledService(std::string_view serviceName) {
+    std::shared_ptr<ServicePool> pool = findPool(serviceName);
+    if (!pool) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    if (pool->idle.empty()) {
+        return nullptr;
+    }
+    ServicePtr service = std::move(pool->idle.back());
+    pool->idle.pop_back();
+    return service;
+}
+
+ServicePtr ServiceFactory::acquirePooledService(ServiceTypeId type) {
+    Reader registry(*this);
+    if (type.index() >= registry->pools.size() ||
+        !registry->pools[type.index()]) {
+        return nullptr;
+    }
+    ServicePool &pool = *registry->pools[type.index()];
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    if (pool.idle.empty()) {
+        return nullptr;
+    }
+    ServicePtr service = std::move(pool.idle.back());
+    pool.idle.pop_back();
+    return service;
+}
+
+void ServiceFactory::recycleService(ServiceTypeId type, ServicePtr service) {
+    Reader registry(*this);
+    if (!service || type.index() >= registry->pools.size() ||
+        !registry->pools[type.index()] || !service->reset()) {
+        return;
+    }
+    ServicePool &pool = *registry->pools[type.index()];
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    if (!pool.retired && pool.idle.size() < pool.options.maxIdle) {
+        pool.idle.push_back(std::move(service));
+    }
+}
+
+void ServiceFactory::retire(ServicePool &pool) {
+    std::vector<ServicePtr> idle;
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        pool.retired = true;
+        idle.swap(pool.idle);
+    }
+    // Idle instances are stopped already; destroy them outside the lock
+}
+
+size_t ServiceFactory::pooledServiceCount(std::string_view serviceName) const {
+    std::shared_ptr<ServicePool> pool = findPool(serviceName);
+    if (!pool) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    return pool->idle.size();
+}
+
+std::shared_ptr<ServiceFactory::ServicePool>
+ServiceFactory::findPool(std::string_view name) const {
+    Reader registry(*this);
+    auto it = registry->ids.find(name);
+    return it != registry->ids.end() ? registry->pools[it->second] : nullptr;
+}
+
+ServicePtr ServiceFactory::createService(ServiceTypeId type) {
+    Reader registry(*this);
+    if (type.index() >= registry->creators.size() ||
+        !registry->creators[type.index()]) {
+        std::cerr << "Service '" << typeName(type) << "' not found in registry"
+                  << std::endl;
+        return nullptr;
+    }
+    return create(registry->names[type.index()],
+                  registry->creators[type.index()]);
+}
+
+ServicePtr ServiceFactory::createService(std::string_view serviceName,
+                                         std::pmr::memory_resource *arena) {
+    ServiceMemory::Scope scope(
+        arena ? std::make_shared<ServiceMemoryAccount>(arena) : nullptr);
+    return createService(serviceName);
+}
+
+ServicePtr ServiceFactory::createService(ServiceTypeId type,
+                                         std::pmr::memory_resource *arena) {
+    ServiceMemory::Scope scope(
+        arena ? std::make_shared<ServiceMemoryAccount>(arena) : nullptr);
+    return createService(type);
+}
+
+template <typename Creator>
+ServicePtr ServiceFactory::create(std::string_view serviceName,
+                                  const Creator &creator) {
     try {
-        auto service = it->second();
+        auto service = creator();
         if (!service) {
             std::cerr << "Failed to create service '" << serviceName << "'"
                       << std::endl;
@@ -54,36 +466,92 @@ ServicePtr ServiceFactory::createService(const std::string &serviceName) {
     }
 }
 
-bool ServiceFactory::isServiceRegistered(const std::string &serviceName) const {
-    return m_serviceCreators.find(serviceName) != m_serviceCreators.end();
+bool ServiceFactory::isServiceRegistered(std::string_view serviceName) const {
+    Reader registry(*this);
+    if (findStatic(*registry, serviceName)) {
+        return true;
+    }
+    auto it = registry->ids.find(serviceName);
+    return it != registry->ids.end() && registry->creators[it->second];
+}
+
+bool ServiceFactory::isServiceRegistered(ServiceTypeId type) const {
+    Reader registry(*this);
+    return type.index() < registry->creators.size() &&
+           registry->creators[type.index()];
 }
 
 std::vector<std::string> ServiceFactory::getRegisteredServices() const {
+    Reader registry(*this);
     std::vector<std::string> services;
-    services.reserve(m_serviceCreators.size());
+    services.reserve(registry->names.size());
 
-    for (const auto &pair : m_serviceCreators) {
-        services.push_back(pair.first);
+    for (const auto &statics : registry->statics) {
+        for (size_t i = 0; i < statics.size(); ++i) {
+            services.emplace_back(statics.entry(i).name);
+        }
+    }
+    for (size_t i = 0; i < registry->names.size(); ++i) {
+        if (registry->creators[i]) {
+            services.emplace_back(registry->names[i]);
+        }
     }
 
+    // Interned compiled-in names appear twice
     std::sort(services.begin(), services.end());
+    services.erase(std::unique(services.begin(), services.end()),
+                   services.end());
     return services;
 }
 
-bool ServiceFactory::unregisterService(const std::string &serviceName) {
-    auto it = m_serviceCreators.find(serviceName);
-    if (it == m_serviceCreators.end()) {
-        return false;
+bool ServiceFactory::unregisterService(std::string_view serviceName) {
+    std::shared_ptr<ServicePool> pool;
+    {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        if (findStatic(current(), serviceName)) {
+            std::cerr << "Service '" << serviceName
+                      << "' is compiled in and cannot be unregistered"
+                      << std::endl;
+            return false;
+        }
+        auto it = current().ids.find(serviceName);
+        if (it == current().ids.end() || !current().creators[it->second]) {
+            return false;
+        }
+        auto next = std::make_unique<Registry>(current());
+        next->creators[it->second] = nullptr; // the ID stays interned
+        pool = std::move(next->pools[it->second]);
+        publish(std::move(next));
+    }
+    if (pool) {
+        retire(*pool);
     }
 
-    m_serviceCreators.erase(it);
     std::cout << "Service '" << serviceName << "' unregistered successfully"
               << std::endl;
     return true;
 }
 
 void ServiceFactory::clear() {
-    m_serviceCreators.clear();
+    std::vector<std::shared_ptr<ServicePool>> pools;
+    {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        auto next = std::make_unique<Registry>(current());
+        for (auto &creator : next->creators) {
+            creator = nullptr;
+        }
+        next->statics.clear();
+        for (auto &pool : next->pools) {
+            if (pool) {
+                pools.push_back(std::move(pool));
+            }
+            pool = nullptr;
+        }
+        publish(std::move(next));
+    }
+    for (auto &pool : pools) {
+        retire(*pool);
+    }
     std::cout << "All services unregistered" << std::endl;
 }
 
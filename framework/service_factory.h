@@ -1,22 +1,88 @@
 #pragma once
 #include "service_interface.h"
+#include "static_service_registry.h"
+#include <atomic>
+#include <cstdint>
+#include <deque>
 #include <functional>
+#include <memory_resource>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
 namespace ServiceFramework {
 
+/**
+ * @brief Interned service type name, from ServiceFactory::typeId()
+ *
+ * Resolving a name once and creating by ID skips hashing the name on every
+ * creation. IDs stay valid for the life of the process, across unregister
+ * and re-register; a default-constructed ID refers to no type.
+ */
+class ServiceTypeId {
+  public:
+    ServiceTypeId() = default;
+
+    bool valid() const { return m_index != INVALID; }
+    uint32_t index() const { return m_index; }
+
+    bool operator==(ServiceTypeId other) const {
+        return m_index == other.m_index;
+    }
+    bool operator!=(ServiceTypeId other) const {
+        return m_index != other.m_index;
+    }
+
+  private:
+    friend class ServiceFactory;
+    static const uint32_t INVALID = UINT32_MAX;
+
+    explicit ServiceTypeId(uint32_t index) : m_index(index) {}
+
+    uint32_t m_index = INVALID;
+};
+
+/**
+ * @brief Instance pool settings for one service type
+ */
+struct ServicePoolOptions {
+    size_t warmInstances = 0; // created and initialized ahead of demand
+    size_t maxIdle = 16;      // recycled instances kept, at least warmInstances
+};
+
 /**
  * @brief Factory class for creating services using the factory pattern
  *
  * This class manages service creation through registered factory functions.
  * Services can be registered at runtime and created by name.
+ *
+ * Thread-safe. Lookups read an immutable snapshot of the registry that
+ * each thread caches, checking it against an atomic generation counter:
+ * without a lock or a shared reference count write, unless a writer has
+ * published since the thread's last lookup. Writers are serialized and
+ * publish a modified copy. A replaced snapshot is freed once every thread
+ * that cached it has looked up again or exited.
+ * Names are looked up as std::string_view, so callers passing literals do
+ * not allocate; hot paths can go further and create by ServiceTypeId.
+ *
+ * Binaries that know their service types at compile time should list them
+ * with makeStaticServices() and addStaticServices() instead of registering
+ * from static constructors; runtime registration extends that set.
+ *
+ * Types with churning instances can get a pool (setServicePool()) of
+ * initialized instances: ServiceManager takes from it when adding a service
+ * and gives removed instances back after IService::reset().
  */
 class ServiceFactory {
   public:
     using ServiceCreator = std::function<ServicePtr()>;
+    // Gets the arena the instance is being created in (or the default
+    // resource) for services that take an allocator in their constructor
+    using ArenaServiceCreator =
+        std::function<ServicePtr(std::pmr::memory_resource *)>;
 
     /**
      * @brief Get the singleton instance of the factory
@@ -30,22 +96,114 @@ class ServiceFactory {
      * @param creator Function that creates the service instance
      * @return true if registration successful, false if service already exists
      */
-    bool registerService(const std::string &serviceName,
-                         ServiceCreator creator);
+    bool registerService(std::string_view serviceName, ServiceCreator creator);
+    bool registerService(std::string_view serviceName,
+                         ArenaServiceCreator creator);
+
+    /**
+     * @brief Add compiled-in service types (see makeStaticServices())
+     * @param services Table with static storage duration, normally constexpr
+     * @return false, adding none, if one of the names is already registered
+     */
+    template <size_t N>
+    bool addStaticServices(const StaticServiceTable<N> &services) {
+        return addStaticServices(services.view());
+    }
+    bool addStaticServices(const StaticServiceView &services);
+
+    /**
+     * @brief Register the service types of every plugin manifest
+     *        ("*.plugin", see service_plugin.h) in a directory
+     * @param directory Directory to scan, not recursively
+     * @return Number of service types registered
+     *
+     * Only the manifests are read here. A plugin's shared object is opened
+     * when one of its types is first created and stays loaded.
+     */
+    size_t loadPlugins(const std::string &directory);
+
+    /**
+     * @brief Intern a service type name
+     * @param serviceName Name of the service type, registered or not yet
+     * @return Stable ID for the name; invalid if the name is empty
+     */
+    ServiceTypeId typeId(std::string_view serviceName);
+
+    /**
+     * @brief Name an ID was interned from (empty for an invalid ID)
+     */
+    std::string_view typeName(ServiceTypeId type) const;
 
     /**
      * @brief Create a service instance by name
      * @param serviceName Name of the service type to create
      * @return Unique pointer to the created service, nullptr if not found
      */
-    ServicePtr createService(const std::string &serviceName);
+    ServicePtr createService(std::string_view serviceName);
+
+    /**
+     * @brief Create a service instance by interned type, without hashing
+     * @return Unique pointer to the created service, nullptr if the type is
+     *         not registered
+     */
+    ServicePtr createService(ServiceTypeId type);
+
+    /**
+     * @brief Create a service instance inside an arena
+     * @param arena Resource the object and its memoryResource() containers
+     *        allocate from, through a per-instance ServiceMemoryAccount;
+     *        nullptr creates on the global heap
+     */
+    ServicePtr createService(std::string_view serviceName,
+                             std::pmr::memory_resource *arena);
+    ServicePtr createService(ServiceTypeId type,
+                             std::pmr::memory_resource *arena);
 
     /**
      * @brief Check if a service type is registered
      * @param serviceName Name of the service type
      * @return true if registered, false otherwise
      */
-    bool isServiceRegistered(const std::string &serviceName) const;
+    bool isServiceRegistered(std::string_view serviceName) const;
+    bool isServiceRegistered(ServiceTypeId type) const;
+
+    /**
+     * @brief Keep a pool of ready instances for a registered type
+     * @param serviceName Name of the service type
+     * @param options Pool sizes; warm instances are created here
+     * @return false if the type is not registered or a warm instance
+     *         failed to initialize
+     */
+    bool setServicePool(std::string_view serviceName,
+                        const ServicePoolOptions &options);
+
+    /**
+     * @brief Top the pool back up to its warm count
+     *
+     * Constructs and initializes instances, so call it off the path that
+     * needs them, e.g. from a background thread after a scale-up.
+     */
+    bool warmServicePool(std::string_view serviceName);
+
+    /**
+     * @brief Take an initialized instance from the type's pool
+     * @return nullptr if the type has no pool or the pool is empty
+     */
+    ServicePtr acquirePooledService(std::string_view serviceName);
+    ServicePtr acquirePooledService(ServiceTypeId type);
+
+    /**
+     * @brief Give back a stopped instance of an interned type
+     *
+     * The instance is reset() and kept if the type has a pool with room;
+     * otherwise it is destroyed.
+     */
+    void recycleService(ServiceTypeId type, ServicePtr service);
+
+    /**
+     * @brief Ready instances in the type's pool
+     */
+    size_t pooledServiceCount(std::string_view serviceName) const;
 
     /**
      * @brief Get list of all registered service names
@@ -56,24 +214,86 @@ class ServiceFactory {
     /**
      * @brief Unregister a service type
      * @param serviceName Name of the service type to unregister
-     * @return true if unregistered, false if not found
+     * @return true if unregistered, false if not found or compiled in
+     *
+     * Idle instances in the type's pool are destroyed.
      */
-    bool unregisterService(const std::string &serviceName);
+    bool unregisterService(std::string_view serviceName);
 
     /**
-     * @brief Clear all registered services
+     * @brief Clear all registered services, compiled-in ones included
      */
     void clear();
 
   private:
-    ServiceFactory() = default;
-    ~ServiceFactory() = default;
+    struct ServicePool {
+        std::mutex mutex;
+        ServicePoolOptions options;
+        std::vector<ServicePtr> idle;
+        bool retired = false; // type unregistered, instances are not kept
+    };
+
+    struct Registry {
+        std::unordered_map<std::string_view, uint32_t> ids; // every interned name
+        std::vector<std::string_view> names;                 // by ID
+        std::vector<ServiceCreator> creators; // by ID, empty when unregistered
+        std::vector<StaticServiceView> statics; // searched before ids
+        std::vector<std::shared_ptr<ServicePool>> pools; // by ID, may be null
+    };
+
+    ServiceFactory();
+    ~ServiceFactory();
 
     // Prevent copying
     ServiceFactory(const ServiceFactory &) = delete;
     ServiceFactory &operator=(const ServiceFactory &) = delete;
 
-    std::unordered_map<std::string, ServiceCreator> m_serviceCreators;
+    // The calling thread's cached snapshot, refreshed on the outermost
+    // lookup once a writer has published; nested lookups (from a creator,
+    // say) keep the snapshot the outer one holds
+    class Reader {
+      public:
+        explicit Reader(const ServiceFactory &factory);
+        ~Reader();
+
+        Reader(const Reader &) = delete;
+        Reader &operator=(const Reader &) = delete;
+
+        const Registry &operator*() const { return *m_registry; }
+        const Registry *operator->() const { return m_registry; }
+
+      private:
+        const Registry *m_registry;
+    };
+
+    struct ReaderCache {
+        std::shared_ptr<const Registry> registry;
+        uint64_t generation = 0;
+        int depth = 0; // Readers alive on the thread
+    };
+    static ReaderCache &readerCache(); // thread_local
+
+    // The published registry, stable while m_writeMutex is held
+    const Registry &current() const { return *m_registry; }
+
+    // Both with m_writeMutex held: adds name to next if new and returns its
+    // ID, and swaps in next as the current registry
+    uint32_t intern(Registry &next, std::string_view name);
+    void publish(std::unique_ptr<Registry> next);
+
+    std::shared_ptr<ServicePool> findPool(std::string_view name) const;
+    static void retire(ServicePool &pool);
+    bool warm(std::string_view serviceName, ServicePool &pool);
+    static const StaticServiceEntry *findStatic(const Registry &registry,
+                                                std::string_view name);
+    template <typename Creator>
+    static ServicePtr create(std::string_view serviceName,
+                             const Creator &creator);
+
+    std::shared_ptr<const Registry> m_registry; // atomic_load/atomic_store
+    std::atomic<uint64_t> m_generation{0};      // bumped after each publish
+    std::mutex m_writeMutex;
+    std::deque<std::string> m_names; // interned names, never moved or freed
 };
 
 // Macro to simplify service registration
@@ -1,5 +1,10 @@
 #pragma once
+#include "service_memory.h"
+#include "thread_placement.h"
+#include <cstddef>
 #include <memory>
+#include <memory_resource>
+#include <new>
 #include <string>
 
 namespace ServiceFramework {
@@ -9,9 +14,14 @@ namespace ServiceFramework {
  *
  * All services must inherit from this interface to be managed
  * by the service factory and framework.
+ *
+ * Service objects are allocated from the arena they are created in, if any
+ * (ServiceFactory::createService(name, arena)); services that build their
+ * containers on memoryResource() keep those there too.
  */
 class IService {
   public:
+    IService() : m_memory(ServiceMemory::current()) {}
     virtual ~IService() = default;
 
     /**
@@ -48,6 +58,67 @@ class IService {
      * @return true if running, false otherwise
      */
     virtual bool isRunning() const = 0;
+
+    /**
+     * @brief Set where the service's threads run (call before start())
+     * @param policy CPU sets and NUMA node per thread role
+     * @return false if the policy was not taken, e.g. because the threads
+     *         it would place already run
+     *
+     * Services that spawn no threads keep this default, which ignores it.
+     */
+    virtual bool setThreadPlacement(const ThreadPlacementPolicy &policy) {
+        (void)policy;
+        return true;
+    }
+
+    /**
+     * @brief Recycle a stopped service for reuse from a pool
+     * @return true if the service is back in its state right after
+     *         initialize(); false (the default) if it cannot be reused and
+     *         should be destroyed
+     *
+     * See ServiceFactory::setServicePool().
+     */
+    virtual bool reset() { return false; }
+
+    /**
+     * @brief Resource for the service's own containers: its arena account,
+     *        or the default resource outside an arena
+     */
+    std::pmr::memory_resource *memoryResource() const {
+        return m_memory ? m_memory.get() : std::pmr::get_default_resource();
+    }
+
+    /**
+     * @brief Bytes the service holds in its arena; null outside an arena
+     */
+    const std::shared_ptr<ServiceMemoryAccount> &memoryAccount() const {
+        return m_memory;
+    }
+
+    static void *operator new(std::size_t size) {
+        return ServiceMemory::allocate(size, alignof(std::max_align_t));
+    }
+    static void *operator new(std::size_t size, std::align_val_t alignment) {
+        return ServiceMemory::allocate(size, static_cast<size_t>(alignment));
+    }
+    static void operator delete(void *p, std::size_t size) {
+        ServiceMemory::deallocate(p, size, alignof(std::max_align_t));
+    }
+    static void operator delete(void *p, std::size_t size,
+                                std::align_val_t alignment) {
+        ServiceMemory::deallocate(p, size, static_cast<size_t>(alignment));
+    }
+
+    // The operators above hide the global placement forms
+    static void *operator new(std::size_t, void *where) noexcept {
+        return where;
+    }
+    static void operator delete(void *, void *) noexcept {}
+
+  private:
+    std::shared_ptr<ServiceMemoryAccount> m_memory;
 };
 
 using ServicePtr = std::unique_ptr<IService>;
@@ -6,21 +6,49 @@ namespace ServiceFramework {
 
 ServiceManager::~ServiceManager() { clear(); }
 
-bool ServiceManager::addService(const std::string &serviceName,
+bool ServiceManager::addService(std::string_view serviceName,
                                 const std::string &instanceName) {
-    auto service = ServiceFactory::getInstance().createService(serviceName);
-    if (!service) {
+    auto &factory = ServiceFactory::getInstance();
+    if (!factory.isServiceRegistered(serviceName)) {
         std::cerr << "Failed to create service: " << serviceName << std::endl;
         return false;
     }
+    return addService(factory.typeId(serviceName), instanceName);
+}
 
+bool ServiceManager::addService(ServiceTypeId type,
+                                const std::string &instanceName) {
+    auto &factory = ServiceFactory::getInstance();
     std::string actualInstanceName =
-        instanceName.empty() ? serviceName : instanceName;
-    return addService(std::move(service), actualInstanceName);
+        instanceName.empty() ? std::string(factory.typeName(type))
+                             : instanceName;
+
+    // A pooled instance is already initialized
+    if (!m_memoryResource) {
+        if (auto service = factory.acquirePooledService(type)) {
+            return insertService(std::move(service), actualInstanceName, type,
+                                 true);
+        }
+    }
+
+    auto service = factory.createService(type, m_memoryResource);
+    if (!service) {
+        std::cerr << "Failed to create service: " << factory.typeName(type)
+                  << std::endl;
+        return false;
+    }
+    return insertService(std::move(service), actualInstanceName, type, false);
 }
 
 bool ServiceManager::addService(ServicePtr service,
                                 const std::string &instanceName) {
+    return insertService(std::move(service), instanceName, ServiceTypeId(),
+                         false);
+}
+
+bool ServiceManager::insertService(ServicePtr service,
+                                   const std::string &instanceName,
+                                   ServiceTypeId type, bool initialized) {
     if (!service || instanceName.empty()) {
         std::cerr << "Invalid service or instance name" << std::endl;
         return false;
@@ -32,9 +60,12 @@ bool ServiceManager::addService(ServicePtr service,
         return false;
     }
 
-    auto serviceInfo = std::make_unique<ServiceInfo>();
+    auto serviceInfo = std::make_shared<ServiceInfo>();
     serviceInfo->service = std::move(service);
     serviceInfo->instanceName = instanceName;
+    serviceInfo->type = type;
+    serviceInfo->initialized = initialized;
+    serviceInfo->sharedOwner = std::make_shared<ServicePtr>();
 
     m_services[instanceName] = std::move(serviceInfo);
     m_serviceOrder.push_back(instanceName);
@@ -50,10 +81,7 @@ bool ServiceManager::removeService(const std::string &instanceName) {
         return false;
     }
 
-    // Stop the service if it's running
-    if (it->second->started) {
-        it->second->service->stop();
-    }
+    release(*it->second);
 
     // Remove from order vector
     auto orderIt =
@@ -73,6 +101,24 @@ IService *ServiceManager::getService(const std::string &instanceName) const {
     return (it != m_services.end()) ? it->second->service.get() : nullptr;
 }
 
+bool ServiceManager::setThreadPlacement(const std::string &instanceName,
+                                        const ThreadPlacementPolicy &policy) {
+    IService *service = getService(instanceName);
+    if (!service) {
+        return false;
+    }
+
+    return service->setThreadPlacement(policy);
+}
+
+size_t ServiceManager::getServiceMemory(const std::string &instanceName) const {
+    IService *service = getService(instanceName);
+    if (!service || !service->memoryAccount()) {
+        return 0;
+    }
+    return service->memoryAccount()->bytesInUse();
+}
+
 bool ServiceManager::initializeAll() {
     std::cout << "Initializing all services..." << std::endl;
 
@@ -174,8 +220,33 @@ bool ServiceManager::hasService(const std::string &instanceName) const {
     return m_services.find(instanceName) != m_services.end();
 }
 
+void ServiceManager::release(ServiceInfo &serviceInfo) {
+    // Stop the service if it's running
+    if (serviceInfo.started) {
+        serviceInfo.service->stop();
+        serviceInfo.started = false;
+    }
+
+    // Still referenced from getSharedServices(): destroyed with the last
+    // reference rather than pooled
+    if (serviceInfo.sharedOwner.use_count() > 1) {
+        *serviceInfo.sharedOwner = std::move(serviceInfo.service);
+        return;
+    }
+
+    // Hand initialized heap instances back to their type's pool, if any
+    if (serviceInfo.type.valid() && serviceInfo.initialized &&
+        !serviceInfo.service->memoryAccount()) {
+        ServiceFactory::getInstance().recycleService(
+            serviceInfo.type, std::move(serviceInfo.service));
+    }
+}
+
 void ServiceManager::clear() {
     stopAll();
+    for (auto &pair : m_services) {
+        release(*pair.second);
+    }
     m_services.clear();
     m_serviceOrder.clear();
     std::cout << "All services cleared" << std::endl;
@@ -189,4 +260,15 @@ std::unordered_map<std::string, IService*> ServiceManager::getAllServices() cons
     return result;
 }
 
+std::unordered_map<std::string, std::shared_ptr<IService>>
+ServiceManager::getSharedServices() const {
+    std::unordered_map<std::string, std::shared_ptr<IService>> result;
+    for (const auto &pair : m_services) {
+        const ServiceInfo &serviceInfo = *pair.second;
+        result[pair.first] = std::shared_ptr<IService>(
+            serviceInfo.sharedOwner, serviceInfo.service.get());
+    }
+    return result;
+}
+
 } // namespace ServiceFramework
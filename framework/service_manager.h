@@ -2,17 +2,58 @@
 #include "service_factory.h"
 #include "service_interface.h"
 #include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
 namespace ServiceFramework {
 
+/**
+ * @brief Typed reference to a managed service instance, resolved once
+ *
+ * Obtained from ServiceManager::getServiceHandle(). Checking it costs one
+ * atomic load: once the instance is removed (or its manager cleared or
+ * destroyed) get() returns nullptr and stale() is true, also if another
+ * instance is later added under the same name; resolve a new handle then.
+ * The handle does not keep the instance alive, so it must not be used
+ * while another thread removes the service.
+ */
+template <typename T> class ServiceHandle {
+  public:
+    ServiceHandle() = default;
+
+    T *get() const { return m_owner.expired() ? nullptr : m_service; }
+    T *operator->() const { return get(); }
+    explicit operator bool() const { return get() != nullptr; }
+
+    /**
+     * @brief True if the handle resolved to an instance that is now gone
+     */
+    bool stale() const { return m_service && m_owner.expired(); }
+
+  private:
+    friend class ServiceManager;
+
+    ServiceHandle(std::weak_ptr<void> owner, T *service)
+        : m_owner(std::move(owner)), m_service(service) {}
+
+    std::weak_ptr<void> m_owner;
+    T *m_service = nullptr;
+};
+
 /**
  * @brief Manager class for handling multiple services
  *
  * This class provides lifecycle management for multiple services,
  * including initialization, starting, stopping, and cleanup.
+ *
+ * Services created from a type with a pool (ServiceFactory::setServicePool())
+ * are taken from it already initialized, and go back to it when removed.
+ * A manager with its own arena (setMemoryResource()) creates every instance
+ * there instead and does not use pools.
  */
 class ServiceManager {
   public:
@@ -29,9 +70,17 @@ class ServiceManager {
      * @param instanceName Optional instance name (defaults to service name)
      * @return true if service added successfully, false otherwise
      */
-    bool addService(const std::string &serviceName,
+    bool addService(std::string_view serviceName,
                     const std::string &instanceName = "");
 
+    /**
+     * @brief Add a service of an interned type (see ServiceFactory::typeId())
+     * @param type Service type to create
+     * @param instanceName Optional instance name (defaults to the type name)
+     * @return true if service added successfully, false otherwise
+     */
+    bool addService(ServiceTypeId type, const std::string &instanceName = "");
+
     /**
      * @brief Add an existing service instance
      * @param service Service instance to add
@@ -44,6 +93,8 @@ class ServiceManager {
      * @brief Remove a service by instance name
      * @param instanceName Name of the service instance to remove
      * @return true if service removed, false if not found
+     *
+     * An initialized instance of a pooled type is stopped and recycled.
      */
     bool removeService(const std::string &instanceName);
 
@@ -54,6 +105,64 @@ class ServiceManager {
      */
     IService *getService(const std::string &instanceName) const;
 
+    /**
+     * @brief Get a service by instance name as its concrete type
+     * @return Pointer to the service, nullptr if not found or not a T
+     *
+     * Each call hashes the name and runs dynamic_cast; code that uses a
+     * service repeatedly should hold a getServiceHandle() instead.
+     */
+    template <typename T> T *getService(const std::string &instanceName) const {
+        static_assert(std::is_base_of<IService, T>::value,
+                      "services derive from IService");
+        return dynamic_cast<T *>(getService(instanceName));
+    }
+
+    /**
+     * @brief Resolve a service once for repeated typed access
+     * @return Handle to the service; empty if not found or not a T
+     *
+     * The name lookup and type check happen here only, so using the handle
+     * from many threads only reads the instance's shared reference count.
+     */
+    template <typename T>
+    ServiceHandle<T> getServiceHandle(const std::string &instanceName) const {
+        static_assert(std::is_base_of<IService, T>::value,
+                      "services derive from IService");
+        auto it = m_services.find(instanceName);
+        if (it == m_services.end()) {
+            return ServiceHandle<T>();
+        }
+        T *service = dynamic_cast<T *>(it->second->service.get());
+        return service ? ServiceHandle<T>(it->second, service)
+                       : ServiceHandle<T>();
+    }
+
+    /**
+     * @brief Place a service instance's threads (before startAll())
+     * @param instanceName Name of the service instance
+     * @param policy CPU sets and NUMA node per thread role
+     * @return true if the instance exists and took the policy
+     */
+    bool setThreadPlacement(const std::string &instanceName,
+                            const ThreadPlacementPolicy &policy);
+
+    /**
+     * @brief Create services added from now on inside an arena
+     * @param arena Resource shared by this manager's instances, e.g. a
+     *        std::pmr::synchronized_pool_resource per NUMA node; it must
+     *        outlive them. nullptr returns to the global heap.
+     */
+    void setMemoryResource(std::pmr::memory_resource *arena) {
+        m_memoryResource = arena;
+    }
+
+    /**
+     * @brief Bytes a service instance holds in its arena
+     * @return 0 if not found or not created in an arena
+     */
+    size_t getServiceMemory(const std::string &instanceName) const;
+
     /**
      * @brief Initialize all services
      * @return true if all services initialized successfully, false otherwise
@@ -101,16 +210,39 @@ class ServiceManager {
      */
     std::unordered_map<std::string, IService*> getAllServices() const;
 
+    /**
+     * @brief Get all services as references that keep each instance alive
+     * @return Map of instance names to shared service references
+     *
+     * For work that may outlive the caller's hold on the manager, such as
+     * probes on other threads. An instance removed while still referenced
+     * is stopped but not returned to its pool; it is destroyed when the
+     * last reference is dropped.
+     */
+    std::unordered_map<std::string, std::shared_ptr<IService>>
+    getSharedServices() const;
+
   private:
     struct ServiceInfo {
         ServicePtr service;
         std::string instanceName;
+        ServiceTypeId type; // set when created from the factory
         bool initialized = false;
         bool started = false;
+        // Behind getSharedServices() references; takes the instance over
+        // if it is removed while they are held. Set on insertion, so that
+        // getSharedServices() only reads.
+        std::shared_ptr<ServicePtr> sharedOwner;
     };
 
-    std::unordered_map<std::string, std::unique_ptr<ServiceInfo>> m_services;
+    bool insertService(ServicePtr service, const std::string &instanceName,
+                       ServiceTypeId type, bool initialized);
+    void release(ServiceInfo &serviceInfo);
+
+    // Shared so that handles can tell when an instance is gone
+    std::unordered_map<std::string, std::shared_ptr<ServiceInfo>> m_services;
     std::vector<std::string> m_serviceOrder; // Maintains insertion order
+    std::pmr::memory_resource *m_memoryResource = nullptr;
 };
 
 } // namespace ServiceFramework
@@ -0,0 +1,101 @@
+#include "service_memory.h"
+#include <mutex>
+#include <new>
+#include <unordered_map>
+
+namespace ServiceFramework {
+
+void *ServiceMemoryAccount::do_allocate(size_t bytes, size_t alignment) {
+    void *p = m_arena->allocate(bytes, alignment);
+    size_t inUse = m_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    size_t peak = m_peak.load(std::memory_order_relaxed);
+    while (inUse > peak &&
+           !m_peak.compare_exchange_weak(peak, inUse,
+                                         std::memory_order_relaxed)) {
+    }
+    return p;
+}
+
+void ServiceMemoryAccount::do_deallocate(void *p, size_t bytes,
+                                         size_t alignment) {
+    m_arena->deallocate(p, bytes, alignment);
+    m_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+namespace ServiceMemory {
+
+namespace {
+
+thread_local std::shared_ptr<ServiceMemoryAccount> t_current;
+
+// Service objects allocated in an arena, with the account that owns each.
+// Heap-allocated services are not listed, so deleting one costs a single
+// load of the count.
+struct ArenaObjects {
+    std::mutex mutex;
+    std::unordered_map<void *, std::shared_ptr<ServiceMemoryAccount>> owners;
+};
+
+std::atomic<size_t> g_arenaObjectCount{0};
+
+ArenaObjects &arenaObjects() {
+    // Never destroyed, services may be deleted during static destruction
+    static ArenaObjects *objects = new ArenaObjects;
+    return *objects;
+}
+
+bool overAligned(size_t alignment) {
+    return alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+}
+
+} // namespace
+
+std::shared_ptr<ServiceMemoryAccount> current() { return t_current; }
+
+Scope::Scope(std::shared_ptr<ServiceMemoryAccount> account)
+    : m_previous(std::move(t_current)) {
+    t_current = std::move(account);
+}
+
+Scope::~Scope() { t_current = std::move(m_previous); }
+
+void *allocate(size_t size, size_t alignment) {
+    if (!t_current) {
+        return overAligned(alignment)
+                   ? ::operator new(size, std::align_val_t(alignment))
+                   : ::operator new(size);
+    }
+
+    void *object = t_current->allocate(size, alignment);
+    ArenaObjects &objects = arenaObjects();
+    std::lock_guard<std::mutex> lock(objects.mutex);
+    objects.owners.emplace(object, t_current);
+    g_arenaObjectCount.fetch_add(1, std::memory_order_relaxed);
+    return object;
+}
+
+void deallocate(void *p, size_t size, size_t alignment) noexcept {
+    std::shared_ptr<ServiceMemoryAccount> account;
+    if (g_arenaObjectCount.load(std::memory_order_relaxed) != 0) {
+        ArenaObjects &objects = arenaObjects();
+        std::lock_guard<std::mutex> lock(objects.mutex);
+        auto it = objects.owners.find(p);
+        if (it != objects.owners.end()) {
+            account = std::move(it->second);
+            objects.owners.erase(it);
+            g_arenaObjectCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    if (account) {
+        account->deallocate(p, size, alignment);
+    } else if (overAligned(alignment)) {
+        ::operator delete(p, size, std::align_val_t(alignment));
+    } else {
+        ::operator delete(p, size);
+    }
+}
+
+} // namespace ServiceMemory
+
+} // namespace ServiceFramework
@@ -0,0 +1,74 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+namespace ServiceFramework {
+
+/**
+ * @brief Memory resource that counts what one service instance allocates
+ *
+ * Wraps an arena, any std::pmr::memory_resource such as one pool per
+ * ServiceManager or per NUMA node. A service created in an arena (see
+ * ServiceFactory::createService()) gets its own account: the service object
+ * and every container built on IService::memoryResource() allocate through
+ * it. The arena must outlive the instance and be thread-safe if the
+ * service allocates from several threads (std::pmr::synchronized_pool_resource
+ * is; std::pmr::monotonic_buffer_resource is not).
+ */
+class ServiceMemoryAccount : public std::pmr::memory_resource {
+  public:
+    explicit ServiceMemoryAccount(std::pmr::memory_resource *arena)
+        : m_arena(arena) {}
+
+    size_t bytesInUse() const {
+        return m_bytes.load(std::memory_order_relaxed);
+    }
+    size_t peakBytes() const { return m_peak.load(std::memory_order_relaxed); }
+    std::pmr::memory_resource *arena() const { return m_arena; }
+
+  private:
+    void *do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource &other) const
+        noexcept override {
+        return this == &other;
+    }
+
+    std::pmr::memory_resource *m_arena;
+    std::atomic<size_t> m_bytes{0};
+    std::atomic<size_t> m_peak{0};
+};
+
+namespace ServiceMemory {
+
+/**
+ * @brief Account services constructed on this thread allocate from, if any
+ */
+std::shared_ptr<ServiceMemoryAccount> current();
+
+/**
+ * @brief Makes account current on this thread for its lifetime
+ */
+class Scope {
+  public:
+    explicit Scope(std::shared_ptr<ServiceMemoryAccount> account);
+    ~Scope();
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+  private:
+    std::shared_ptr<ServiceMemoryAccount> m_previous;
+};
+
+// Storage for service objects (IService::operator new/delete): from the
+// current account, which is remembered per object, or else the global heap
+// with no overhead
+void *allocate(size_t size, size_t alignment);
+void deallocate(void *p, size_t size, size_t alignment) noexcept;
+
+} // namespace ServiceMemory
+
+} // namespace ServiceFramework
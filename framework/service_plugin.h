@@ -0,0 +1,34 @@
+#pragma once
+#include "service_interface.h"
+#include "static_service_registry.h"
+
+/**
+ * Service plugins are shared objects that export the service types listed
+ * in SERVICE_PLUGIN(). Each is described by a manifest, a "<name>.plugin"
+ * text file that ServiceFactory::loadPlugins() reads:
+ *
+ *   # Types are registered from here; the library is only opened when
+ *   # one of them is first created
+ *   library = libweather_plugin.so      (relative to the manifest)
+ *   service = WeatherService
+ *   service = ForecastService
+ *
+ * Plugins resolve framework symbols from the host, so hosts are linked with
+ * -rdynamic (CMake: ENABLE_EXPORTS) and plugins are built as modules that
+ * do not link the framework library themselves.
+ */
+
+// Symbol a plugin exports to create its services
+#define SERVICE_PLUGIN_ENTRY_POINT "serviceFrameworkCreateService"
+
+// Define the plugin's entry point for the listed types, each naming itself
+// with SERVICE_TYPE as for makeStaticServices()
+#define SERVICE_PLUGIN(...)                                                    \
+    extern "C" ServiceFramework::IService *serviceFrameworkCreateService(      \
+        const char *serviceType) {                                             \
+        static constexpr auto services =                                       \
+            ServiceFramework::makeStaticServices<__VA_ARGS__>();               \
+        const ServiceFramework::StaticServiceEntry *entry =                    \
+            services.view().find(serviceType);                                 \
+        return entry ? entry->create().release() : nullptr;                    \
+    }
@@ -0,0 +1,164 @@
+#pragma once
+#include "service_interface.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+
+namespace ServiceFramework {
+
+/**
+ * @brief One compiled-in service type
+ */
+struct StaticServiceEntry {
+    std::string_view name;
+    ServicePtr (*create)() = nullptr;
+};
+
+/**
+ * @brief Type-erased view of a StaticServiceTable, as kept by ServiceFactory
+ */
+class StaticServiceView {
+  public:
+    constexpr StaticServiceView(const StaticServiceEntry *entries, size_t size,
+                                const int16_t *slots, size_t slotCount,
+                                uint32_t seed)
+        : m_entries(entries), m_size(size), m_slots(slots),
+          m_slotMask(slotCount - 1), m_seed(seed) {}
+
+    size_t size() const { return m_size; }
+    const StaticServiceEntry &entry(size_t index) const {
+        return m_entries[index];
+    }
+
+    /**
+     * @brief Entry for a type name, or nullptr: one hash, one comparison
+     */
+    const StaticServiceEntry *find(std::string_view name) const {
+        int index = m_slots[hash(m_seed, name) & m_slotMask];
+        if (index >= 0 && m_entries[index].name == name) {
+            return &m_entries[index];
+        }
+        return nullptr;
+    }
+
+    // FNV-1a over the name
+    static constexpr uint32_t hash(uint32_t seed, std::string_view name) {
+        uint32_t value = 2166136261u ^ (seed * 0x9e3779b9u);
+        for (char c : name) {
+            value = (value ^ static_cast<uint8_t>(c)) * 16777619u;
+        }
+        return value ^ (value >> 15);
+    }
+
+  private:
+    const StaticServiceEntry *m_entries;
+    size_t m_size;
+    const int16_t *m_slots;
+    size_t m_slotMask;
+    uint32_t m_seed;
+};
+
+/**
+ * @brief Service types known at compile time, sorted by name and placed in
+ *        a perfect hash
+ *
+ * Built by makeStaticServices() as a constexpr object, so it is constant
+ * initialized: no static constructors run and nothing is hashed or printed
+ * at startup. Hand it to ServiceFactory::addStaticServices() from main();
+ * runtime registerService() calls then extend it. Duplicate names fail to
+ * compile.
+ */
+template <size_t N>
+class StaticServiceTable {
+  public:
+    static_assert(N > 0 && N < 0x7fff, "service table size out of range");
+
+    constexpr explicit StaticServiceTable(
+        const StaticServiceEntry (&entries)[N])
+        : m_entries{}, m_slots{}, m_seed(0) {
+        // Insertion sort by name, so listing needs no sorting at runtime
+        for (size_t i = 0; i < N; ++i) {
+            size_t j = i;
+            while (j > 0 && entries[i].name < m_entries[j - 1].name) {
+                m_entries[j] = m_entries[j - 1];
+                --j;
+            }
+            if (j > 0 && m_entries[j - 1].name == entries[i].name) {
+                throw std::logic_error("duplicate static service");
+            }
+            m_entries[j] = entries[i];
+        }
+
+        // Smallest seed under which no two names share a slot
+        for (uint32_t seed = 1;; ++seed) {
+            if (seed > 100000) {
+                throw std::logic_error("no perfect hash for static services");
+            }
+            for (size_t slot = 0; slot < SLOTS; ++slot) {
+                m_slots[slot] = -1;
+            }
+            bool collision = false;
+            for (size_t i = 0; i < N && !collision; ++i) {
+                size_t slot = StaticServiceView::hash(seed, m_entries[i].name) &
+                              (SLOTS - 1);
+                collision = m_slots[slot] >= 0;
+                m_slots[slot] = static_cast<int16_t>(i);
+            }
+            if (!collision) {
+                m_seed = seed;
+                break;
+            }
+        }
+    }
+
+    static constexpr size_t size() { return N; }
+
+    constexpr const StaticServiceEntry &entry(size_t index) const {
+        return m_entries[index];
+    }
+
+    /**
+     * @brief View for ServiceFactory; the table must outlive it
+     */
+    constexpr StaticServiceView view() const {
+        return StaticServiceView(m_entries, N, m_slots, SLOTS, m_seed);
+    }
+
+  private:
+    // At least twice as many slots as names keeps the seed search short
+    static constexpr size_t slotCount() {
+        size_t slots = 4;
+        while (slots < 2 * N) {
+            slots *= 2;
+        }
+        return slots;
+    }
+    static constexpr size_t SLOTS = slotCount();
+
+    StaticServiceEntry m_entries[N];
+    int16_t m_slots[SLOTS];
+    uint32_t m_seed;
+};
+
+template <typename Service> ServicePtr createStaticService() {
+    return std::make_unique<Service>();
+}
+
+/**
+ * @brief Table of the listed service types, each naming itself with
+ *        `static constexpr std::string_view SERVICE_TYPE`
+ *
+ * @code
+ * constexpr auto SERVICES = makeStaticServices<LoggingService, CacheService>();
+ * @endcode
+ */
+template <typename... Services>
+constexpr StaticServiceTable<sizeof...(Services)> makeStaticServices() {
+    const StaticServiceEntry entries[] = {
+        {Services::SERVICE_TYPE, &createStaticService<Services>}...};
+    return StaticServiceTable<sizeof...(Services)>(entries);
+}
+
+} // namespace ServiceFramework
@@ -1,8 +1,18 @@
 #include "services/examples/example_services.h"
 #include "framework/service_factory.h"
 #include "framework/service_manager.h"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdio>
+#include <dlfcn.h>
+#include <fstream>
 #include <iostream>
+#include <memory_resource>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
 
 using namespace ServiceFramework;
 
@@ -174,8 +184,8 @@ bool testMultipleServiceInstances() {
     }
 
     // Get both instances
-    auto *cache1 = dynamic_cast<CacheService *>(manager.getService("cache1"));
-    auto *cache2 = dynamic_cast<CacheService *>(manager.getService("cache2"));
+    auto *cache1 = manager.getService<CacheService>("cache1");
+    auto *cache2 = manager.getService<CacheService>("cache2");
 
     if (!cache1 || !cache2) {
         return false;
@@ -254,6 +264,370 @@ bool testErrorHandling() {
     return true;
 }
 
+// Minimal service for registry tests
+class PluginService : public IService {
+  public:
+    bool initialize() override { return true; }
+    bool health() override { return true; }
+    bool start() override { return true; }
+    void stop() override {}
+    std::string getName() const override { return "PluginService"; }
+    bool isRunning() const override { return false; }
+};
+
+bool testConcurrentRegistry() {
+    auto &factory = ServiceFactory::getInstance();
+    factory.registerService("ConcurrentCache", []() -> ServicePtr {
+        return std::make_unique<PluginService>();
+    });
+
+    // Plugins come and go while other threads keep creating services
+    std::atomic<bool> done(false);
+    std::atomic<int> failures(0);
+    std::vector<std::thread> creators;
+    for (int t = 0; t < 4; ++t) {
+        creators.emplace_back([&] {
+            while (!done.load()) {
+                if (!factory.createService("ConcurrentCache")) {
+                    failures++;
+                }
+            }
+            // Each thread's cached snapshot catches up with the writes
+            if (factory.isServiceRegistered("ConcurrentPlugin49")) {
+                failures++;
+            }
+        });
+    }
+    for (int i = 0; i < 50; ++i) {
+        std::string name = "ConcurrentPlugin" + std::to_string(i);
+        if (!factory.registerService(name, []() -> ServicePtr {
+                return std::make_unique<PluginService>();
+            }) ||
+            !factory.createService(name) || !factory.unregisterService(name)) {
+            failures++;
+        }
+    }
+    done = true;
+    for (auto &creator : creators) {
+        creator.join();
+    }
+
+    // A creator may use the factory, even to unregister its own type, while
+    // the lookup that called it still reads the older snapshot
+    factory.registerService("SelfRemoving", [&factory]() -> ServicePtr {
+        factory.unregisterService("SelfRemoving");
+        return factory.createService("ConcurrentCache");
+    });
+    bool nested = factory.createService("SelfRemoving") &&
+                  !factory.isServiceRegistered("SelfRemoving");
+
+    bool unregistered = nested && factory.unregisterService("ConcurrentCache") &&
+                        !factory.isServiceRegistered("ConcurrentPlugin0");
+    return failures.load() == 0 && unregistered;
+}
+
+bool testServiceTypeIds() {
+    auto &factory = ServiceFactory::getInstance();
+
+    // IDs can be taken before registration and outlive it
+    ServiceTypeId type = factory.typeId("InternedPlugin");
+    if (!type.valid() || factory.isServiceRegistered(type) ||
+        factory.createService(type)) {
+        return false;
+    }
+    factory.registerService("InternedPlugin", []() -> ServicePtr {
+        return std::make_unique<PluginService>();
+    });
+
+    ServiceManager manager;
+    bool created = factory.typeId("InternedPlugin") == type &&
+                   factory.typeName(type) == "InternedPlugin" &&
+                   factory.isServiceRegistered(type) &&
+                   factory.createService(type) != nullptr &&
+                   manager.addService(type) &&
+                   manager.hasService("InternedPlugin");
+
+    factory.unregisterService("InternedPlugin");
+    return created && !factory.isServiceRegistered(type) &&
+           factory.typeId("InternedPlugin") == type &&
+           !factory.typeId("").valid() &&
+           !factory.createService(ServiceTypeId());
+}
+
+// Compiled-in types, listed out of order
+class ZebraPlugin : public PluginService {
+  public:
+    static constexpr std::string_view SERVICE_TYPE = "ZebraPlugin";
+};
+
+class AardvarkPlugin : public PluginService {
+  public:
+    static constexpr std::string_view SERVICE_TYPE = "AardvarkPlugin";
+};
+
+constexpr auto STATIC_PLUGINS =
+    makeStaticServices<ZebraPlugin, AardvarkPlugin>();
+static_assert(STATIC_PLUGINS.size() == 2 &&
+                  STATIC_PLUGINS.entry(0).name == "AardvarkPlugin" &&
+                  STATIC_PLUGINS.entry(1).name == "ZebraPlugin",
+              "static service table is sorted at compile time");
+
+bool testStaticRegistry() {
+    auto &factory = ServiceFactory::getInstance();
+    ServiceTypeId zebra = factory.typeId("ZebraPlugin"); // interned before
+    if (!factory.addStaticServices(STATIC_PLUGINS) ||
+        factory.addStaticServices(STATIC_PLUGINS)) {
+        return false;
+    }
+
+    auto services = factory.getRegisteredServices();
+    bool listed = std::count(services.begin(), services.end(),
+                             "ZebraPlugin") == 1 &&
+                  std::count(services.begin(), services.end(),
+                             "AardvarkPlugin") == 1;
+
+    // Runtime registration extends the table but cannot shadow it
+    return listed && factory.isServiceRegistered("AardvarkPlugin") &&
+           factory.createService("AardvarkPlugin") != nullptr &&
+           factory.createService(zebra) != nullptr &&
+           factory.createService(factory.typeId("AardvarkPlugin")) != nullptr &&
+           !factory.registerService("ZebraPlugin", []() -> ServicePtr {
+               return std::make_unique<PluginService>();
+           }) &&
+           !factory.unregisterService("ZebraPlugin") &&
+           !factory.isServiceRegistered("ZebraPlugin2");
+}
+
+// Counts setup work, to show pooled instances skip it
+class PooledService : public PluginService {
+  public:
+    PooledService() { ++s_constructed; }
+    ~PooledService() override { ++s_destroyed; }
+    bool initialize() override {
+        ++s_initialized;
+        return true;
+    }
+    bool reset() override {
+        ++s_reset;
+        return true;
+    }
+
+    static int s_constructed;
+    static int s_initialized;
+    static int s_reset;
+    static int s_destroyed;
+};
+
+int PooledService::s_constructed = 0;
+int PooledService::s_initialized = 0;
+int PooledService::s_reset = 0;
+int PooledService::s_destroyed = 0;
+
+bool testServicePools() {
+    auto &factory = ServiceFactory::getInstance();
+    factory.registerService("PooledService", []() -> ServicePtr {
+        return std::make_unique<PooledService>();
+    });
+    ServicePoolOptions options;
+    options.warmInstances = 2;
+    options.maxIdle = 3;
+    if (!factory.setServicePool("PooledService", options) ||
+        factory.pooledServiceCount("PooledService") != 2 ||
+        factory.setServicePool("NonExistentService", options)) {
+        return false;
+    }
+
+    // Scale-up takes warm instances without constructing or initializing
+    ServiceManager manager;
+    bool added = manager.addService("PooledService", "tenant1") &&
+                 manager.addService("PooledService", "tenant2") &&
+                 manager.initializeAll() && manager.startAll();
+    bool warmUsed = added && PooledService::s_constructed == 2 &&
+                    PooledService::s_initialized == 2 &&
+                    factory.pooledServiceCount("PooledService") == 0;
+
+    // An empty pool falls back to creating
+    bool fallback = manager.addService("PooledService", "tenant3") &&
+                    manager.initializeAll() &&
+                    PooledService::s_constructed == 3;
+
+    // Removed instances are reset and kept up to maxIdle
+    manager.removeService("tenant1");
+    manager.clear();
+    bool recycled = PooledService::s_reset == 3 &&
+                    factory.pooledServiceCount("PooledService") == 3 &&
+                    factory.warmServicePool("PooledService") &&
+                    PooledService::s_constructed == 3;
+
+    // Unregistering destroys the idle instances right away
+    factory.unregisterService("PooledService");
+    return warmUsed && fallback && recycled &&
+           PooledService::s_destroyed == 3 &&
+           factory.pooledServiceCount("PooledService") == 0;
+}
+
+// Takes its allocator from the creator
+class ArenaService : public PluginService {
+  public:
+    explicit ArenaService(std::pmr::memory_resource *arena) : m_data(arena) {
+        m_data.resize(1000);
+    }
+
+    std::pmr::memory_resource *dataResource() const {
+        return m_data.get_allocator().resource();
+    }
+
+  private:
+    std::pmr::vector<int> m_data;
+};
+
+bool testServiceArenas() {
+    auto &factory = ServiceFactory::getInstance();
+    factory.registerService(
+        "ArenaService", [](std::pmr::memory_resource *arena) -> ServicePtr {
+            return std::make_unique<ArenaService>(arena);
+        });
+
+    std::pmr::synchronized_pool_resource arena;
+    std::shared_ptr<ServiceMemoryAccount> account;
+    bool accounted = false;
+    {
+        ServiceManager manager;
+        manager.setMemoryResource(&arena);
+        if (!manager.addService("ArenaService", "tenant")) {
+            return false;
+        }
+
+        // The object and its vector are both charged to the instance
+        auto *service = manager.getService<ArenaService>("tenant");
+        account = service->memoryAccount();
+        accounted = account && account->arena() == &arena &&
+                    service->dataResource() == account.get() &&
+                    manager.getServiceMemory("tenant") >=
+                        sizeof(ArenaService) + 1000 * sizeof(int) &&
+                    manager.getServiceMemory("missing") == 0;
+    }
+
+    // Outside an arena nothing is accounted
+    auto heap = factory.createService("ArenaService");
+    bool heapOk = heap && !heap->memoryAccount() &&
+                  dynamic_cast<ArenaService *>(heap.get())->dataResource() ==
+                      std::pmr::get_default_resource();
+
+    // Placement new is not hidden by the class allocation functions
+    alignas(ArenaService) unsigned char storage[sizeof(ArenaService)];
+    auto *placed = new (storage) ArenaService(std::pmr::get_default_resource());
+    bool placedOk = !placed->memoryAccount();
+    placed->~ArenaService();
+
+    factory.unregisterService("ArenaService");
+    return accounted && account->bytesInUse() == 0 &&
+           account->peakBytes() >= 1000 * sizeof(int) && heapOk && placedOk;
+}
+
+class TypedService : public PluginService {
+  public:
+    int calls = 0;
+};
+
+bool testTypedLookup() {
+    ServiceManager manager;
+    manager.addService(std::make_unique<TypedService>(), "typed");
+    manager.addService(std::make_unique<PluginService>(), "plain");
+
+    // Lookups of different types on the same instance do not interfere
+    auto *typed = manager.getService<TypedService>("typed");
+    bool lookups = typed && manager.getService<TypedService>("typed") == typed &&
+                   manager.getService<IService>("typed") == typed &&
+                   manager.getService<TypedService>("typed") == typed &&
+                   !manager.getService<TypedService>("plain") &&
+                   !manager.getService<TypedService>("plain") &&
+                   !manager.getService<TypedService>("missing");
+
+    // Request handlers look services up from many threads at once
+    std::atomic<int> mismatches(0);
+    std::vector<std::thread> handlers;
+    for (int t = 0; t < 4; ++t) {
+        handlers.emplace_back([&manager, &mismatches, typed, t] {
+            auto own = manager.getServiceHandle<TypedService>("typed");
+            for (int i = 0; i < 1000; ++i) {
+                bool ok = (t % 2 ? manager.getService<IService>("typed")
+                                 : manager.getService<TypedService>("typed")) ==
+                              typed &&
+                          own.get() == typed;
+                mismatches += ok ? 0 : 1;
+            }
+        });
+    }
+    for (auto &handler : handlers) {
+        handler.join();
+    }
+    lookups = lookups && mismatches == 0;
+
+    auto handle = manager.getServiceHandle<TypedService>("typed");
+    handle->calls++;
+    bool resolved = handle && handle.get() == typed && typed->calls == 1 &&
+                    !handle.stale() &&
+                    !manager.getServiceHandle<TypedService>("plain") &&
+                    !manager.getServiceHandle<TypedService>("plain").stale();
+
+    // A new instance under the same name does not revive the handle
+    manager.removeService("typed");
+    manager.addService(std::make_unique<TypedService>(), "typed");
+    bool stale = !handle && handle.stale() && !handle.get();
+
+    // A shared reference keeps a removed instance alive, handles still
+    // go stale
+    auto other = manager.getServiceHandle<PluginService>("plain");
+    auto *plain = other.get();
+    std::shared_ptr<IService> shared = manager.getSharedServices().at("plain");
+    manager.clear();
+    bool kept = dynamic_cast<PluginService *>(shared.get()) == plain;
+    return lookups && resolved && stale && other.stale() && kept;
+}
+
+#ifdef TEST_PLUGIN_PATH
+bool testPlugins() {
+    auto &factory = ServiceFactory::getInstance();
+    char directory[] = "/tmp/service_pluginsXXXXXX";
+    if (!mkdtemp(directory)) {
+        return false;
+    }
+    std::string manifest = std::string(directory) + "/test.plugin";
+    std::string broken = std::string(directory) + "/broken.plugin";
+    std::ofstream(manifest) << "# Test plugin\n"
+                            << "library = " TEST_PLUGIN_PATH "\n"
+                            << "service = LoadedService\n"
+                            << "service = UnexportedService\n";
+    std::ofstream(broken) << "library = missing.so\n"
+                          << "service = MissingService\n";
+
+    // Types are known right away, the library is opened on first use
+    bool registered = factory.loadPlugins(directory) == 3 &&
+                      factory.isServiceRegistered("LoadedService") &&
+                      !dlopen(TEST_PLUGIN_PATH, RTLD_NOW | RTLD_NOLOAD);
+
+    auto service = factory.createService("LoadedService");
+    void *handle = dlopen(TEST_PLUGIN_PATH, RTLD_NOW | RTLD_NOLOAD);
+    bool loaded = service && service->getName() == "LoadedService" && handle;
+    if (handle) {
+        dlclose(handle);
+    }
+
+    bool failures = !factory.createService("UnexportedService") &&
+                    !factory.createService("MissingService");
+
+    for (const char *type :
+         {"LoadedService", "UnexportedService", "MissingService"}) {
+        factory.unregisterService(type);
+    }
+    std::remove(manifest.c_str());
+    std::remove(broken.c_str());
+    rmdir(directory);
+    return registered && loaded && failures;
+}
+#endif
+
 int main() {
     std::cout << "Service Framework Unit Tests" << std::endl;
     std::cout << "============================" << std::endl;
@@ -265,6 +639,15 @@ int main() {
                         testMultipleServiceInstances);
     TestRunner::runTest("Service Factory Features", testServiceFactoryFeatures);
     TestRunner::runTest("Error Handling", testErrorHandling);
+    TestRunner::runTest("Concurrent Registry", testConcurrentRegistry);
+    TestRunner::runTest("Service Type IDs", testServiceTypeIds);
+    TestRunner::runTest("Static Registry", testStaticRegistry);
+    TestRunner::runTest("Service Pools", testServicePools);
+    TestRunner::runTest("Service Arenas", testServiceArenas);
+    TestRunner::runTest("Typed Lookup", testTypedLookup);
+#ifdef TEST_PLUGIN_PATH
+    TestRunner::runTest("Service Plugins", testPlugins);
+#endif
 
     // Print results
     TestRunner::printResults();
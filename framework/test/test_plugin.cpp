@@ -0,0 +1,20 @@
+#include "framework/service_plugin.h"
+#include <string>
+#include <string_view>
+
+using namespace ServiceFramework;
+
+// Service type exported by the plugin the framework tests load
+class LoadedService : public IService {
+  public:
+    static constexpr std::string_view SERVICE_TYPE = "LoadedService";
+
+    bool initialize() override { return true; }
+    bool health() override { return true; }
+    bool start() override { return true; }
+    void stop() override {}
+    std::string getName() const override { return "LoadedService"; }
+    bool isRunning() const override { return false; }
+};
+
+SERVICE_PLUGIN(LoadedService)
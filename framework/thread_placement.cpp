@@ -0,0 +1,170 @@
+#include "thread_placement.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sstream>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace ServiceFramework {
+
+namespace {
+
+const char NODE_SYSFS[] = "/sys/devices/system/node/";
+
+// Allocations of the calling thread come from node first, falling back to
+// other nodes when it is full. There is no libnuma dependency, so this
+// goes through the raw system call.
+bool preferNode(int node) {
+    const size_t bitsPerWord = sizeof(unsigned long) * 8;
+    std::vector<unsigned long> mask(static_cast<size_t>(node) / bitsPerWord + 1, 0);
+    mask[static_cast<size_t>(node) / bitsPerWord] |= 1UL << (static_cast<size_t>(node) % bitsPerWord);
+    long result = syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask.data(),
+                          mask.size() * bitsPerWord + 1);
+    // ENOSYS: kernel without NUMA, where all memory is local anyway
+    return result == 0 || errno == ENOSYS;
+}
+
+} // namespace
+
+void ThreadPlacementPolicy::set(ThreadRole role,
+                                const ThreadPlacement &placement) {
+    m_placements[static_cast<size_t>(role)] = placement;
+}
+
+const ThreadPlacement &ThreadPlacementPolicy::get(ThreadRole role) const {
+    return m_placements[static_cast<size_t>(role)];
+}
+
+ThreadPlacementPolicy ThreadPlacementPolicy::isolateIo(size_t ioCpus,
+                                                       int numaNode) {
+    std::vector<int> cpus = numaNode >= 0
+                                ? ThreadAffinity::numaNodeCpus(numaNode)
+                                : ThreadAffinity::allowedCpus();
+
+    ThreadPlacement io;
+    ThreadPlacement compute;
+    io.numaNode = numaNode;
+    compute.numaNode = numaNode;
+    if (ioCpus > 0 && cpus.size() > ioCpus) {
+        io.cpus.assign(cpus.begin(), cpus.begin() + ioCpus);
+        compute.cpus.assign(cpus.begin() + ioCpus, cpus.end());
+    } else {
+        io.cpus = cpus;
+        compute.cpus = cpus;
+    }
+
+    ThreadPlacementPolicy policy;
+    policy.set(ThreadRole::Io, io);
+    policy.set(ThreadRole::Worker, compute);
+    policy.set(ThreadRole::Background, compute);
+    return policy;
+}
+
+bool ThreadAffinity::apply(const ThreadPlacement &placement, size_t index) {
+    if (placement.empty()) {
+        return true;
+    }
+
+    std::vector<int> cpus = placement.cpus;
+    if (cpus.empty()) {
+        cpus = numaNodeCpus(placement.numaNode);
+    }
+    if (placement.spread && !cpus.empty()) {
+        cpus = {cpus[index % cpus.size()]};
+    }
+
+    bool applied = true;
+    if (!cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus) {
+            if (cpu >= 0 && cpu < CPU_SETSIZE) {
+                CPU_SET(cpu, &set);
+            }
+        }
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+            std::cerr << "Failed to set thread affinity" << std::endl;
+            applied = false;
+        }
+    }
+
+    if (placement.numaNode >= 0 && !preferNode(placement.numaNode)) {
+        std::cerr << "Failed to prefer NUMA node " << placement.numaNode
+                  << " for thread memory" << std::endl;
+        applied = false;
+    }
+    return applied;
+}
+
+int ThreadAffinity::numaNodeCount() {
+    std::ifstream online(std::string(NODE_SYSFS) + "online");
+    std::string list;
+    if (!std::getline(online, list)) {
+        return 1;
+    }
+    std::vector<int> nodes = parseCpuList(list);
+    return nodes.empty() ? 1 : nodes.back() + 1;
+}
+
+std::vector<int> ThreadAffinity::numaNodeCpus(int node) {
+    if (node < 0) {
+        return {};
+    }
+    std::ifstream file(std::string(NODE_SYSFS) + "node" +
+                       std::to_string(node) + "/cpulist");
+    std::string list;
+    if (!std::getline(file, list)) {
+        // No sysfs node information: a non-NUMA host has just node 0
+        return node == 0 ? allowedCpus() : std::vector<int>();
+    }
+    return parseCpuList(list);
+}
+
+std::vector<int> ThreadAffinity::allowedCpus() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    return cpus;
+}
+
+std::vector<int> ThreadAffinity::parseCpuList(const std::string &list) {
+    std::vector<int> cpus;
+    std::istringstream ranges(list);
+    std::string range;
+    while (std::getline(ranges, range, ',')) {
+        if (range.empty()) {
+            continue;
+        }
+        char *end = nullptr;
+        long first = std::strtol(range.c_str(), &end, 10);
+        long last = first;
+        if (end != nullptr && *end == '-') {
+            last = std::strtol(end + 1, &end, 10);
+        }
+        if (end == nullptr || (*end != '\0' && *end != '\n') || first < 0 ||
+            last < first) {
+            return {};
+        }
+        for (long cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+} // namespace ServiceFramework
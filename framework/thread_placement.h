@@ -0,0 +1,103 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace ServiceFramework {
+
+/**
+ * @brief Where one kind of thread may run
+ *
+ * An empty placement leaves the thread to the scheduler. With a NUMA node
+ * and no CPUs, the thread may run on any CPU of that node.
+ */
+struct ThreadPlacement {
+    std::vector<int> cpus; // allowed CPUs, empty for all (or all of numaNode)
+    int numaNode = -1;     // memory (and default CPU) node, -1 for none
+    bool spread = false;   // pin the i-th thread of a group to the i-th CPU
+
+    bool empty() const { return cpus.empty() && numaNode < 0; }
+};
+
+/**
+ * @brief Kinds of framework threads, placed independently
+ */
+enum class ThreadRole {
+    Io,        // event loops and accept threads
+    Worker,    // request handlers and other compute
+    Background // timers, exporters, monitors
+};
+
+/**
+ * @brief Placement of a service's threads by role
+ *
+ * Services apply the placement of a role when they spawn a thread of that
+ * role, so set it before start().
+ */
+class ThreadPlacementPolicy {
+  public:
+    ThreadPlacementPolicy() = default;
+
+    /**
+     * @brief Set where threads of a role run
+     */
+    void set(ThreadRole role, const ThreadPlacement &placement);
+
+    /**
+     * @brief Placement of a role (empty if never set)
+     */
+    const ThreadPlacement &get(ThreadRole role) const;
+
+    /**
+     * @brief Keep I/O threads off the CPUs that run handlers
+     * @param ioCpus Number of CPUs reserved for I/O threads
+     * @param numaNode Node to place everything on, -1 for all allowed CPUs
+     * @return Policy giving the first ioCpus CPUs to Io and the rest to
+     *         Worker and Background; without enough CPUs to split, all
+     *         roles share them
+     */
+    static ThreadPlacementPolicy isolateIo(size_t ioCpus, int numaNode = -1);
+
+  private:
+    ThreadPlacement m_placements[3];
+};
+
+/**
+ * @brief Applying placements to the calling thread
+ */
+class ThreadAffinity {
+  public:
+    /**
+     * @brief Pin the calling thread and prefer its NUMA node for memory
+     * @param placement Where the thread may run
+     * @param index Position of the thread in its group, for spread placements
+     * @return true if the placement was applied (or empty)
+     *
+     * Call it first thing in the new thread: memory the thread allocates
+     * afterwards (its buffers, its stack as it grows) comes from the
+     * placement's node when one is set.
+     */
+    static bool apply(const ThreadPlacement &placement, size_t index = 0);
+
+    /**
+     * @brief Number of NUMA nodes (1 without NUMA support)
+     */
+    static int numaNodeCount();
+
+    /**
+     * @brief CPUs of a NUMA node, empty if there is no such node
+     */
+    static std::vector<int> numaNodeCpus(int node);
+
+    /**
+     * @brief CPUs the calling thread may currently run on
+     */
+    static std::vector<int> allowedCpus();
+
+    /**
+     * @brief Parse a kernel CPU list such as "0-3,8,10-11"
+     */
+    static std::vector<int> parseCpuList(const std::string &list);
+};
+
+} // namespace ServiceFramework
@@ -8,6 +8,9 @@
 
 using namespace ServiceFramework;
 
+// Service types this binary creates, resolved at compile time
+constexpr auto SERVICES = makeStaticServices<LoggingService>();
+
 void demonstrateBasicUsage() {
     std::cout << "\n=== Basic Service Framework Usage ===" << std::endl;
 
@@ -39,28 +42,26 @@ void demonstrateBasicUsage() {
     std::cout << "\n--- Using Services ---" << std::endl;
 
     // Get and use logging service
-    auto *logger = dynamic_cast<LoggingService *>(manager.getService("logger"));
+    auto *logger = manager.getService<LoggingService>("logger");
     if (logger) {
         logger->logMessage("Application started successfully");
     }
 
     // Get and use database service
-    auto *database =
-        dynamic_cast<DatabaseService *>(manager.getService("maindb"));
+    auto *database = manager.getService<DatabaseService>("maindb");
     if (database) {
         database->executeQuery("SELECT * FROM users");
     }
 
     // Get and use cache service
-    auto *cache = dynamic_cast<CacheService *>(manager.getService("cache"));
+    auto *cache = manager.getService<CacheService>("cache");
     if (cache) {
         cache->set("user:123", "John Doe");
         std::string user = cache->get("user:123");
     }
 
     // Get and use network service
-    auto *network =
-        dynamic_cast<NetworkService *>(manager.getService("webserver"));
+    auto *network = manager.getService<NetworkService>("webserver");
     if (network) {
         std::cout << "Network service running on port: " << network->getPort()
                   << std::endl;
@@ -134,10 +135,8 @@ void demonstrateServiceManager() {
 
     // Use multiple instances of the same service type
     std::cout << "\n--- Using Multiple Service Instances ---" << std::endl;
-    auto *primaryDb =
-        dynamic_cast<DatabaseService *>(manager.getService("primary_db"));
-    auto *secondaryDb =
-        dynamic_cast<DatabaseService *>(manager.getService("secondary_db"));
+    auto *primaryDb = manager.getService<DatabaseService>("primary_db");
+    auto *secondaryDb = manager.getService<DatabaseService>("secondary_db");
 
     if (primaryDb) {
         primaryDb->executeQuery("INSERT INTO users VALUES (1, 'Alice')");
@@ -160,6 +159,7 @@ void demonstrateServiceManager() {
 int main() {
     std::cout << "C++ Services Framework Demo" << std::endl;
     std::cout << "===========================" << std::endl;
+    ServiceFactory::getInstance().addStaticServices(SERVICES);
 
     try {
         // Demonstrate basic usage
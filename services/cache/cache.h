@@ -4,6 +4,9 @@
 #include <atomic>
 #include <chrono>
 #include <iostream>
+#include <memory_resource>
+#include <string>
+#include <string_view>
 #include <thread>
 #include <unordered_map>
 
@@ -11,10 +14,14 @@ namespace ServiceFramework {
 
 /**
  * @brief Example cache service
+ *
+ * Entries live in the instance's arena when it was created in one.
  */
 class CacheService : public IService {
   public:
-    CacheService() : m_running(false) {}
+    static constexpr std::string_view SERVICE_TYPE = "CacheService";
+
+    CacheService() : m_running(false), m_cache(memoryResource()) {}
 
     bool initialize() override {
         std::cout << "CacheService: Initializing cache..." << std::endl;
@@ -42,29 +49,55 @@ class CacheService : public IService {
 
     bool isRunning() const override { return m_running; }
 
+    bool reset() override {
+        m_cache.clear();
+        return !m_running;
+    }
+
     // Service-specific methods
-    void set(const std::string &key, const std::string &value) {
+    void set(std::string_view key, std::string_view value) {
         if (m_running) {
-            m_cache[key] = value;
+            auto it = m_cache.find(key);
+            if (it != m_cache.end()) {
+                it->second.value.assign(value);
+            } else {
+                // Insert under the caller's key, then point the key at the
+                // entry's own copy; nodes do not move, so it stays valid
+                auto resource = memoryResource();
+                auto node = m_cache.extract(
+                    m_cache
+                        .try_emplace(key, Entry{std::pmr::string(key, resource),
+                                                std::pmr::string(value, resource)})
+                        .first);
+                node.key() = node.mapped().key;
+                m_cache.insert(std::move(node));
+            }
             std::cout << "[CACHE] Set: " << key << " = " << value << std::endl;
         }
     }
 
-    std::string get(const std::string &key) {
+    std::string get(std::string_view key) {
         if (m_running) {
             auto it = m_cache.find(key);
             if (it != m_cache.end()) {
-                std::cout << "[CACHE] Get: " << key << " = " << it->second
-                          << std::endl;
-                return it->second;
+                std::cout << "[CACHE] Get: " << key << " = "
+                          << it->second.value << std::endl;
+                return std::string(std::string_view(it->second.value));
             }
         }
         return "";
     }
 
   private:
+    struct Entry {
+        std::pmr::string key; // the map's key views this
+        std::pmr::string value;
+    };
+
     std::atomic<bool> m_running;
-    std::unordered_map<std::string, std::string> m_cache;
+    // Keyed by std::string_view so lookups do not build a string (C++17
+    // unordered containers have no heterogeneous lookup)
+    std::pmr::unordered_map<std::string_view, Entry> m_cache;
 };
 
 } // namespace ServiceFramework
@@ -14,6 +14,8 @@ namespace ServiceFramework {
  */
 class DatabaseService : public IService {
   public:
+    static constexpr std::string_view SERVICE_TYPE = "DatabaseService";
+
     DatabaseService() : m_running(false), m_connected(false) {}
 
     bool initialize() override {
@@ -45,6 +47,9 @@ class DatabaseService : public IService {
 
     bool isRunning() const override { return m_running; }
 
+    // The connection setup done by initialize() is kept
+    bool reset() override { return !m_running; }
+
     // Service-specific methods
     bool executeQuery(const std::string &query) {
         if (m_connected) {
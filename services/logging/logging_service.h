@@ -3,18 +3,33 @@
 #include "../../framework/service_interface.h"
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <iostream>
+#include <mutex>
+#include <string>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
 namespace ServiceFramework {
 
 /**
  * @brief Example logging service
+ *
+ * Besides single messages it drains batched log sources, such as
+ * RestApiService::accessLog(), from a writer thread: producers only fill
+ * memory buffers and each batch reaches the output in one write.
  */
 class LoggingService : public IService {
   public:
+    static constexpr std::string_view SERVICE_TYPE = "LoggingService";
+
+    // Appends formatted lines to batch and returns how many it added
+    using LogSource = std::function<size_t(std::string &batch)>;
+
     LoggingService() : m_running(false) {}
+    ~LoggingService() override { stopWriter(); }
 
     bool initialize() override {
         std::cout << "LoggingService: Initializing..." << std::endl;
@@ -27,12 +42,18 @@ class LoggingService : public IService {
     bool start() override {
         std::cout << "LoggingService: Starting..." << std::endl;
         m_running = true;
+        std::lock_guard<std::mutex> lock(m_writerMutex);
+        if (!m_writer.joinable()) {
+            m_stopWriter = false;
+            m_writer = std::thread(&LoggingService::writerLoop, this);
+        }
         return true;
     }
 
     void stop() override {
         std::cout << "LoggingService: Stopping..." << std::endl;
         m_running = false;
+        stopWriter();
     }
 
     std::string getName() const override { return "LoggingService"; }
@@ -46,23 +67,69 @@ class LoggingService : public IService {
         }
     }
 
-  private:
-    std::atomic<bool> m_running;
-};
+    /**
+     * @brief Drain source in the background while running
+     */
+    void addLogSource(LogSource source) {
+        std::lock_guard<std::mutex> lock(m_sourcesMutex);
+        m_sources.push_back(std::move(source));
+    }
 
-} // namespace ServiceFramework
+    // Where batches go (std::cout by default) and how often, before start()
+    void setOutput(std::ostream &output) { m_output = &output; }
+    void setFlushInterval(std::chrono::milliseconds interval) { m_flushInterval = interval; }
+
+    /**
+     * @brief Drain every source now
+     */
+    void flush() {
+        std::lock_guard<std::mutex> lock(m_sourcesMutex);
+        std::string batch;
+        for (auto &source : m_sources) {
+            while (source(batch) > 0) {
+                m_output->write(batch.data(), static_cast<std::streamsize>(batch.size()));
+                batch.clear();
+            }
+        }
+        m_output->flush();
+    }
 
-namespace {
-struct ServiceRegistrations {
-    ServiceRegistrations() {
-        auto &factory = ServiceFramework::ServiceFactory::getInstance();
+  private:
+    void writerLoop() {
+        std::unique_lock<std::mutex> lock(m_writerMutex);
+        while (!m_stopWriter) {
+            m_writerCondition.wait_for(lock, m_flushInterval, [this] { return m_stopWriter; });
+            lock.unlock();
+            flush();
+            lock.lock();
+        }
+    }
 
-        factory.registerService(
-            "LoggingService", []() -> ServiceFramework::ServicePtr {
-                return std::make_unique<ServiceFramework::LoggingService>();
-            });
+    // Stops the writer after a final flush
+    void stopWriter() {
+        std::thread writer;
+        {
+            std::lock_guard<std::mutex> lock(m_writerMutex);
+            m_stopWriter = true;
+            writer.swap(m_writer);
+        }
+        m_writerCondition.notify_all();
+        if (writer.joinable()) {
+            writer.join();
+        }
     }
+
+    std::atomic<bool> m_running;
+
+    // Batched sources and their writer thread
+    std::mutex m_sourcesMutex;
+    std::vector<LogSource> m_sources;
+    std::ostream *m_output = &std::cout;
+    std::chrono::milliseconds m_flushInterval{200};
+    std::mutex m_writerMutex;
+    std::condition_variable m_writerCondition;
+    std::thread m_writer;
+    bool m_stopWriter = false;
 };
 
-static ServiceRegistrations g_serviceRegistrations;
-} // namespace
+} // namespace ServiceFramework
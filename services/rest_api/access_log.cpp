@@ -0,0 +1,114 @@
+#include "access_log.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace ServiceFramework {
+
+namespace {
+
+void appendJsonString(std::string& out, const std::string& value) {
+    out.push_back('"');
+    for (char c : value) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out += escaped;
+            } else {
+                out.push_back(c);
+            }
+        }
+    }
+    out.push_back('"');
+}
+
+void appendRecord(std::string& out, const AccessLogRecord& record) {
+    char number[32];
+    long long millis =
+        std::chrono::duration_cast<std::chrono::milliseconds>(record.time.time_since_epoch()).count();
+    snprintf(number, sizeof(number), "%lld", millis);
+    out += "{\"time\":";
+    out += number;
+    out += ",\"method\":";
+    appendJsonString(out, record.method);
+    out += ",\"path\":";
+    appendJsonString(out, record.path);
+    out += ",\"protocol\":";
+    appendJsonString(out, record.protocol);
+
+    snprintf(number, sizeof(number), "%d", record.status);
+    out += ",\"status\":";
+    out += number;
+    snprintf(number, sizeof(number), "%zu", record.requestBytes);
+    out += ",\"requestBytes\":";
+    out += number;
+    snprintf(number, sizeof(number), "%zu", record.responseBytes);
+    out += ",\"responseBytes\":";
+    out += number;
+    snprintf(number, sizeof(number), "%lld", static_cast<long long>(record.queued.count()));
+    out += ",\"queueUs\":";
+    out += number;
+    snprintf(number, sizeof(number), "%lld", static_cast<long long>(record.handled.count()));
+    out += ",\"handlerUs\":";
+    out += number;
+    out += "}\n";
+}
+
+} // namespace
+
+AccessLog::AccessLog(const AccessLogOptions& options, size_t producers) : m_options(options) {
+    size_t capacity = std::max<size_t>(1, m_options.bufferRecords);
+    for (size_t i = 0; i < producers; ++i) {
+        m_rings.push_back(std::make_unique<Ring>(capacity));
+    }
+}
+
+bool AccessLog::sample(size_t producer, int status) {
+    if (m_options.logErrors && status >= 400) {
+        return true;
+    }
+    if (m_options.sampleRatio >= 1.0) {
+        return true;
+    }
+    Ring& ring = *m_rings[producer];
+    ring.sampleCredit += std::max(0.0, m_options.sampleRatio);
+    if (ring.sampleCredit < 1.0) {
+        return false;
+    }
+    ring.sampleCredit -= 1.0;
+    return true;
+}
+
+void AccessLog::record(size_t producer, AccessLogRecord&& record) {
+    Ring& ring = *m_rings[producer];
+    size_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) >= ring.slots.size()) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed); // the consumer fell behind
+        return;
+    }
+    ring.slots[head % ring.slots.size()] = std::move(record);
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+size_t AccessLog::drain(std::string& batch, size_t maxRecords) {
+    std::lock_guard<std::mutex> lock(m_drainMutex);
+    size_t drained = 0;
+    for (auto& ringPtr : m_rings) {
+        Ring& ring = *ringPtr;
+        size_t tail = ring.tail.load(std::memory_order_relaxed);
+        size_t head = ring.head.load(std::memory_order_acquire);
+        while (tail != head && drained < maxRecords) {
+            appendRecord(batch, ring.slots[tail % ring.slots.size()]);
+            ++tail;
+            ++drained;
+        }
+        // Hands the slots back to the producer
+        ring.tail.store(tail, std::memory_order_release);
+    }
+    return drained;
+}
+
+} // namespace ServiceFramework
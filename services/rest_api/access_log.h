@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ServiceFramework {
+
+/**
+ * @brief One line of the access log
+ */
+struct AccessLogRecord {
+    std::chrono::system_clock::time_point time; // when the handler finished
+    std::string method;
+    std::string path;     // without the query string
+    std::string protocol; // "HTTP/1.1", "HTTP/2", "RPC/1", ...
+    int status = 0;
+    size_t requestBytes = 0;  // body
+    size_t responseBytes = 0; // body
+    std::chrono::microseconds queued{0};  // framed to picked up by a worker
+    std::chrono::microseconds handled{0}; // parse, route and handler
+};
+
+/**
+ * @brief How much to log
+ */
+struct AccessLogOptions {
+    double sampleRatio = 1.0;    // share of successful requests logged
+    bool logErrors = true;       // 4xx and 5xx responses are logged regardless of sampling
+    size_t bufferRecords = 4096; // per worker; records beyond this are dropped, not blocked on
+};
+
+/**
+ * @brief Per-worker access log buffers, drained in batches
+ *
+ * Each worker writes into its own single-producer ring without locks or
+ * I/O; a consumer, normally LoggingService's writer thread, calls drain()
+ * to format everything buffered as JSON lines and write it in one go.
+ * Sampling is a per-worker credit counter, so sampleRatio 0.1 logs every
+ * tenth successful request of each worker.
+ */
+class AccessLog {
+public:
+    /**
+     * @param producers Number of writer threads, indexed 0..producers-1
+     */
+    AccessLog(const AccessLogOptions& options, size_t producers);
+
+    // Prevent copying (shared by the workers and the consumer)
+    AccessLog(const AccessLog&) = delete;
+    AccessLog& operator=(const AccessLog&) = delete;
+
+    /**
+     * @brief Whether a response with this status should be logged
+     *
+     * Decides before the record is built, so unsampled requests cost
+     * nothing more. Only the producer's own thread may call it.
+     */
+    bool sample(size_t producer, int status);
+
+    /**
+     * @brief Buffer a record (producer's own thread only)
+     */
+    void record(size_t producer, AccessLogRecord&& record);
+
+    /**
+     * @brief Append buffered records to batch as JSON lines (thread-safe)
+     * @return Number of records appended
+     */
+    size_t drain(std::string& batch, size_t maxRecords = SIZE_MAX);
+
+    uint64_t droppedRecords() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    struct Ring {
+        explicit Ring(size_t capacity) : slots(capacity) {}
+
+        std::vector<AccessLogRecord> slots;
+        alignas(64) std::atomic<size_t> head{0}; // next slot written, by the producer
+        alignas(64) std::atomic<size_t> tail{0}; // next slot read, by the consumer
+        double sampleCredit = 0;                 // producer only
+    };
+
+    AccessLogOptions m_options;
+    std::vector<std::unique_ptr<Ring>> m_rings;
+    std::mutex m_drainMutex; // the rings have a single consumer
+    std::atomic<uint64_t> m_dropped{0};
+};
+
+} // namespace ServiceFramework
@@ -0,0 +1,181 @@
+#include "health_monitor.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+namespace ServiceFramework {
+
+struct HealthMonitor::State {
+    struct Entry {
+        const IService* service = nullptr;
+        bool probing = false;
+        bool hasResult = false;
+        bool healthy = false;
+        Clock::time_point checkedAt;
+    };
+
+    struct Job {
+        std::string name;
+        std::shared_ptr<IService> service;
+    };
+
+    struct Probe {
+        Clock::time_point started;
+        bool abandoned = false; // its thread no longer counts against probeThreads
+    };
+
+    HealthCheckOptions options;
+
+    std::mutex mutex;
+    std::condition_variable resultCondition;
+    std::unordered_map<std::string, Entry> entries;
+    uint64_t probesStarted = 0;
+
+    std::deque<Job> jobs;
+    std::list<Probe> running;
+    size_t threads = 0; // probe threads not given up on
+    bool stopping = false;
+};
+
+HealthMonitor::HealthMonitor(const HealthCheckOptions& options) : m_state(std::make_shared<State>()) {
+    m_state->options = options;
+}
+
+HealthMonitor::~HealthMonitor() {
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    m_state->stopping = true;
+    m_state->jobs.clear();
+}
+
+std::vector<ProbeResult> HealthMonitor::check(const std::unordered_map<std::string, std::shared_ptr<IService>>& services) {
+    State& state = *m_state;
+    Clock::time_point now = Clock::now();
+    std::vector<std::string> pending;
+
+    std::unique_lock<std::mutex> lock(state.mutex);
+
+    // Forget instances that were removed
+    for (auto it = state.entries.begin(); it != state.entries.end();) {
+        auto service = services.find(it->first);
+        it = service == services.end() || service->second.get() != it->second.service ? state.entries.erase(it)
+                                                                                       : std::next(it);
+    }
+
+    for (const auto& service : services) {
+        State::Entry& entry = state.entries[service.first];
+        entry.service = service.second.get();
+        if (entry.hasResult && now - entry.checkedAt <= state.options.freshness) {
+            continue;
+        }
+        pending.push_back(service.first);
+        if (!entry.probing) {
+            entry.probing = true;
+            ++state.probesStarted;
+            state.jobs.push_back(State::Job{service.first, service.second});
+        }
+    }
+    abandonHungProbes(now);
+    startProbeThreads();
+
+    // Wait for this round's probes, but never longer than probeTimeout
+    state.resultCondition.wait_until(lock, now + state.options.probeTimeout, [&state, &pending, now] {
+        return std::all_of(pending.begin(), pending.end(), [&state, now](const std::string& name) {
+            auto it = state.entries.find(name);
+            return it == state.entries.end() || (it->second.hasResult && it->second.checkedAt >= now);
+        });
+    });
+
+    // Served: results fresh when the request came in, or probed since
+    Clock::time_point answered = Clock::now();
+    std::vector<ProbeResult> results;
+    results.reserve(services.size());
+    for (const auto& service : services) {
+        ProbeResult result;
+        result.name = service.first;
+        auto it = state.entries.find(service.first);
+        if (it != state.entries.end() && it->second.hasResult &&
+            (it->second.checkedAt >= now || now - it->second.checkedAt <= state.options.freshness)) {
+            result.state = it->second.healthy ? ProbeResult::State::Healthy : ProbeResult::State::Unhealthy;
+            result.age = std::chrono::duration_cast<std::chrono::milliseconds>(answered - it->second.checkedAt);
+        }
+        results.push_back(std::move(result));
+    }
+    abandonHungProbes(answered);
+    startProbeThreads();
+    lock.unlock();
+
+    std::sort(results.begin(), results.end(),
+              [](const ProbeResult& a, const ProbeResult& b) { return a.name < b.name; });
+    return results;
+}
+
+uint64_t HealthMonitor::probesStarted() const {
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    return m_state->probesStarted;
+}
+
+void HealthMonitor::abandonHungProbes(Clock::time_point now) {
+    for (auto& probe : m_state->running) {
+        if (!probe.abandoned && now - probe.started >= m_state->options.probeTimeout) {
+            probe.abandoned = true;
+            --m_state->threads;
+        }
+    }
+}
+
+void HealthMonitor::startProbeThreads() {
+    State& state = *m_state;
+    size_t limit = std::max<size_t>(1, state.options.probeThreads);
+    while (state.threads < std::min(limit, state.jobs.size())) {
+        try {
+            std::thread(&HealthMonitor::probeLoop, m_state).detach();
+        } catch (const std::system_error&) {
+            break; // the jobs wait for the next check()
+        }
+        ++state.threads;
+    }
+}
+
+void HealthMonitor::probeLoop(std::shared_ptr<State> state) {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    while (!state->stopping && !state->jobs.empty()) {
+        State::Job job = std::move(state->jobs.front());
+        state->jobs.pop_front();
+        auto probe = state->running.insert(state->running.end(), State::Probe{Clock::now()});
+        lock.unlock();
+
+        bool healthy = false;
+        try {
+            healthy = job.service->health();
+        } catch (...) {
+            healthy = false;
+        }
+
+        lock.lock();
+        bool abandoned = probe->abandoned;
+        state->running.erase(probe);
+        auto it = state->entries.find(job.name);
+        if (it != state->entries.end() && it->second.service == job.service.get()) {
+            it->second.probing = false;
+            it->second.hasResult = true;
+            it->second.healthy = healthy;
+            it->second.checkedAt = Clock::now();
+            state->resultCondition.notify_all();
+        }
+
+        // A removed service may be destroyed here; not under the lock
+        lock.unlock();
+        job.service.reset();
+        lock.lock();
+        if (abandoned) {
+            return; // another thread has taken its place
+        }
+    }
+    --state->threads;
+}
+
+} // namespace ServiceFramework
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "framework/service_interface.h"
+#include <chrono>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ServiceFramework {
+
+/**
+ * @brief Timing of the aggregated GET /api/health endpoint
+ */
+struct HealthCheckOptions {
+    std::chrono::milliseconds probeTimeout{500}; // longest a request waits for health()
+    std::chrono::milliseconds freshness{1000};   // results younger than this are served without probing
+    size_t probeThreads = 4;                      // health() calls in progress at once
+};
+
+/**
+ * @brief Outcome of one service's health check
+ */
+struct ProbeResult {
+    enum class State { Healthy, Unhealthy, Timeout };
+
+    std::string name;
+    State state = State::Timeout;
+    std::chrono::milliseconds age{0}; // since health() returned, 0 on timeout
+
+    bool healthy() const { return state == State::Healthy; }
+};
+
+/**
+ * @brief Runs IService::health() for many instances in parallel, with caching
+ *
+ * check() serves results younger than the freshness window from cache and
+ * probes the rest on the monitor's own threads, waiting at most
+ * probeTimeout. An instance whose probe is still running (or hung) reports
+ * Timeout and is not probed again until that call returns, so a slow
+ * health() costs the caller at most probeTimeout and never piles up probes.
+ *
+ * A probe running longer than probeTimeout stops counting against
+ * probeThreads: other instances are probed on new threads, and the hung
+ * one exits once health() returns. Each probe holds a reference to its
+ * service, so removing the service while it is probed is safe, and the
+ * destructor does not wait for probes in progress. Thread-safe.
+ */
+class HealthMonitor {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit HealthMonitor(const HealthCheckOptions& options = HealthCheckOptions());
+
+    /**
+     * @brief Drop queued probes; those in progress finish on their own
+     */
+    ~HealthMonitor();
+
+    // Prevent copying (shares its state with the probe threads)
+    HealthMonitor(const HealthMonitor&) = delete;
+    HealthMonitor& operator=(const HealthMonitor&) = delete;
+
+    /**
+     * @brief Health of every given instance, sorted by name
+     * @param services Instance name to service, as ServiceManager::getSharedServices()
+     */
+    std::vector<ProbeResult> check(const std::unordered_map<std::string, std::shared_ptr<IService>>& services);
+
+    /**
+     * @brief health() calls made so far (cache hits make none)
+     */
+    uint64_t probesStarted() const;
+
+private:
+    struct State;
+
+    void abandonHungProbes(Clock::time_point now);
+    void startProbeThreads();
+    static void probeLoop(std::shared_ptr<State> state);
+
+    // Outlives the monitor while probe threads still use it
+    std::shared_ptr<State> m_state;
+};
+
+} // namespace ServiceFramework
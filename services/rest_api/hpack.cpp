@@ -0,0 +1,442 @@
+#include "hpack.h"
+#include <algorithm>
+#include <cstring>
+
+namespace ServiceFramework {
+
+namespace {
+
+struct StaticEntry {
+    const char* name;
+    const char* value;
+};
+
+// RFC 7541 Appendix A, indices 1-61
+const StaticEntry STATIC_TABLE[] = {
+    {":authority", ""}, {":method", "GET"}, {":method", "POST"}, {":path", "/"},
+    {":path", "/index.html"}, {":scheme", "http"}, {":scheme", "https"}, {":status", "200"},
+    {":status", "204"}, {":status", "206"}, {":status", "304"}, {":status", "400"},
+    {":status", "404"}, {":status", "500"}, {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"}, {"accept-language", ""}, {"accept-ranges", ""},
+    {"accept", ""}, {"access-control-allow-origin", ""}, {"age", ""}, {"allow", ""},
+    {"authorization", ""}, {"cache-control", ""}, {"content-disposition", ""},
+    {"content-encoding", ""}, {"content-language", ""}, {"content-length", ""},
+    {"content-location", ""}, {"content-range", ""}, {"content-type", ""}, {"cookie", ""},
+    {"date", ""}, {"etag", ""}, {"expect", ""}, {"expires", ""}, {"from", ""}, {"host", ""},
+    {"if-match", ""}, {"if-modified-since", ""}, {"if-none-match", ""}, {"if-range", ""},
+    {"if-unmodified-since", ""}, {"last-modified", ""}, {"link", ""}, {"location", ""},
+    {"max-forwards", ""}, {"proxy-authenticate", ""}, {"proxy-authorization", ""},
+    {"range", ""}, {"referer", ""}, {"refresh", ""}, {"retry-after", ""}, {"server", ""},
+    {"set-cookie", ""}, {"strict-transport-security", ""}, {"transfer-encoding", ""},
+    {"user-agent", ""}, {"vary", ""}, {"via", ""}, {"www-authenticate", ""},
+};
+
+const size_t STATIC_TABLE_SIZE = sizeof(STATIC_TABLE) / sizeof(STATIC_TABLE[0]);
+const size_t ENTRY_OVERHEAD = 32;
+const size_t MAX_ENCODER_TABLE_SIZE = 4096;
+const int EOS_SYMBOL = 256;
+
+// RFC 7541 Appendix B code lengths for symbols 0-256. The code is
+// canonical, so the lengths alone determine every code.
+const uint8_t HUFFMAN_CODE_LENGTHS[257] = {
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+    28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+    6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+    5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+    13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+    15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+    6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+    24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+    21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+    19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+    26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+    30,
+};
+
+const int MAX_CODE_LENGTH = 30;
+
+/**
+ * @brief Canonical Huffman tables derived from the code lengths
+ */
+struct HuffmanTable {
+    uint32_t codes[257];
+    uint32_t firstCode[MAX_CODE_LENGTH + 1];
+    uint16_t count[MAX_CODE_LENGTH + 1];
+    uint16_t firstIndex[MAX_CODE_LENGTH + 1];
+    uint16_t symbols[257]; // ordered by (length, symbol)
+
+    HuffmanTable() {
+        std::memset(count, 0, sizeof(count));
+        for (int symbol = 0; symbol <= EOS_SYMBOL; ++symbol) {
+            ++count[HUFFMAN_CODE_LENGTHS[symbol]];
+        }
+
+        uint32_t code = 0;
+        uint16_t index = 0;
+        for (int length = 1; length <= MAX_CODE_LENGTH; ++length) {
+            code <<= 1;
+            firstCode[length] = code;
+            firstIndex[length] = index;
+            for (int symbol = 0; symbol <= EOS_SYMBOL; ++symbol) {
+                if (HUFFMAN_CODE_LENGTHS[symbol] == length) {
+                    codes[symbol] = code++;
+                    symbols[index++] = static_cast<uint16_t>(symbol);
+                }
+            }
+        }
+    }
+};
+
+const HuffmanTable& huffmanTable() {
+    static const HuffmanTable table;
+    return table;
+}
+
+bool decodeInteger(const uint8_t*& pos, const uint8_t* end, int prefixBits, uint64_t& value) {
+    if (pos >= end) {
+        return false;
+    }
+    uint8_t mask = static_cast<uint8_t>((1u << prefixBits) - 1);
+    value = *pos++ & mask;
+    if (value < mask) {
+        return true;
+    }
+
+    int shift = 0;
+    while (pos < end) {
+        uint8_t byte = *pos++;
+        value += static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+        shift += 7;
+        if (shift > 28) {
+            return false; // larger than anything a header block can need
+        }
+    }
+    return false;
+}
+
+bool decodeString(const uint8_t*& pos, const uint8_t* end, std::string& out) {
+    if (pos >= end) {
+        return false;
+    }
+    bool huffman = (*pos & 0x80) != 0;
+    uint64_t length = 0;
+    if (!decodeInteger(pos, end, 7, length) || length > static_cast<uint64_t>(end - pos)) {
+        return false;
+    }
+
+    bool decoded = true;
+    if (huffman) {
+        out.clear();
+        decoded = Hpack::huffmanDecode(pos, static_cast<size_t>(length), out);
+    } else {
+        out.assign(reinterpret_cast<const char*>(pos), static_cast<size_t>(length));
+    }
+    pos += length;
+    return decoded;
+}
+
+void encodeInteger(uint64_t value, int prefixBits, uint8_t flags, std::string& out) {
+    uint8_t mask = static_cast<uint8_t>((1u << prefixBits) - 1);
+    if (value < mask) {
+        out.push_back(static_cast<char>(flags | value));
+        return;
+    }
+    out.push_back(static_cast<char>(flags | mask));
+    value -= mask;
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+void encodeString(const std::string& value, std::string& out) {
+    size_t huffmanLength = Hpack::huffmanEncodedLength(value);
+    if (huffmanLength < value.size()) {
+        encodeInteger(huffmanLength, 7, 0x80, out);
+        Hpack::huffmanEncode(value, out);
+    } else {
+        encodeInteger(value.size(), 7, 0x00, out);
+        out.append(value);
+    }
+}
+
+size_t entrySize(const HeaderField& field) {
+    return field.name.size() + field.value.size() + ENTRY_OVERHEAD;
+}
+
+// Values that change on every response, or must not sit in a shared table
+bool shouldIndex(const HeaderField& field) {
+    return field.name != ":path" && field.name != "content-length" &&
+           field.name != "authorization" && field.name != "cookie" &&
+           field.name != "set-cookie" && field.value.size() <= 512;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Huffman coding
+// ---------------------------------------------------------------------------
+
+namespace Hpack {
+
+bool huffmanDecode(const uint8_t* data, size_t size, std::string& out) {
+    const HuffmanTable& table = huffmanTable();
+    uint32_t code = 0;
+    int length = 0;
+
+    for (size_t i = 0; i < size; ++i) {
+        for (int bit = 7; bit >= 0; --bit) {
+            code = (code << 1) | ((data[i] >> bit) & 1u);
+            ++length;
+            if (length > MAX_CODE_LENGTH) {
+                return false;
+            }
+            // Canonical code: every code of this length lies in one range
+            uint32_t offset = code - table.firstCode[length];
+            if (code >= table.firstCode[length] && offset < table.count[length]) {
+                uint16_t symbol = table.symbols[table.firstIndex[length] + offset];
+                if (symbol == EOS_SYMBOL) {
+                    return false;
+                }
+                out.push_back(static_cast<char>(symbol));
+                code = 0;
+                length = 0;
+            }
+        }
+    }
+
+    // Padding is at most 7 bits, all ones (a prefix of EOS)
+    return length <= 7 && code == (1u << length) - 1;
+}
+
+void huffmanEncode(const std::string& in, std::string& out) {
+    const HuffmanTable& table = huffmanTable();
+    uint64_t bits = 0;
+    int pending = 0;
+    for (unsigned char c : in) {
+        int length = HUFFMAN_CODE_LENGTHS[c];
+        bits = (bits << length) | table.codes[c];
+        pending += length;
+        while (pending >= 8) {
+            pending -= 8;
+            out.push_back(static_cast<char>(bits >> pending));
+        }
+    }
+    if (pending > 0) {
+        // Pad with the most significant bits of EOS (all ones)
+        out.push_back(static_cast<char>((bits << (8 - pending)) | (0xffu >> pending)));
+    }
+}
+
+size_t huffmanEncodedLength(const std::string& in) {
+    size_t bits = 0;
+    for (unsigned char c : in) {
+        bits += HUFFMAN_CODE_LENGTHS[c];
+    }
+    return (bits + 7) / 8;
+}
+
+} // namespace Hpack
+
+// ---------------------------------------------------------------------------
+// Decoder
+// ---------------------------------------------------------------------------
+
+HpackDecoder::HpackDecoder(size_t maxTableSize, size_t maxHeaderListSize)
+    : m_capacity(maxTableSize), m_maxTableSize(maxTableSize), m_maxHeaderListSize(maxHeaderListSize) {
+}
+
+bool HpackDecoder::decode(const uint8_t* data, size_t size, HeaderList& headers) {
+    const uint8_t* pos = data;
+    const uint8_t* end = data + size;
+    size_t listSize = 0;
+    bool fieldSeen = false;
+
+    while (pos < end) {
+        uint8_t first = *pos;
+        HeaderField field;
+        uint64_t index = 0;
+
+        if (first & 0x80) {
+            // Indexed header field
+            if (!decodeInteger(pos, end, 7, index) || !lookup(index, field)) {
+                return false;
+            }
+        } else if ((first & 0xe0) == 0x20) {
+            // Dynamic table size update, only allowed before the first field
+            uint64_t newSize = 0;
+            if (fieldSeen || !decodeInteger(pos, end, 5, newSize) || newSize > m_maxTableSize) {
+                return false;
+            }
+            m_capacity = static_cast<size_t>(newSize);
+            evict(m_capacity);
+            continue;
+        } else {
+            // Literal: with incremental indexing (01), without (0000) or never indexed (0001)
+            bool incremental = (first & 0xc0) == 0x40;
+            if (!decodeInteger(pos, end, incremental ? 6 : 4, index)) {
+                return false;
+            }
+            if (index == 0) {
+                if (!decodeString(pos, end, field.name)) {
+                    return false;
+                }
+            } else {
+                HeaderField named;
+                if (!lookup(index, named)) {
+                    return false;
+                }
+                field.name = std::move(named.name);
+            }
+            if (!decodeString(pos, end, field.value)) {
+                return false;
+            }
+            if (incremental) {
+                insert(field);
+            }
+        }
+
+        fieldSeen = true;
+        listSize += entrySize(field);
+        if (listSize > m_maxHeaderListSize) {
+            return false;
+        }
+        headers.push_back(std::move(field));
+    }
+    return true;
+}
+
+bool HpackDecoder::lookup(uint64_t index, HeaderField& field) const {
+    if (index == 0) {
+        return false;
+    }
+    if (index <= STATIC_TABLE_SIZE) {
+        field.name = STATIC_TABLE[index - 1].name;
+        field.value = STATIC_TABLE[index - 1].value;
+        return true;
+    }
+    uint64_t dynamicIndex = index - STATIC_TABLE_SIZE - 1;
+    if (dynamicIndex >= m_table.size()) {
+        return false;
+    }
+    field = m_table[static_cast<size_t>(dynamicIndex)];
+    return true;
+}
+
+void HpackDecoder::insert(const HeaderField& field) {
+    size_t size = entrySize(field);
+    if (size > m_capacity) {
+        // An entry larger than the table empties it
+        evict(0);
+        return;
+    }
+    evict(m_capacity - size);
+    m_table.push_front(field);
+    m_tableSize += size;
+}
+
+void HpackDecoder::evict(size_t limit) {
+    while (m_tableSize > limit && !m_table.empty()) {
+        m_tableSize -= entrySize(m_table.back());
+        m_table.pop_back();
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Encoder
+// ---------------------------------------------------------------------------
+
+void HpackEncoder::setMaxTableSize(size_t size) {
+    size = std::min(size, MAX_ENCODER_TABLE_SIZE);
+    if (size == m_capacity) {
+        return;
+    }
+    m_smallestPendingSize = m_pendingSizeUpdate ? std::min(m_smallestPendingSize, size) : size;
+    m_pendingSizeUpdate = true;
+    m_capacity = size;
+    evict(m_capacity);
+}
+
+void HpackEncoder::encode(const HeaderList& headers, std::string& out) {
+    if (m_pendingSizeUpdate) {
+        // Announce the smallest size we went through, then the final one
+        if (m_smallestPendingSize < m_capacity) {
+            encodeInteger(m_smallestPendingSize, 5, 0x20, out);
+        }
+        encodeInteger(m_capacity, 5, 0x20, out);
+        m_pendingSizeUpdate = false;
+    }
+
+    for (const auto& field : headers) {
+        size_t nameIndex = 0;
+        size_t fullIndex = 0;
+        for (size_t i = 0; i < STATIC_TABLE_SIZE && fullIndex == 0; ++i) {
+            if (field.name == STATIC_TABLE[i].name) {
+                if (nameIndex == 0) {
+                    nameIndex = i + 1;
+                }
+                if (field.value == STATIC_TABLE[i].value) {
+                    fullIndex = i + 1;
+                }
+            }
+        }
+        for (size_t i = 0; i < m_table.size() && fullIndex == 0; ++i) {
+            if (field.name == m_table[i].name) {
+                if (nameIndex == 0) {
+                    nameIndex = STATIC_TABLE_SIZE + 1 + i;
+                }
+                if (field.value == m_table[i].value) {
+                    fullIndex = STATIC_TABLE_SIZE + 1 + i;
+                }
+            }
+        }
+
+        if (fullIndex != 0) {
+            encodeInteger(fullIndex, 7, 0x80, out);
+            continue;
+        }
+
+        bool index = shouldIndex(field);
+        if (index) {
+            encodeInteger(nameIndex, 6, 0x40, out);
+        } else {
+            encodeInteger(nameIndex, 4, 0x00, out);
+        }
+        if (nameIndex == 0) {
+            encodeString(field.name, out);
+        }
+        encodeString(field.value, out);
+        if (index) {
+            insert(field);
+        }
+    }
+}
+
+void HpackEncoder::insert(const HeaderField& field) {
+    size_t size = entrySize(field);
+    if (size > m_capacity) {
+        evict(0);
+        return;
+    }
+    evict(m_capacity - size);
+    m_table.push_front(field);
+    m_tableSize += size;
+}
+
+void HpackEncoder::evict(size_t limit) {
+    while (m_tableSize > limit && !m_table.empty()) {
+        m_tableSize -= entrySize(m_table.back());
+        m_table.pop_back();
+    }
+}
+
+} // namespace ServiceFramework
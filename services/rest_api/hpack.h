@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace ServiceFramework {
+
+/**
+ * @brief One decoded header field (names are lowercase in HTTP/2)
+ */
+struct HeaderField {
+    std::string name;
+    std::string value;
+};
+
+using HeaderList = std::vector<HeaderField>;
+
+/**
+ * @brief HPACK header compression (RFC 7541)
+ *
+ * One decoder and one encoder per HTTP/2 connection; each keeps the dynamic
+ * table for its direction, so header blocks must be processed in the order
+ * they appear on the wire. Not thread-safe.
+ */
+class HpackDecoder {
+public:
+    /**
+     * @param maxTableSize Dynamic table limit we advertise (SETTINGS_HEADER_TABLE_SIZE)
+     * @param maxHeaderListSize Largest decoded header list accepted, in RFC 7541 octets
+     */
+    explicit HpackDecoder(size_t maxTableSize = 4096, size_t maxHeaderListSize = 64 * 1024);
+
+    /**
+     * @brief Decode one complete header block
+     * @return false on a compression error or an oversized header list; the
+     *         connection must then be torn down as the table is out of sync
+     */
+    bool decode(const uint8_t* data, size_t size, HeaderList& headers);
+
+private:
+    bool lookup(uint64_t index, HeaderField& field) const;
+    void insert(const HeaderField& field);
+    void evict(size_t limit);
+
+    std::deque<HeaderField> m_table; // newest first
+    size_t m_tableSize = 0;
+    size_t m_capacity;
+    size_t m_maxTableSize;
+    size_t m_maxHeaderListSize;
+};
+
+class HpackEncoder {
+public:
+    /**
+     * @brief Apply the peer's SETTINGS_HEADER_TABLE_SIZE
+     *
+     * The table is capped at 4096 bytes regardless; a change is announced at
+     * the start of the next header block.
+     */
+    void setMaxTableSize(size_t size);
+
+    /**
+     * @brief Append the encoded form of a header list to out
+     */
+    void encode(const HeaderList& headers, std::string& out);
+
+private:
+    void insert(const HeaderField& field);
+    void evict(size_t limit);
+
+    std::deque<HeaderField> m_table; // newest first
+    size_t m_tableSize = 0;
+    size_t m_capacity = 4096;
+    bool m_pendingSizeUpdate = false;
+    size_t m_smallestPendingSize = 4096;
+};
+
+namespace Hpack {
+
+/**
+ * @brief Decode a Huffman-coded string literal
+ * @return false on invalid padding or an embedded EOS symbol
+ */
+bool huffmanDecode(const uint8_t* data, size_t size, std::string& out);
+
+/**
+ * @brief Append the Huffman-coded form of a string
+ */
+void huffmanEncode(const std::string& in, std::string& out);
+
+/**
+ * @brief Length of the Huffman-coded form of a string, in bytes
+ */
+size_t huffmanEncodedLength(const std::string& in);
+
+} // namespace Hpack
+
+} // namespace ServiceFramework
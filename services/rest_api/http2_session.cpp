@@ -0,0 +1,735 @@
+#include "http2_session.h"
+#include <algorithm>
+#include <cstring>
+
+namespace ServiceFramework {
+
+namespace {
+
+// Frame types
+const uint8_t FRAME_DATA = 0x0;
+const uint8_t FRAME_HEADERS = 0x1;
+const uint8_t FRAME_PRIORITY = 0x2;
+const uint8_t FRAME_RST_STREAM = 0x3;
+const uint8_t FRAME_SETTINGS = 0x4;
+const uint8_t FRAME_PUSH_PROMISE = 0x5;
+const uint8_t FRAME_PING = 0x6;
+const uint8_t FRAME_GOAWAY = 0x7;
+const uint8_t FRAME_WINDOW_UPDATE = 0x8;
+const uint8_t FRAME_CONTINUATION = 0x9;
+
+// Frame flags
+const uint8_t FLAG_END_STREAM = 0x1;
+const uint8_t FLAG_ACK = 0x1;
+const uint8_t FLAG_END_HEADERS = 0x4;
+const uint8_t FLAG_PADDED = 0x8;
+const uint8_t FLAG_PRIORITY = 0x20;
+
+// Error codes
+const uint32_t NO_ERROR = 0x0;
+const uint32_t PROTOCOL_ERROR = 0x1;
+const uint32_t FLOW_CONTROL_ERROR = 0x3;
+const uint32_t STREAM_CLOSED = 0x5;
+const uint32_t FRAME_SIZE_ERROR = 0x6;
+const uint32_t REFUSED_STREAM = 0x7;
+const uint32_t COMPRESSION_ERROR = 0x9;
+const uint32_t ENHANCE_YOUR_CALM = 0xb;
+
+// Settings
+const uint16_t SETTINGS_HEADER_TABLE_SIZE = 0x1;
+const uint16_t SETTINGS_ENABLE_PUSH = 0x2;
+const uint16_t SETTINGS_MAX_CONCURRENT_STREAMS = 0x3;
+const uint16_t SETTINGS_INITIAL_WINDOW_SIZE = 0x4;
+const uint16_t SETTINGS_MAX_FRAME_SIZE = 0x5;
+const uint16_t SETTINGS_MAX_HEADER_LIST_SIZE = 0x6;
+
+const size_t FRAME_HEADER_LENGTH = 9;
+const uint32_t DEFAULT_MAX_FRAME_SIZE = 16384;
+const uint32_t MAX_FRAME_SIZE_LIMIT = 16777215;
+const int64_t DEFAULT_WINDOW = 65535;
+const int64_t MAX_WINDOW = 0x7fffffff;
+
+// We open the connection-level receive window wider than the default so a
+// single upload is not throttled to 64KB per round trip
+const int64_t CONNECTION_RECEIVE_WINDOW = 1024 * 1024;
+
+uint32_t readUint32(const uint8_t* data) {
+    return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) |
+           (static_cast<uint32_t>(data[2]) << 8) | static_cast<uint32_t>(data[3]);
+}
+
+void appendUint32(std::string& out, uint32_t value) {
+    out.push_back(static_cast<char>(value >> 24));
+    out.push_back(static_cast<char>(value >> 16));
+    out.push_back(static_cast<char>(value >> 8));
+    out.push_back(static_cast<char>(value));
+}
+
+void appendSetting(std::string& out, uint16_t id, uint32_t value) {
+    out.push_back(static_cast<char>(id >> 8));
+    out.push_back(static_cast<char>(id));
+    appendUint32(out, value);
+}
+
+bool base64UrlDecode(const std::string& in, std::string& out) {
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (char c : in) {
+        int value;
+        if (c >= 'A' && c <= 'Z') {
+            value = c - 'A';
+        } else if (c >= 'a' && c <= 'z') {
+            value = c - 'a' + 26;
+        } else if (c >= '0' && c <= '9') {
+            value = c - '0' + 52;
+        } else if (c == '-' || c == '+') {
+            value = 62;
+        } else if (c == '_' || c == '/') {
+            value = 63;
+        } else if (c == '=') {
+            break;
+        } else {
+            return false;
+        }
+        buffer = (buffer << 6) | static_cast<uint32_t>(value);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out.push_back(static_cast<char>((buffer >> bits) & 0xff));
+        }
+    }
+    return true;
+}
+
+// Hop-by-hop headers have no meaning in HTTP/2 (RFC 7540 section 8.1.2.2)
+bool isConnectionSpecific(const std::string& name) {
+    return name == "connection" || name == "keep-alive" || name == "proxy-connection" ||
+           name == "transfer-encoding" || name == "upgrade" || name == "content-length";
+}
+
+} // namespace
+
+const char Http2Session::PREFACE[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+const size_t Http2Session::PREFACE_LENGTH;
+
+Http2Session::Http2Session(const Limits& limits)
+    : m_limits(limits),
+      m_decoder(4096, limits.maxHeaderListSize),
+      m_connectionSendWindow(DEFAULT_WINDOW),
+      m_connectionReceiveWindow(DEFAULT_WINDOW),
+      m_peerInitialWindow(DEFAULT_WINDOW),
+      m_peerMaxFrameSize(DEFAULT_MAX_FRAME_SIZE) {
+    // Server connection preface
+    writeSettings();
+    writeWindowUpdate(0, static_cast<uint32_t>(CONNECTION_RECEIVE_WINDOW - DEFAULT_WINDOW));
+    m_connectionReceiveWindow = CONNECTION_RECEIVE_WINDOW;
+}
+
+bool Http2Session::upgrade(const std::string& http2Settings) {
+    std::string payload;
+    if (!base64UrlDecode(http2Settings, payload) || payload.size() % 6 != 0 ||
+        !applySettings(reinterpret_cast<const uint8_t*>(payload.data()), payload.size())) {
+        return false;
+    }
+
+    // The 101 response acknowledges these settings implicitly
+    Stream& stream = m_streams[1];
+    stream.remoteClosed = true;
+    stream.dispatched = true;
+    stream.sendWindow = m_peerInitialWindow;
+    stream.receiveWindow = DEFAULT_WINDOW;
+    m_lastStreamId = 1;
+    return true;
+}
+
+bool Http2Session::receive(std::string& input) {
+    if (m_failed) {
+        input.clear();
+        return false;
+    }
+
+    size_t offset = 0;
+    if (!m_prefaceReceived) {
+        size_t compared = std::min(input.size(), PREFACE_LENGTH);
+        if (std::memcmp(input.data(), PREFACE, compared) != 0) {
+            input.clear();
+            return connectionError(PROTOCOL_ERROR);
+        }
+        if (compared < PREFACE_LENGTH) {
+            return true;
+        }
+        m_prefaceReceived = true;
+        offset = PREFACE_LENGTH;
+    }
+
+    while (input.size() - offset >= FRAME_HEADER_LENGTH) {
+        const uint8_t* header = reinterpret_cast<const uint8_t*>(input.data() + offset);
+        uint32_t length = (static_cast<uint32_t>(header[0]) << 16) |
+                          (static_cast<uint32_t>(header[1]) << 8) | header[2];
+        uint8_t type = header[3];
+        uint8_t flags = header[4];
+        uint32_t streamId = readUint32(header + 5) & 0x7fffffff;
+
+        // We never raise SETTINGS_MAX_FRAME_SIZE above the default
+        if (length > DEFAULT_MAX_FRAME_SIZE) {
+            input.clear();
+            return connectionError(FRAME_SIZE_ERROR);
+        }
+        if (input.size() - offset - FRAME_HEADER_LENGTH < length) {
+            break;
+        }
+        if (!m_settingsReceived && type != FRAME_SETTINGS) {
+            input.clear();
+            return connectionError(PROTOCOL_ERROR);
+        }
+
+        if (!processFrame(type, flags, streamId, header + FRAME_HEADER_LENGTH, length)) {
+            input.clear();
+            return false;
+        }
+        offset += FRAME_HEADER_LENGTH + length;
+    }
+
+    input.erase(0, offset);
+    return true;
+}
+
+void Http2Session::takeRequests(std::vector<StreamRequest>& requests) {
+    for (auto& request : m_ready) {
+        requests.push_back(std::move(request));
+    }
+    m_ready.clear();
+}
+
+void Http2Session::submitResponse(uint32_t streamId, int status, const HeaderList& headers,
+                                  const std::string& body) {
+    auto it = m_streams.find(streamId);
+    if (it == m_streams.end() || it->second.responded || m_failed) {
+        return;
+    }
+    Stream& stream = it->second;
+
+    HeaderList fields;
+    fields.reserve(headers.size() + 2);
+    fields.push_back({":status", std::to_string(status)});
+    for (const auto& header : headers) {
+        if (!isConnectionSpecific(header.name)) {
+            fields.push_back(header);
+        }
+    }
+    fields.push_back({"content-length", std::to_string(body.size())});
+
+    std::string block;
+    m_encoder.encode(fields, block);
+
+    // HEADERS, then CONTINUATION frames if the block exceeds the peer's frame size
+    bool endStream = body.empty();
+    size_t offset = 0;
+    bool first = true;
+    do {
+        size_t chunk = std::min<size_t>(block.size() - offset, m_peerMaxFrameSize);
+        bool last = offset + chunk == block.size();
+        uint8_t flags = (last ? FLAG_END_HEADERS : 0) | (first && endStream ? FLAG_END_STREAM : 0);
+        writeFrame(first ? FRAME_HEADERS : FRAME_CONTINUATION, flags, streamId,
+                   block.data() + offset, chunk);
+        offset += chunk;
+        first = false;
+    } while (offset < block.size());
+
+    stream.responded = true;
+    if (endStream) {
+        closeIfDone(streamId);
+        return;
+    }
+    stream.pending = body;
+    stream.pendingOffset = 0;
+    flushPending();
+}
+
+void Http2Session::goAway() {
+    if (!m_goAwaySent) {
+        writeGoAway(NO_ERROR);
+        m_goAwaySent = true;
+    }
+}
+
+bool Http2Session::isFinished() const {
+    return m_failed || ((m_goAwaySent || m_goAwayReceived) && m_streams.empty());
+}
+
+bool Http2Session::processFrame(uint8_t type, uint8_t flags, uint32_t streamId,
+                                const uint8_t* payload, size_t length) {
+    // A header block must not be interleaved with other frames
+    if (m_continuationStream != 0 && type != FRAME_CONTINUATION) {
+        return connectionError(PROTOCOL_ERROR);
+    }
+
+    switch (type) {
+    case FRAME_DATA:
+        return onData(flags, streamId, payload, length);
+    case FRAME_HEADERS:
+        return onHeaders(flags, streamId, payload, length);
+    case FRAME_PRIORITY:
+        // Advisory only; all streams are served as workers free up
+        if (streamId == 0) {
+            return connectionError(PROTOCOL_ERROR);
+        }
+        if (length != 5) {
+            resetStream(streamId, FRAME_SIZE_ERROR);
+        }
+        return true;
+    case FRAME_RST_STREAM:
+        return onRstStream(streamId, length);
+    case FRAME_SETTINGS:
+        return onSettings(flags, streamId, payload, length);
+    case FRAME_PUSH_PROMISE:
+        return connectionError(PROTOCOL_ERROR); // clients cannot push
+    case FRAME_PING:
+        return onPing(flags, streamId, payload, length);
+    case FRAME_GOAWAY:
+        return onGoAway(streamId, length);
+    case FRAME_WINDOW_UPDATE:
+        return onWindowUpdate(streamId, payload, length);
+    case FRAME_CONTINUATION:
+        return onContinuation(flags, streamId, payload, length);
+    default:
+        return true; // unknown frame types are ignored
+    }
+}
+
+bool Http2Session::onHeaders(uint8_t flags, uint32_t streamId, const uint8_t* payload, size_t length) {
+    if (streamId == 0) {
+        return connectionError(PROTOCOL_ERROR);
+    }
+
+    size_t position = 0;
+    size_t padding = 0;
+    if (flags & FLAG_PADDED) {
+        if (length < 1) {
+            return connectionError(PROTOCOL_ERROR);
+        }
+        padding = payload[0];
+        position = 1;
+    }
+    if (flags & FLAG_PRIORITY) {
+        position += 5;
+    }
+    if (position + padding > length) {
+        return connectionError(PROTOCOL_ERROR);
+    }
+
+    m_headerBlock.assign(reinterpret_cast<const char*>(payload + position), length - position - padding);
+    m_continuationEndStream = (flags & FLAG_END_STREAM) != 0;
+    if (flags & FLAG_END_HEADERS) {
+        return onHeaderBlock(streamId, m_continuationEndStream);
+    }
+    m_continuationStream = streamId;
+    return true;
+}
+
+bool Http2Session::onContinuation(uint8_t flags, uint32_t streamId, const uint8_t* payload, size_t length) {
+    if (m_continuationStream == 0 || streamId != m_continuationStream) {
+        return connectionError(PROTOCOL_ERROR);
+    }
+
+    m_headerBlock.append(reinterpret_cast<const char*>(payload), length);
+    if (m_headerBlock.size() > m_limits.maxHeaderListSize) {
+        return connectionError(ENHANCE_YOUR_CALM);
+    }
+    if (flags & FLAG_END_HEADERS) {
+        m_continuationStream = 0;
+        return onHeaderBlock(streamId, m_continuationEndStream);
+    }
+    return true;
+}
+
+bool Http2Session::onHeaderBlock(uint32_t streamId, bool endStream) {
+    // Always decode, even for streams we refuse, to keep HPACK state in sync
+    HeaderList headers;
+    bool decoded = m_decoder.decode(reinterpret_cast<const uint8_t*>(m_headerBlock.data()),
+                                    m_headerBlock.size(), headers);
+    m_headerBlock.clear();
+    if (!decoded) {
+        return connectionError(COMPRESSION_ERROR);
+    }
+
+    auto it = m_streams.find(streamId);
+    if (it != m_streams.end()) {
+        // Trailers: accepted to end the stream, their fields are dropped
+        Stream& stream = it->second;
+        if (stream.remoteClosed) {
+            resetStream(streamId, STREAM_CLOSED);
+        } else if (!endStream) {
+            resetStream(streamId, PROTOCOL_ERROR);
+        } else {
+            stream.remoteClosed = true;
+            if (stream.discardBody) {
+                closeIfDone(streamId);
+            } else {
+                completeRequest(streamId, stream);
+            }
+        }
+        return true;
+    }
+
+    if (streamId <= m_lastStreamId) {
+        return connectionError(STREAM_CLOSED);
+    }
+    if ((streamId & 1) == 0) {
+        return connectionError(PROTOCOL_ERROR);
+    }
+    if (m_goAwaySent || m_goAwayReceived) {
+        return true; // streams after GOAWAY are ignored
+    }
+    m_lastStreamId = streamId;
+
+    if (m_streams.size() >= m_limits.maxConcurrentStreams) {
+        resetStream(streamId, REFUSED_STREAM);
+        return true;
+    }
+
+    bool hasMethod = false;
+    bool hasPath = false;
+    for (const auto& field : headers) {
+        hasMethod = hasMethod || field.name == ":method";
+        hasPath = hasPath || field.name == ":path";
+    }
+    if (!hasMethod || !hasPath) {
+        resetStream(streamId, PROTOCOL_ERROR);
+        return true;
+    }
+
+    Stream& stream = m_streams[streamId];
+    stream.headers = std::move(headers);
+    stream.sendWindow = m_peerInitialWindow;
+    stream.receiveWindow = DEFAULT_WINDOW;
+    if (endStream) {
+        stream.remoteClosed = true;
+        completeRequest(streamId, stream);
+    }
+    return true;
+}
+
+bool Http2Session::onData(uint8_t flags, uint32_t streamId, const uint8_t* payload, size_t length) {
+    if (streamId == 0) {
+        return connectionError(PROTOCOL_ERROR);
+    }
+
+    size_t position = 0;
+    size_t padding = 0;
+    if (flags & FLAG_PADDED) {
+        if (length < 1) {
+            return connectionError(PROTOCOL_ERROR);
+        }
+        padding = payload[0];
+        position = 1;
+    }
+    if (position + padding > length) {
+        return connectionError(PROTOCOL_ERROR);
+    }
+
+    // Flow control covers the whole payload, padding included
+    int64_t flowLength = static_cast<int64_t>(length);
+    if (flowLength > m_connectionReceiveWindow) {
+        return connectionError(FLOW_CONTROL_ERROR);
+    }
+    m_connectionReceiveWindow -= flowLength;
+    m_receivedUnacknowledged += static_cast<uint32_t>(length);
+    if (m_receivedUnacknowledged >= CONNECTION_RECEIVE_WINDOW / 2) {
+        writeWindowUpdate(0, m_receivedUnacknowledged);
+        m_connectionReceiveWindow += m_receivedUnacknowledged;
+        m_receivedUnacknowledged = 0;
+    }
+
+    auto it = m_streams.find(streamId);
+    if (it == m_streams.end()) {
+        if (streamId > m_lastStreamId) {
+            return connectionError(PROTOCOL_ERROR); // stream never opened
+        }
+        return true; // stream we already reset or answered
+    }
+    Stream& stream = it->second;
+    if (stream.remoteClosed) {
+        resetStream(streamId, STREAM_CLOSED);
+        return true;
+    }
+    if (flowLength > stream.receiveWindow) {
+        resetStream(streamId, FLOW_CONTROL_ERROR);
+        return true;
+    }
+    stream.receiveWindow -= flowLength;
+
+    size_t dataLength = length - position - padding;
+    bool endStream = (flags & FLAG_END_STREAM) != 0;
+    if (!stream.discardBody) {
+        if (stream.body.size() + dataLength > m_limits.maxBodySize) {
+            // Answer now; the stream is reset once the response is out
+            stream.discardBody = true;
+            stream.body.clear();
+            stream.remoteClosed = stream.remoteClosed || endStream;
+            submitResponse(streamId, 413, {{"content-type", "application/json"}},
+                           R"({"error": "Payload Too Large"})");
+            return true;
+        }
+        stream.body.append(reinterpret_cast<const char*>(payload + position), dataLength);
+    }
+
+    if (endStream) {
+        stream.remoteClosed = true;
+        if (stream.discardBody) {
+            closeIfDone(streamId);
+        } else {
+            completeRequest(streamId, stream);
+        }
+    } else if (stream.receiveWindow < DEFAULT_WINDOW / 2) {
+        writeWindowUpdate(streamId, static_cast<uint32_t>(DEFAULT_WINDOW - stream.receiveWindow));
+        stream.receiveWindow = DEFAULT_WINDOW;
+    }
+    return true;
+}
+
+bool Http2Session::onSettings(uint8_t flags, uint32_t streamId, const uint8_t* payload, size_t length) {
+    if (streamId != 0) {
+        return connectionError(PROTOCOL_ERROR);
+    }
+    if (flags & FLAG_ACK) {
+        return length == 0 ? true : connectionError(FRAME_SIZE_ERROR);
+    }
+    if (length % 6 != 0) {
+        return connectionError(FRAME_SIZE_ERROR);
+    }
+    if (!applySettings(payload, length)) {
+        return false;
+    }
+
+    m_settingsReceived = true;
+    writeFrame(FRAME_SETTINGS, FLAG_ACK, 0, nullptr, 0);
+    flushPending();
+    return true;
+}
+
+bool Http2Session::applySettings(const uint8_t* payload, size_t length) {
+    for (size_t offset = 0; offset + 6 <= length; offset += 6) {
+        uint16_t id = static_cast<uint16_t>((payload[offset] << 8) | payload[offset + 1]);
+        uint32_t value = readUint32(payload + offset + 2);
+
+        switch (id) {
+        case SETTINGS_HEADER_TABLE_SIZE:
+            m_encoder.setMaxTableSize(value);
+            break;
+        case SETTINGS_ENABLE_PUSH:
+            if (value > 1) {
+                return connectionError(PROTOCOL_ERROR);
+            }
+            break; // we never push
+        case SETTINGS_INITIAL_WINDOW_SIZE: {
+            if (value > MAX_WINDOW) {
+                return connectionError(FLOW_CONTROL_ERROR);
+            }
+            // Applies retroactively to every open stream
+            int64_t delta = static_cast<int64_t>(value) - m_peerInitialWindow;
+            for (auto& entry : m_streams) {
+                entry.second.sendWindow += delta;
+                if (entry.second.sendWindow > MAX_WINDOW) {
+                    return connectionError(FLOW_CONTROL_ERROR);
+                }
+            }
+            m_peerInitialWindow = value;
+            break;
+        }
+        case SETTINGS_MAX_FRAME_SIZE:
+            if (value < DEFAULT_MAX_FRAME_SIZE || value > MAX_FRAME_SIZE_LIMIT) {
+                return connectionError(PROTOCOL_ERROR);
+            }
+            m_peerMaxFrameSize = value;
+            break;
+        case SETTINGS_MAX_CONCURRENT_STREAMS:
+        case SETTINGS_MAX_HEADER_LIST_SIZE:
+        default:
+            break; // only relevant to streams we would initiate, or unknown
+        }
+    }
+    return true;
+}
+
+bool Http2Session::onWindowUpdate(uint32_t streamId, const uint8_t* payload, size_t length) {
+    if (length != 4) {
+        return connectionError(FRAME_SIZE_ERROR);
+    }
+    uint32_t increment = readUint32(payload) & 0x7fffffff;
+
+    if (streamId == 0) {
+        if (increment == 0) {
+            return connectionError(PROTOCOL_ERROR);
+        }
+        m_connectionSendWindow += increment;
+        if (m_connectionSendWindow > MAX_WINDOW) {
+            return connectionError(FLOW_CONTROL_ERROR);
+        }
+    } else {
+        auto it = m_streams.find(streamId);
+        if (it == m_streams.end()) {
+            return streamId > m_lastStreamId ? connectionError(PROTOCOL_ERROR) : true;
+        }
+        if (increment == 0) {
+            resetStream(streamId, PROTOCOL_ERROR);
+            return true;
+        }
+        it->second.sendWindow += increment;
+        if (it->second.sendWindow > MAX_WINDOW) {
+            resetStream(streamId, FLOW_CONTROL_ERROR);
+            return true;
+        }
+    }
+
+    flushPending();
+    return true;
+}
+
+bool Http2Session::onRstStream(uint32_t streamId, size_t length) {
+    if (streamId == 0 || streamId > m_lastStreamId) {
+        return connectionError(PROTOCOL_ERROR);
+    }
+    if (length != 4) {
+        return connectionError(FRAME_SIZE_ERROR);
+    }
+    // A response still being produced for it is dropped on submit
+    m_streams.erase(streamId);
+    return true;
+}
+
+bool Http2Session::onPing(uint8_t flags, uint32_t streamId, const uint8_t* payload, size_t length) {
+    if (streamId != 0) {
+        return connectionError(PROTOCOL_ERROR);
+    }
+    if (length != 8) {
+        return connectionError(FRAME_SIZE_ERROR);
+    }
+    if ((flags & FLAG_ACK) == 0) {
+        writeFrame(FRAME_PING, FLAG_ACK, 0, reinterpret_cast<const char*>(payload), length);
+    }
+    return true;
+}
+
+bool Http2Session::onGoAway(uint32_t streamId, size_t length) {
+    if (streamId != 0) {
+        return connectionError(PROTOCOL_ERROR);
+    }
+    if (length < 8) {
+        return connectionError(FRAME_SIZE_ERROR);
+    }
+    // The peer opens no new streams; finish the ones we have
+    m_goAwayReceived = true;
+    return true;
+}
+
+void Http2Session::completeRequest(uint32_t streamId, Stream& stream) {
+    stream.dispatched = true;
+    StreamRequest request;
+    request.streamId = streamId;
+    request.headers = std::move(stream.headers);
+    request.body = std::move(stream.body);
+    stream.headers.clear();
+    stream.body.clear();
+    m_ready.push_back(std::move(request));
+}
+
+void Http2Session::flushPending() {
+    for (auto it = m_streams.begin(); it != m_streams.end() && m_connectionSendWindow > 0;) {
+        uint32_t streamId = it->first;
+        Stream& stream = it->second;
+        ++it; // closeIfDone() may erase this stream
+
+        if (!stream.responded || stream.pendingOffset >= stream.pending.size()) {
+            continue;
+        }
+
+        while (stream.pendingOffset < stream.pending.size() && stream.sendWindow > 0 &&
+               m_connectionSendWindow > 0) {
+            size_t chunk = std::min<size_t>(stream.pending.size() - stream.pendingOffset,
+                                            static_cast<size_t>(stream.sendWindow));
+            chunk = std::min<size_t>(chunk, static_cast<size_t>(m_connectionSendWindow));
+            chunk = std::min<size_t>(chunk, m_peerMaxFrameSize);
+            bool last = stream.pendingOffset + chunk == stream.pending.size();
+
+            writeFrame(FRAME_DATA, last ? FLAG_END_STREAM : 0, streamId,
+                       stream.pending.data() + stream.pendingOffset, chunk);
+            stream.pendingOffset += chunk;
+            stream.sendWindow -= static_cast<int64_t>(chunk);
+            m_connectionSendWindow -= static_cast<int64_t>(chunk);
+        }
+
+        if (stream.pendingOffset >= stream.pending.size()) {
+            closeIfDone(streamId);
+        }
+    }
+}
+
+void Http2Session::closeIfDone(uint32_t streamId) {
+    auto it = m_streams.find(streamId);
+    if (it == m_streams.end()) {
+        return;
+    }
+    const Stream& stream = it->second;
+    if (!stream.responded || stream.pendingOffset < stream.pending.size()) {
+        return;
+    }
+    if (!stream.remoteClosed) {
+        // Answered before the request finished: tell the peer to stop sending
+        std::string code;
+        appendUint32(code, NO_ERROR);
+        writeFrame(FRAME_RST_STREAM, 0, streamId, code.data(), code.size());
+    }
+    m_streams.erase(it);
+}
+
+void Http2Session::resetStream(uint32_t streamId, uint32_t errorCode) {
+    std::string code;
+    appendUint32(code, errorCode);
+    writeFrame(FRAME_RST_STREAM, 0, streamId, code.data(), code.size());
+    m_streams.erase(streamId);
+}
+
+bool Http2Session::connectionError(uint32_t errorCode) {
+    if (!m_failed) {
+        writeGoAway(errorCode);
+        m_goAwaySent = true;
+        m_failed = true;
+    }
+    return false;
+}
+
+void Http2Session::writeFrame(uint8_t type, uint8_t flags, uint32_t streamId,
+                              const char* payload, size_t length) {
+    m_output.push_back(static_cast<char>(length >> 16));
+    m_output.push_back(static_cast<char>(length >> 8));
+    m_output.push_back(static_cast<char>(length));
+    m_output.push_back(static_cast<char>(type));
+    m_output.push_back(static_cast<char>(flags));
+    appendUint32(m_output, streamId & 0x7fffffff);
+    if (length > 0) {
+        m_output.append(payload, length);
+    }
+}
+
+void Http2Session::writeSettings() {
+    std::string payload;
+    appendSetting(payload, SETTINGS_MAX_CONCURRENT_STREAMS, m_limits.maxConcurrentStreams);
+    appendSetting(payload, SETTINGS_MAX_HEADER_LIST_SIZE, static_cast<uint32_t>(m_limits.maxHeaderListSize));
+    writeFrame(FRAME_SETTINGS, 0, 0, payload.data(), payload.size());
+}
+
+void Http2Session::writeWindowUpdate(uint32_t streamId, uint32_t increment) {
+    std::string payload;
+    appendUint32(payload, increment & 0x7fffffff);
+    writeFrame(FRAME_WINDOW_UPDATE, 0, streamId, payload.data(), payload.size());
+}
+
+void Http2Session::writeGoAway(uint32_t errorCode) {
+    std::string payload;
+    appendUint32(payload, m_lastStreamId);
+    appendUint32(payload, errorCode);
+    writeFrame(FRAME_GOAWAY, 0, 0, payload.data(), payload.size());
+}
+
+} // namespace ServiceFramework
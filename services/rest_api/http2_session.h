@@ -0,0 +1,159 @@
+#pragma once
+
+#include "hpack.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ServiceFramework {
+
+/**
+ * @brief Server side of one HTTP/2 connection (RFC 7540), without sockets
+ *
+ * The owner feeds received bytes into receive(), collects complete requests
+ * with takeRequests(), answers them in any order with submitResponse() and
+ * writes whatever accumulates in output(). The session handles framing,
+ * HPACK, stream states and flow control in both directions; response
+ * bodies larger than the peer's windows are held back until WINDOW_UPDATE
+ * frames arrive. Not thread-safe: owned by the I/O loop.
+ */
+class Http2Session {
+public:
+    struct Limits {
+        uint32_t maxConcurrentStreams = 100;
+        size_t maxHeaderListSize = 64 * 1024;
+        size_t maxBodySize = 8 * 1024 * 1024;
+    };
+
+    /**
+     * @brief A stream whose request has been fully received
+     */
+    struct StreamRequest {
+        uint32_t streamId = 0;
+        HeaderList headers; // pseudo-headers (":method", ":path", ...) first
+        std::string body;
+    };
+
+    // Client connection preface (prior knowledge starts with this)
+    static const char PREFACE[];
+    static const size_t PREFACE_LENGTH = 24;
+
+    explicit Http2Session(const Limits& limits);
+
+    /**
+     * @brief Take over an HTTP/1.1 connection after "Upgrade: h2c"
+     *
+     * The upgrading request becomes stream 1, already fully received; its
+     * response must be submitted with submitResponse(1, ...).
+     * @param http2Settings Value of the request's HTTP2-Settings header
+     * @return false if the settings are malformed
+     */
+    bool upgrade(const std::string& http2Settings);
+
+    /**
+     * @brief Consume complete frames from the front of input
+     * @return false on a connection error; a GOAWAY is queued and the
+     *         connection should be closed once output is flushed
+     */
+    bool receive(std::string& input);
+
+    /**
+     * @brief Move out requests completed since the last call
+     */
+    void takeRequests(std::vector<StreamRequest>& requests);
+
+    /**
+     * @brief Send a response on a stream; ignored if the peer reset it
+     * @param headers Regular headers with lowercase names
+     */
+    void submitResponse(uint32_t streamId, int status, const HeaderList& headers,
+                        const std::string& body);
+
+    /**
+     * @brief Stop accepting new streams (graceful shutdown)
+     */
+    void goAway();
+
+    /**
+     * @brief Bytes ready to be written to the socket
+     */
+    std::string& output() { return m_output; }
+
+    /**
+     * @brief Streams that are open or awaiting a response
+     */
+    size_t activeStreams() const { return m_streams.size(); }
+
+    /**
+     * @brief True once the connection should be closed after flushing output
+     */
+    bool isFinished() const;
+
+private:
+    struct Stream {
+        bool remoteClosed = false;  // END_STREAM received
+        bool dispatched = false;    // handed to the owner via takeRequests()
+        bool responded = false;     // response HEADERS sent
+        bool discardBody = false;   // answered early, ignore further DATA
+        HeaderList headers;
+        std::string body;
+        int64_t sendWindow = 0;
+        int64_t receiveWindow = 0;
+        std::string pending;        // response body held back by flow control
+        size_t pendingOffset = 0;
+    };
+
+    bool processFrame(uint8_t type, uint8_t flags, uint32_t streamId,
+                      const uint8_t* payload, size_t length);
+    bool onHeaders(uint8_t flags, uint32_t streamId, const uint8_t* payload, size_t length);
+    bool onContinuation(uint8_t flags, uint32_t streamId, const uint8_t* payload, size_t length);
+    bool onHeaderBlock(uint32_t streamId, bool endStream);
+    bool onData(uint8_t flags, uint32_t streamId, const uint8_t* payload, size_t length);
+    bool onSettings(uint8_t flags, uint32_t streamId, const uint8_t* payload, size_t length);
+    bool onWindowUpdate(uint32_t streamId, const uint8_t* payload, size_t length);
+    bool onRstStream(uint32_t streamId, size_t length);
+    bool onPing(uint8_t flags, uint32_t streamId, const uint8_t* payload, size_t length);
+    bool onGoAway(uint32_t streamId, size_t length);
+    bool applySettings(const uint8_t* payload, size_t length);
+
+    void completeRequest(uint32_t streamId, Stream& stream);
+    void flushPending();
+    void closeIfDone(uint32_t streamId);
+    void resetStream(uint32_t streamId, uint32_t errorCode);
+    bool connectionError(uint32_t errorCode);
+
+    void writeFrame(uint8_t type, uint8_t flags, uint32_t streamId, const char* payload, size_t length);
+    void writeSettings();
+    void writeWindowUpdate(uint32_t streamId, uint32_t increment);
+    void writeGoAway(uint32_t errorCode);
+
+    Limits m_limits;
+    HpackDecoder m_decoder;
+    HpackEncoder m_encoder;
+    std::map<uint32_t, Stream> m_streams;
+    std::vector<StreamRequest> m_ready;
+    std::string m_output;
+
+    bool m_prefaceReceived = false;
+    bool m_settingsReceived = false;
+    bool m_goAwaySent = false;
+    bool m_goAwayReceived = false;
+    bool m_failed = false;
+    uint32_t m_lastStreamId = 0;
+
+    // Header block spanning HEADERS + CONTINUATION frames
+    uint32_t m_continuationStream = 0;
+    bool m_continuationEndStream = false;
+    std::string m_headerBlock;
+
+    // Flow control
+    int64_t m_connectionSendWindow;
+    int64_t m_connectionReceiveWindow;
+    uint32_t m_receivedUnacknowledged = 0;
+    int64_t m_peerInitialWindow;
+    uint32_t m_peerMaxFrameSize;
+};
+
+} // namespace ServiceFramework
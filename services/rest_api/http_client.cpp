@@ -0,0 +1,419 @@
+#include "http_client.h"
+#include <algorithm>
+#include <strings.h>
+#include <system_error>
+
+namespace ServiceFramework {
+
+namespace {
+
+ClientError toClientError(Http1::Status status) {
+    switch (status) {
+    case Http1::Status::Ok: return ClientError::None;
+    case Http1::Status::ConnectFailed: return ClientError::Connect;
+    case Http1::Status::Timeout: return ClientError::Timeout;
+    case Http1::Status::Malformed: return ClientError::Protocol;
+    case Http1::Status::Closed: break;
+    }
+    return ClientError::Closed;
+}
+
+} // namespace
+
+// One request from send() to completion, shared by its attempts
+struct HttpClient::Call {
+    ClientRequest request;
+    std::string head;
+    bool idempotent = false;
+    bool headRequest = false;
+    UpstreamPool* pool = nullptr;
+    Clock::time_point deadline;
+    std::promise<ClientResult> promise;
+    ClientCallback callback;
+
+    std::mutex mutex;
+    bool done = false;
+    int attempts = 0;
+    int inFlight = 0;
+    int retries = 0;
+};
+
+bool ClientRequest::idempotent() const {
+    return Http1::isIdempotent(method);
+}
+
+bool ClientRequest::fromUrl(const std::string& method, const std::string& url, ClientRequest& request) {
+    const std::string scheme = "http://";
+    if (url.compare(0, scheme.size(), scheme) != 0) {
+        return false;
+    }
+    size_t hostStart = scheme.size();
+    size_t pathStart = url.find_first_of("/?", hostStart);
+    std::string authority = url.substr(hostStart, pathStart == std::string::npos ? std::string::npos : pathStart - hostStart);
+    if (authority.empty()) {
+        return false;
+    }
+
+    // Default port unless one follows the host (or a bracketed IPv6 host)
+    size_t colon = authority.rfind(':');
+    bool hasPort = colon != std::string::npos && (authority[0] != '[' || colon > authority.find(']'));
+    request.method = method;
+    request.address = hasPort ? authority : authority + ":80";
+    request.target = pathStart == std::string::npos ? "/" : url.substr(pathStart);
+    if (request.target[0] == '?') {
+        request.target.insert(0, "/");
+    }
+    request.headers["Host"] = authority;
+    return true;
+}
+
+HttpClient::HttpClient(const HttpClientOptions& options) : m_options(options) {
+    size_t threads = std::max<size_t>(1, m_options.workerThreads);
+    for (size_t i = 0; i < threads; ++i) {
+        m_workers.emplace_back([this, i] {
+            ThreadAffinity::apply(m_options.placement, i);
+            workerLoop();
+        });
+    }
+    if (m_options.hedgeDelay.count() > 0) {
+        m_hedger = std::thread([this] { hedgeLoop(); });
+    }
+}
+
+HttpClient::~HttpClient() {
+    // Hedges first: a running one may still hand a retry to the workers.
+    // Pending ones are dropped, their calls' first attempts are queued.
+    if (m_hedger.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_hedgesMutex);
+            m_hedgesStopping = true;
+        }
+        m_hedgesCondition.notify_all();
+        m_hedger.join();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_tasksMutex);
+        m_stopping = true;
+    }
+    m_tasksCondition.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+std::future<ClientResult> HttpClient::send(ClientRequest request) {
+    CallPtr call = makeCall(std::move(request), nullptr);
+    std::future<ClientResult> result = call->promise.get_future();
+    start(call);
+    return result;
+}
+
+void HttpClient::send(ClientRequest request, ClientCallback callback) {
+    start(makeCall(std::move(request), std::move(callback)));
+}
+
+std::vector<std::future<ClientResult>> HttpClient::sendBatch(std::vector<ClientRequest> requests) {
+    std::vector<std::future<ClientResult>> results;
+    results.reserve(requests.size());
+
+    // Idempotent requests grouped by host, in order; the rest go one by one
+    std::map<std::string, std::vector<CallPtr>> pipelines;
+    for (auto& request : requests) {
+        CallPtr call = makeCall(std::move(request), nullptr);
+        results.push_back(call->promise.get_future());
+        if (call->idempotent && call->pool && m_options.maxPipelineDepth > 1) {
+            pipelines[call->request.address].push_back(call);
+        } else {
+            start(call);
+        }
+    }
+
+    for (auto& hostCalls : pipelines) {
+        std::vector<CallPtr>& calls = hostCalls.second;
+        for (size_t first = 0; first < calls.size(); first += m_options.maxPipelineDepth) {
+            size_t last = std::min(calls.size(), first + m_options.maxPipelineDepth);
+            std::vector<CallPtr> chunk(calls.begin() + first, calls.begin() + last);
+            if (chunk.size() == 1) {
+                start(chunk[0]);
+            } else {
+                schedule(Clock::now(), [this, chunk]() { pipeline(chunk); });
+            }
+        }
+    }
+    return results;
+}
+
+uint64_t HttpClient::connectionsOpened() const {
+    std::lock_guard<std::mutex> lock(m_poolsMutex);
+    uint64_t total = 0;
+    for (const auto& pool : m_pools) {
+        total += pool.second->connectionsOpened();
+    }
+    return total;
+}
+
+HttpClient::CallPtr HttpClient::makeCall(ClientRequest request, ClientCallback callback) {
+    auto call = std::make_shared<Call>();
+    call->request = std::move(request);
+    call->head = buildHead(call->request);
+    call->idempotent = call->request.idempotent();
+    call->headRequest = call->request.method == "HEAD";
+    call->pool = poolFor(call->request.address);
+    auto timeout = call->request.timeout.count() > 0 ? call->request.timeout : m_options.requestTimeout;
+    call->deadline = Clock::now() + timeout;
+    call->callback = std::move(callback);
+    return call;
+}
+
+void HttpClient::start(const CallPtr& call) {
+    if (!call->pool) {
+        fail(call, ClientError::InvalidRequest);
+        return;
+    }
+
+    auto now = Clock::now();
+    schedule(now, [this, call]() { attempt(call); });
+    if (call->idempotent && m_options.hedgeDelay.count() > 0 && now + m_options.hedgeDelay < call->deadline) {
+        scheduleHedge(now + m_options.hedgeDelay, [this, call]() { attempt(call); });
+    }
+}
+
+void HttpClient::attempt(const CallPtr& call, bool counted) {
+    {
+        std::lock_guard<std::mutex> lock(call->mutex);
+        if (call->done) {
+            return;
+        }
+        if (!counted) {
+            ++call->attempts;
+        }
+        ++call->inFlight;
+    }
+
+    HttpResponse response;
+    auto now = Clock::now();
+    Http1::Status status = Http1::Status::Timeout;
+    if (now < call->deadline) {
+        auto connectDeadline = std::min(call->deadline, now + m_options.connectTimeout);
+        status = Http1::exchange(*call->pool, call->head, call->request.body, connectDeadline, call->deadline,
+                                 call->headRequest, call->idempotent, m_options.maxResponseBytes, response);
+    }
+
+    if (status == Http1::Status::Ok) {
+        {
+            std::lock_guard<std::mutex> lock(call->mutex);
+            --call->inFlight;
+        }
+        ClientResult result;
+        result.response = std::move(response);
+        complete(call, result);
+        return;
+    }
+
+    bool retry = false;
+    bool lastAttempt = false;
+    {
+        std::lock_guard<std::mutex> lock(call->mutex);
+        --call->inFlight;
+        if (call->done) {
+            return;
+        }
+        if (call->idempotent && status != Http1::Status::Timeout && call->retries < m_options.maxRetries) {
+            ++call->retries;
+            retry = true;
+        } else {
+            // A hedged attempt still running may yet answer
+            lastAttempt = call->inFlight == 0;
+        }
+    }
+
+    if (retry) {
+        schedule(Clock::now(), [this, call]() { attempt(call); });
+    } else if (lastAttempt) {
+        fail(call, toClientError(status));
+    }
+}
+
+void HttpClient::pipeline(std::vector<CallPtr> calls) {
+    UpstreamPool& pool = *calls[0]->pool;
+    auto now = Clock::now();
+    auto deadline = calls[0]->deadline;
+    for (const auto& call : calls) {
+        deadline = std::min(deadline, call->deadline);
+        std::lock_guard<std::mutex> lock(call->mutex);
+        ++call->attempts;
+    }
+
+    // Requests back to back on one connection, responses read in order;
+    // whatever is left unanswered falls back to single attempts
+    size_t answered = 0;
+    bool reusable = false;
+    UpstreamPool::Lease lease;
+    if (now < deadline && pool.acquire(lease, std::min(deadline, now + m_options.connectTimeout))) {
+        std::vector<struct iovec> iov;
+        iov.reserve(2 * calls.size());
+        for (const auto& call : calls) {
+            iov.push_back({const_cast<char*>(call->head.data()), call->head.size()});
+            iov.push_back({const_cast<char*>(call->request.body.data()), call->request.body.size()});
+        }
+        Http1::Status status = Http1::writeAll(lease.fd, iov.data(), static_cast<int>(iov.size()), deadline);
+
+        Http1::ResponseReader reader(lease.fd);
+        bool keepAlive = true;
+        while (status == Http1::Status::Ok && keepAlive && answered < calls.size()) {
+            ClientResult result;
+            status = Http1::readResponse(reader, deadline, calls[answered]->headRequest, m_options.maxResponseBytes,
+                                         result.response, keepAlive);
+            if (status == Http1::Status::Ok) {
+                complete(calls[answered++], result);
+            }
+        }
+        reusable = status == Http1::Status::Ok && keepAlive && reader.drained();
+        pool.release(lease, reusable);
+    }
+
+    // The fallback finishes the attempt counted above rather than adding one
+    for (size_t i = answered; i < calls.size(); ++i) {
+        schedule(Clock::now(), [this, call = calls[i]]() { attempt(call, true); });
+    }
+}
+
+void HttpClient::complete(const CallPtr& call, ClientResult& result) {
+    {
+        std::lock_guard<std::mutex> lock(call->mutex);
+        if (call->done) {
+            return;
+        }
+        call->done = true;
+        result.attempts = call->attempts;
+    }
+
+    if (call->callback) {
+        call->callback(result);
+    } else {
+        call->promise.set_value(std::move(result));
+    }
+}
+
+void HttpClient::fail(const CallPtr& call, ClientError error) {
+    ClientResult result;
+    result.error = error;
+    result.response.statusCode = 0;
+    result.response.statusText.clear();
+    result.response.headers.clear();
+    complete(call, result);
+}
+
+void HttpClient::schedule(Clock::time_point notBefore, std::function<void()> run) {
+    {
+        std::lock_guard<std::mutex> lock(m_tasksMutex);
+        m_tasks.push(Task{notBefore, m_taskSequence++, std::move(run)});
+    }
+    m_tasksCondition.notify_one();
+}
+
+void HttpClient::scheduleHedge(Clock::time_point notBefore, std::function<void()> run) {
+    {
+        std::lock_guard<std::mutex> lock(m_hedgesMutex);
+        m_hedges.push(Task{notBefore, m_hedgeSequence++, std::move(run)});
+    }
+    m_hedgesCondition.notify_one();
+}
+
+UpstreamPool* HttpClient::poolFor(const std::string& address) {
+    std::lock_guard<std::mutex> lock(m_poolsMutex);
+    auto& pool = m_pools[address];
+    if (!pool) {
+        pool = std::make_unique<UpstreamPool>(std::vector<std::string>{address}, m_options.maxIdlePerHost);
+    }
+    return pool->valid() ? pool.get() : nullptr;
+}
+
+std::string HttpClient::buildHead(const ClientRequest& request) {
+    std::string head;
+    head.reserve(128);
+    head += request.method + " " + request.target + " HTTP/1.1\r\n";
+
+    bool hasHost = false;
+    for (const auto& header : request.headers) {
+        if (Http1::isHopByHopHeader(header.first)) {
+            continue;
+        }
+        hasHost = hasHost || strcasecmp(header.first.c_str(), "host") == 0;
+        head += header.first + ": " + header.second + "\r\n";
+    }
+    if (!hasHost) {
+        bool unixSocket = request.address.compare(0, 5, "unix:") == 0 || request.address.compare(0, 1, "@") == 0;
+        head += "Host: " + (unixSocket ? std::string("localhost") : request.address) + "\r\n";
+    }
+    if (!request.body.empty() || request.method == "POST" || request.method == "PUT" || request.method == "PATCH") {
+        head += "Content-Length: " + std::to_string(request.body.size()) + "\r\n";
+    }
+    head += "\r\n";
+    return head;
+}
+
+void HttpClient::workerLoop() {
+    std::unique_lock<std::mutex> lock(m_tasksMutex);
+    while (true) {
+        if (m_tasks.empty()) {
+            if (m_stopping) {
+                return;
+            }
+            m_tasksCondition.wait(lock);
+            continue;
+        }
+
+        // Delayed tasks run early once stopping; attempts are no-ops for
+        // calls that have already completed
+        Clock::time_point due = m_tasks.top().notBefore;
+        if (!m_stopping && due > Clock::now()) {
+            m_tasksCondition.wait_until(lock, due);
+            continue;
+        }
+
+        std::function<void()> run = std::move(const_cast<Task&>(m_tasks.top()).run);
+        m_tasks.pop();
+        lock.unlock();
+        run();
+        lock.lock();
+    }
+}
+
+void HttpClient::hedgeLoop() {
+    // Each hedge is bounded by its call's deadline, so the threads still
+    // running when the loop ends are joined by their futures shortly after
+    std::vector<std::future<void>> running;
+    std::unique_lock<std::mutex> lock(m_hedgesMutex);
+    while (!m_hedgesStopping) {
+        running.erase(std::remove_if(running.begin(), running.end(),
+                                     [](const std::future<void>& hedge) {
+                                         return hedge.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+                                     }),
+                      running.end());
+
+        if (m_hedges.empty()) {
+            m_hedgesCondition.wait(lock);
+            continue;
+        }
+        Clock::time_point due = m_hedges.top().notBefore;
+        if (due > Clock::now()) {
+            m_hedgesCondition.wait_until(lock, due);
+            continue;
+        }
+
+        std::function<void()> run = std::move(const_cast<Task&>(m_hedges.top()).run);
+        m_hedges.pop();
+        lock.unlock();
+        try {
+            running.push_back(std::async(std::launch::async, run));
+        } catch (const std::system_error&) {
+            // No thread to spare: the hedge waits for a worker instead
+            schedule(Clock::now(), std::move(run));
+        }
+        lock.lock();
+    }
+}
+
+} // namespace ServiceFramework
@@ -0,0 +1,191 @@
+#pragma once
+
+#include "rest_api_service.h"
+#include "upstream_pool.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace ServiceFramework {
+
+/**
+ * @brief Pools, timeouts and retry policy of an HttpClient
+ */
+struct HttpClientOptions {
+    size_t workerThreads = 4;    // exchanges in progress at once, hedges aside
+    size_t maxIdlePerHost = 16;  // keep-alive connections kept per host
+    size_t maxPipelineDepth = 8; // requests written ahead on one connection by sendBatch()
+    std::chrono::milliseconds connectTimeout{1000};
+    std::chrono::milliseconds requestTimeout{10000}; // per request, retries and hedges included
+    // Idempotent requests only: a second attempt starts if the first has not
+    // answered after hedgeDelay (0 disables), and failed attempts are retried.
+    // Hedges run on threads of their own, not on the workers
+    std::chrono::milliseconds hedgeDelay{0};
+    int maxRetries = 1;
+    size_t maxResponseBytes = 64 * 1024 * 1024;
+    ThreadPlacement placement; // where the worker threads run
+};
+
+/**
+ * @brief One outgoing request
+ */
+struct ClientRequest {
+    std::string method = "GET";
+    std::string address;       // "host:port", "unix:/path/to.sock" or "@abstract"
+    std::string target = "/";  // path and query
+    std::map<std::string, std::string> headers;
+    std::string body;
+    std::chrono::milliseconds timeout{0}; // 0: HttpClientOptions::requestTimeout
+
+    /**
+     * @brief Safe to send twice (GET, HEAD, OPTIONS, PUT, DELETE)
+     */
+    bool idempotent() const;
+
+    /**
+     * @brief Fill address and target from "http://host[:port]/path?query"
+     * @return false if the URL is not a plain http:// URL
+     */
+    static bool fromUrl(const std::string& method, const std::string& url, ClientRequest& request);
+};
+
+enum class ClientError {
+    None,
+    InvalidRequest, // bad address
+    Connect,        // no connection could be made
+    Timeout,        // no response before the request's deadline
+    Protocol,       // malformed or oversized response
+    Closed          // the server closed the connection without answering
+};
+
+/**
+ * @brief Outcome of a request; response is meaningful when ok()
+ */
+struct ClientResult {
+    ClientError error = ClientError::None;
+    HttpResponse response;
+    int attempts = 0; // exchanges started, retries and hedges included
+
+    bool ok() const { return error == ClientError::None; }
+};
+
+using ClientCallback = std::function<void(ClientResult& result)>;
+
+/**
+ * @brief Pooled HTTP/1.1 client for service-to-service calls
+ *
+ * Keeps a pool of keep-alive connections per host, so steady traffic pays
+ * no connect or handshake per call. Requests complete asynchronously on the
+ * client's worker threads, through a future or a callback. Idempotent
+ * requests are retried on connection failures and can be hedged: if the
+ * first attempt is slow, a second one races it and the first response wins.
+ * Hedges are started by a timer thread of their own, so they still go out
+ * when every worker is blocked on a slow upstream.
+ * sendBatch() pipelines idempotent requests to the same host.
+ *
+ * Thread-safe; one client is meant to be shared by all of a process's
+ * services.
+ */
+class HttpClient {
+public:
+    using Clock = UpstreamPool::Clock;
+
+    explicit HttpClient(const HttpClientOptions& options = HttpClientOptions());
+
+    /**
+     * @brief Finish queued requests, then stop the worker threads
+     */
+    ~HttpClient();
+
+    // Prevent copying (owns the worker threads and pools)
+    HttpClient(const HttpClient&) = delete;
+    HttpClient& operator=(const HttpClient&) = delete;
+
+    std::future<ClientResult> send(ClientRequest request);
+
+    /**
+     * @brief Send and run callback on a worker thread when done
+     *
+     * The callback must not wait on this client's other requests.
+     */
+    void send(ClientRequest request, ClientCallback callback);
+
+    /**
+     * @brief Send and wait
+     */
+    ClientResult request(ClientRequest request) { return send(std::move(request)).get(); }
+
+    /**
+     * @brief Send several requests, pipelining idempotent ones per host
+     *
+     * Up to maxPipelineDepth idempotent requests to one address are written
+     * back to back on a single connection and their responses read in order.
+     * Other requests are sent as by send(). Results are in request order.
+     */
+    std::vector<std::future<ClientResult>> sendBatch(std::vector<ClientRequest> requests);
+
+    /**
+     * @brief Connections opened across all hosts (reuse keeps this flat)
+     */
+    uint64_t connectionsOpened() const;
+
+private:
+    struct Call;
+    using CallPtr = std::shared_ptr<Call>;
+
+    struct Task {
+        Clock::time_point notBefore;
+        uint64_t sequence; // FIFO among tasks due at the same time
+        std::function<void()> run;
+
+        bool operator>(const Task& other) const {
+            return notBefore != other.notBefore ? notBefore > other.notBefore : sequence > other.sequence;
+        }
+    };
+
+    CallPtr makeCall(ClientRequest request, ClientCallback callback);
+    void start(const CallPtr& call);
+    // counted: the call's attempt was already counted (pipelining fallback)
+    void attempt(const CallPtr& call, bool counted = false);
+    void pipeline(std::vector<CallPtr> calls);
+    void complete(const CallPtr& call, ClientResult& result);
+    void fail(const CallPtr& call, ClientError error);
+    void schedule(Clock::time_point notBefore, std::function<void()> run);
+    void scheduleHedge(Clock::time_point notBefore, std::function<void()> run);
+    UpstreamPool* poolFor(const std::string& address);
+    static std::string buildHead(const ClientRequest& request);
+    void workerLoop();
+    void hedgeLoop();
+
+    HttpClientOptions m_options;
+
+    mutable std::mutex m_poolsMutex;
+    std::unordered_map<std::string, std::unique_ptr<UpstreamPool>> m_pools;
+
+    std::mutex m_tasksMutex;
+    std::condition_variable m_tasksCondition;
+    std::priority_queue<Task, std::vector<Task>, std::greater<Task>> m_tasks;
+    uint64_t m_taskSequence = 0;
+    bool m_stopping = false;
+    std::vector<std::thread> m_workers;
+
+    // Hedges wait here and each runs on its own thread when due
+    std::mutex m_hedgesMutex;
+    std::condition_variable m_hedgesCondition;
+    std::priority_queue<Task, std::vector<Task>, std::greater<Task>> m_hedges;
+    uint64_t m_hedgeSequence = 0;
+    bool m_hedgesStopping = false;
+    std::thread m_hedger;
+};
+
+} // namespace ServiceFramework
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace ServiceFramework {
+
+/**
+ * @brief HDR-style latency histogram
+ *
+ * Log-linear buckets with a fixed number of significant decimal digits, so
+ * every recorded value is accurate to within 10^-digits of itself from one
+ * microsecond up to the highest trackable value. Recording is O(1) and
+ * allocation-free; histograms from several threads are combined with add().
+ */
+class LatencyHistogram {
+public:
+    /**
+     * @param highestTrackableValue Largest value recorded exactly; larger
+     *        values are clamped to it
+     * @param significantDigits Decimal digits of precision (1-5)
+     */
+    explicit LatencyHistogram(int64_t highestTrackableValue = 3600LL * 1000 * 1000,
+                              int significantDigits = 3)
+        : m_highestTrackableValue(std::max<int64_t>(highestTrackableValue, 2)) {
+        significantDigits = std::min(std::max(significantDigits, 1), 5);
+        int64_t largestSingleUnitResolution =
+            2 * static_cast<int64_t>(std::pow(10, significantDigits));
+        int subBucketCountMagnitude = static_cast<int>(
+            std::ceil(std::log2(static_cast<double>(largestSingleUnitResolution))));
+        m_subBucketHalfCountMagnitude = std::max(subBucketCountMagnitude, 1) - 1;
+        m_subBucketCount = int64_t(1) << (m_subBucketHalfCountMagnitude + 1);
+        m_subBucketHalfCount = m_subBucketCount / 2;
+        m_subBucketMask = m_subBucketCount - 1;
+
+        // Buckets needed until the highest value fits
+        int bucketCount = 1;
+        int64_t smallestUntrackable = m_subBucketCount;
+        while (smallestUntrackable <= m_highestTrackableValue) {
+            if (smallestUntrackable > INT64_MAX / 2) {
+                ++bucketCount;
+                break;
+            }
+            smallestUntrackable <<= 1;
+            ++bucketCount;
+        }
+        m_counts.assign(static_cast<size_t>((bucketCount + 1) * m_subBucketHalfCount), 0);
+    }
+
+    /**
+     * @brief Record a value (negative values count as zero)
+     */
+    void record(int64_t value, int64_t count = 1) {
+        value = std::min(std::max<int64_t>(value, 0), m_highestTrackableValue);
+        m_counts[countsIndex(value)] += count;
+        m_totalCount += count;
+        m_min = std::min(m_min, value);
+        m_max = std::max(m_max, value);
+        m_sum += static_cast<double>(value) * count;
+        m_sumOfSquares += static_cast<double>(value) * value * count;
+    }
+
+    /**
+     * @brief Merge another histogram with the same configuration
+     */
+    void add(const LatencyHistogram& other) {
+        if (other.m_counts.size() != m_counts.size()) {
+            return;
+        }
+        for (size_t i = 0; i < m_counts.size(); ++i) {
+            m_counts[i] += other.m_counts[i];
+        }
+        m_totalCount += other.m_totalCount;
+        m_min = std::min(m_min, other.m_min);
+        m_max = std::max(m_max, other.m_max);
+        m_sum += other.m_sum;
+        m_sumOfSquares += other.m_sumOfSquares;
+    }
+
+    /**
+     * @brief Value at the given percentile (0-100)
+     * @return Highest value equivalent to the percentile's bucket, 0 if empty
+     */
+    int64_t valueAtPercentile(double percentile) const {
+        if (m_totalCount == 0) {
+            return 0;
+        }
+        percentile = std::min(std::max(percentile, 0.0), 100.0);
+        int64_t target = static_cast<int64_t>(
+            std::ceil(percentile / 100.0 * static_cast<double>(m_totalCount)));
+        target = std::max<int64_t>(target, 1);
+
+        int64_t cumulative = 0;
+        for (size_t i = 0; i < m_counts.size(); ++i) {
+            cumulative += m_counts[i];
+            if (cumulative >= target) {
+                return std::min(highestEquivalentValue(valueFromIndex(i)), m_max);
+            }
+        }
+        return m_max;
+    }
+
+    int64_t totalCount() const { return m_totalCount; }
+    int64_t min() const { return m_totalCount == 0 ? 0 : m_min; }
+    int64_t max() const { return m_totalCount == 0 ? 0 : m_max; }
+
+    double mean() const {
+        return m_totalCount == 0 ? 0.0 : m_sum / static_cast<double>(m_totalCount);
+    }
+
+    double stddev() const {
+        if (m_totalCount == 0) {
+            return 0.0;
+        }
+        double average = mean();
+        double variance = m_sumOfSquares / static_cast<double>(m_totalCount) - average * average;
+        return variance > 0 ? std::sqrt(variance) : 0.0;
+    }
+
+private:
+    size_t countsIndex(int64_t value) const {
+        int bucketIndex = bucketIndexOf(value);
+        int64_t subBucketIndex = value >> bucketIndex;
+        // Bucket 0 uses all sub-buckets, later buckets only the upper half
+        int64_t bucketBase = static_cast<int64_t>(bucketIndex + 1) << m_subBucketHalfCountMagnitude;
+        return static_cast<size_t>(bucketBase + subBucketIndex - m_subBucketHalfCount);
+    }
+
+    int bucketIndexOf(int64_t value) const {
+        int pow2Ceiling = 64 - __builtin_clzll(static_cast<uint64_t>(value | m_subBucketMask));
+        return pow2Ceiling - (m_subBucketHalfCountMagnitude + 1);
+    }
+
+    int64_t valueFromIndex(size_t index) const {
+        int bucketIndex = static_cast<int>(index >> m_subBucketHalfCountMagnitude) - 1;
+        int64_t subBucketIndex = static_cast<int64_t>(index & (m_subBucketHalfCount - 1)) + m_subBucketHalfCount;
+        if (bucketIndex < 0) {
+            subBucketIndex -= m_subBucketHalfCount;
+            bucketIndex = 0;
+        }
+        return subBucketIndex << bucketIndex;
+    }
+
+    int64_t highestEquivalentValue(int64_t value) const {
+        int64_t rangeSize = int64_t(1) << bucketIndexOf(value);
+        return value + rangeSize - 1;
+    }
+
+    int64_t m_highestTrackableValue;
+    int m_subBucketHalfCountMagnitude = 0;
+    int64_t m_subBucketCount = 0;
+    int64_t m_subBucketHalfCount = 0;
+    int64_t m_subBucketMask = 0;
+    std::vector<int64_t> m_counts;
+    int64_t m_totalCount = 0;
+    int64_t m_min = INT64_MAX;
+    int64_t m_max = 0;
+    double m_sum = 0;
+    double m_sumOfSquares = 0;
+};
+
+} // namespace ServiceFramework
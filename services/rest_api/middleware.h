@@ -0,0 +1,247 @@
+#pragma once
+
+#include "rest_api_service.h"
+#include <chrono>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <strings.h>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace ServiceFramework {
+
+/**
+ * @brief Per-request state for pipelines whose stages share none
+ */
+struct NoContext {};
+
+namespace MiddlewareDetail {
+
+template <typename T, typename Context, typename = void>
+struct HasHandle : std::false_type {};
+template <typename T, typename Context>
+struct HasHandle<T, Context,
+                 std::void_t<decltype(std::declval<const T&>().handle(
+                     std::declval<const HttpRequest&>(), std::declval<Context&>(),
+                     std::declval<HttpResponse (*)()>()))>> : std::true_type {};
+
+template <typename T, typename Context, typename = void>
+struct HasBeforeWithContext : std::false_type {};
+template <typename T, typename Context>
+struct HasBeforeWithContext<T, Context,
+                            std::void_t<decltype(std::declval<const T&>().before(
+                                std::declval<const HttpRequest&>(), std::declval<Context&>()))>>
+    : std::true_type {};
+
+template <typename T, typename = void>
+struct HasBefore : std::false_type {};
+template <typename T>
+struct HasBefore<T, std::void_t<decltype(std::declval<const T&>().before(std::declval<const HttpRequest&>()))>>
+    : std::true_type {};
+
+template <typename T, typename Context, typename = void>
+struct HasAfterWithContext : std::false_type {};
+template <typename T, typename Context>
+struct HasAfterWithContext<T, Context,
+                           std::void_t<decltype(std::declval<const T&>().after(
+                               std::declval<const HttpRequest&>(), std::declval<Context&>(),
+                               std::declval<HttpResponse&>()))>> : std::true_type {};
+
+template <typename T, typename = void>
+struct HasAfter : std::false_type {};
+template <typename T>
+struct HasAfter<T, std::void_t<decltype(std::declval<const T&>().after(std::declval<const HttpRequest&>(),
+                                                                        std::declval<HttpResponse&>()))>>
+    : std::true_type {};
+
+} // namespace MiddlewareDetail
+
+/**
+ * @brief A route handler wrapped in middleware, composed at registration
+ *
+ * Middleware runs outermost first. Each middleware type provides either
+ * hooks, any of:
+ *
+ *     std::optional<HttpResponse> before(const HttpRequest&[, Context&]) const;
+ *     void after(const HttpRequest&[, Context&], HttpResponse&) const;
+ *
+ * where a response from before() short-circuits the rest of the chain (the
+ * after() hooks of middleware outside it still run), or a wrapper:
+ *
+ *     template <typename Context, typename Next>
+ *     HttpResponse handle(const HttpRequest&, Context&, Next&& next) const;
+ *
+ * that calls next() to continue. The handler is called as
+ * handler(request, context) or handler(request). Every stage is a template
+ * argument, so the whole chain inlines into one call; Context is a
+ * default-constructed per-request struct for stages to hand state inward.
+ * Stages run concurrently on the worker threads and must not mutate
+ * themselves.
+ */
+template <typename Context, typename Handler, typename... Middleware>
+class Pipeline {
+public:
+    explicit Pipeline(Handler handler, Middleware... middleware)
+        : m_handler(std::move(handler)), m_middleware(std::move(middleware)...) {}
+
+    HttpResponse operator()(const HttpRequest& request) const {
+        Context context{};
+        return run(request, context);
+    }
+
+    HttpResponse run(const HttpRequest& request, Context& context) const {
+        return step<0>(request, context);
+    }
+
+private:
+    template <size_t I>
+    HttpResponse step(const HttpRequest& request, Context& context) const {
+        if constexpr (I == sizeof...(Middleware)) {
+            if constexpr (std::is_invocable_v<const Handler&, const HttpRequest&, Context&>) {
+                return m_handler(request, context);
+            } else {
+                return m_handler(request);
+            }
+        } else {
+            using Stage = std::tuple_element_t<I, std::tuple<Middleware...>>;
+            const Stage& stage = std::get<I>(m_middleware);
+
+            if constexpr (MiddlewareDetail::HasHandle<Stage, Context>::value) {
+                return stage.handle(request, context, [&]() { return step<I + 1>(request, context); });
+            } else {
+                if constexpr (MiddlewareDetail::HasBeforeWithContext<Stage, Context>::value) {
+                    if (std::optional<HttpResponse> early = stage.before(request, context)) {
+                        return std::move(*early);
+                    }
+                } else if constexpr (MiddlewareDetail::HasBefore<Stage>::value) {
+                    if (std::optional<HttpResponse> early = stage.before(request)) {
+                        return std::move(*early);
+                    }
+                }
+
+                HttpResponse response = step<I + 1>(request, context);
+                if constexpr (MiddlewareDetail::HasAfterWithContext<Stage, Context>::value) {
+                    stage.after(request, context, response);
+                } else if constexpr (MiddlewareDetail::HasAfter<Stage>::value) {
+                    stage.after(request, response);
+                }
+                return response;
+            }
+        }
+    }
+
+    Handler m_handler;
+    std::tuple<Middleware...> m_middleware;
+};
+
+/**
+ * @brief Wrap a handler for addRoute() in per-route middleware
+ *
+ * Example:
+ *   service.addRoute("GET", "/api/orders/{id}",
+ *                    withMiddleware(getOrder, BearerAuthMiddleware{token}, RequestIdMiddleware{}));
+ */
+template <typename Context = NoContext, typename Handler, typename... Middleware>
+Pipeline<Context, Handler, Middleware...> withMiddleware(Handler handler, Middleware... middleware) {
+    return Pipeline<Context, Handler, Middleware...>(std::move(handler), std::move(middleware)...);
+}
+
+/**
+ * @brief Case-insensitive header lookup (HTTP/1.1 keeps the client's case)
+ */
+inline const std::string* findHeader(const HttpRequest& request, std::string_view name) {
+    for (const auto& header : request.headers) {
+        if (header.first.size() == name.size() &&
+            strncasecmp(header.first.data(), name.data(), name.size()) == 0) {
+            return &header.second;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Echo the caller's X-Request-Id, or mint one, on the response
+ */
+struct RequestIdMiddleware {
+    void after(const HttpRequest& request, HttpResponse& response) const {
+        if (const std::string* id = findHeader(request, "x-request-id")) {
+            response.headers["X-Request-Id"] = *id;
+            return;
+        }
+        auto bytes = Tracer::newSpanId();
+        char id[2 * sizeof(bytes) + 1];
+        for (size_t i = 0; i < bytes.size(); ++i) {
+            std::snprintf(id + 2 * i, 3, "%02x", bytes[i]);
+        }
+        response.headers["X-Request-Id"] = id;
+    }
+};
+
+/**
+ * @brief Allow cross-origin callers on the response
+ */
+struct CorsMiddleware {
+    std::string allowOrigin = "*";
+
+    void after(const HttpRequest& request, HttpResponse& response) const {
+        (void)request;
+        response.headers["Access-Control-Allow-Origin"] = allowOrigin;
+        if (allowOrigin != "*") {
+            response.headers["Vary"] = "Origin";
+        }
+    }
+};
+
+/**
+ * @brief Reject requests without "Authorization: Bearer <token>" (401)
+ */
+struct BearerAuthMiddleware {
+    std::string token;
+
+    std::optional<HttpResponse> before(const HttpRequest& request) const {
+        const std::string* authorization = findHeader(request, "authorization");
+        if (authorization && authorization->size() == 7 + token.size() &&
+            strncasecmp(authorization->c_str(), "Bearer ", 7) == 0) {
+            // Constant time, so the token can't be guessed byte by byte
+            unsigned char difference = 0;
+            for (size_t i = 0; i < token.size(); ++i) {
+                difference |= static_cast<unsigned char>((*authorization)[7 + i] ^ token[i]);
+            }
+            if (difference == 0) {
+                return std::nullopt;
+            }
+        }
+
+        HttpResponse response;
+        response.statusCode = 401;
+        response.statusText = "Unauthorized";
+        response.headers["WWW-Authenticate"] = "Bearer";
+        response.body = R"({"error": "Missing or invalid bearer token"})";
+        return response;
+    }
+};
+
+/**
+ * @brief Report the time spent inside the chain as a Server-Timing header
+ */
+struct TimingMiddleware {
+    std::string metric = "app";
+
+    template <typename Context, typename Next>
+    HttpResponse handle(const HttpRequest& request, Context& context, Next&& next) const {
+        (void)request;
+        (void)context;
+        auto start = std::chrono::steady_clock::now();
+        HttpResponse response = next();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        char value[64];
+        std::snprintf(value, sizeof(value), "%s;dur=%.3f", metric.c_str(), elapsed.count());
+        response.headers["Server-Timing"] = value;
+        return response;
+    }
+};
+
+} // namespace ServiceFramework
@@ -0,0 +1,73 @@
+#include "request_coalescer.h"
+#include <strings.h>
+
+namespace ServiceFramework {
+
+std::string RequestCoalescer::keyOf(const HttpRequest& request, const std::vector<std::string>& varyHeaders) {
+    std::string key;
+    key.reserve(request.method.size() + request.path.size() + request.query.size() + 2);
+    key += request.method;
+    key += ' ';
+    key += request.path;
+    if (!request.query.empty()) {
+        key += '?';
+        key += request.query;
+    }
+
+    for (const auto& name : varyHeaders) {
+        // '\n' cannot occur in a header value, so keys never run together
+        key += '\n';
+        for (const auto& header : request.headers) {
+            if (strcasecmp(header.first.c_str(), name.c_str()) == 0) {
+                key += header.second;
+                break;
+            }
+        }
+    }
+    return key;
+}
+
+size_t RequestCoalescer::inFlight() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_flights.size();
+}
+
+std::shared_ptr<RequestCoalescer::Flight> RequestCoalescer::join(const std::string& key, bool& leader) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::shared_ptr<Flight>& flight = m_flights[key];
+    leader = !flight;
+    if (leader) {
+        flight = std::make_shared<Flight>();
+    } else {
+        m_coalesced.fetch_add(1, std::memory_order_relaxed);
+    }
+    return flight;
+}
+
+void RequestCoalescer::finish(const std::string& key, Flight& flight, std::shared_ptr<const HttpResponse> response,
+                              std::exception_ptr error) {
+    // Later arrivals start a new flight rather than reuse this result
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_flights.erase(key);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(flight.mutex);
+        flight.response = std::move(response);
+        flight.error = error;
+        flight.finished = true;
+    }
+    flight.done.notify_all();
+}
+
+HttpResponse RequestCoalescer::wait(Flight& flight) {
+    std::unique_lock<std::mutex> lock(flight.mutex);
+    flight.done.wait(lock, [&flight] { return flight.finished; });
+    if (flight.error) {
+        std::rethrow_exception(flight.error);
+    }
+    return *flight.response;
+}
+
+} // namespace ServiceFramework
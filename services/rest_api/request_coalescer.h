@@ -0,0 +1,116 @@
+#pragma once
+
+#include "rest_api_service.h"
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ServiceFramework {
+
+/**
+ * @brief Singleflight for responses: identical concurrent requests share one computation
+ *
+ * The first request for a key runs the handler; requests for the same key
+ * that arrive while it runs wait and receive a copy of its response (or its
+ * exception). The flight ends when the handler returns, so a request that
+ * arrives afterwards computes afresh: nothing is cached and nothing is
+ * served stale. Thread-safe.
+ */
+class RequestCoalescer {
+public:
+    RequestCoalescer() = default;
+
+    // Prevent copying (waiters hold on to its flights)
+    RequestCoalescer(const RequestCoalescer&) = delete;
+    RequestCoalescer& operator=(const RequestCoalescer&) = delete;
+
+    template <typename Compute>
+    HttpResponse run(const std::string& key, Compute&& compute);
+
+    /**
+     * @brief Key of a request: method, path and raw query, plus the values
+     *        of headers the response depends on
+     */
+    static std::string keyOf(const HttpRequest& request, const std::vector<std::string>& varyHeaders = {});
+
+    /**
+     * @brief Requests answered from another request's computation so far
+     */
+    uint64_t coalescedRequests() const { return m_coalesced.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Keys being computed right now
+     */
+    size_t inFlight() const;
+
+private:
+    struct Flight {
+        std::mutex mutex;
+        std::condition_variable done;
+        bool finished = false;
+        std::shared_ptr<const HttpResponse> response;
+        std::exception_ptr error;
+    };
+
+    // Returns the flight for key; leader is set if the caller must compute it
+    std::shared_ptr<Flight> join(const std::string& key, bool& leader);
+    void finish(const std::string& key, Flight& flight, std::shared_ptr<const HttpResponse> response,
+                std::exception_ptr error);
+    static HttpResponse wait(Flight& flight);
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, std::shared_ptr<Flight>> m_flights;
+    std::atomic<uint64_t> m_coalesced{0};
+};
+
+template <typename Compute>
+HttpResponse RequestCoalescer::run(const std::string& key, Compute&& compute) {
+    bool leader = false;
+    std::shared_ptr<Flight> flight = join(key, leader);
+    if (!leader) {
+        return wait(*flight);
+    }
+
+    std::shared_ptr<const HttpResponse> response;
+    try {
+        response = std::make_shared<const HttpResponse>(compute());
+    } catch (...) {
+        finish(key, *flight, nullptr, std::current_exception());
+        throw;
+    }
+    finish(key, *flight, response, nullptr);
+    return *response;
+}
+
+/**
+ * @brief Middleware coalescing identical concurrent GET and HEAD requests
+ *
+ * Opt-in per route, e.g. for a listing every dashboard polls at once:
+ *   auto coalescer = std::make_shared<RequestCoalescer>();
+ *   service.addRoute("GET", "/api/inventory", withMiddleware(listInventory, CoalesceMiddleware{coalescer}));
+ *
+ * Requests differing in a header the handler reads (a tenant, credentials)
+ * must list it in varyHeaders, or they would share each other's responses.
+ * Place it inside authentication middleware so every caller is checked.
+ */
+struct CoalesceMiddleware {
+    std::shared_ptr<RequestCoalescer> coalescer;
+    std::vector<std::string> varyHeaders;
+
+    template <typename Context, typename Next>
+    HttpResponse handle(const HttpRequest& request, Context& context, Next&& next) const {
+        (void)context;
+        if (request.method != "GET" && request.method != "HEAD") {
+            return next();
+        }
+        return coalescer->run(RequestCoalescer::keyOf(request, varyHeaders), std::forward<Next>(next));
+    }
+};
+
+} // namespace ServiceFramework
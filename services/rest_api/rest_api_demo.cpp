@@ -1,5 +1,4 @@
 #include "rest_api_service.h"
-#include "rest_api_registration.h"
 #include "../../framework/service_manager.h"
 #include "../logging/logging_service.h"
 #include "../database/database.h"
@@ -10,29 +9,30 @@
 
 using namespace ServiceFramework;
 
-// Register missing services
+// Service types this binary creates, resolved at compile time
 namespace {
-struct AdditionalServiceRegistrations {
-    AdditionalServiceRegistrations() {
-        auto &factory = ServiceFramework::ServiceFactory::getInstance();
-
-        factory.registerService(
-            "DatabaseService", []() -> ServiceFramework::ServicePtr {
-                return std::make_unique<ServiceFramework::DatabaseService>();
-            });
-            
-        factory.registerService(
-            "CacheService", []() -> ServiceFramework::ServicePtr {
-                return std::make_unique<ServiceFramework::CacheService>();
-            });
-    }
-};
-
-static AdditionalServiceRegistrations g_additionalServiceRegistrations;
+constexpr auto SERVICES =
+    makeStaticServices<LoggingService, DatabaseService, CacheService, RestApiService>();
 } // namespace
 
-int main() {
+int main(int argc, char* argv[]) {
     std::cout << "=== REST API Service Demo ===" << std::endl;
+    ServiceFactory::getInstance().addStaticServices(SERVICES);
+
+    // Optional hot upgrade control socket: start a second instance with the
+    // same path to take over the listening socket without dropping connections.
+    std::string upgradeSocket;
+    // Optional span export: --trace <file or http://collector:4318> [--trace-sample <ratio>]
+    TracingOptions tracing;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::string(argv[i]) == "--upgrade-socket") {
+            upgradeSocket = argv[i + 1];
+        } else if (std::string(argv[i]) == "--trace") {
+            tracing.endpoint = argv[i + 1];
+        } else if (std::string(argv[i]) == "--trace-sample") {
+            tracing.sampleRatio = std::atof(argv[i + 1]);
+        }
+    }
     
     try {
         // Create service manager
@@ -46,11 +46,21 @@ int main() {
         manager.addService("CacheService", "redis_cache");
         manager.addService("RestApiService", "api_server");
         
-        // Get the REST API service and configure it
-        auto* apiService = dynamic_cast<RestApiService*>(manager.getService("api_server"));
+        // Get the REST API service and configure it; the handle notices if
+        // the instance is removed while the server runs
+        auto apiService = manager.getServiceHandle<RestApiService>("api_server");
         if (apiService) {
             apiService->setServiceManager(&manager);
             apiService->setPort(8080);
+            apiService->setHotUpgradePath(upgradeSocket);
+            apiService->setTracing(tracing);
+
+            // Access log lines are buffered by the workers and written by the logger
+            apiService->setAccessLog(AccessLogOptions());
+            if (auto* logger = manager.getService<LoggingService>("logger")) {
+                std::shared_ptr<AccessLog> accessLog = apiService->accessLog();
+                logger->addLogSource([accessLog](std::string& batch) { return accessLog->drain(batch, 256); });
+            }
             
             // Add custom routes
             apiService->addRoute("GET", "/api/custom/hello", [](const HttpRequest& req) {
@@ -86,6 +96,7 @@ int main() {
         std::cout << "\nAvailable endpoints:" << std::endl;
         std::cout << "  GET    http://localhost:8080/api/services" << std::endl;
         std::cout << "  GET    http://localhost:8080/api/services/{name}" << std::endl;
+        std::cout << "  GET    http://localhost:8080/api/health" << std::endl;
         std::cout << "  GET    http://localhost:8080/api/health/{name}" << std::endl;
         std::cout << "  POST   http://localhost:8080/api/services/{name}/start" << std::endl;
         std::cout << "  POST   http://localhost:8080/api/services/{name}/stop" << std::endl;
@@ -108,6 +119,10 @@ int main() {
             std::this_thread::sleep_for(std::chrono::seconds(1));
             
             // Check if API service is still running
+            if (apiService && apiService->isDraining() && !apiService->isRunning()) {
+                std::cout << "API service handed off to new process" << std::endl;
+                break;
+            }
             if (!apiService || !apiService->isRunning()) {
                 std::cout << "API service stopped unexpectedly" << std::endl;
                 break;
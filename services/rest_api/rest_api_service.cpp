@@ -1,14 +1,184 @@
 #include "rest_api_service.h"
+#include "middleware.h"
+#include "request_coalescer.h"
+#include "rpc_codec.h"
+#include "reverse_proxy.h"
+#include "socket_handoff.h"
 #include <iostream>
 #include <sstream>
 #include <algorithm>
+#include <cerrno>
 #include <cstring>
+#include <cstddef>
+#include <cstdlib>
 #include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/un.h>
 
 namespace ServiceFramework {
 
+namespace {
+
+// "@name" selects the Linux abstract namespace, anything else is a filesystem path
+bool makeUnixAddress(const std::string& path, struct sockaddr_un& address, socklen_t& addressLen) {
+    if (path.empty() || path == "@" || path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path[0] == '@') {
+        std::memcpy(address.sun_path + 1, path.c_str() + 1, path.size() - 1);
+        addressLen = offsetof(struct sockaddr_un, sun_path) + path.size();
+    } else {
+        std::memcpy(address.sun_path, path.c_str(), path.size());
+        addressLen = sizeof(address);
+    }
+    return true;
+}
+
+std::string unixAddressPath(const struct sockaddr_un& address, socklen_t addressLen) {
+    size_t pathLen = addressLen > offsetof(struct sockaddr_un, sun_path)
+                         ? addressLen - offsetof(struct sockaddr_un, sun_path)
+                         : 0;
+    if (pathLen > 0 && address.sun_path[0] == '\0') {
+        return "@" + std::string(address.sun_path + 1, pathLen - 1);
+    }
+    return std::string(address.sun_path, strnlen(address.sun_path, pathLen));
+}
+
+// Case-insensitive lookup of a header value inside a raw header block
+bool findHeaderValue(const std::string& headers, const char* name, std::string& value) {
+    size_t nameLen = std::strlen(name);
+    size_t lineStart = headers.find("\r\n");
+    while (lineStart != std::string::npos) {
+        lineStart += 2;
+        size_t lineEnd = headers.find("\r\n", lineStart);
+        if (lineEnd == std::string::npos) {
+            lineEnd = headers.size();
+        }
+        if (lineEnd - lineStart > nameLen && headers[lineStart + nameLen] == ':' &&
+            strncasecmp(headers.c_str() + lineStart, name, nameLen) == 0) {
+            size_t valueStart = headers.find_first_not_of(" \t", lineStart + nameLen + 1);
+            size_t valueEnd = headers.find_last_not_of(" \t", lineEnd - 1);
+            value = (valueStart == std::string::npos || valueStart > lineEnd)
+                        ? std::string()
+                        : headers.substr(valueStart, valueEnd - valueStart + 1);
+            return true;
+        }
+        lineStart = lineEnd < headers.size() ? lineEnd : std::string::npos;
+    }
+    return false;
+}
+
+const char CONTINUE_RESPONSE[] = "HTTP/1.1 100 Continue\r\n\r\n";
+const char SWITCHING_PROTOCOLS_RESPONSE[] =
+    "HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n";
+
+// "Upgrade: h2c" with the mandatory HTTP2-Settings header (RFC 7540 section 3.2)
+bool isH2cUpgrade(const std::string& headers) {
+    std::string upgrade;
+    std::string settings;
+    if (!findHeaderValue(headers, "Upgrade", upgrade) ||
+        !findHeaderValue(headers, "HTTP2-Settings", settings)) {
+        return false;
+    }
+    std::istringstream tokens(upgrade);
+    std::string token;
+    while (std::getline(tokens, token, ',')) {
+        token.erase(0, token.find_first_not_of(" \t"));
+        token.erase(token.find_last_not_of(" \t") + 1);
+        if (strcasecmp(token.c_str(), "h2c") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+HeaderList toHttp2Headers(const std::map<std::string, std::string>& headers) {
+    HeaderList fields;
+    fields.reserve(headers.size());
+    for (const auto& header : headers) {
+        std::string name = header.first;
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        fields.push_back({name, header.second});
+    }
+    return fields;
+}
+
+// 503 until a ServiceManager is attached
+struct RequireServiceManager {
+    ServiceManager* manager;
+
+    std::optional<HttpResponse> before(const HttpRequest& request) const {
+        (void)request;
+        if (manager) {
+            return std::nullopt;
+        }
+        HttpResponse response;
+        response.statusCode = 503;
+        response.statusText = "Service Unavailable";
+        response.body = R"({"error": "Service manager not available"})";
+        return response;
+    }
+};
+
+// Resolves the {name} path parameter into context.service: 400 without
+// one, 404 if no such service is registered
+struct ResolveService {
+    ServiceManager* manager;
+
+    template <typename Context>
+    std::optional<HttpResponse> before(const HttpRequest& request, Context& context) const {
+        auto nameIt = request.pathParams.find("name");
+        if (nameIt == request.pathParams.end()) {
+            HttpResponse response;
+            response.statusCode = 400;
+            response.statusText = "Bad Request";
+            response.body = R"({"error": "Service name not provided"})";
+            return response;
+        }
+
+        context.service = manager->getService(nameIt->second);
+        if (!context.service) {
+            HttpResponse response;
+            response.statusCode = 404;
+            response.statusText = "Not Found";
+            response.body = R"({"error": "Service not found"})";
+            return response;
+        }
+        return std::nullopt;
+    }
+};
+
+// Content negotiation: callers that accept RPC_CONTENT_TYPE get the
+// schema-encoded body (rpc_codec.h) instead of JSON
+bool acceptsRpc(const HttpRequest& request) {
+    for (const auto& header : request.headers) {
+        if (strcasecmp(header.first.c_str(), "Accept") == 0) {
+            return header.second.find(RPC_CONTENT_TYPE) != std::string::npos;
+        }
+    }
+    return false;
+}
+
+void setRpcBody(HttpResponse& response, RpcWriter& message) {
+    response.headers["Content-Type"] = RPC_CONTENT_TYPE;
+    response.body = message.take();
+}
+
+} // namespace
+
 RestApiService::RestApiService(int port) 
-    : m_port(port), m_serverSocket(-1), m_serviceManager(nullptr) {
+    : m_port(port), m_serverSocket(-1), m_serviceManager(nullptr),
+      m_wakePipe{-1, -1}, m_epollFd(-1), m_loopEvent(-1),
+      m_handoffSocket(-1), m_inheritedControl(-1),
+      m_priorityPrefixes{"/api/health", "/api/status"} {
+    setupDefaultRoutes();
 }
 
 RestApiService::~RestApiService() {
@@ -21,50 +191,59 @@ bool RestApiService::initialize() {
     }
 
     try {
-        // Create socket
-        m_serverSocket = socket(AF_INET, SOCK_STREAM, 0);
-        if (m_serverSocket < 0) {
-            std::cerr << "RestApiService: Failed to create socket" << std::endl;
-            return false;
+        // Take over the listening socket of a running predecessor, if any
+        if (!m_hotUpgradePath.empty()) {
+            std::vector<int> fds;
+            m_inheritedControl = SocketHandoff::requestListeners(m_hotUpgradePath, fds, m_handoffTimeout);
+            if (m_inheritedControl >= 0) {
+                adoptInheritedListeners(fds);
+                std::cout << "RestApiService: Inherited " << fds.size()
+                          << " listening socket(s) from previous process" << std::endl;
+            }
         }
 
-        // Set socket options
-        int opt = 1;
-        if (setsockopt(m_serverSocket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
-            std::cerr << "RestApiService: Failed to set socket options" << std::endl;
-            close(m_serverSocket);
+        if (m_serverSocket < 0 && !createListener()) {
+            releaseSockets();
             return false;
         }
 
-        // Bind socket
-        struct sockaddr_in address;
-        address.sin_family = AF_INET;
-        address.sin_addr.s_addr = INADDR_ANY;
-        address.sin_port = htons(m_port);
-
-        if (bind(m_serverSocket, (struct sockaddr*)&address, sizeof(address)) < 0) {
-            std::cerr << "RestApiService: Failed to bind to port " << m_port << std::endl;
-            close(m_serverSocket);
-            return false;
+        for (auto& listener : m_unixListeners) {
+            if (listener.socket < 0 && !createUnixListener(listener)) {
+                releaseSockets();
+                return false;
+            }
         }
 
-        // Listen for connections
-        if (listen(m_serverSocket, 10) < 0) {
-            std::cerr << "RestApiService: Failed to listen on socket" << std::endl;
-            close(m_serverSocket);
+        if (!setupEventLoop()) {
+            releaseSockets();
             return false;
         }
 
-        // Setup default routes
-        setupDefaultRoutes();
+        m_healthMonitor = std::make_unique<HealthMonitor>(m_healthOptions);
 
         // Start worker threads
+        m_stopWorkers.store(false);
         for (size_t i = 0; i < MAX_WORKER_THREADS; ++i) {
-            m_workerThreads.emplace_back(&RestApiService::workerLoop, this);
+            m_workerThreads.emplace_back([this, i] {
+                ThreadAffinity::apply(m_threadPlacement.get(ThreadRole::Worker), i);
+                workerLoop(false, i);
+            });
+        }
+        // The priority lane keeps health checks answered when every
+        // regular worker is stuck in a slow handler
+        for (size_t i = 0; i < PRIORITY_WORKER_THREADS; ++i) {
+            m_workerThreads.emplace_back([this, i] {
+                ThreadAffinity::apply(m_threadPlacement.get(ThreadRole::Worker), MAX_WORKER_THREADS + i);
+                workerLoop(true, MAX_WORKER_THREADS + i);
+            });
         }
 
         m_initialized.store(true);
-        std::cout << "RestApiService: Initialized on port " << m_port << std::endl;
+        m_handedOff = false;
+        std::cout << "RestApiService: Initialized on port " << m_port << (m_tls ? " (TLS)" : "") << std::endl;
+        for (const auto& listener : m_unixListeners) {
+            std::cout << "RestApiService: Listening on unix:" << listener.path << std::endl;
+        }
         return true;
 
     } catch (const std::exception& e) {
@@ -73,6 +252,190 @@ bool RestApiService::initialize() {
     }
 }
 
+bool RestApiService::createListener() {
+    // Create socket
+    m_serverSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_serverSocket < 0) {
+        std::cerr << "RestApiService: Failed to create socket" << std::endl;
+        return false;
+    }
+
+    // Set socket options
+    int opt = 1;
+    if (setsockopt(m_serverSocket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+        std::cerr << "RestApiService: Failed to set socket options" << std::endl;
+        close(m_serverSocket);
+        m_serverSocket = -1;
+        return false;
+    }
+
+    // Bind socket
+    struct sockaddr_in address;
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(m_port);
+
+    if (bind(m_serverSocket, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        std::cerr << "RestApiService: Failed to bind to port " << m_port << std::endl;
+        close(m_serverSocket);
+        m_serverSocket = -1;
+        return false;
+    }
+
+    // Listen for connections
+    if (listen(m_serverSocket, SOMAXCONN) < 0) {
+        std::cerr << "RestApiService: Failed to listen on socket" << std::endl;
+        close(m_serverSocket);
+        m_serverSocket = -1;
+        return false;
+    }
+
+    // Report the actual port when bound to an ephemeral one
+    socklen_t addressLen = sizeof(address);
+    if (m_port == 0 && getsockname(m_serverSocket, (struct sockaddr*)&address, &addressLen) == 0) {
+        m_port = ntohs(address.sin_port);
+    }
+
+    return true;
+}
+
+bool RestApiService::createUnixListener(UnixListener& listener) {
+    struct sockaddr_un address;
+    socklen_t addressLen = 0;
+    if (!makeUnixAddress(listener.path, address, addressLen)) {
+        std::cerr << "RestApiService: Invalid unix socket path '" << listener.path << "'" << std::endl;
+        return false;
+    }
+
+    listener.socket = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listener.socket < 0) {
+        std::cerr << "RestApiService: Failed to create unix socket" << std::endl;
+        return false;
+    }
+
+    // Replace a stale socket file left behind by a previous run
+    if (listener.path[0] != '@') {
+        unlink(listener.path.c_str());
+    }
+
+    if (bind(listener.socket, (struct sockaddr*)&address, addressLen) < 0 ||
+        listen(listener.socket, SOMAXCONN) < 0) {
+        std::cerr << "RestApiService: Failed to listen on unix:" << listener.path << std::endl;
+        close(listener.socket);
+        listener.socket = -1;
+        return false;
+    }
+
+    return true;
+}
+
+void RestApiService::adoptInheritedListeners(const std::vector<int>& fds) {
+    for (int fd : fds) {
+        // The accept loop drains listeners until EAGAIN
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+        struct sockaddr_storage storage;
+        socklen_t storageLen = sizeof(storage);
+        if (getsockname(fd, (struct sockaddr*)&storage, &storageLen) < 0) {
+            close(fd);
+            continue;
+        }
+
+        if (storage.ss_family == AF_INET && m_serverSocket < 0) {
+            m_serverSocket = fd;
+            m_port = ntohs(reinterpret_cast<struct sockaddr_in*>(&storage)->sin_port);
+            continue;
+        }
+
+        if (storage.ss_family == AF_UNIX) {
+            std::string path = unixAddressPath(*reinterpret_cast<struct sockaddr_un*>(&storage), storageLen);
+            auto it = std::find_if(m_unixListeners.begin(), m_unixListeners.end(),
+                                   [&path](const UnixListener& listener) {
+                                       return listener.socket < 0 && listener.path == path;
+                                   });
+            if (it != m_unixListeners.end()) {
+                it->socket = fd;
+                continue;
+            }
+        }
+
+        // The predecessor listened somewhere we are no longer configured to
+        close(fd);
+    }
+}
+
+std::vector<int> RestApiService::listeningSockets() const {
+    std::vector<int> sockets;
+    if (m_serverSocket >= 0) {
+        sockets.push_back(m_serverSocket);
+    }
+    for (const auto& listener : m_unixListeners) {
+        if (listener.socket >= 0) {
+            sockets.push_back(listener.socket);
+        }
+    }
+    return sockets;
+}
+
+bool RestApiService::setupEventLoop() {
+    if (pipe2(m_wakePipe, O_CLOEXEC | O_NONBLOCK) < 0) {
+        std::cerr << "RestApiService: Failed to create wake pipe" << std::endl;
+        return false;
+    }
+
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    m_loopEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_epollFd < 0 || m_loopEvent < 0) {
+        std::cerr << "RestApiService: Failed to create event loop" << std::endl;
+        return false;
+    }
+
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = m_loopEvent;
+    epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_loopEvent, &event);
+
+    m_listenerSlots.clear();
+    m_listenerSlots.push_back({m_serverSocket, &m_tcpTimeouts, false, m_tls != nullptr});
+    for (const auto& listener : m_unixListeners) {
+        m_listenerSlots.push_back({listener.socket, &listener.timeouts, true, false});
+    }
+    for (const auto& slot : m_listenerSlots) {
+        event.events = EPOLLIN;
+        event.data.fd = slot.socket;
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, slot.socket, &event) < 0) {
+            std::cerr << "RestApiService: Failed to watch listener" << std::endl;
+            return false;
+        }
+    }
+    m_listening = true;
+    return true;
+}
+
+void RestApiService::releaseSockets() {
+    for (auto& listener : m_unixListeners) {
+        if (listener.socket < 0) {
+            continue;
+        }
+        close(listener.socket);
+        listener.socket = -1;
+        // After a hand-off the path belongs to the successor
+        if (!m_handedOff && listener.path[0] != '@') {
+            unlink(listener.path.c_str());
+        }
+    }
+
+    for (int* fd : {&m_serverSocket, &m_handoffSocket, &m_inheritedControl,
+                    &m_wakePipe[0], &m_wakePipe[1], &m_epollFd, &m_loopEvent}) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+    m_listenerSlots.clear();
+    m_listening = false;
+}
+
 bool RestApiService::health() {
     return m_initialized.load() && m_running.load() && m_serverSocket >= 0;
 }
@@ -88,13 +451,55 @@ bool RestApiService::start() {
     }
 
     try {
+        if (!m_tracingOptions.endpoint.empty()) {
+            m_tracer = std::make_unique<Tracer>(m_tracingOptions);
+            if (m_tracer->start()) {
+                std::cout << "RestApiService: Tracing to " << m_tracingOptions.endpoint
+                          << " (sample ratio " << m_tracingOptions.sampleRatio << ")" << std::endl;
+            } else {
+                m_tracer.reset(); // serve without tracing rather than not at all
+            }
+        }
+
         m_running.store(true);
-        m_serverThread = std::thread(&RestApiService::serverLoop, this);
+        m_accepting.store(true);
+        m_loopExit.store(false);
+        m_serverThread = std::thread([this] {
+            ThreadAffinity::apply(m_threadPlacement.get(ThreadRole::Io));
+            if (m_tls) {
+                // OpenSSL writes with write(), not send(MSG_NOSIGNAL): a peer
+                // reset must fail with EPIPE rather than kill the process
+                sigset_t pipe;
+                sigemptyset(&pipe);
+                sigaddset(&pipe, SIGPIPE);
+                pthread_sigmask(SIG_BLOCK, &pipe, nullptr);
+            }
+            serverLoop();
+        });
+
+        // Let the predecessor stop accepting now that we are
+        if (m_inheritedControl >= 0) {
+            SocketHandoff::sendAck(m_inheritedControl);
+            close(m_inheritedControl);
+            m_inheritedControl = -1;
+        }
+
+        if (!m_hotUpgradePath.empty()) {
+            m_handoffSocket = SocketHandoff::listenControlSocket(m_hotUpgradePath);
+            if (m_handoffSocket >= 0) {
+                m_handoffThread = std::thread([this] {
+                    ThreadAffinity::apply(m_threadPlacement.get(ThreadRole::Background));
+                    handoffLoop();
+                });
+                std::cout << "RestApiService: Hot upgrade enabled via " << m_hotUpgradePath << std::endl;
+            }
+        }
         
         std::cout << "RestApiService: Started HTTP server on port " << m_port << std::endl;
         std::cout << "RestApiService: Available endpoints:" << std::endl;
         std::cout << "  GET    /api/services           - List all services" << std::endl;
         std::cout << "  GET    /api/services/{name}    - Get service info" << std::endl;
+        std::cout << "  GET    /api/health             - Check all services' health" << std::endl;
         std::cout << "  GET    /api/health/{name}      - Check service health" << std::endl;
         std::cout << "  POST   /api/services/{name}/start - Start service" << std::endl;
         std::cout << "  POST   /api/services/{name}/stop  - Stop service" << std::endl;
@@ -109,152 +514,1352 @@ bool RestApiService::start() {
 }
 
 void RestApiService::stop() {
-    if (!m_running.load()) {
+    if (!m_initialized.load()) {
         return;
     }
 
     std::cout << "RestApiService: Stopping..." << std::endl;
-    m_running.store(false);
-    m_stopWorkers.store(true);
 
-    // Close server socket to break accept() loop
-    if (m_serverSocket >= 0) {
-        close(m_serverSocket);
-        m_serverSocket = -1;
+    // Stop accepting but keep the listening socket open: after a hand-off it
+    // is shared with the successor, and otherwise closing it last lets the
+    // kernel keep queueing connections while we drain.
+    stopAccepting();
+    if (m_handoffThread.joinable()) {
+        m_handoffThread.join();
     }
 
-    // Wait for server thread to finish
+    // Let the I/O loop finish in-flight requests before tearing it down
+    drainConnections(std::chrono::steady_clock::now() + m_drainTimeout);
+    m_running.store(false);
+    m_loopExit.store(true);
+    wakeLoop();
     if (m_serverThread.joinable()) {
         m_serverThread.join();
     }
 
-    // Notify all worker threads to stop
-    {
-        std::lock_guard<std::mutex> lock(m_queueMutex);
-        m_queueCondition.notify_all();
-    }
+    // Notify all worker threads to stop
+    m_stopWorkers.store(true);
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_queueCondition.notify_all();
+        m_priorityCondition.notify_all();
+    }
+
+    // Wait for worker threads to finish
+    for (auto& worker : m_workerThreads) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    m_workerThreads.clear();
+    m_healthMonitor.reset();
+
+    // Export spans of everything that finished
+    if (m_tracer) {
+        m_tracer->stop();
+        m_tracer.reset();
+    }
+
+    // Anything still open missed the drain deadline
+    for (auto& entry : m_connections) {
+        m_timers.cancel(entry.second->timer);
+        close(entry.second->socket);
+    }
+    m_connections.clear();
+    m_workQueue.clear();
+    m_priorityQueue.clear();
+    m_completions.clear();
+    m_openConnections = 0;
+
+    releaseSockets();
+
+    m_initialized.store(false);
+    std::cout << "RestApiService: Stopped" << std::endl;
+}
+
+std::string RestApiService::getName() const {
+    return "RestApiService";
+}
+
+bool RestApiService::isRunning() const {
+    return m_running.load();
+}
+
+bool RestApiService::setThreadPlacement(const ThreadPlacementPolicy& policy) {
+    if (m_initialized.load()) {
+        std::cerr << "RestApiService: Thread placement must be set before initialize()" << std::endl;
+        return false;
+    }
+    m_threadPlacement = policy;
+    return true;
+}
+
+void RestApiService::setServiceManager(ServiceManager* manager) {
+    m_serviceManager = manager;
+}
+
+void RestApiService::addRoute(const std::string& method, const std::string& path, RouteHandler handler) {
+    std::lock_guard<std::mutex> lock(m_routesMutex);
+    m_routes[method][path] = handler;
+
+    // Replaces a static route with the same pattern, built-in ones included
+    for (const auto& routes : m_staticRoutes) {
+        int index = routes.indexOf(method, path);
+        if (index >= 0) {
+            routes.overridden[index].store(true, std::memory_order_relaxed);
+        }
+    }
+}
+
+void RestApiService::setPort(int port) {
+    if (!m_running.load()) {
+        m_port = port;
+    }
+}
+
+int RestApiService::getPort() const {
+    return m_port;
+}
+
+void RestApiService::setHotUpgradePath(const std::string& path) {
+    if (!m_initialized.load()) {
+        m_hotUpgradePath = path;
+    }
+}
+
+void RestApiService::setDrainTimeout(std::chrono::milliseconds timeout) {
+    m_drainTimeout = timeout;
+}
+
+void RestApiService::setHandoffTimeout(std::chrono::milliseconds timeout) {
+    if (!m_initialized.load()) {
+        m_handoffTimeout = timeout;
+    }
+}
+
+bool RestApiService::enableTls(const TlsOptions& options) {
+    if (m_initialized.load()) {
+        return false;
+    }
+
+    std::string error;
+    std::unique_ptr<TlsContext> context = TlsContext::create(options, error);
+    if (!context) {
+        std::cerr << "RestApiService: " << error << std::endl;
+        return false;
+    }
+    m_tls = std::move(context);
+    return true;
+}
+
+uint64_t RestApiService::kernelTlsConnections() const {
+    return m_kernelTlsConnections.load(std::memory_order_relaxed);
+}
+
+void RestApiService::setConnectionTimeouts(const ConnectionTimeouts& timeouts) {
+    if (!m_initialized.load()) {
+        m_tcpTimeouts = timeouts;
+    }
+}
+
+bool RestApiService::addUnixListener(const std::string& path, const ConnectionTimeouts& timeouts) {
+    struct sockaddr_un address;
+    socklen_t addressLen = 0;
+    if (m_initialized.load() || !makeUnixAddress(path, address, addressLen)) {
+        return false;
+    }
+
+    UnixListener listener;
+    listener.path = path;
+    listener.timeouts = timeouts;
+    m_unixListeners.push_back(listener);
+    return true;
+}
+
+void RestApiService::setTracing(const TracingOptions& options) {
+    m_tracingOptions = options;
+}
+
+void RestApiService::setAccessLog(const AccessLogOptions& options) {
+    if (!m_initialized.load()) {
+        m_accessLog = std::make_shared<AccessLog>(options, MAX_WORKER_THREADS + PRIORITY_WORKER_THREADS);
+    }
+}
+
+bool RestApiService::isDraining() const {
+    return m_initialized.load() && !m_accepting.load();
+}
+
+void RestApiService::serverLoop() {
+    std::vector<struct epoll_event> events(64);
+    std::vector<TimerWheel::Timer*> expired;
+
+    while (!m_loopExit.load()) {
+        int timeout = m_timers.millisecondsUntilNextTick(TimerWheel::Clock::now());
+        int count = epoll_wait(m_epollFd, events.data(), static_cast<int>(events.size()), timeout);
+        if (count < 0 && errno != EINTR) {
+            std::cerr << "RestApiService: Event loop failed" << std::endl;
+            break;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == m_loopEvent) {
+                uint64_t signalled;
+                ssize_t drained = read(m_loopEvent, &signalled, sizeof(signalled));
+                (void)drained;
+                onCompletions();
+                continue;
+            }
+
+            auto listener = std::find_if(m_listenerSlots.begin(), m_listenerSlots.end(),
+                                         [fd](const ListenerSlot& slot) { return slot.socket == fd; });
+            if (listener != m_listenerSlots.end()) {
+                if (m_listening) {
+                    acceptConnections(*listener);
+                }
+                continue;
+            }
+
+            auto it = m_connections.find(fd);
+            if (it == m_connections.end()) {
+                continue;
+            }
+            Connection& connection = *it->second;
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                closeConnection(connection);
+                continue;
+            }
+
+            // HTTP/2 connections wait for both at once; writing may close
+            if (connection.tls && !connection.tls->established()) {
+                continueHandshake(connection);
+                continue;
+            }
+
+            uint64_t connectionId = connection.id;
+            if (events[i].events & EPOLLOUT) {
+                writeOutput(connection);
+            }
+            if (events[i].events & EPOLLIN) {
+                it = m_connections.find(fd);
+                if (it != m_connections.end() && it->second->id == connectionId) {
+                    onReadable(*it->second);
+                }
+            }
+        }
+
+        expired.clear();
+        m_timers.advance(TimerWheel::Clock::now(), expired);
+        for (TimerWheel::Timer* timer : expired) {
+            onDeadline(timer);
+        }
+
+        if (m_listening && !m_accepting.load()) {
+            stopListening();
+        }
+    }
+
+    // Whatever is left missed the drain deadline
+    for (auto& entry : m_connections) {
+        m_timers.cancel(entry.second->timer);
+        close(entry.second->socket);
+    }
+    m_connections.clear();
+}
+
+void RestApiService::acceptConnections(const ListenerSlot& listener) {
+    while (true) {
+        int clientSocket = accept4(listener.socket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (clientSocket < 0) {
+            // EAGAIN: backlog drained, or the successor won the race
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                std::cerr << "RestApiService: Accept failed" << std::endl;
+            }
+            return;
+        }
+
+        auto connection = std::make_unique<Connection>();
+        connection->socket = clientSocket;
+        connection->id = ++m_nextConnectionId;
+        connection->timeouts = listener.timeouts;
+        connection->timer.context = connection.get();
+        connection->timer.kind = HEADER_DEADLINE;
+        if (m_tracer) {
+            connection->acceptedAt = TimerWheel::Clock::now();
+        }
+
+        if (listener.isUnix) {
+            struct ucred credentials;
+            socklen_t credentialsLen = sizeof(credentials);
+            if (getsockopt(clientSocket, SOL_SOCKET, SO_PEERCRED, &credentials, &credentialsLen) == 0) {
+                connection->peer.valid = true;
+                connection->peer.pid = credentials.pid;
+                connection->peer.uid = credentials.uid;
+                connection->peer.gid = credentials.gid;
+            }
+        }
+
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = clientSocket;
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, clientSocket, &event) < 0) {
+            close(clientSocket);
+            continue;
+        }
+
+        // The handshake runs under the header deadline
+        if (listener.tls) {
+            connection->tls = std::make_unique<TlsConnection>(*m_tls, clientSocket);
+        }
+
+        m_timers.schedule(connection->timer, TimerWheel::Clock::now() + listener.timeouts->headerRead);
+        m_connections[clientSocket] = std::move(connection);
+
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        ++m_openConnections;
+    }
+}
+
+void RestApiService::continueHandshake(Connection& connection) {
+    switch (connection.tls->handshake()) {
+    case TlsConnection::HandshakeResult::Done:
+        if (connection.tls->kernelTlsSend()) {
+            m_kernelTlsConnections.fetch_add(1, std::memory_order_relaxed);
+        }
+        setInterest(connection, EPOLLIN);
+        // The client's first request may have arrived with its Finished
+        onReadable(connection);
+        break;
+    case TlsConnection::HandshakeResult::WantRead:
+        setInterest(connection, EPOLLIN);
+        break;
+    case TlsConnection::HandshakeResult::WantWrite:
+        setInterest(connection, EPOLLOUT);
+        break;
+    case TlsConnection::HandshakeResult::Failed:
+    default:
+        closeConnection(connection);
+        break;
+    }
+}
+
+ssize_t RestApiService::receive(Connection& connection, char* buffer, size_t length) {
+    if (connection.tls) {
+        return connection.tls->read(buffer, length);
+    }
+    return recv(connection.socket, buffer, length, 0);
+}
+
+ssize_t RestApiService::transmit(Connection& connection, const char* data, size_t length) {
+    if (connection.tls) {
+        return connection.tls->write(data, length);
+    }
+    return send(connection.socket, data, length, MSG_NOSIGNAL);
+}
+
+void RestApiService::onReadable(Connection& connection) {
+    char buffer[16384];
+    while (true) {
+        ssize_t bytesRead = receive(connection, buffer, sizeof(buffer));
+        if (bytesRead > 0) {
+            connection.input.append(buffer, bytesRead);
+            continue;
+        }
+        if (bytesRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (bytesRead < 0 && errno == EINTR) {
+            continue;
+        }
+        // Peer closed or the connection failed
+        closeConnection(connection);
+        return;
+    }
+
+    if (connection.http2) {
+        onHttp2Input(connection);
+        return;
+    }
+    if (connection.rpc) {
+        onRpcInput(connection);
+        return;
+    }
+
+    if (m_tracer && connection.requestStart == TimerWheel::Clock::time_point() && !connection.input.empty()) {
+        connection.requestStart = TimerWheel::Clock::now();
+    }
+
+    if (connection.state == ConnectionState::Idle && !connection.input.empty()) {
+        // First byte of the next keep-alive request starts the header deadline
+        connection.state = ConnectionState::ReadingHeaders;
+        connection.timer.kind = HEADER_DEADLINE;
+        m_timers.schedule(connection.timer, TimerWheel::Clock::now() + connection.timeouts->headerRead);
+    }
+
+    frameRequest(connection);
+}
+
+void RestApiService::frameRequest(Connection& connection) {
+    if (connection.state != ConnectionState::ReadingHeaders &&
+        connection.state != ConnectionState::ReadingBody) {
+        return;
+    }
+
+    if (connection.requestSize == 0) {
+        // HTTP/2 with prior knowledge opens with the client preface
+        size_t compared = std::min(connection.input.size(), Http2Session::PREFACE_LENGTH);
+        if (compared > 0 && connection.input.compare(0, compared, Http2Session::PREFACE, compared) == 0) {
+            if (compared == Http2Session::PREFACE_LENGTH && startHttp2(connection)) {
+                onHttp2Input(connection);
+            }
+            return;
+        }
+
+        // So does the binary RPC protocol, with its own preface
+        compared = std::min(connection.input.size(), RpcSession::PREFACE_LENGTH);
+        if (compared > 0 && connection.input.compare(0, compared, RpcSession::PREFACE, compared) == 0) {
+            if (compared == RpcSession::PREFACE_LENGTH) {
+                startRpc(connection);
+                onRpcInput(connection);
+            }
+            return;
+        }
+
+        size_t headerEnd = connection.input.find("\r\n\r\n");
+        if (headerEnd == std::string::npos) {
+            if (connection.input.size() > MAX_HEADER_BYTES) {
+                rejectRequest(connection, 431, "Request Header Fields Too Large");
+            }
+            return;
+        }
+
+        std::string headers = connection.input.substr(0, headerEnd);
+        std::string value;
+        if (findHeaderValue(headers, "Transfer-Encoding", value)) {
+            rejectRequest(connection, 501, "Not Implemented");
+            return;
+        }
+
+        size_t contentLength = 0;
+        if (findHeaderValue(headers, "Content-Length", value)) {
+            char* end = nullptr;
+            unsigned long long parsed = std::strtoull(value.c_str(), &end, 10);
+            if (value.empty() || end == nullptr || *end != '\0') {
+                rejectRequest(connection, 400, "Bad Request");
+                return;
+            }
+            if (parsed > MAX_BODY_BYTES) {
+                rejectRequest(connection, 413, "Payload Too Large");
+                return;
+            }
+            contentLength = static_cast<size_t>(parsed);
+        }
+
+        connection.requestSize = headerEnd + 4 + contentLength;
+        if (connection.input.size() < connection.requestSize) {
+            connection.state = ConnectionState::ReadingBody;
+            connection.timer.kind = BODY_DEADLINE;
+            m_timers.schedule(connection.timer, TimerWheel::Clock::now() + connection.timeouts->bodyRead);
+
+            if (findHeaderValue(headers, "Expect", value) && strcasecmp(value.c_str(), "100-continue") == 0) {
+                transmit(connection, CONTINUE_RESPONSE, sizeof(CONTINUE_RESPONSE) - 1);
+            }
+        }
+    }
+
+    if (connection.input.size() >= connection.requestSize) {
+        // Upgrades are only taken while accepting; a draining server answers
+        // in HTTP/1.1. h2c is cleartext only, TLS clients negotiate h2 by ALPN.
+        if (m_accepting.load() && !connection.tls && isH2cUpgrade(connection.input.substr(0, connection.input.find("\r\n\r\n")))) {
+            upgradeToHttp2(connection);
+        } else {
+            dispatchRequest(connection);
+        }
+    }
+}
+
+void RestApiService::dispatchRequest(Connection& connection) {
+    WorkItem item;
+    item.socket = connection.socket;
+    item.connectionId = connection.id;
+    item.peer = connection.peer;
+    if (connection.input.size() == connection.requestSize) {
+        item.data.swap(connection.input);
+    } else {
+        // Keep pipelined bytes for the next request
+        item.data = connection.input.substr(0, connection.requestSize);
+        connection.input.erase(0, connection.requestSize);
+    }
+    connection.requestSize = 0;
+    item.trace = beginTrace(connection);
+
+    // Handler time is not bounded by socket deadlines, and further input
+    // waits until the response is written
+    connection.state = ConnectionState::Processing;
+    m_timers.cancel(connection.timer);
+    setInterest(connection, 0);
+
+    bool priority;
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        priority = queueWork(item);
+    }
+    notifyWorkers(priority ? 0 : 1, priority ? 1 : 0);
+}
+
+void RestApiService::onCompletions() {
+    std::vector<Completion> completions;
+    {
+        std::lock_guard<std::mutex> lock(m_completionMutex);
+        completions.swap(m_completions);
+    }
+
+    for (auto& completion : completions) {
+        auto it = m_connections.find(completion.socket);
+        if (it == m_connections.end() || it->second->id != completion.connectionId) {
+            continue; // closed while the handler ran
+        }
+
+        Connection& connection = *it->second;
+        if (completion.streamId != 0) {
+            if (connection.http2) {
+                const HttpResponse& response = completion.response;
+                connection.http2->submitResponse(completion.streamId, response.statusCode,
+                                                 toHttp2Headers(response.headers), response.body);
+                if (completion.trace) {
+                    finishTrace(std::move(completion.trace), TimerWheel::Clock::now());
+                }
+                flushHttp2(connection);
+            } else if (connection.rpc) {
+                const HttpResponse& response = completion.response;
+                HeaderList headers;
+                for (const auto& header : response.headers) {
+                    headers.push_back({header.first, header.second});
+                }
+                connection.rpc->submitResponse(completion.streamId, response.statusCode, headers, response.body);
+                if (completion.trace) {
+                    finishTrace(std::move(completion.trace), TimerWheel::Clock::now());
+                }
+                flushRpc(connection);
+            }
+            continue;
+        }
+
+        connection.output = std::move(completion.data);
+        connection.outputOffset = 0;
+        connection.keepAlive = completion.keepAlive;
+        connection.trace = std::move(completion.trace);
+        connection.state = ConnectionState::Writing;
+        writeOutput(connection);
+    }
+}
+
+void RestApiService::writeOutput(Connection& connection) {
+    while (connection.outputOffset < connection.output.size()) {
+        ssize_t sent = transmit(connection, connection.output.data() + connection.outputOffset,
+                                connection.output.size() - connection.outputOffset);
+        if (sent > 0) {
+            connection.outputOffset += static_cast<size_t>(sent);
+            continue;
+        }
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // Socket buffer full: wait for EPOLLOUT under the write deadline
+            if (!connection.timer.isArmed() || connection.timer.kind != WRITE_DEADLINE) {
+                connection.timer.kind = WRITE_DEADLINE;
+                m_timers.schedule(connection.timer, TimerWheel::Clock::now() + connection.timeouts->write);
+            }
+            // Multiplexed connections keep reading new requests meanwhile
+            setInterest(connection, connection.http2 || connection.rpc ? (EPOLLIN | EPOLLOUT) : EPOLLOUT);
+            return;
+        }
+        closeConnection(connection);
+        return;
+    }
+
+    if (connection.http2) {
+        finishHttp2Write(connection);
+    } else if (connection.rpc) {
+        finishRpcWrite(connection);
+    } else {
+        finishResponse(connection);
+    }
+}
+
+void RestApiService::finishResponse(Connection& connection) {
+    if (connection.trace) {
+        finishTrace(std::move(connection.trace), TimerWheel::Clock::now());
+    }
+    m_timers.cancel(connection.timer);
+    connection.output.clear();
+    connection.outputOffset = 0;
+
+    if (!connection.keepAlive || !m_accepting.load()) {
+        closeConnection(connection);
+        return;
+    }
+
+    setInterest(connection, EPOLLIN);
+    if (connection.input.empty()) {
+        connection.state = ConnectionState::Idle;
+        connection.timer.kind = IDLE_DEADLINE;
+        m_timers.schedule(connection.timer, TimerWheel::Clock::now() + connection.timeouts->idle);
+        return;
+    }
+
+    // A pipelined request is already buffered
+    if (m_tracer) {
+        connection.requestStart = TimerWheel::Clock::now();
+    }
+    connection.state = ConnectionState::ReadingHeaders;
+    connection.timer.kind = HEADER_DEADLINE;
+    m_timers.schedule(connection.timer, TimerWheel::Clock::now() + connection.timeouts->headerRead);
+    frameRequest(connection);
+}
+
+void RestApiService::rejectRequest(Connection& connection, int statusCode, const std::string& statusText) {
+    HttpResponse response;
+    response.statusCode = statusCode;
+    response.statusText = statusText;
+    response.body = R"({"error": ")" + statusText + R"("})";
+
+    connection.input.clear();
+    connection.requestSize = 0;
+    connection.output = buildResponse(response);
+    connection.outputOffset = 0;
+    connection.keepAlive = false;
+    connection.state = ConnectionState::Writing;
+    m_timers.cancel(connection.timer);
+    writeOutput(connection);
+}
+
+void RestApiService::onDeadline(TimerWheel::Timer* timer) {
+    Connection& connection = *static_cast<Connection*>(timer->context);
+    switch (timer->kind) {
+    case HEADER_DEADLINE:
+    case BODY_DEADLINE:
+        // Slow or stalled client: answer best-effort if it sent anything
+        if (!connection.input.empty()) {
+            HttpResponse response;
+            response.statusCode = 408;
+            response.statusText = "Request Timeout";
+            response.body = R"({"error": "Request Timeout"})";
+            std::string data = buildResponse(response);
+            transmit(connection, data.data(), data.size()); // the socket is non-blocking
+        }
+        closeConnection(connection);
+        break;
+    case IDLE_DEADLINE:
+    case WRITE_DEADLINE:
+    default:
+        closeConnection(connection);
+        break;
+    }
+}
+
+void RestApiService::setInterest(Connection& connection, uint32_t events) {
+    struct epoll_event event;
+    event.events = events;
+    event.data.fd = connection.socket;
+    epoll_ctl(m_epollFd, EPOLL_CTL_MOD, connection.socket, &event);
+}
+
+void RestApiService::closeConnection(Connection& connection) {
+    int socket = connection.socket;
+    m_timers.cancel(connection.timer);
+    if (connection.tls) {
+        connection.tls->shutdown();
+    }
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, socket, nullptr);
+    close(socket);
+    m_connections.erase(socket); // destroys connection
+
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    if (m_openConnections > 0) {
+        --m_openConnections;
+    }
+    if (m_openConnections == 0) {
+        m_drainCondition.notify_all();
+    }
+}
+
+void RestApiService::stopListening() {
+    // Listeners stay open (they may be shared with a successor); we just
+    // stop taking connections from them
+    for (const auto& slot : m_listenerSlots) {
+        epoll_ctl(m_epollFd, EPOLL_CTL_DEL, slot.socket, nullptr);
+    }
+    m_listening = false;
+
+    // Keep-alive connections between requests have nothing to drain;
+    // HTTP/2 and RPC connections get a GOAWAY and close once their
+    // requests finish
+    std::vector<Connection*> idle;
+    std::vector<Connection*> http2;
+    std::vector<Connection*> rpc;
+    for (auto& entry : m_connections) {
+        if (entry.second->http2) {
+            http2.push_back(entry.second.get());
+        } else if (entry.second->rpc) {
+            rpc.push_back(entry.second.get());
+        } else if (entry.second->state == ConnectionState::Idle) {
+            idle.push_back(entry.second.get());
+        }
+    }
+    for (Connection* connection : idle) {
+        closeConnection(*connection);
+    }
+    for (Connection* connection : http2) {
+        flushHttp2(*connection);
+    }
+    for (Connection* connection : rpc) {
+        flushRpc(*connection);
+    }
+}
+
+bool RestApiService::startHttp2(Connection& connection, const std::string* upgradeSettings) {
+    Http2Session::Limits limits;
+    limits.maxConcurrentStreams = MAX_HTTP2_STREAMS;
+    limits.maxHeaderListSize = MAX_HEADER_BYTES;
+    limits.maxBodySize = MAX_BODY_BYTES;
+
+    auto session = std::make_unique<Http2Session>(limits);
+    if (upgradeSettings != nullptr) {
+        if (!session->upgrade(*upgradeSettings)) {
+            return false;
+        }
+        // The 101 goes out ahead of the server preface
+        connection.output.append(SWITCHING_PROTOCOLS_RESPONSE, sizeof(SWITCHING_PROTOCOLS_RESPONSE) - 1);
+    }
+
+    connection.http2 = std::move(session);
+    connection.state = ConnectionState::Http2;
+    connection.requestSize = 0;
+    m_timers.cancel(connection.timer);
+    return true;
+}
+
+void RestApiService::upgradeToHttp2(Connection& connection) {
+    size_t headerEnd = connection.input.find("\r\n\r\n");
+    std::string settings;
+    findHeaderValue(connection.input.substr(0, headerEnd), "HTTP2-Settings", settings);
+
+    if (!startHttp2(connection, &settings)) {
+        rejectRequest(connection, 400, "Bad Request");
+        return;
+    }
+
+    // The upgrading request is answered on stream 1; anything after it is
+    // the client preface and HTTP/2 frames
+    WorkItem item;
+    item.socket = connection.socket;
+    item.connectionId = connection.id;
+    item.peer = connection.peer;
+    item.streamId = 1;
+    size_t requestSize = headerEnd + 4;
+    std::string value;
+    if (findHeaderValue(connection.input.substr(0, headerEnd), "Content-Length", value)) {
+        requestSize += std::strtoul(value.c_str(), nullptr, 10);
+    }
+    item.data = connection.input.substr(0, requestSize);
+    connection.input.erase(0, requestSize);
+    item.trace = beginTrace(connection);
+
+    bool priority;
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        priority = queueWork(item);
+    }
+    notifyWorkers(priority ? 0 : 1, priority ? 1 : 0);
+
+    onHttp2Input(connection);
+}
+
+void RestApiService::onHttp2Input(Connection& connection) {
+    // A protocol error leaves a GOAWAY queued; isFinished() then closes
+    connection.http2->receive(connection.input);
+
+    std::vector<Http2Session::StreamRequest> requests;
+    connection.http2->takeRequests(requests);
+    if (!requests.empty()) {
+        // Streams run concurrently on the worker pool
+        size_t priority = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_queueMutex);
+            for (auto& request : requests) {
+                WorkItem item;
+                item.socket = connection.socket;
+                item.connectionId = connection.id;
+                item.peer = connection.peer;
+                item.streamId = request.streamId;
+                item.stream = std::move(request);
+                item.trace = beginTrace(connection);
+                priority += queueWork(item) ? 1 : 0;
+            }
+        }
+        notifyWorkers(requests.size() - priority, priority);
+    }
+
+    flushHttp2(connection);
+}
+
+void RestApiService::flushHttp2(Connection& connection) {
+    Http2Session& session = *connection.http2;
+    if (!m_accepting.load()) {
+        session.goAway();
+    }
+
+    std::string& frames = session.output();
+    if (!frames.empty()) {
+        if (connection.outputOffset >= connection.output.size()) {
+            connection.output.swap(frames);
+            connection.outputOffset = 0;
+        } else {
+            connection.output.append(frames);
+        }
+        frames.clear();
+    }
+
+    if (connection.outputOffset < connection.output.size()) {
+        writeOutput(connection);
+    } else {
+        finishHttp2Write(connection);
+    }
+}
+
+void RestApiService::finishHttp2Write(Connection& connection) {
+    connection.output.clear();
+    connection.outputOffset = 0;
+
+    if (connection.http2->isFinished()) {
+        closeConnection(connection);
+        return;
+    }
+
+    setInterest(connection, EPOLLIN);
+    if (connection.http2->activeStreams() > 0) {
+        // Handler time is not bounded, as for HTTP/1.1
+        m_timers.cancel(connection.timer);
+    } else if (!connection.timer.isArmed() || connection.timer.kind != IDLE_DEADLINE) {
+        connection.timer.kind = IDLE_DEADLINE;
+        m_timers.schedule(connection.timer, TimerWheel::Clock::now() + connection.timeouts->idle);
+    }
+}
+
+std::unique_ptr<RestApiService::RequestTrace> RestApiService::beginTrace(Connection& connection) {
+    if (!m_tracer) {
+        return nullptr;
+    }
+
+    auto trace = std::make_unique<RequestTrace>();
+    trace->framed = TimerWheel::Clock::now();
+    trace->accepted = connection.acceptedAt;
+    trace->readStart = connection.requestStart == TimerWheel::Clock::time_point() ? trace->framed
+                                                                                   : connection.requestStart;
+    connection.acceptedAt = TimerWheel::Clock::time_point();
+    connection.requestStart = TimerWheel::Clock::time_point();
+    return trace;
+}
+
+void RestApiService::startRequestSpan(HttpRequest& request, std::unique_ptr<RequestTrace>& trace) {
+    TraceContext incoming;
+    bool hasParent = false;
+    for (const auto& header : request.headers) {
+        if (strcasecmp(header.first.c_str(), "traceparent") == 0) {
+            hasParent = TraceContext::parse(header.second, incoming);
+            break;
+        }
+    }
+
+    if (!trace) {
+        // Not tracing: pass the caller's context through unchanged
+        if (hasParent) {
+            request.trace = incoming;
+        }
+        return;
+    }
+
+    trace->context = m_tracer->startSpan(hasParent ? &incoming : nullptr);
+    request.trace = trace->context;
+    if (!trace->context.sampled()) {
+        trace.reset(); // propagated, but not recorded
+        return;
+    }
+    if (hasParent) {
+        trace->parentSpanId = incoming.spanId;
+    }
+    trace->method = request.method;
+    trace->target = request.path;
+    trace->protocol = request.version == "HTTP/2" ? "2" : request.version == "HTTP/1.0" ? "1.0" : "1.1";
+}
+
+void RestApiService::finishTrace(std::unique_ptr<RequestTrace> trace, TimerWheel::Clock::time_point sentAt) {
+    using TimePoint = RequestTrace::TimePoint;
+    const RequestTrace& request = *trace;
+    if (!m_tracer || !request.context.valid()) {
+        return; // failed before a span was started
+    }
+
+    std::vector<SpanRecord> spans;
+    spans.reserve(8);
+
+    // One server span for the whole exchange...
+    SpanRecord server;
+    server.name = request.route.empty() ? request.method : request.method + " " + request.route;
+    server.traceId = request.context.traceId;
+    server.spanId = request.context.spanId;
+    server.parentSpanId = request.parentSpanId;
+    server.server = true;
+    server.error = request.statusCode >= 500;
+    server.startUnixNanos = m_tracer->toUnixNanos(request.accepted != TimePoint() ? request.accepted
+                                                                                  : request.readStart);
+    server.endUnixNanos = m_tracer->toUnixNanos(sentAt);
+    server.attributes.push_back({"http.request.method", request.method, 0, false});
+    server.attributes.push_back({"url.path", request.target, 0, false});
+    if (!request.route.empty()) {
+        server.attributes.push_back({"http.route", request.route, 0, false});
+    }
+    server.attributes.push_back({"http.response.status_code", "", request.statusCode, true});
+    server.attributes.push_back({"network.protocol.version", request.protocol, 0, false});
+    spans.push_back(std::move(server));
+
+    // ...and a child per phase, so a slow request shows where it waited
+    auto addPhase = [&](const char* name, TimePoint begin, TimePoint end) {
+        if (begin == TimePoint() || end == TimePoint() || end < begin) {
+            return;
+        }
+        SpanRecord span;
+        span.name = name;
+        span.traceId = request.context.traceId;
+        span.spanId = Tracer::newSpanId();
+        span.parentSpanId = request.context.spanId;
+        span.startUnixNanos = m_tracer->toUnixNanos(begin);
+        span.endUnixNanos = m_tracer->toUnixNanos(end);
+        spans.push_back(std::move(span));
+    };
+    addPhase("accept", request.accepted, request.readStart);
+    addPhase("read", request.readStart, request.framed);
+    addPhase("queue", request.framed, request.dequeued);
+    addPhase("parse", request.dequeued, request.parsed);
+    addPhase("route", request.parsed, request.routed);
+    addPhase("handler", request.routed, request.handled);
+    addPhase("send", request.handled, sentAt);
+
+    m_tracer->submit(spans);
+}
+
+HttpRequest RestApiService::buildHttp2Request(Http2Session::StreamRequest& stream) {
+    HttpRequest request;
+    request.version = "HTTP/2";
+    for (auto& field : stream.headers) {
+        if (field.name == ":method") {
+            request.method = field.value;
+        } else if (field.name == ":path") {
+            request.path = field.value;
+        } else if (field.name == ":authority") {
+            request.headers["host"] = field.value;
+        } else if (!field.name.empty() && field.name[0] != ':') {
+            // Repeated fields fold as in HTTP/1.1 (cookies use "; ")
+            std::string& value = request.headers[field.name];
+            if (!value.empty()) {
+                value += field.name == "cookie" ? "; " : ", ";
+            }
+            value += field.value;
+        }
+    }
+
+    size_t queryPos = request.path.find('?');
+    if (queryPos != std::string::npos) {
+        request.query = request.path.substr(queryPos + 1);
+        request.queryParams = parseQueryString(request.query);
+        request.path.erase(queryPos);
+    }
+    request.body = std::move(stream.body);
+    return request;
+}
+
+void RestApiService::startRpc(Connection& connection) {
+    RpcSession::Limits limits;
+    limits.maxConcurrentRequests = MAX_RPC_REQUESTS;
+    limits.maxFrameSize = MAX_HEADER_BYTES + MAX_BODY_BYTES;
+
+    connection.rpc = std::make_unique<RpcSession>(limits);
+    connection.state = ConnectionState::Rpc;
+    connection.requestSize = 0;
+    m_timers.cancel(connection.timer);
+}
+
+void RestApiService::onRpcInput(Connection& connection) {
+    // A protocol error leaves a GOAWAY queued; isFinished() then closes
+    connection.rpc->receive(connection.input);
+
+    std::vector<RpcSession::Request> requests;
+    connection.rpc->takeRequests(requests);
+    if (!requests.empty()) {
+        // Requests run concurrently on the worker pool
+        size_t priority = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_queueMutex);
+            for (auto& request : requests) {
+                WorkItem item;
+                item.socket = connection.socket;
+                item.connectionId = connection.id;
+                item.peer = connection.peer;
+                item.streamId = request.id;
+                item.rpc = std::move(request);
+                item.trace = beginTrace(connection);
+                priority += queueWork(item) ? 1 : 0;
+            }
+        }
+        notifyWorkers(requests.size() - priority, priority);
+    }
+
+    flushRpc(connection);
+}
+
+void RestApiService::flushRpc(Connection& connection) {
+    RpcSession& session = *connection.rpc;
+    if (!m_accepting.load()) {
+        session.goAway();
+    }
+
+    std::string& frames = session.output();
+    if (!frames.empty()) {
+        if (connection.outputOffset >= connection.output.size()) {
+            connection.output.swap(frames);
+            connection.outputOffset = 0;
+        } else {
+            connection.output.append(frames);
+        }
+        frames.clear();
+    }
+
+    if (connection.outputOffset < connection.output.size()) {
+        writeOutput(connection);
+    } else {
+        finishRpcWrite(connection);
+    }
+}
+
+void RestApiService::finishRpcWrite(Connection& connection) {
+    connection.output.clear();
+    connection.outputOffset = 0;
+
+    if (connection.rpc->isFinished()) {
+        closeConnection(connection);
+        return;
+    }
+
+    setInterest(connection, EPOLLIN);
+    if (connection.rpc->activeRequests() > 0) {
+        m_timers.cancel(connection.timer);
+    } else if (!connection.timer.isArmed() || connection.timer.kind != IDLE_DEADLINE) {
+        connection.timer.kind = IDLE_DEADLINE;
+        m_timers.schedule(connection.timer, TimerWheel::Clock::now() + connection.timeouts->idle);
+    }
+}
+
+HttpRequest RestApiService::buildRpcRequest(RpcSession::Request& rpc) {
+    HttpRequest request;
+    request.version = "RPC/1";
+    request.method = std::move(rpc.method);
+    request.path = std::move(rpc.path);
+    bool hasAccept = false;
+    for (auto& header : rpc.headers) {
+        hasAccept = hasAccept || strcasecmp(header.name.c_str(), "Accept") == 0;
+        request.headers[header.name] = std::move(header.value);
+    }
+    // RPC callers get schema-encoded bodies unless they ask otherwise
+    if (!hasAccept) {
+        request.headers["Accept"] = RPC_CONTENT_TYPE;
+    }
+
+    size_t queryPos = request.path.find('?');
+    if (queryPos != std::string::npos) {
+        request.query = request.path.substr(queryPos + 1);
+        request.queryParams = parseQueryString(request.query);
+        request.path.erase(queryPos);
+    }
+    request.body = std::move(rpc.body);
+    return request;
+}
+
+void RestApiService::handoffLoop() {
+    struct pollfd fds[2];
+    fds[0].fd = m_handoffSocket;
+    fds[0].events = POLLIN;
+    fds[1].fd = m_wakePipe[0];
+    fds[1].events = POLLIN;
+
+    while (m_accepting.load()) {
+        fds[0].revents = 0;
+        fds[1].revents = 0;
+        if (poll(fds, 2, -1) < 0) {
+            if (errno != EINTR) {
+                break;
+            }
+            continue;
+        }
+
+        if (fds[1].revents != 0) {
+            break;
+        }
 
-    // Wait for worker threads to finish
-    for (auto& worker : m_workerThreads) {
-        if (worker.joinable()) {
-            worker.join();
+        int controlSocket = accept4(m_handoffSocket, nullptr, nullptr, SOCK_CLOEXEC);
+        if (controlSocket < 0) {
+            continue;
         }
-    }
-    m_workerThreads.clear();
 
-    m_initialized.store(false);
-    std::cout << "RestApiService: Stopped" << std::endl;
-}
+        std::cout << "RestApiService: Handing listening socket to new process" << std::endl;
+        bool handedOff = SocketHandoff::sendListeners(controlSocket, listeningSockets(), m_handoffTimeout) &&
+                         SocketHandoff::waitForAck(controlSocket, m_handoffTimeout);
+        close(controlSocket);
 
-std::string RestApiService::getName() const {
-    return "RestApiService";
-}
+        if (!handedOff) {
+            // The successor failed to come up; keep serving
+            std::cerr << "RestApiService: Hot upgrade aborted, continuing to serve" << std::endl;
+            continue;
+        }
 
-bool RestApiService::isRunning() const {
-    return m_running.load();
+        // The successor now accepts on the shared socket. Finish what we
+        // already accepted, then report ourselves as no longer running so
+        // the owning process can exit.
+        std::cout << "RestApiService: Hot upgrade acknowledged, draining connections" << std::endl;
+        m_handedOff = true;
+        stopAccepting();
+        drainConnections(std::chrono::steady_clock::now() + m_drainTimeout);
+        m_running.store(false);
+        std::cout << "RestApiService: Drain complete" << std::endl;
+        break;
+    }
 }
 
-void RestApiService::setServiceManager(ServiceManager* manager) {
-    m_serviceManager = manager;
+void RestApiService::stopAccepting() {
+    if (m_accepting.exchange(false)) {
+        // The pipe is never read, so it wakes the hand-off poller for good
+        if (m_wakePipe[1] >= 0) {
+            char wake = 1;
+            ssize_t written = write(m_wakePipe[1], &wake, 1);
+            (void)written;
+        }
+        wakeLoop();
+    }
 }
 
-void RestApiService::addRoute(const std::string& method, const std::string& path, RouteHandler handler) {
-    std::lock_guard<std::mutex> lock(m_routesMutex);
-    m_routes[method][path] = handler;
+void RestApiService::wakeLoop() {
+    if (m_loopEvent >= 0) {
+        uint64_t one = 1;
+        ssize_t written = write(m_loopEvent, &one, sizeof(one));
+        (void)written;
+    }
 }
 
-void RestApiService::setPort(int port) {
-    if (!m_running.load()) {
-        m_port = port;
+void RestApiService::drainConnections(std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(m_queueMutex);
+    bool drained = m_drainCondition.wait_until(lock, deadline, [this] {
+        return m_openConnections == 0;
+    });
+    if (!drained) {
+        std::cerr << "RestApiService: Drain deadline reached with " << m_openConnections
+                  << " open connections" << std::endl;
     }
 }
 
-int RestApiService::getPort() const {
-    return m_port;
+bool RestApiService::isPriorityTarget(const char* target, size_t length) const {
+    size_t pathLength = 0;
+    while (pathLength < length && target[pathLength] != '?' && target[pathLength] != ' ') {
+        ++pathLength;
+    }
+    for (const auto& prefix : m_priorityPrefixes) {
+        if (pathLength >= prefix.size() && std::memcmp(target, prefix.data(), prefix.size()) == 0 &&
+            (pathLength == prefix.size() || prefix.back() == '/' || target[prefix.size()] == '/')) {
+            return true;
+        }
+    }
+    return false;
 }
 
-void RestApiService::serverLoop() {
-    while (m_running.load()) {
-        struct sockaddr_in clientAddress;
-        socklen_t clientLen = sizeof(clientAddress);
-        
-        int clientSocket = accept(m_serverSocket, (struct sockaddr*)&clientAddress, &clientLen);
-        if (clientSocket < 0) {
-            if (m_running.load()) {
-                std::cerr << "RestApiService: Accept failed" << std::endl;
+bool RestApiService::queueWork(WorkItem& item) {
+    // Classified from the request target alone, before anything is parsed
+    bool priority = false;
+    if (!item.data.empty()) {
+        size_t targetStart = item.data.find(' ');
+        size_t lineEnd = item.data.find("\r\n");
+        if (targetStart != std::string::npos && targetStart < lineEnd) {
+            priority = isPriorityTarget(item.data.data() + targetStart + 1, lineEnd - targetStart - 1);
+        }
+    } else if (item.rpc.id != 0) {
+        priority = isPriorityTarget(item.rpc.path.data(), item.rpc.path.size());
+    } else {
+        for (const auto& field : item.stream.headers) {
+            if (field.name == ":path") {
+                priority = isPriorityTarget(field.value.data(), field.value.size());
+                break;
             }
-            continue;
         }
+    }
 
-        // Add client to queue for worker threads
-        {
-            std::lock_guard<std::mutex> lock(m_queueMutex);
-            m_clientQueue.push_back(clientSocket);
+    if (m_accessLog) {
+        item.queuedAt = TimerWheel::Clock::now();
+    }
+    (priority ? m_priorityQueue : m_workQueue).push_back(std::move(item));
+    return priority;
+}
+
+void RestApiService::notifyWorkers(size_t regular, size_t priority) {
+    // Priority requests wake a lane thread and, in case the lane is busy,
+    // a regular worker too; regular requests never wake the lane
+    if (priority > 0) {
+        if (priority == 1) {
+            m_priorityCondition.notify_one();
+        } else {
+            m_priorityCondition.notify_all();
         }
+    }
+    if (regular + priority == 1) {
         m_queueCondition.notify_one();
+    } else if (regular + priority > 1) {
+        m_queueCondition.notify_all();
     }
 }
 
-void RestApiService::workerLoop() {
+void RestApiService::workerLoop(bool priorityLane, size_t worker) {
+    std::condition_variable& condition = priorityLane ? m_priorityCondition : m_queueCondition;
     while (!m_stopWorkers.load()) {
-        int clientSocket = -1;
+        WorkItem item;
         
-        // Wait for client connection
+        // Wait for a complete request from the I/O loop
         {
             std::unique_lock<std::mutex> lock(m_queueMutex);
-            m_queueCondition.wait(lock, [this] { 
-                return !m_clientQueue.empty() || m_stopWorkers.load(); 
+            condition.wait(lock, [this, priorityLane] {
+                return !m_priorityQueue.empty() || (!priorityLane && !m_workQueue.empty()) ||
+                       m_stopWorkers.load();
             });
             
             if (m_stopWorkers.load()) {
                 break;
             }
             
-            if (!m_clientQueue.empty()) {
-                clientSocket = m_clientQueue.back();
-                m_clientQueue.pop_back();
-            }
+            // Strict priority: every worker takes health and admin requests first
+            std::deque<WorkItem>& queue = m_priorityQueue.empty() ? m_workQueue : m_priorityQueue;
+            item = std::move(queue.front());
+            queue.pop_front();
         }
         
-        if (clientSocket >= 0) {
-            handleClient(clientSocket);
-        }
+        processRequest(item, worker);
     }
 }
 
-void RestApiService::handleClient(int clientSocket) {
+void RestApiService::processRequest(WorkItem& item, size_t worker) {
+    Completion completion;
+    completion.socket = item.socket;
+    completion.connectionId = item.connectionId;
+    completion.keepAlive = false;
+    completion.streamId = item.streamId;
+    TimerWheel::Clock::time_point dequeued;
+    if (item.trace || m_accessLog) {
+        dequeued = TimerWheel::Clock::now();
+    }
+    if (item.trace) {
+        item.trace->dequeued = dequeued;
+    }
+
     try {
-        // Set socket timeout
-        struct timeval timeout;
-        timeout.tv_sec = 30;  // 30 seconds timeout
-        timeout.tv_usec = 0;
-        setsockopt(clientSocket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
-
-        // Read request
-        char buffer[4096];
-        ssize_t bytesRead = recv(clientSocket, buffer, sizeof(buffer) - 1, 0);
-        
-        if (bytesRead <= 0) {
-            close(clientSocket);
-            return;
-        }
-        
-        buffer[bytesRead] = '\0';
-        std::string requestData(buffer);
-        
         // Parse and route request
-        HttpRequest request = parseRequest(requestData);
-        HttpResponse response = routeRequest(request);
-        
-        // Send response
-        std::string responseStr = buildResponse(response);
-        send(clientSocket, responseStr.c_str(), responseStr.length(), 0);
-        
+        HttpRequest request;
+        if (item.rpc.id != 0) {
+            request = buildRpcRequest(item.rpc);
+        } else if (item.data.empty() && item.streamId != 0) {
+            request = buildHttp2Request(item.stream);
+        } else {
+            request = parseRequest(item.data);
+        }
+        request.peer = item.peer;
+        if (item.trace) {
+            item.trace->parsed = TimerWheel::Clock::now();
+        }
+        startRequestSpan(request, item.trace);
+
+        HttpResponse response = routeRequest(request, item.trace.get());
+        if (item.trace) {
+            item.trace->handled = TimerWheel::Clock::now();
+            item.trace->statusCode = response.statusCode;
+        }
+        if (m_accessLog) {
+            logAccess(worker, item, dequeued, &request, response);
+        }
+
+        if (completion.streamId != 0) {
+            // HTTP/2 responses are framed by the I/O loop
+            completion.response = std::move(response);
+        } else {
+            // HTTP/1.1 defaults to keep-alive, HTTP/1.0 must ask for it
+            std::string connectionHeader;
+            for (const auto& header : request.headers) {
+                if (strcasecmp(header.first.c_str(), "Connection") == 0) {
+                    connectionHeader = header.second;
+                }
+            }
+            if (request.version == "HTTP/1.1") {
+                completion.keepAlive = strcasecmp(connectionHeader.c_str(), "close") != 0;
+            } else {
+                completion.keepAlive = strcasecmp(connectionHeader.c_str(), "keep-alive") == 0;
+            }
+            completion.keepAlive = completion.keepAlive && m_accepting.load();
+
+            completion.data = buildResponse(response, completion.keepAlive);
+        }
     } catch (const std::exception& e) {
         std::cerr << "RestApiService: Error handling client: " << e.what() << std::endl;
+        HttpResponse response;
+        response.statusCode = 500;
+        response.statusText = "Internal Server Error";
+        response.body = R"({"error": "Internal server error"})";
+        completion.keepAlive = false;
+        if (completion.streamId != 0) {
+            completion.response = response;
+        } else {
+            completion.data = buildResponse(response);
+        }
+        if (item.trace) {
+            item.trace->handled = TimerWheel::Clock::now();
+            item.trace->statusCode = response.statusCode;
+        }
+        if (m_accessLog) {
+            logAccess(worker, item, dequeued, nullptr, response);
+        }
     }
-    
-    close(clientSocket);
+    completion.trace = std::move(item.trace);
+
+    {
+        std::lock_guard<std::mutex> lock(m_completionMutex);
+        m_completions.push_back(std::move(completion));
+    }
+    wakeLoop();
+}
+
+void RestApiService::logAccess(size_t worker, const WorkItem& item, TimerWheel::Clock::time_point dequeued,
+                               const HttpRequest* request, const HttpResponse& response) {
+    if (!m_accessLog->sample(worker, response.statusCode)) {
+        return;
+    }
+
+    AccessLogRecord record;
+    record.time = std::chrono::system_clock::now();
+    if (request != nullptr) {
+        record.method = request->method;
+        record.path = request->path;
+        record.protocol = request->version;
+        record.requestBytes = request->body.size();
+    }
+    record.status = response.statusCode;
+    record.responseBytes = response.body.size();
+    record.queued = std::chrono::duration_cast<std::chrono::microseconds>(dequeued - item.queuedAt);
+    record.handled = std::chrono::duration_cast<std::chrono::microseconds>(TimerWheel::Clock::now() - dequeued);
+    m_accessLog->record(worker, std::move(record));
 }
 
 HttpRequest RestApiService::parseRequest(const std::string& requestData) {
@@ -270,9 +1875,9 @@ HttpRequest RestApiService::parseRequest(const std::string& requestData) {
         // Parse query parameters
         size_t queryPos = request.path.find('?');
         if (queryPos != std::string::npos) {
-            std::string queryString = request.path.substr(queryPos + 1);
+            request.query = request.path.substr(queryPos + 1);
             request.path = request.path.substr(0, queryPos);
-            request.queryParams = parseQueryString(queryString);
+            request.queryParams = parseQueryString(request.query);
         }
     }
     
@@ -293,20 +1898,26 @@ HttpRequest RestApiService::parseRequest(const std::string& requestData) {
         }
     }
     
-    // Parse body (if present)
-    std::string body;
-    while (std::getline(stream, line)) {
-        body += line + "\n";
-    }
-    if (!body.empty()) {
-        body.pop_back(); // Remove last newline
-        request.body = body;
+    // Parse body (if present). The I/O loop frames requests by
+    // Content-Length, so everything after the blank line is the body.
+    size_t headerEnd = requestData.find("\r\n\r\n");
+    if (headerEnd != std::string::npos) {
+        request.body = requestData.substr(headerEnd + 4);
+    } else {
+        std::string body;
+        while (std::getline(stream, line)) {
+            body += line + "\n";
+        }
+        if (!body.empty()) {
+            body.pop_back(); // Remove last newline
+            request.body = body;
+        }
     }
     
     return request;
 }
 
-std::string RestApiService::buildResponse(const HttpResponse& response) {
+std::string RestApiService::buildResponse(const HttpResponse& response, bool keepAlive) {
     std::ostringstream responseStream;
     
     // Status line
@@ -319,7 +1930,7 @@ std::string RestApiService::buildResponse(const HttpResponse& response) {
     
     // Content-Length header
     responseStream << "Content-Length: " << response.body.length() << "\r\n";
-    responseStream << "Connection: close\r\n";
+    responseStream << (keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n");
     responseStream << "\r\n";
     
     // Body
@@ -328,82 +1939,281 @@ std::string RestApiService::buildResponse(const HttpResponse& response) {
     return responseStream.str();
 }
 
-HttpResponse RestApiService::routeRequest(const HttpRequest& request) {
-    std::lock_guard<std::mutex> lock(m_routesMutex);
-    
-    // Check for exact route match first
-    auto methodIt = m_routes.find(request.method);
-    if (methodIt != m_routes.end()) {
-        auto pathIt = methodIt->second.find(request.path);
-        if (pathIt != methodIt->second.end()) {
-            return pathIt->second(request);
-        }
-        
-        // Check for parameterized routes
-        for (const auto& route : methodIt->second) {
-            std::map<std::string, std::string> pathParams;
-            if (matchRoute(route.first, request.path, pathParams)) {
-                HttpRequest modifiedRequest = request;
-                modifiedRequest.pathParams = pathParams;
-                return route.second(modifiedRequest);
+HttpResponse RestApiService::routeRequest(const HttpRequest& request, RequestTrace* trace) {
+    // Exact routes first, static then dynamic; compile-time tables are fixed
+    // once started and need no lock
+    std::optional<HttpResponse> response;
+    if (dispatchStaticRoutes(request, false, response, trace)) {
+        return std::move(*response);
+    }
+
+    // Resolve dynamic routes under the lock but run the handler outside it,
+    // so a slow handler doesn't hold up requests on the other workers
+    RouteHandler handler;
+    {
+        std::lock_guard<std::mutex> lock(m_routesMutex);
+        auto methodIt = m_routes.find(request.method);
+        if (methodIt != m_routes.end()) {
+            auto pathIt = methodIt->second.find(request.path);
+            if (pathIt != methodIt->second.end()) {
+                handler = pathIt->second;
+                if (trace) {
+                    trace->route = pathIt->first;
+                }
             }
         }
     }
-    
-    // Check if path exists for other methods
-    for (const auto& methodPair : m_routes) {
-        if (methodPair.first != request.method) {
-            if (methodPair.second.find(request.path) != methodPair.second.end()) {
-                return handleMethodNotAllowed(request);
+    if (handler) {
+        if (trace) {
+            trace->routed = TimerWheel::Clock::now();
+        }
+        return handler(request);
+    }
+
+    // Then parameterized routes, in the same order
+    if (dispatchStaticRoutes(request, true, response, trace)) {
+        return std::move(*response);
+    }
+
+    std::map<std::string, std::string> pathParams;
+    std::shared_ptr<ReverseProxy> proxy;
+    bool methodNotAllowed = false;
+    {
+        std::lock_guard<std::mutex> lock(m_routesMutex);
+        auto methodIt = m_routes.find(request.method);
+        if (methodIt != m_routes.end()) {
+            for (const auto& route : methodIt->second) {
+                if (matchRoute(route.first, request.path, pathParams)) {
+                    handler = route.second;
+                    if (trace) {
+                        trace->route = route.first;
+                    }
+                    break;
+                }
+                pathParams.clear();
+            }
+        }
+
+        // Then proxy routes, longest prefix first
+        if (!handler) {
+            size_t longest = 0;
+            for (const auto& route : m_proxyRoutes) {
+                const std::string& prefix = route.first;
+                bool matches = request.path.compare(0, prefix.size(), prefix) == 0 &&
+                               (request.path.size() == prefix.size() || prefix.back() == '/' ||
+                                request.path[prefix.size()] == '/');
+                if (matches && prefix.size() >= longest) {
+                    longest = prefix.size();
+                    proxy = route.second;
+                    if (trace) {
+                        trace->route = prefix;
+                    }
+                }
+            }
+        }
+
+        // Check if path exists for other methods
+        if (!handler && !proxy) {
+            for (const auto& methodPair : m_routes) {
+                if (methodPair.first != request.method &&
+                    methodPair.second.find(request.path) != methodPair.second.end()) {
+                    methodNotAllowed = true;
+                    break;
+                }
             }
         }
     }
-    
+
+    if (trace) {
+        trace->routed = TimerWheel::Clock::now();
+    }
+
+    if (handler) {
+        HttpRequest modifiedRequest = request;
+        modifiedRequest.pathParams = std::move(pathParams);
+        return handler(modifiedRequest);
+    }
+    if (proxy) {
+        return proxy->forward(request);
+    }
+    for (const auto& routes : m_staticRoutes) {
+        methodNotAllowed = methodNotAllowed || routes.hasOtherMethod(request);
+    }
+    if (methodNotAllowed) {
+        return handleMethodNotAllowed(request);
+    }
     return handleNotFound(request);
 }
 
-void RestApiService::setupDefaultRoutes() {
+void RestApiService::setBuiltinCoalescing(bool enabled) {
+    if (m_running.load()) {
+        return;
+    }
+    if (!enabled) {
+        m_builtinCoalescer.reset();
+    } else if (!m_builtinCoalescer) {
+        m_builtinCoalescer = std::make_unique<RequestCoalescer>();
+    }
+}
+
+void RestApiService::setHealthCheckOptions(const HealthCheckOptions& options) {
+    if (!m_initialized.load()) {
+        m_healthOptions = options;
+    }
+}
+
+bool RestApiService::addPriorityRoute(const std::string& prefix) {
+    if (m_initialized.load() || prefix.empty() || prefix[0] != '/') {
+        return false;
+    }
+    m_priorityPrefixes.push_back(prefix);
+    return true;
+}
+
+bool RestApiService::addProxyRoute(const std::string& prefix, std::shared_ptr<ReverseProxy> proxy) {
+    if (!proxy || !proxy->valid() || prefix.empty() || prefix[0] != '/') {
+        std::cerr << "RestApiService: Invalid proxy route '" << prefix << "'" << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_routesMutex);
+    m_proxyRoutes.emplace_back(prefix, std::move(proxy));
+    return true;
+}
+
+bool RestApiService::dispatchStaticRoutes(const HttpRequest& request, bool parameterized,
+                                          std::optional<HttpResponse>& response, RequestTrace* trace) {
+    for (const auto& routes : m_staticRoutes) {
+        std::map<std::string, std::string> pathParams;
+        int index = routes.find(request, parameterized, pathParams);
+        if (index < 0 || routes.overridden[index].load(std::memory_order_relaxed)) {
+            continue;
+        }
+
+        if (trace) {
+            trace->route = std::string(routes.pattern(index));
+            trace->routed = TimerWheel::Clock::now();
+        }
+        if (!parameterized) {
+            response.emplace(routes.invoke(routes.owner, index, request));
+        } else {
+            HttpRequest modifiedRequest = request;
+            modifiedRequest.pathParams = std::move(pathParams);
+            response.emplace(routes.invoke(routes.owner, index, modifiedRequest));
+        }
+        return true;
+    }
+    return false;
+}
+
+// Built-in endpoints: fixed, so they are dispatched from a compile-time table
+constexpr StaticRouteTable<RestApiService::BuiltinHandler, 7> RestApiService::BUILTIN_ROUTES({
     // Service management routes
-    addRoute("GET", "/api/services", [this](const HttpRequest& req) { return handleServiceList(req); });
-    addRoute("GET", "/api/services/{name}", [this](const HttpRequest& req) { return handleServiceInfo(req); });
-    addRoute("GET", "/api/health/{name}", [this](const HttpRequest& req) { return handleServiceHealth(req); });
-    addRoute("POST", "/api/services/{name}/start", [this](const HttpRequest& req) { return handleServiceStart(req); });
-    addRoute("POST", "/api/services/{name}/stop", [this](const HttpRequest& req) { return handleServiceStop(req); });
-    
+    {"GET", "/api/services",
+     &RestApiService::builtinRoute<&RestApiService::handleServiceList, RequireServiceManager>},
+    {"GET", "/api/services/{name}",
+     &RestApiService::builtinRoute<&RestApiService::handleServiceInfo, RequireServiceManager, ResolveService>},
+    {"GET", "/api/health", &RestApiService::builtinRoute<&RestApiService::handleHealthSummary, RequireServiceManager>},
+    {"GET", "/api/health/{name}",
+     &RestApiService::builtinRoute<&RestApiService::handleServiceHealth, RequireServiceManager, ResolveService>},
+    {"POST", "/api/services/{name}/start",
+     &RestApiService::builtinRoute<&RestApiService::handleServiceStart, RequireServiceManager, ResolveService>},
+    {"POST", "/api/services/{name}/stop",
+     &RestApiService::builtinRoute<&RestApiService::handleServiceStop, RequireServiceManager, ResolveService>},
+
     // API status route
-    addRoute("GET", "/api/status", [this](const HttpRequest& req) {
-        HttpResponse response;
-        response.body = R"({
+    {"GET", "/api/status", &RestApiService::handleServiceStatus},
+});
+
+// Built-in handler behind middleware constructed from the service manager
+template <auto Handler, typename... Middleware>
+HttpResponse RestApiService::builtinRoute(const HttpRequest& request) {
+    auto handler = [this](const HttpRequest& request, ServiceRoute& route) {
+        if constexpr (std::is_invocable_v<decltype(Handler), RestApiService*, const HttpRequest&, ServiceRoute&>) {
+            return (this->*Handler)(request, route);
+        } else {
+            (void)route;
+            return (this->*Handler)(request);
+        }
+    };
+    ServiceRoute route;
+    auto pipeline = withMiddleware<ServiceRoute>(handler, Middleware{m_serviceManager}...);
+    if (m_builtinCoalescer && request.method == "GET") {
+        // JSON and RPC callers get different bodies
+        static const std::vector<std::string> VARY{"Accept"};
+        return m_builtinCoalescer->run(RequestCoalescer::keyOf(request, VARY),
+                                       [&]() { return pipeline.run(request, route); });
+    }
+    return pipeline.run(request, route);
+}
+
+void RestApiService::setupDefaultRoutes() {
+    insertStaticRoutes(makeStaticRouteSet<BUILTIN_ROUTES>(*this), true);
+}
+
+bool RestApiService::insertStaticRoutes(StaticRouteSet routes, bool builtin) {
+    // Workers read the tables without a lock once initialized
+    if (m_initialized.load()) {
+        std::cerr << "RestApiService: Static routes must be added before initialize()" << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_routesMutex);
+    for (const auto& methodRoutes : m_routes) {
+        for (const auto& route : methodRoutes.second) {
+            int index = routes.indexOf(methodRoutes.first, route.first);
+            if (index >= 0) {
+                routes.overridden[index].store(true, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // The built-in table, added by the constructor, stays last
+    auto position = builtin || m_staticRoutes.empty() ? m_staticRoutes.end() : m_staticRoutes.end() - 1;
+    m_staticRoutes.insert(position, std::move(routes));
+    return true;
+}
+
+HttpResponse RestApiService::handleServiceStatus(const HttpRequest& request) {
+    (void)request;
+    HttpResponse response;
+    response.body = R"({
             "service": "RestApiService",
             "status": "running",
             "port": )" + std::to_string(m_port) + R"(,
             "endpoints": [
                 "GET /api/services",
                 "GET /api/services/{name}",
+                "GET /api/health",
                 "GET /api/health/{name}",
                 "POST /api/services/{name}/start",
                 "POST /api/services/{name}/stop",
                 "GET /api/status"
             ]
         })";
-        return response;
-    });
+    return response;
 }
 
 HttpResponse RestApiService::handleServiceList(const HttpRequest& request) {
     HttpResponse response;
-    
-    if (!m_serviceManager) {
-        response.statusCode = 503;
-        response.statusText = "Service Unavailable";
-        response.body = R"({"error": "Service manager not available"})";
+    auto services = m_serviceManager->getAllServices();
+
+    if (acceptsRpc(request)) {
+        RpcWriter list;
+        for (const auto& servicePair : services) {
+            RpcWriter entry;
+            entry.bytes(RpcSchema::ServiceInfo::NAME, servicePair.first);
+            entry.bytes(RpcSchema::ServiceInfo::TYPE, servicePair.second->getName());
+            entry.boolean(RpcSchema::ServiceInfo::RUNNING, servicePair.second->isRunning());
+            list.message(RpcSchema::ServiceList::SERVICE, entry);
+        }
+        setRpcBody(response, list);
         return response;
     }
     
     std::ostringstream json;
     json << R"({"services": [)";
     
-    auto services = m_serviceManager->getAllServices();
     bool first = true;
     for (const auto& servicePair : services) {
         if (!first) json << ",";
@@ -420,35 +2230,23 @@ HttpResponse RestApiService::handleServiceList(const HttpRequest& request) {
     return response;
 }
 
-HttpResponse RestApiService::handleServiceInfo(const HttpRequest& request) {
+HttpResponse RestApiService::handleServiceInfo(const HttpRequest& request, ServiceRoute& route) {
     HttpResponse response;
-    
-    if (!m_serviceManager) {
-        response.statusCode = 503;
-        response.statusText = "Service Unavailable";
-        response.body = R"({"error": "Service manager not available"})";
-        return response;
-    }
-    
-    auto nameIt = request.pathParams.find("name");
-    if (nameIt == request.pathParams.end()) {
-        response.statusCode = 400;
-        response.statusText = "Bad Request";
-        response.body = R"({"error": "Service name not provided"})";
-        return response;
-    }
-    
-    auto service = m_serviceManager->getService(nameIt->second);
-    if (!service) {
-        response.statusCode = 404;
-        response.statusText = "Not Found";
-        response.body = R"({"error": "Service not found"})";
+    IService* service = route.service;
+
+    if (acceptsRpc(request)) {
+        RpcWriter info;
+        info.bytes(RpcSchema::ServiceInfo::NAME, request.pathParams.at("name"));
+        info.bytes(RpcSchema::ServiceInfo::TYPE, service->getName());
+        info.boolean(RpcSchema::ServiceInfo::RUNNING, service->isRunning());
+        info.boolean(RpcSchema::ServiceInfo::HEALTHY, service->health());
+        setRpcBody(response, info);
         return response;
     }
     
     std::ostringstream json;
     json << R"({)";
-    json << R"("name": ")" << nameIt->second << R"(",)";
+    json << R"("name": ")" << request.pathParams.at("name") << R"(",)";
     json << R"("type": ")" << service->getName() << R"(",)";
     json << R"("running": )" << (service->isRunning() ? "true" : "false") << R"(,)";
     json << R"("healthy": )" << (service->health() ? "true" : "false");
@@ -458,34 +2256,18 @@ HttpResponse RestApiService::handleServiceInfo(const HttpRequest& request) {
     return response;
 }
 
-HttpResponse RestApiService::handleServiceHealth(const HttpRequest& request) {
+HttpResponse RestApiService::handleServiceHealth(const HttpRequest& request, ServiceRoute& route) {
     HttpResponse response;
-    
-    if (!m_serviceManager) {
-        response.statusCode = 503;
-        response.statusText = "Service Unavailable";
-        response.body = R"({"error": "Service manager not available"})";
-        return response;
-    }
-    
-    auto nameIt = request.pathParams.find("name");
-    if (nameIt == request.pathParams.end()) {
-        response.statusCode = 400;
-        response.statusText = "Bad Request";
-        response.body = R"({"error": "Service name not provided"})";
-        return response;
-    }
-    
-    auto service = m_serviceManager->getService(nameIt->second);
-    if (!service) {
-        response.statusCode = 404;
-        response.statusText = "Not Found";
-        response.body = R"({"error": "Service not found"})";
-        return response;
-    }
+    IService* service = route.service;
     
     bool healthy = service->health();
-    response.body = R"({"healthy": )" + std::string(healthy ? "true" : "false") + R"(})";
+    if (acceptsRpc(request)) {
+        RpcWriter health;
+        health.boolean(RpcSchema::ServiceHealth::HEALTHY, healthy);
+        setRpcBody(response, health);
+    } else {
+        response.body = R"({"healthy": )" + std::string(healthy ? "true" : "false") + R"(})";
+    }
     
     if (!healthy) {
         response.statusCode = 503;
@@ -495,31 +2277,50 @@ HttpResponse RestApiService::handleServiceHealth(const HttpRequest& request) {
     return response;
 }
 
-HttpResponse RestApiService::handleServiceStart(const HttpRequest& request) {
+HttpResponse RestApiService::handleHealthSummary(const HttpRequest& request) {
     HttpResponse response;
-    
-    if (!m_serviceManager) {
+    std::vector<ProbeResult> results = m_healthMonitor->check(m_serviceManager->getSharedServices());
+    bool healthy = std::all_of(results.begin(), results.end(),
+                               [](const ProbeResult& result) { return result.healthy(); });
+    if (!healthy) {
         response.statusCode = 503;
         response.statusText = "Service Unavailable";
-        response.body = R"({"error": "Service manager not available"})";
-        return response;
     }
-    
-    auto nameIt = request.pathParams.find("name");
-    if (nameIt == request.pathParams.end()) {
-        response.statusCode = 400;
-        response.statusText = "Bad Request";
-        response.body = R"({"error": "Service name not provided"})";
+
+    if (acceptsRpc(request)) {
+        RpcWriter summary;
+        for (const ProbeResult& result : results) {
+            RpcWriter entry;
+            entry.bytes(RpcSchema::HealthEntry::NAME, result.name);
+            entry.boolean(RpcSchema::HealthEntry::HEALTHY, result.healthy());
+            entry.integer(RpcSchema::HealthEntry::STATE, static_cast<uint64_t>(result.state));
+            entry.integer(RpcSchema::HealthEntry::AGE_MS, static_cast<uint64_t>(result.age.count()));
+            summary.message(RpcSchema::HealthSummary::SERVICE, entry);
+        }
+        summary.boolean(RpcSchema::HealthSummary::HEALTHY, healthy);
+        setRpcBody(response, summary);
         return response;
     }
-    
-    auto service = m_serviceManager->getService(nameIt->second);
-    if (!service) {
-        response.statusCode = 404;
-        response.statusText = "Not Found";
-        response.body = R"({"error": "Service not found"})";
-        return response;
+
+    static const char* const STATES[] = {"healthy", "unhealthy", "timeout"};
+    std::ostringstream json;
+    json << R"({"services": [)";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const ProbeResult& result = results[i];
+        if (i > 0) json << ",";
+        json << R"({"name": ")" << result.name << R"(",)";
+        json << R"("healthy": )" << (result.healthy() ? "true" : "false") << R"(,)";
+        json << R"("state": ")" << STATES[static_cast<int>(result.state)] << R"(",)";
+        json << R"("ageMs": )" << result.age.count() << R"(})";
     }
+    json << R"(], "healthy": )" << (healthy ? "true" : "false") << R"(})";
+    response.body = json.str();
+    return response;
+}
+
+HttpResponse RestApiService::handleServiceStart(const HttpRequest& request, ServiceRoute& route) {
+    HttpResponse response;
+    IService* service = route.service;
     
     bool started = service->start();
     response.body = R"({"started": )" + std::string(started ? "true" : "false") + R"(})";
@@ -532,31 +2333,9 @@ HttpResponse RestApiService::handleServiceStart(const HttpRequest& request) {
     return response;
 }
 
-HttpResponse RestApiService::handleServiceStop(const HttpRequest& request) {
+HttpResponse RestApiService::handleServiceStop(const HttpRequest& request, ServiceRoute& route) {
     HttpResponse response;
-    
-    if (!m_serviceManager) {
-        response.statusCode = 503;
-        response.statusText = "Service Unavailable";
-        response.body = R"({"error": "Service manager not available"})";
-        return response;
-    }
-    
-    auto nameIt = request.pathParams.find("name");
-    if (nameIt == request.pathParams.end()) {
-        response.statusCode = 400;
-        response.statusText = "Bad Request";
-        response.body = R"({"error": "Service name not provided"})";
-        return response;
-    }
-    
-    auto service = m_serviceManager->getService(nameIt->second);
-    if (!service) {
-        response.statusCode = 404;
-        response.statusText = "Not Found";
-        response.body = R"({"error": "Service not found"})";
-        return response;
-    }
+    IService* service = route.service;
     
     service->stop();
     response.body = R"({"stopped": true})";
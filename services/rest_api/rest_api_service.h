@@ -2,23 +2,49 @@
 
 #include "framework/service_interface.h"
 #include "framework/service_manager.h"
+#include "access_log.h"
+#include "health_monitor.h"
+#include "timer_wheel.h"
+#include "http2_session.h"
+#include "rpc_session.h"
+#include "static_routes.h"
+#include "tls.h"
+#include "tracing.h"
 #include <atomic>
+#include <chrono>
 #include <thread>
 #include <string>
 #include <map>
+#include <deque>
+#include <unordered_map>
 #include <functional>
 #include <vector>
 #include <sstream>
 #include <memory>
+#include <optional>
 #include <mutex>
 #include <condition_variable>
 #include <sys/socket.h>
+#include <sys/types.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 
 namespace ServiceFramework {
 
+/**
+ * @brief Credentials of the process on the other end of a Unix socket
+ *
+ * Only populated (valid == true) for connections accepted on a Unix domain
+ * listener; TCP clients have no kernel-verified identity.
+ */
+struct PeerCredentials {
+    bool valid = false;
+    pid_t pid = 0;
+    uid_t uid = 0;
+    gid_t gid = 0;
+};
+
 /**
  * @brief HTTP Request structure
  */
@@ -29,7 +55,10 @@ struct HttpRequest {
     std::map<std::string, std::string> headers;
     std::string body;
     std::map<std::string, std::string> queryParams;
+    std::string query; // raw query string without the '?', as received
     std::map<std::string, std::string> pathParams;
+    PeerCredentials peer;
+    TraceContext trace; // server span; pass trace.traceparent() to downstream calls
 };
 
 /**
@@ -47,11 +76,25 @@ struct HttpResponse {
     }
 };
 
+/**
+ * @brief Per-listener connection deadlines, enforced by the I/O loop
+ */
+struct ConnectionTimeouts {
+    std::chrono::milliseconds headerRead{10000}; // first byte to end of headers
+    std::chrono::milliseconds bodyRead{30000};   // end of headers to end of body
+    std::chrono::milliseconds idle{60000};       // between keep-alive requests
+    std::chrono::milliseconds write{30000};      // flushing one response
+};
+
 /**
  * @brief Route handler function type
  */
 using RouteHandler = std::function<HttpResponse(const HttpRequest&)>;
 
+struct RestApiServiceInternals;
+class ReverseProxy;
+class RequestCoalescer;
+
 /**
  * @brief RESTful API Service
  * 
@@ -61,6 +104,8 @@ using RouteHandler = std::function<HttpResponse(const HttpRequest&)>;
  */
 class RestApiService : public IService {
 public:
+    static constexpr std::string_view SERVICE_TYPE = "RestApiService";
+
     RestApiService(int port = 8080);
     virtual ~RestApiService();
 
@@ -72,27 +117,291 @@ public:
     std::string getName() const override;
     bool isRunning() const override;
 
+    /**
+     * @brief Place the I/O loop (Io), request workers (Worker) and hot
+     *        upgrade thread (Background)
+     * @return false once initialized; the threads are placed as they start
+     */
+    bool setThreadPlacement(const ThreadPlacementPolicy& policy) override;
+
     // REST API specific methods
     void setServiceManager(ServiceManager* manager);
     void addRoute(const std::string& method, const std::string& path, RouteHandler handler);
+
+    /**
+     * @brief Register a compile-time route table (before initialize())
+     * @return false if the service is already initialized
+     *
+     * Table is a constexpr StaticRouteTable of
+     * HttpResponse (Owner::*)(const HttpRequest&) handlers, typically built
+     * with makeStaticRoutes(). Matching takes no lock and handlers are called
+     * directly rather than through std::function. Exact routes win over
+     * parameterized ones across both kinds; otherwise static routes are
+     * tried before addRoute() routes, and tables added here before the
+     * built-in one. An addRoute() route with the same method and pattern as
+     * a static route replaces it.
+     */
+    template <const auto& Table, typename Owner>
+    bool addStaticRoutes(Owner& owner);
+
+    /**
+     * @brief Forward every request under a path prefix to upstream servers
+     * @param prefix Path prefix such as "/workers", matched on whole segments
+     * @return false if the proxy has no valid upstream
+     *
+     * Proxy routes are tried after exact and parameterized routes; the
+     * longest matching prefix wins.
+     */
+    bool addProxyRoute(const std::string& prefix, std::shared_ptr<ReverseProxy> proxy);
+
+    /**
+     * @brief Serve requests under a path prefix on the priority lane (before initialize())
+     * @param prefix Path prefix such as "/admin", matched on whole segments
+     * @return false if already initialized or the prefix is not a path
+     *
+     * Priority requests are queued apart from the others and taken first by
+     * every worker, and PRIORITY_WORKER_THREADS threads serve nothing else,
+     * so a backlog of slow requests cannot delay them. "/api/health" and
+     * "/api/status" are on the lane by default.
+     */
+    bool addPriorityRoute(const std::string& prefix);
+
+    /**
+     * @brief Coalesce identical concurrent GETs of the built-in routes (before start())
+     *
+     * Concurrent requests with the same path and query share one run of the
+     * handler, e.g. a dashboard refresh hitting GET /api/services hundreds
+     * of times at once. Off by default; custom routes opt in with
+     * CoalesceMiddleware (request_coalescer.h).
+     */
+    void setBuiltinCoalescing(bool enabled);
+
+    // Probe timeout and cache freshness of GET /api/health (before initialize())
+    void setHealthCheckOptions(const HealthCheckOptions& options);
+
     void setPort(int port);
     int getPort() const;
 
+    // Connection deadlines for the TCP listener
+    void setConnectionTimeouts(const ConnectionTimeouts& timeouts);
+
+    /**
+     * @brief Serve HTTPS on the TCP listener (before initialize())
+     * @return false if already initialized, TLS is not compiled in, or the
+     *         certificate or key cannot be loaded
+     *
+     * Clients resume sessions from tickets or the server cache, skipping
+     * the full handshake on reconnect. ALPN offers "h2" and "http/1.1" by
+     * default; "h2" needs no Upgrade. With kernelTls, record encryption is
+     * handed to the kernel where it supports the negotiated cipher. Unix
+     * listeners stay plaintext.
+     */
+    bool enableTls(const TlsOptions& options);
+
+    // HTTPS connections whose records the kernel encrypts (TlsOptions::kernelTls)
+    uint64_t kernelTlsConnections() const;
+
+    // Additional Unix domain socket listener ("@name" for the abstract namespace)
+    bool addUnixListener(const std::string& path,
+                         const ConnectionTimeouts& timeouts = ConnectionTimeouts());
+
+    // Hot upgrade (listening socket hand-off to a successor process)
+    void setHotUpgradePath(const std::string& path);
+    void setDrainTimeout(std::chrono::milliseconds timeout);
+    // Longest wait for each step of the exchange with the other process
+    void setHandoffTimeout(std::chrono::milliseconds timeout);
+    bool isDraining() const;
+
+    // Span tracing of request phases, exported as OTLP JSON (before start())
+    void setTracing(const TracingOptions& options);
+
+    /**
+     * @brief Record an access log line per request (before initialize())
+     *
+     * Workers buffer records without locks or I/O; hand accessLog() to a
+     * consumer such as LoggingService::addLogSource() to write them out
+     * in batches.
+     */
+    void setAccessLog(const AccessLogOptions& options);
+    std::shared_ptr<AccessLog> accessLog() const { return m_accessLog; } // null unless enabled
+
 private:
+    // Exposes the request path to benchmarks (benchmarks/rest_api_bench.cpp)
+    friend struct RestApiServiceInternals;
+
+    struct UnixListener {
+        std::string path;
+        int socket = -1;
+        ConnectionTimeouts timeouts;
+    };
+
+    struct ListenerSlot {
+        int socket;
+        const ConnectionTimeouts* timeouts;
+        bool isUnix;
+        bool tls;
+    };
+
+    // A compile-time route table bound to its owner (see addStaticRoutes())
+    struct StaticRouteSet {
+        void* owner;
+        int (*find)(const HttpRequest& request, bool parameterized, std::map<std::string, std::string>& params);
+        int (*indexOf)(std::string_view method, std::string_view pattern);
+        HttpResponse (*invoke)(void* owner, int index, const HttpRequest& request);
+        std::string_view (*pattern)(int index);
+        bool (*hasOtherMethod)(const HttpRequest& request);
+        std::unique_ptr<std::atomic<bool>[]> overridden; // by index, set when addRoute() replaces the route
+    };
+
+    using BuiltinHandler = HttpResponse (RestApiService::*)(const HttpRequest&);
+    static const StaticRouteTable<BuiltinHandler, 7> BUILTIN_ROUTES;
+
+    // Per-request state the built-in middleware hands to handlers
+    struct ServiceRoute {
+        IService* service = nullptr; // resolved from the {name} path parameter
+    };
+
+    enum class ConnectionState { Idle, ReadingHeaders, ReadingBody, Processing, Writing, Http2, Rpc };
+    enum DeadlineKind { HEADER_DEADLINE, BODY_DEADLINE, IDLE_DEADLINE, WRITE_DEADLINE };
+
+    // Phase timestamps of one request, only collected while tracing
+    struct RequestTrace {
+        using TimePoint = TimerWheel::Clock::time_point;
+        TimePoint accepted;  // first request on a connection only
+        TimePoint readStart; // first byte of the request
+        TimePoint framed;    // queued for a worker
+        TimePoint dequeued;
+        TimePoint parsed;
+        TimePoint routed;
+        TimePoint handled;
+        TraceContext context;                  // this request's server span
+        std::array<uint8_t, 8> parentSpanId{}; // caller's span from traceparent
+        std::string method;
+        std::string target;
+        std::string route; // matched pattern, empty if none
+        const char* protocol = "1.1";
+        int statusCode = 0;
+    };
+
+    // Owned by the I/O loop thread
+    struct Connection {
+        int socket = -1;
+        uint64_t id = 0;
+        ConnectionState state = ConnectionState::ReadingHeaders;
+        const ConnectionTimeouts* timeouts = nullptr;
+        PeerCredentials peer;
+        std::string input;
+        size_t requestSize = 0; // header + body bytes, known once headers are complete
+        std::string output;
+        size_t outputOffset = 0;
+        bool keepAlive = false;
+        TimerWheel::Timer timer;
+        std::unique_ptr<Http2Session> http2; // set once the connection speaks h2c
+        std::unique_ptr<TlsConnection> tls;  // set on HTTPS connections
+        std::unique_ptr<RpcSession> rpc;     // set once the connection speaks binary RPC
+        TimerWheel::Clock::time_point acceptedAt;   // tracing only
+        TimerWheel::Clock::time_point requestStart; // tracing only
+        std::unique_ptr<RequestTrace> trace;        // response being written
+    };
+
+    // A complete request handed from the I/O loop to a worker. HTTP/1.x
+    // requests travel as raw bytes in data; HTTP/2 streams as decoded
+    // headers in stream, except stream 1 of an Upgrade, which is HTTP/1.1.
+    // Binary RPC requests arrive decoded in rpc, with streamId as their ID.
+    struct WorkItem {
+        int socket;
+        uint64_t connectionId;
+        std::string data;
+        PeerCredentials peer;
+        uint32_t streamId = 0; // HTTP/2 stream, 0 for HTTP/1.x
+        Http2Session::StreamRequest stream;
+        RpcSession::Request rpc;
+        std::unique_ptr<RequestTrace> trace;
+        TimerWheel::Clock::time_point queuedAt; // access log only
+    };
+
+    // A response handed back from a worker to the I/O loop: serialized for
+    // HTTP/1.x, structured for HTTP/2 (the I/O loop owns the HPACK state)
+    struct Completion {
+        int socket;
+        uint64_t connectionId;
+        std::string data;
+        bool keepAlive;
+        uint32_t streamId = 0;
+        HttpResponse response;
+        std::unique_ptr<RequestTrace> trace;
+    };
+
     // HTTP server methods
+    bool createListener();
+    bool createUnixListener(UnixListener& listener);
+    void adoptInheritedListeners(const std::vector<int>& fds);
+    std::vector<int> listeningSockets() const;
+    bool setupEventLoop();
+    void releaseSockets();
+    void handoffLoop();
+    void stopAccepting();
+    void drainConnections(std::chrono::steady_clock::time_point deadline);
+    void wakeLoop();
+
+    // I/O loop
     void serverLoop();
-    void handleClient(int clientSocket);
+    void acceptConnections(const ListenerSlot& listener);
+    void onReadable(Connection& connection);
+    void continueHandshake(Connection& connection);
+    ssize_t receive(Connection& connection, char* buffer, size_t length);
+    ssize_t transmit(Connection& connection, const char* data, size_t length);
+    void frameRequest(Connection& connection);
+    void dispatchRequest(Connection& connection);
+    void onCompletions();
+    void writeOutput(Connection& connection);
+    void finishResponse(Connection& connection);
+    void rejectRequest(Connection& connection, int statusCode, const std::string& statusText);
+    void onDeadline(TimerWheel::Timer* timer);
+    void setInterest(Connection& connection, uint32_t events);
+    void closeConnection(Connection& connection);
+    void stopListening();
+
+    // HTTP/2 (h2c)
+    bool startHttp2(Connection& connection, const std::string* upgradeSettings = nullptr);
+    void upgradeToHttp2(Connection& connection);
+    void onHttp2Input(Connection& connection);
+    void flushHttp2(Connection& connection);
+    void finishHttp2Write(Connection& connection);
+    HttpRequest buildHttp2Request(Http2Session::StreamRequest& stream);
+
+    // Binary RPC
+    void startRpc(Connection& connection);
+    void onRpcInput(Connection& connection);
+    void flushRpc(Connection& connection);
+    void finishRpcWrite(Connection& connection);
+    HttpRequest buildRpcRequest(RpcSession::Request& rpc);
+
+    // Tracing
+    std::unique_ptr<RequestTrace> beginTrace(Connection& connection);
+    void startRequestSpan(HttpRequest& request, std::unique_ptr<RequestTrace>& trace);
+    void finishTrace(std::unique_ptr<RequestTrace> trace, TimerWheel::Clock::time_point sentAt);
+
+    // Worker side (worker indexes the access log buffers)
+    void processRequest(WorkItem& item, size_t worker);
+    void logAccess(size_t worker, const WorkItem& item, TimerWheel::Clock::time_point dequeued,
+                   const HttpRequest* request, const HttpResponse& response);
     HttpRequest parseRequest(const std::string& requestData);
-    std::string buildResponse(const HttpResponse& response);
-    HttpResponse routeRequest(const HttpRequest& request);
+    std::string buildResponse(const HttpResponse& response, bool keepAlive = false);
+    HttpResponse routeRequest(const HttpRequest& request, RequestTrace* trace = nullptr);
+    bool dispatchStaticRoutes(const HttpRequest& request, bool parameterized,
+                              std::optional<HttpResponse>& response, RequestTrace* trace);
     
     // Built-in route handlers
+    template <auto Handler, typename... Middleware>
+    HttpResponse builtinRoute(const HttpRequest& request);
     HttpResponse handleServiceList(const HttpRequest& request);
     HttpResponse handleServiceStatus(const HttpRequest& request);
-    HttpResponse handleServiceHealth(const HttpRequest& request);
-    HttpResponse handleServiceStart(const HttpRequest& request);
-    HttpResponse handleServiceStop(const HttpRequest& request);
-    HttpResponse handleServiceInfo(const HttpRequest& request);
+    HttpResponse handleServiceHealth(const HttpRequest& request, ServiceRoute& route);
+    HttpResponse handleHealthSummary(const HttpRequest& request);
+    HttpResponse handleServiceStart(const HttpRequest& request, ServiceRoute& route);
+    HttpResponse handleServiceStop(const HttpRequest& request, ServiceRoute& route);
+    HttpResponse handleServiceInfo(const HttpRequest& request, ServiceRoute& route);
     HttpResponse handleNotFound(const HttpRequest& request);
     HttpResponse handleMethodNotAllowed(const HttpRequest& request);
     
@@ -109,21 +418,106 @@ private:
     int m_serverSocket;
     std::thread m_serverThread;
     ServiceManager* m_serviceManager;
+    std::vector<UnixListener> m_unixListeners;
+    ConnectionTimeouts m_tcpTimeouts;
+    std::unique_ptr<TlsContext> m_tls; // set when the TCP listener serves HTTPS
+    std::atomic<uint64_t> m_kernelTlsConnections{0};
+    int m_wakePipe[2];
+    std::atomic<bool> m_accepting{false};
+    bool m_handedOff = false;
+
+    // I/O loop state
+    int m_epollFd;
+    int m_loopEvent; // eventfd signalled by workers and stop()
+    std::atomic<bool> m_loopExit{false};
+    std::vector<ListenerSlot> m_listenerSlots;
+    bool m_listening = false;
+    std::unordered_map<int, std::unique_ptr<Connection>> m_connections;
+    uint64_t m_nextConnectionId = 0;
+    TimerWheel m_timers;
+    std::mutex m_completionMutex;
+    std::vector<Completion> m_completions;
+    static const size_t MAX_HEADER_BYTES = 64 * 1024;
+    static const size_t MAX_BODY_BYTES = 8 * 1024 * 1024;
+    static const uint32_t MAX_HTTP2_STREAMS = 100; // concurrent streams per connection
+    static const uint32_t MAX_RPC_REQUESTS = 100;  // outstanding RPC requests per connection
+
+    // Hot upgrade state
+    std::string m_hotUpgradePath;
+    int m_handoffSocket;   // control socket successors connect to
+    int m_inheritedControl; // connection to the predecessor we inherited from
+    std::thread m_handoffThread;
+    std::chrono::milliseconds m_drainTimeout{10000};
+    std::chrono::milliseconds m_handoffTimeout{5000};
+
+    // Tracing (m_tracer exists while running with an endpoint configured)
+    TracingOptions m_tracingOptions;
+    std::unique_ptr<Tracer> m_tracer;
+    std::shared_ptr<AccessLog> m_accessLog; // set while access logging is enabled
     
     // Route management
     std::map<std::string, std::map<std::string, RouteHandler>> m_routes; // method -> path -> handler
     std::mutex m_routesMutex;
+    std::vector<std::pair<std::string, std::shared_ptr<ReverseProxy>>> m_proxyRoutes; // under m_routesMutex
+    std::vector<StaticRouteSet> m_staticRoutes; // fixed once initialized, read without the lock
+    std::unique_ptr<RequestCoalescer> m_builtinCoalescer; // set while built-in routes coalesce
+    HealthCheckOptions m_healthOptions;
+    std::unique_ptr<HealthMonitor> m_healthMonitor; // exists while initialized
     
     // Thread pool for handling requests
     std::vector<std::thread> m_workerThreads;
     std::mutex m_queueMutex;
     std::condition_variable m_queueCondition;
-    std::vector<int> m_clientQueue;
+    std::deque<WorkItem> m_workQueue;
+    std::deque<WorkItem> m_priorityQueue; // health and admin requests, served first
+    std::condition_variable m_priorityCondition; // wakes only the priority lane
+    std::vector<std::string> m_priorityPrefixes; // fixed once initialized
+    std::condition_variable m_drainCondition;
+    size_t m_openConnections = 0; // guarded by m_queueMutex
     std::atomic<bool> m_stopWorkers{false};
     static const size_t MAX_WORKER_THREADS = 10;
+    static const size_t PRIORITY_WORKER_THREADS = 2;
+    ThreadPlacementPolicy m_threadPlacement;
     
-    void workerLoop();
+    bool isPriorityTarget(const char* target, size_t length) const;
+    bool queueWork(WorkItem& item); // m_queueMutex held; true if queued on the priority lane
+    void notifyWorkers(size_t regular, size_t priority);
+    void workerLoop(bool priorityLane, size_t worker);
     void setupDefaultRoutes();
+    bool insertStaticRoutes(StaticRouteSet routes, bool builtin);
+    template <const auto& Table, typename Owner>
+    static StaticRouteSet makeStaticRouteSet(Owner& owner);
 };
 
+template <const auto& Table, typename Owner>
+bool RestApiService::addStaticRoutes(Owner& owner) {
+    return insertStaticRoutes(makeStaticRouteSet<Table>(owner), false);
+}
+
+template <const auto& Table, typename Owner>
+RestApiService::StaticRouteSet RestApiService::makeStaticRouteSet(Owner& owner) {
+    StaticRouteSet routes;
+    routes.owner = &owner;
+    routes.find = [](const HttpRequest& request, bool parameterized, std::map<std::string, std::string>& params) {
+        return Table.find(request.method, request.path, parameterized, params);
+    };
+    routes.indexOf = [](std::string_view method, std::string_view pattern) {
+        for (size_t i = 0; i < Table.size(); ++i) {
+            if (Table.route(i).method == method && Table.route(i).pattern == pattern) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    };
+    routes.invoke = [](void* target, int index, const HttpRequest& request) -> HttpResponse {
+        return StaticRoutes::invoke<Table>(*static_cast<Owner*>(target), static_cast<size_t>(index), request);
+    };
+    routes.pattern = [](int index) { return Table.route(static_cast<size_t>(index)).pattern; };
+    routes.hasOtherMethod = [](const HttpRequest& request) {
+        return Table.hasOtherMethod(request.method, request.path);
+    };
+    routes.overridden.reset(new std::atomic<bool>[Table.size()]());
+    return routes;
+}
+
 } // namespace ServiceFramework
@@ -0,0 +1,74 @@
+#include "reverse_proxy.h"
+#include <algorithm>
+#include <strings.h>
+
+namespace ServiceFramework {
+
+ReverseProxy::ReverseProxy(const ProxyOptions& options)
+    : m_options(options), m_pool(options.upstreams, options.maxIdlePerUpstream) {
+}
+
+std::string ReverseProxy::buildRequestHead(const HttpRequest& request) const {
+    std::string target = request.path;
+    if (!m_options.stripPrefix.empty() && target.compare(0, m_options.stripPrefix.size(), m_options.stripPrefix) == 0) {
+        target.erase(0, m_options.stripPrefix.size());
+        if (target.empty() || target[0] != '/') {
+            target.insert(0, "/");
+        }
+    }
+    if (!request.query.empty()) {
+        target += "?" + request.query;
+    }
+
+    std::string head;
+    head.reserve(256);
+    head += request.method + " " + target + " HTTP/1.1\r\n";
+    bool hasHost = false;
+    for (const auto& header : request.headers) {
+        if (Http1::isHopByHopHeader(header.first) || strcasecmp(header.first.c_str(), "traceparent") == 0) {
+            continue;
+        }
+        hasHost = hasHost || strcasecmp(header.first.c_str(), "host") == 0;
+        head += header.first + ": " + header.second + "\r\n";
+    }
+    if (!hasHost) {
+        head += "Host: localhost\r\n";
+    }
+    if (request.trace.valid()) {
+        head += "traceparent: " + request.trace.traceparent() + "\r\n";
+    }
+    if (!request.body.empty() || request.method == "POST" || request.method == "PUT" || request.method == "PATCH") {
+        head += "Content-Length: " + std::to_string(request.body.size()) + "\r\n";
+    }
+    head += "\r\n";
+    return head;
+}
+
+HttpResponse ReverseProxy::errorResponse(int statusCode, const std::string& statusText) {
+    HttpResponse response;
+    response.statusCode = statusCode;
+    response.statusText = statusText;
+    response.body = R"({"error": ")" + statusText + R"("})";
+    return response;
+}
+
+HttpResponse ReverseProxy::forward(const HttpRequest& request) {
+    std::string head = buildRequestHead(request);
+    auto deadline = UpstreamPool::Clock::now() + m_options.responseTimeout;
+    auto connectDeadline = std::min(deadline, UpstreamPool::Clock::now() + m_options.connectTimeout);
+    bool headRequest = request.method == "HEAD";
+
+    HttpResponse response;
+    Http1::Status status = Http1::exchange(m_pool, head, request.body, connectDeadline, deadline, headRequest,
+                                           Http1::isIdempotent(request.method), m_options.maxResponseBytes,
+                                           response);
+    if (status == Http1::Status::Ok) {
+        return response;
+    }
+    if (status == Http1::Status::Timeout) {
+        return errorResponse(504, "Gateway Timeout");
+    }
+    return errorResponse(502, "Bad Gateway");
+}
+
+} // namespace ServiceFramework
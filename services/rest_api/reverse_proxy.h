@@ -0,0 +1,50 @@
+#pragma once
+
+#include "rest_api_service.h"
+#include "upstream_pool.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace ServiceFramework {
+
+/**
+ * @brief Where and how a proxy route forwards requests
+ */
+struct ProxyOptions {
+    // "host:port", "unix:/path/to.sock" or "@abstract"
+    std::vector<std::string> upstreams;
+    std::string stripPrefix;                  // removed from the path before forwarding
+    size_t maxIdlePerUpstream = 32;           // keep-alive connections kept per upstream
+    std::chrono::milliseconds connectTimeout{1000};
+    std::chrono::milliseconds responseTimeout{30000}; // whole exchange, connect included
+    size_t maxResponseBytes = 64 * 1024 * 1024;
+};
+
+/**
+ * @brief Forwards requests to a pool of upstream HTTP/1.1 servers
+ *
+ * Each request goes to the upstream with the fewest requests in flight over
+ * a pooled keep-alive connection. Hop-by-hop headers are dropped in both
+ * directions and the server span's traceparent is passed on. Connection
+ * failures answer 502 and timeouts 504.
+ */
+class ReverseProxy {
+public:
+    explicit ReverseProxy(const ProxyOptions& options);
+
+    bool valid() const { return m_pool.valid(); }
+
+    HttpResponse forward(const HttpRequest& request);
+
+    const UpstreamPool& pool() const { return m_pool; }
+
+private:
+    std::string buildRequestHead(const HttpRequest& request) const;
+    static HttpResponse errorResponse(int statusCode, const std::string& statusText);
+
+    ProxyOptions m_options;
+    UpstreamPool m_pool;
+};
+
+} // namespace ServiceFramework
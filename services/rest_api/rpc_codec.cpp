@@ -0,0 +1,81 @@
+#include "rpc_codec.h"
+
+namespace ServiceFramework {
+
+const char RPC_CONTENT_TYPE[] = "application/x-sf-rpc";
+
+namespace {
+
+const uint32_t WIRE_VARINT = 0;
+const uint32_t WIRE_BYTES = 2;
+
+} // namespace
+
+void RpcWriter::integer(uint32_t field, uint64_t value) {
+    varint((static_cast<uint64_t>(field) << 3) | WIRE_VARINT);
+    varint(value);
+}
+
+void RpcWriter::bytes(uint32_t field, std::string_view value) {
+    varint((static_cast<uint64_t>(field) << 3) | WIRE_BYTES);
+    varint(value.size());
+    m_data.append(value.data(), value.size());
+}
+
+void RpcWriter::varint(uint64_t value) {
+    while (value >= 0x80) {
+        m_data.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    m_data.push_back(static_cast<char>(value));
+}
+
+bool RpcReader::next() {
+    if (m_failed || m_offset >= m_data.size()) {
+        return false;
+    }
+
+    uint64_t key;
+    if (!readVarint(key) || (key >> 3) == 0 || (key >> 3) > UINT32_MAX) {
+        m_failed = true;
+        return false;
+    }
+    m_field = static_cast<uint32_t>(key >> 3);
+    m_wireType = static_cast<uint32_t>(key & 0x7);
+
+    if (m_wireType == WIRE_VARINT) {
+        m_bytes = std::string_view();
+        if (!readVarint(m_value)) {
+            m_failed = true;
+            return false;
+        }
+        return true;
+    }
+
+    uint64_t length;
+    if (m_wireType != WIRE_BYTES || !readVarint(length) || length > m_data.size() - m_offset) {
+        m_failed = true;
+        return false;
+    }
+    m_value = 0;
+    m_bytes = m_data.substr(m_offset, static_cast<size_t>(length));
+    m_offset += static_cast<size_t>(length);
+    return true;
+}
+
+bool RpcReader::readVarint(uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (m_offset >= m_data.size()) {
+            return false;
+        }
+        uint8_t byte = static_cast<uint8_t>(m_data[m_offset++]);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false; // longer than ten bytes
+}
+
+} // namespace ServiceFramework
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace ServiceFramework {
+
+// Content type of schema-encoded bodies; ask for it with Accept
+extern const char RPC_CONTENT_TYPE[];
+
+/**
+ * @brief Builds one message in the binary RPC encoding
+ *
+ * A message is a sequence of fields, each a varint key (field number << 3
+ * | wire type) followed by either a varint (wire type 0: integers and
+ * booleans) or a varint length and that many bytes (wire type 2: strings,
+ * bytes and nested messages). This is the protobuf wire format, so the
+ * schemas in RpcSchema can be written as .proto files for other clients.
+ */
+class RpcWriter {
+public:
+    void integer(uint32_t field, uint64_t value);
+    void boolean(uint32_t field, bool value) { integer(field, value ? 1 : 0); }
+    void bytes(uint32_t field, std::string_view value);
+    void message(uint32_t field, const RpcWriter& nested) { bytes(field, nested.m_data); }
+
+    const std::string& data() const { return m_data; }
+    std::string take() { return std::move(m_data); }
+
+private:
+    void varint(uint64_t value);
+
+    std::string m_data;
+};
+
+/**
+ * @brief Walks the fields of one message without copying
+ *
+ * Unknown fields are skipped by simply not asking for them, so readers
+ * keep working when a schema gains fields. The viewed data must outlive
+ * the reader.
+ */
+class RpcReader {
+public:
+    explicit RpcReader(std::string_view data) : m_data(data) {}
+
+    /**
+     * @brief Move to the next field
+     * @return false at the end of the message or on malformed input (see ok())
+     */
+    bool next();
+
+    uint32_t field() const { return m_field; }
+    uint64_t integer() const { return m_value; }       // wire type 0
+    std::string_view bytes() const { return m_bytes; } // wire type 2, nested messages too
+    bool isBytes() const { return m_wireType == 2; }
+
+    bool ok() const { return !m_failed; }
+
+private:
+    bool readVarint(uint64_t& value);
+
+    std::string_view m_data;
+    size_t m_offset = 0;
+    uint32_t m_field = 0;
+    uint32_t m_wireType = 0;
+    uint64_t m_value = 0;
+    std::string_view m_bytes;
+    bool m_failed = false;
+};
+
+/**
+ * @brief Field numbers of the RPC messages
+ *
+ * Transport (see RpcSession):
+ *   message Header   { string name = 1; string value = 2; }
+ *   message Request  { string method = 1; string path = 2; repeated Header header = 3; bytes body = 4; }
+ *   message Response { uint32 status = 1; repeated Header header = 2; bytes body = 3; }
+ *
+ * Bodies of the built-in endpoints (Accept: application/x-sf-rpc):
+ *   message ServiceInfo   { string name = 1; string type = 2; bool running = 3; bool healthy = 4; }
+ *   message ServiceList   { repeated ServiceInfo service = 1; }      // healthy not set
+ *   message ServiceHealth { bool healthy = 1; }
+ *   message HealthEntry   { string name = 1; bool healthy = 2; uint32 state = 3; uint64 age_ms = 4; }
+ *   message HealthSummary { repeated HealthEntry service = 1; bool healthy = 2; }
+ *
+ * HealthEntry.state is ProbeResult::State (0 healthy, 1 unhealthy, 2 timeout).
+ */
+namespace RpcSchema {
+
+struct Header {
+    static constexpr uint32_t NAME = 1;
+    static constexpr uint32_t VALUE = 2;
+};
+
+struct Request {
+    static constexpr uint32_t METHOD = 1;
+    static constexpr uint32_t PATH = 2;
+    static constexpr uint32_t HEADER = 3;
+    static constexpr uint32_t BODY = 4;
+};
+
+struct Response {
+    static constexpr uint32_t STATUS = 1;
+    static constexpr uint32_t HEADER = 2;
+    static constexpr uint32_t BODY = 3;
+};
+
+struct ServiceInfo {
+    static constexpr uint32_t NAME = 1;
+    static constexpr uint32_t TYPE = 2;
+    static constexpr uint32_t RUNNING = 3;
+    static constexpr uint32_t HEALTHY = 4;
+};
+
+struct ServiceList {
+    static constexpr uint32_t SERVICE = 1;
+};
+
+struct ServiceHealth {
+    static constexpr uint32_t HEALTHY = 1;
+};
+
+struct HealthEntry {
+    static constexpr uint32_t NAME = 1;
+    static constexpr uint32_t HEALTHY = 2;
+    static constexpr uint32_t STATE = 3;
+    static constexpr uint32_t AGE_MS = 4;
+};
+
+struct HealthSummary {
+    static constexpr uint32_t SERVICE = 1;
+    static constexpr uint32_t HEALTHY = 2;
+};
+
+} // namespace RpcSchema
+
+} // namespace ServiceFramework
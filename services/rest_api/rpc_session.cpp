@@ -0,0 +1,241 @@
+#include "rpc_session.h"
+#include "rpc_codec.h"
+
+namespace ServiceFramework {
+
+const char RpcSession::PREFACE[] = "SFRPC/1\n";
+const size_t RpcSession::PREFACE_LENGTH;
+const uint8_t RpcSession::FRAME_REQUEST;
+const uint8_t RpcSession::FRAME_RESPONSE;
+const uint8_t RpcSession::FRAME_GOAWAY;
+const size_t RpcSession::FRAME_HEADER_LENGTH;
+
+namespace {
+
+const char REFUSED_BODY[] = R"({"error": "Service Unavailable"})";
+
+uint32_t readUint32(const uint8_t* data) {
+    return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) |
+           (static_cast<uint32_t>(data[2]) << 8) | static_cast<uint32_t>(data[3]);
+}
+
+void writeUint32(std::string& output, uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        output.push_back(static_cast<char>(value >> shift));
+    }
+}
+
+void writeHeaders(RpcWriter& message, uint32_t field, const HeaderList& headers) {
+    for (const auto& header : headers) {
+        RpcWriter entry;
+        entry.bytes(RpcSchema::Header::NAME, header.name);
+        entry.bytes(RpcSchema::Header::VALUE, header.value);
+        message.message(field, entry);
+    }
+}
+
+bool readHeader(std::string_view data, HeaderList& headers) {
+    HeaderField header;
+    RpcReader reader(data);
+    while (reader.next()) {
+        if (reader.field() == RpcSchema::Header::NAME) {
+            header.name = reader.bytes();
+        } else if (reader.field() == RpcSchema::Header::VALUE) {
+            header.value = reader.bytes();
+        }
+    }
+    if (!reader.ok() || header.name.empty()) {
+        return false;
+    }
+    headers.push_back(std::move(header));
+    return true;
+}
+
+} // namespace
+
+RpcSession::RpcSession(const Limits& limits) : m_limits(limits) {}
+
+bool RpcSession::receive(std::string& input) {
+    if (m_failed) {
+        input.clear();
+        return false;
+    }
+
+    size_t offset = 0;
+    if (!m_prefaceReceived) {
+        if (input.size() < PREFACE_LENGTH) {
+            return true;
+        }
+        if (input.compare(0, PREFACE_LENGTH, PREFACE, PREFACE_LENGTH) != 0) {
+            input.clear();
+            return protocolError();
+        }
+        m_prefaceReceived = true;
+        offset = PREFACE_LENGTH;
+    }
+
+    bool ok = true;
+    while (ok && input.size() - offset >= FRAME_HEADER_LENGTH) {
+        const uint8_t* header = reinterpret_cast<const uint8_t*>(input.data() + offset);
+        uint32_t length = readUint32(header);
+        uint8_t type = header[4];
+        uint32_t id = readUint32(header + 5);
+        if (length > m_limits.maxFrameSize) {
+            ok = protocolError();
+            break;
+        }
+        if (input.size() - offset - FRAME_HEADER_LENGTH < length) {
+            break; // wait for the rest of the frame
+        }
+
+        const char* payload = input.data() + offset + FRAME_HEADER_LENGTH;
+        offset += FRAME_HEADER_LENGTH + length;
+        if (type == FRAME_REQUEST) {
+            ok = onRequest(id, payload, length);
+        } else if (type != FRAME_GOAWAY) {
+            // A client GOAWAY only announces it is done sending
+            ok = protocolError();
+        }
+    }
+
+    if (ok) {
+        input.erase(0, offset);
+    } else {
+        input.clear();
+    }
+    return ok;
+}
+
+void RpcSession::takeRequests(std::vector<Request>& requests) {
+    for (auto& request : m_ready) {
+        requests.push_back(std::move(request));
+    }
+    m_ready.clear();
+}
+
+void RpcSession::submitResponse(uint32_t id, int status, const HeaderList& headers, const std::string& body) {
+    if (m_active.erase(id) == 0) {
+        return; // not ours, or the connection failed meanwhile
+    }
+
+    RpcWriter message;
+    message.integer(RpcSchema::Response::STATUS, static_cast<uint64_t>(status));
+    writeHeaders(message, RpcSchema::Response::HEADER, headers);
+    if (!body.empty()) {
+        message.bytes(RpcSchema::Response::BODY, body);
+    }
+    appendFrame(m_output, FRAME_RESPONSE, id, message.data());
+}
+
+void RpcSession::goAway() {
+    if (!m_goAwaySent) {
+        appendFrame(m_output, FRAME_GOAWAY, 0, std::string());
+        m_goAwaySent = true;
+    }
+}
+
+bool RpcSession::isFinished() const {
+    return m_failed || (m_goAwaySent && m_active.empty());
+}
+
+bool RpcSession::onRequest(uint32_t id, const char* payload, size_t length) {
+    if (id == 0 || m_active.count(id) != 0) {
+        return protocolError();
+    }
+
+    Request request;
+    request.id = id;
+    RpcReader reader(std::string_view(payload, length));
+    while (reader.next()) {
+        switch (reader.field()) {
+        case RpcSchema::Request::METHOD:
+            request.method = reader.bytes();
+            break;
+        case RpcSchema::Request::PATH:
+            request.path = reader.bytes();
+            break;
+        case RpcSchema::Request::HEADER:
+            if (!readHeader(reader.bytes(), request.headers)) {
+                return protocolError();
+            }
+            break;
+        case RpcSchema::Request::BODY:
+            request.body = reader.bytes();
+            break;
+        default:
+            break;
+        }
+    }
+    if (!reader.ok() || request.method.empty() || request.path.empty() || request.path[0] != '/') {
+        return protocolError();
+    }
+
+    // Refused requests are answered at once so the client can retry elsewhere
+    m_active.insert(id);
+    if (m_goAwaySent || m_active.size() > m_limits.maxConcurrentRequests) {
+        submitResponse(id, 503, {{"Content-Type", "application/json"}}, REFUSED_BODY);
+        return true;
+    }
+    m_ready.push_back(std::move(request));
+    return true;
+}
+
+bool RpcSession::protocolError() {
+    goAway();
+    m_failed = true;
+    return false;
+}
+
+void RpcSession::appendFrame(std::string& output, uint8_t type, uint32_t id, const std::string& payload) {
+    writeUint32(output, static_cast<uint32_t>(payload.size()));
+    output.push_back(static_cast<char>(type));
+    writeUint32(output, id);
+    output.append(payload);
+}
+
+void RpcSession::appendRequest(std::string& output, const Request& request) {
+    RpcWriter message;
+    message.bytes(RpcSchema::Request::METHOD, request.method);
+    message.bytes(RpcSchema::Request::PATH, request.path);
+    writeHeaders(message, RpcSchema::Request::HEADER, request.headers);
+    if (!request.body.empty()) {
+        message.bytes(RpcSchema::Request::BODY, request.body);
+    }
+    appendFrame(output, FRAME_REQUEST, request.id, message.data());
+}
+
+bool RpcSession::takeResponse(std::string& input, Response& response) {
+    while (input.size() >= FRAME_HEADER_LENGTH) {
+        const uint8_t* header = reinterpret_cast<const uint8_t*>(input.data());
+        uint32_t length = readUint32(header);
+        if (input.size() - FRAME_HEADER_LENGTH < length) {
+            return false;
+        }
+        uint8_t type = header[4];
+        uint32_t id = readUint32(header + 5);
+        std::string payload = input.substr(FRAME_HEADER_LENGTH, length);
+        input.erase(0, FRAME_HEADER_LENGTH + length);
+        if (type != FRAME_RESPONSE) {
+            continue;
+        }
+
+        response = Response();
+        response.id = id;
+        RpcReader reader(payload);
+        while (reader.next()) {
+            if (reader.field() == RpcSchema::Response::STATUS) {
+                response.status = static_cast<int>(reader.integer());
+            } else if (reader.field() == RpcSchema::Response::HEADER) {
+                if (!readHeader(reader.bytes(), response.headers)) {
+                    return false;
+                }
+            } else if (reader.field() == RpcSchema::Response::BODY) {
+                response.body = reader.bytes();
+            }
+        }
+        return reader.ok();
+    }
+    return false;
+}
+
+} // namespace ServiceFramework
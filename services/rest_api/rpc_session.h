@@ -0,0 +1,114 @@
+#pragma once
+
+#include "hpack.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace ServiceFramework {
+
+/**
+ * @brief Server side of one binary RPC connection, without sockets
+ *
+ * A client opens with PREFACE and then sends frames, each a 9-byte header
+ * (32-bit payload length, 8-bit type, 32-bit request ID, all big-endian)
+ * followed by the payload. REQUEST and RESPONSE frames carry
+ * one RpcSchema::Request or RpcSchema::Response message; a GOAWAY frame
+ * (ID 0, empty payload) tells the client no new requests will be taken.
+ * Request IDs are chosen by the client, must be non-zero and unique among
+ * its outstanding requests, and responses come back in completion order.
+ *
+ * Used like Http2Session: feed receive(), collect takeRequests(), answer
+ * with submitResponse() and write output(). Not thread-safe: owned by the
+ * I/O loop. The static request/response helpers are for clients.
+ */
+class RpcSession {
+public:
+    struct Limits {
+        uint32_t maxConcurrentRequests = 100;
+        size_t maxFrameSize = 8 * 1024 * 1024 + 64 * 1024; // largest body plus headers
+    };
+
+    struct Request {
+        uint32_t id = 0;
+        std::string method;
+        std::string path; // with the query string, if any
+        HeaderList headers;
+        std::string body;
+    };
+
+    struct Response {
+        uint32_t id = 0;
+        int status = 0;
+        HeaderList headers;
+        std::string body;
+    };
+
+    // Sent by the client first, in place of an HTTP request line
+    static const char PREFACE[];
+    static const size_t PREFACE_LENGTH = 8;
+
+    static const uint8_t FRAME_REQUEST = 0x1;
+    static const uint8_t FRAME_RESPONSE = 0x2;
+    static const uint8_t FRAME_GOAWAY = 0x3;
+    static const size_t FRAME_HEADER_LENGTH = 9;
+
+    explicit RpcSession(const Limits& limits);
+
+    /**
+     * @brief Consume the preface and complete frames from the front of input
+     * @return false on a protocol error; a GOAWAY is queued and the
+     *         connection should be closed once output is flushed
+     */
+    bool receive(std::string& input);
+
+    /**
+     * @brief Move out requests completed since the last call
+     */
+    void takeRequests(std::vector<Request>& requests);
+
+    /**
+     * @brief Answer a request taken with takeRequests()
+     */
+    void submitResponse(uint32_t id, int status, const HeaderList& headers, const std::string& body);
+
+    /**
+     * @brief Stop taking new requests (graceful shutdown); later ones get 503
+     */
+    void goAway();
+
+    std::string& output() { return m_output; }
+
+    /**
+     * @brief Requests handed out and not yet answered
+     */
+    size_t activeRequests() const { return m_active.size(); }
+
+    /**
+     * @brief True once the connection should be closed after flushing output
+     */
+    bool isFinished() const;
+
+    // Client side: append a request frame, or take one response frame from
+    // the front of input (GOAWAY frames are skipped). takeResponse() returns
+    // false until a whole response has arrived or if input is malformed.
+    static void appendRequest(std::string& output, const Request& request);
+    static bool takeResponse(std::string& input, Response& response);
+
+private:
+    bool onRequest(uint32_t id, const char* payload, size_t length);
+    bool protocolError();
+    static void appendFrame(std::string& output, uint8_t type, uint32_t id, const std::string& payload);
+
+    Limits m_limits;
+    bool m_prefaceReceived = false;
+    bool m_goAwaySent = false;
+    bool m_failed = false;
+    std::unordered_set<uint32_t> m_active;
+    std::vector<Request> m_ready;
+    std::string m_output;
+};
+
+} // namespace ServiceFramework
@@ -0,0 +1,178 @@
+#include "socket_handoff.h"
+#include <iostream>
+#include <cstring>
+#include <cstdint>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace ServiceFramework {
+
+namespace {
+
+const char HANDOFF_REQUEST = 'U';
+const char HANDOFF_ACK = 'A';
+
+bool fillUnixAddress(const std::string& path, struct sockaddr_un& address) {
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size());
+    return true;
+}
+
+bool waitReadable(int fd, std::chrono::milliseconds timeout) {
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    return poll(&pfd, 1, static_cast<int>(timeout.count())) > 0;
+}
+
+} // namespace
+
+int SocketHandoff::listenControlSocket(const std::string& path) {
+    struct sockaddr_un address;
+    if (!fillUnixAddress(path, address)) {
+        std::cerr << "SocketHandoff: Invalid control socket path '" << path << "'" << std::endl;
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        std::cerr << "SocketHandoff: Failed to create control socket" << std::endl;
+        return -1;
+    }
+
+    // A previous owner has already handed its listeners over (or died), so
+    // the path is ours to replace.
+    unlink(path.c_str());
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(fd, 1) < 0) {
+        std::cerr << "SocketHandoff: Failed to listen on '" << path << "'" << std::endl;
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+int SocketHandoff::requestListeners(const std::string& path, std::vector<int>& fds,
+                                    std::chrono::milliseconds timeout) {
+    struct sockaddr_un address;
+    if (!fillUnixAddress(path, address)) {
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    // No predecessor listening is the normal cold-start case
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    if (send(fd, &HANDOFF_REQUEST, 1, MSG_NOSIGNAL) != 1 || !waitReadable(fd, timeout)) {
+        std::cerr << "SocketHandoff: Predecessor did not answer hand-off request" << std::endl;
+        close(fd);
+        return -1;
+    }
+
+    uint32_t count = 0;
+    struct iovec iov;
+    iov.iov_base = &count;
+    iov.iov_len = sizeof(count);
+
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int) * MAX_HANDOFF_FDS)];
+    struct msghdr message;
+    std::memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    if (recvmsg(fd, &message, MSG_CMSG_CLOEXEC | MSG_DONTWAIT) != sizeof(count)) {
+        std::cerr << "SocketHandoff: Failed to receive listening sockets" << std::endl;
+        close(fd);
+        return -1;
+    }
+
+    fds.clear();
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message); cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(&message, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            size_t received = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            const int* data = reinterpret_cast<const int*>(CMSG_DATA(cmsg));
+            fds.assign(data, data + received);
+        }
+    }
+
+    if (fds.size() != count || (message.msg_flags & MSG_CTRUNC)) {
+        std::cerr << "SocketHandoff: Expected " << count << " sockets, received "
+                  << fds.size() << std::endl;
+        for (int received : fds) {
+            close(received);
+        }
+        fds.clear();
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+bool SocketHandoff::sendListeners(int controlSocket, const std::vector<int>& fds,
+                                  std::chrono::milliseconds timeout) {
+    if (fds.empty() || fds.size() > MAX_HANDOFF_FDS) {
+        return false;
+    }
+
+    // A peer that connects and stays silent must not stall the hand-off
+    char request = 0;
+    if (!waitReadable(controlSocket, timeout) ||
+        recv(controlSocket, &request, 1, MSG_DONTWAIT) != 1 || request != HANDOFF_REQUEST) {
+        std::cerr << "SocketHandoff: No hand-off request from successor" << std::endl;
+        return false;
+    }
+
+    uint32_t count = static_cast<uint32_t>(fds.size());
+    struct iovec iov;
+    iov.iov_base = &count;
+    iov.iov_len = sizeof(count);
+
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int) * MAX_HANDOFF_FDS)];
+    std::memset(control, 0, sizeof(control));
+    struct msghdr message;
+    std::memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+    std::memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+
+    return sendmsg(controlSocket, &message, MSG_NOSIGNAL) == sizeof(count);
+}
+
+bool SocketHandoff::sendAck(int controlSocket) {
+    return send(controlSocket, &HANDOFF_ACK, 1, MSG_NOSIGNAL) == 1;
+}
+
+bool SocketHandoff::waitForAck(int controlSocket, std::chrono::milliseconds timeout) {
+    if (!waitReadable(controlSocket, timeout)) {
+        return false;
+    }
+    char ack = 0;
+    return recv(controlSocket, &ack, 1, MSG_DONTWAIT) == 1 && ack == HANDOFF_ACK;
+}
+
+} // namespace ServiceFramework
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace ServiceFramework {
+
+/**
+ * @brief Listening socket hand-off over a Unix domain control socket
+ *
+ * Used for zero-downtime restarts: the running process listens on a
+ * control socket, a newly started process connects to it and receives
+ * the listening file descriptors via SCM_RIGHTS, so the kernel accept
+ * queue is never closed between the two processes.
+ */
+class SocketHandoff {
+public:
+    /**
+     * @brief Create a listening control socket at the given path
+     * @param path Filesystem path of the control socket (replaced if stale)
+     * @return Control socket descriptor, -1 on failure
+     */
+    static int listenControlSocket(const std::string& path);
+
+    /**
+     * @brief Connect to a running process and receive its listening sockets
+     * @param path Filesystem path of the predecessor's control socket
+     * @param fds Receives the listening socket descriptors
+     * @param timeout Maximum time to wait for the predecessor to answer
+     * @return Connected control descriptor (used to acknowledge), -1 if no
+     *         predecessor is available or the transfer failed
+     */
+    static int requestListeners(const std::string& path, std::vector<int>& fds,
+                                std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Send listening sockets to a successor over an accepted control connection
+     * @param controlSocket Accepted control connection
+     * @param fds Listening socket descriptors to duplicate into the successor
+     * @param timeout Maximum time to wait for the successor's request
+     * @return true if the descriptors were sent
+     */
+    static bool sendListeners(int controlSocket, const std::vector<int>& fds,
+                              std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Tell the predecessor that the successor is accepting connections
+     * @param controlSocket Descriptor returned by requestListeners()
+     * @return true if the acknowledgement was sent
+     */
+    static bool sendAck(int controlSocket);
+
+    /**
+     * @brief Wait for the successor's acknowledgement
+     * @param controlSocket Accepted control connection
+     * @param timeout Maximum time to wait
+     * @return true if the successor acknowledged the hand-off
+     */
+    static bool waitForAck(int controlSocket, std::chrono::milliseconds timeout);
+
+private:
+    static const size_t MAX_HANDOFF_FDS = 16;
+};
+
+} // namespace ServiceFramework
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace ServiceFramework {
+
+/**
+ * @brief One route of a compile-time route table
+ *
+ * Patterns use the same syntax as RestApiService::addRoute(), with "{name}"
+ * segments captured into HttpRequest::pathParams.
+ */
+template <typename Handler>
+struct StaticRoute {
+    std::string_view method;
+    std::string_view pattern;
+    Handler handler{};
+};
+
+/**
+ * @brief Route table built entirely at compile time
+ *
+ * Exact routes are placed in a perfect hash over "METHOD path", so a lookup
+ * is one hash of the request line plus one comparison, with no allocation.
+ * Parameterized routes are matched in declaration order by walking pattern
+ * and path segments in place. Construct it as a constexpr object (see
+ * makeStaticRoutes()); duplicate routes then fail to compile.
+ */
+template <typename Handler, size_t N>
+class StaticRouteTable {
+public:
+    static_assert(N > 0 && N < 0x7fff, "route table size out of range");
+
+    constexpr explicit StaticRouteTable(const StaticRoute<Handler> (&routes)[N])
+        : m_routes{}, m_parameterized{}, m_slots{}, m_seed(0) {
+        for (size_t i = 0; i < N; ++i) {
+            m_routes[i] = routes[i];
+            m_parameterized[i] = routes[i].pattern.find('{') != std::string_view::npos;
+            for (size_t j = 0; j < i; ++j) {
+                if (routes[j].method == routes[i].method && routes[j].pattern == routes[i].pattern) {
+                    throw std::logic_error("duplicate static route");
+                }
+            }
+        }
+
+        // Smallest seed under which no two exact routes share a slot
+        for (uint32_t seed = 1;; ++seed) {
+            if (seed > 100000) {
+                throw std::logic_error("no perfect hash for static routes");
+            }
+            for (size_t slot = 0; slot < SLOTS; ++slot) {
+                m_slots[slot] = -1;
+            }
+            bool collision = false;
+            for (size_t i = 0; i < N && !collision; ++i) {
+                if (m_parameterized[i]) {
+                    continue;
+                }
+                size_t slot = hash(seed, m_routes[i].method, m_routes[i].pattern) & (SLOTS - 1);
+                collision = m_slots[slot] >= 0;
+                m_slots[slot] = static_cast<int16_t>(i);
+            }
+            if (!collision) {
+                m_seed = seed;
+                break;
+            }
+        }
+    }
+
+    static constexpr size_t size() { return N; }
+
+    constexpr const StaticRoute<Handler>& route(size_t index) const { return m_routes[index]; }
+
+    /**
+     * @brief Index of the route for a request, or -1
+     * @param parameterized false: exact routes only; true: "{name}" routes
+     *        only, capturing their segments into params
+     */
+    template <typename Params>
+    int find(std::string_view method, std::string_view path, bool parameterized, Params& params) const {
+        if (!parameterized) {
+            int index = m_slots[hash(m_seed, method, path) & (SLOTS - 1)];
+            if (index >= 0 && m_routes[index].method == method && m_routes[index].pattern == path) {
+                return index;
+            }
+            return -1;
+        }
+
+        for (size_t i = 0; i < N; ++i) {
+            if (m_parameterized[i] && m_routes[i].method == method &&
+                matchPattern(m_routes[i].pattern, path, static_cast<Params*>(nullptr))) {
+                matchPattern(m_routes[i].pattern, path, &params);
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * @brief True if an exact route with another method has this path (405)
+     */
+    bool hasOtherMethod(std::string_view method, std::string_view path) const {
+        for (size_t i = 0; i < N; ++i) {
+            if (!m_parameterized[i] && m_routes[i].pattern == path && m_routes[i].method != method) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    // At least twice as many slots as routes keeps the seed search short
+    static constexpr size_t slotCount() {
+        size_t slots = 4;
+        while (slots < 2 * N) {
+            slots *= 2;
+        }
+        return slots;
+    }
+    static constexpr size_t SLOTS = slotCount();
+
+    // FNV-1a over "METHOD path"
+    static constexpr uint32_t hash(uint32_t seed, std::string_view method, std::string_view path) {
+        uint32_t value = 2166136261u ^ (seed * 0x9e3779b9u);
+        for (char c : method) {
+            value = (value ^ static_cast<uint8_t>(c)) * 16777619u;
+        }
+        value = (value ^ static_cast<uint8_t>(' ')) * 16777619u;
+        for (char c : path) {
+            value = (value ^ static_cast<uint8_t>(c)) * 16777619u;
+        }
+        return value ^ (value >> 15);
+    }
+
+    // Segment-wise match, ignoring empty segments like addRoute() patterns
+    template <typename Params>
+    static bool matchPattern(std::string_view pattern, std::string_view path, Params* params) {
+        size_t p = 0;
+        size_t q = 0;
+        while (true) {
+            while (p < pattern.size() && pattern[p] == '/') {
+                ++p;
+            }
+            while (q < path.size() && path[q] == '/') {
+                ++q;
+            }
+            if (p == pattern.size() || q == path.size()) {
+                return p == pattern.size() && q == path.size();
+            }
+
+            size_t patternEnd = std::min(pattern.find('/', p), pattern.size());
+            size_t pathEnd = std::min(path.find('/', q), path.size());
+            std::string_view segment = pattern.substr(p, patternEnd - p);
+            std::string_view value = path.substr(q, pathEnd - q);
+            if (segment.size() >= 2 && segment.front() == '{' && segment.back() == '}') {
+                if (params != nullptr) {
+                    (*params)[std::string(segment.substr(1, segment.size() - 2))] = std::string(value);
+                }
+            } else if (segment != value) {
+                return false;
+            }
+            p = patternEnd;
+            q = pathEnd;
+        }
+    }
+
+    StaticRoute<Handler> m_routes[N];
+    bool m_parameterized[N];
+    int16_t m_slots[SLOTS];
+    uint32_t m_seed;
+};
+
+/**
+ * @brief Build a route table, deducing its size
+ */
+template <typename Handler, size_t N>
+constexpr StaticRouteTable<Handler, N> makeStaticRoutes(const StaticRoute<Handler> (&routes)[N]) {
+    return StaticRouteTable<Handler, N>(routes);
+}
+
+namespace StaticRoutes {
+
+template <const auto& Table, typename Owner, typename Request, size_t I>
+auto callRoute(Owner& owner, const Request& request) {
+    constexpr auto handler = Table.route(I).handler;
+    return (owner.*handler)(request);
+}
+
+template <const auto& Table, typename Owner, typename Request, size_t... I>
+auto invoke(Owner& owner, size_t index, const Request& request, std::index_sequence<I...>) {
+    // One thunk per route, each calling its handler directly
+    using Result = decltype(callRoute<Table, Owner, Request, 0>(owner, request));
+    using Thunk = Result (*)(Owner&, const Request&);
+    static constexpr Thunk THUNKS[] = {&callRoute<Table, Owner, Request, I>...};
+    return THUNKS[index](owner, request);
+}
+
+/**
+ * @brief Call route index of Table on owner
+ *
+ * Dispatch is a jump table of direct calls, so handlers can be inlined;
+ * there is no std::function or member pointer call at runtime.
+ */
+template <const auto& Table, typename Owner, typename Request>
+auto invoke(Owner& owner, size_t index, const Request& request) {
+    return invoke<Table>(owner, index, request, std::make_index_sequence<Table.size()>());
+}
+
+} // namespace StaticRoutes
+
+} // namespace ServiceFramework
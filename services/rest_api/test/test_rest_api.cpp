@@ -0,0 +1,1674 @@
+#include "services/logging/logging_service.h"
+#include "services/rest_api/http_client.h"
+#include "services/rest_api/middleware.h"
+#include "services/rest_api/request_coalescer.h"
+#include "services/rest_api/rest_api_service.h"
+#include "services/rest_api/reverse_proxy.h"
+#include "services/rest_api/rpc_codec.h"
+#include "services/rest_api/rpc_session.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#ifdef SERVICES_FRAMEWORK_TLS
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#endif
+
+using namespace ServiceFramework;
+
+// Simple test framework
+class TestRunner {
+  public:
+    static void runTest(const std::string &testName,
+                        std::function<bool()> testFunc) {
+        std::cout << "Running test: " << testName << "... ";
+        try {
+            if (testFunc()) {
+                std::cout << "PASSED" << std::endl;
+                s_passedTests++;
+            } else {
+                std::cout << "FAILED" << std::endl;
+                s_failedTests++;
+            }
+        } catch (const std::exception &e) {
+            std::cout << "FAILED (Exception: " << e.what() << ")" << std::endl;
+            s_failedTests++;
+        }
+        s_totalTests++;
+    }
+
+    static void printResults() {
+        std::cout << "\n=== Test Results ===" << std::endl;
+        std::cout << "Total tests: " << s_totalTests << std::endl;
+        std::cout << "Passed: " << s_passedTests << std::endl;
+        std::cout << "Failed: " << s_failedTests << std::endl;
+    }
+
+    static bool allTestsPassed() { return s_failedTests == 0; }
+
+  private:
+    static int s_totalTests;
+    static int s_passedTests;
+    static int s_failedTests;
+};
+
+int TestRunner::s_totalTests = 0;
+int TestRunner::s_passedTests = 0;
+int TestRunner::s_failedTests = 0;
+
+// Sends a raw request over a fresh loopback connection and returns
+// everything the server wrote before closing.
+static std::string sendRaw(int port, const std::string &request) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) {
+        return "";
+    }
+
+    struct sockaddr_in server;
+    std::memset(&server, 0, sizeof(server));
+    server.sin_family = AF_INET;
+    server.sin_port = htons(port);
+    server.sin_addr.s_addr = inet_addr("127.0.0.1");
+
+    if (connect(sock, (struct sockaddr *)&server, sizeof(server)) < 0) {
+        close(sock);
+        return "";
+    }
+
+    send(sock, request.c_str(), request.length(), MSG_NOSIGNAL);
+
+    std::string response;
+    char buffer[4096];
+    ssize_t bytesRead;
+    while ((bytesRead = recv(sock, buffer, sizeof(buffer), 0)) > 0) {
+        response.append(buffer, bytesRead);
+    }
+
+    close(sock);
+    return response;
+}
+
+// Same as sendRaw() but over a Unix domain socket ("@name" is abstract)
+static std::string sendRawUnix(const std::string &path,
+                               const std::string &request) {
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0) {
+        return "";
+    }
+
+    struct sockaddr_un server;
+    std::memset(&server, 0, sizeof(server));
+    server.sun_family = AF_UNIX;
+    std::memcpy(server.sun_path, path.c_str(), path.size());
+    socklen_t serverLen = sizeof(server);
+    if (path[0] == '@') {
+        server.sun_path[0] = '\0';
+        serverLen = offsetof(struct sockaddr_un, sun_path) + path.size();
+    }
+
+    if (connect(sock, (struct sockaddr *)&server, serverLen) < 0) {
+        close(sock);
+        return "";
+    }
+
+    send(sock, request.c_str(), request.length(), MSG_NOSIGNAL);
+
+    std::string response;
+    char buffer[4096];
+    ssize_t bytesRead;
+    while ((bytesRead = recv(sock, buffer, sizeof(buffer), 0)) > 0) {
+        response.append(buffer, bytesRead);
+    }
+
+    close(sock);
+    return response;
+}
+
+static std::string httpGet(int port, const std::string &path) {
+    return sendRaw(port, "GET " + path +
+                             " HTTP/1.1\r\nHost: localhost\r\n"
+                             "Connection: close\r\n\r\n");
+}
+
+static void addWhoAmIRoute(RestApiService &service, const std::string &name) {
+    service.addRoute("GET", "/whoami", [name](const HttpRequest &) {
+        HttpResponse response;
+        response.body = name;
+        return response;
+    });
+}
+
+// Test functions
+bool testBasicRequest() {
+    RestApiService service(0);
+    addWhoAmIRoute(service, "basic");
+    if (!service.initialize() || !service.start()) {
+        return false;
+    }
+
+    std::string response = httpGet(service.getPort(), "/whoami");
+    service.stop();
+
+    return response.find("HTTP/1.1 200 OK") == 0 &&
+           response.find("\r\n\r\nbasic") != std::string::npos;
+}
+
+bool testUnixListeners() {
+    const std::string filePath =
+        "/tmp/rest_api_test_" + std::to_string(getpid()) + ".sock";
+    const std::string abstractPath =
+        "@rest_api_test_" + std::to_string(getpid());
+
+    RestApiService service(0);
+    if (!service.addUnixListener(filePath) ||
+        !service.addUnixListener(abstractPath)) {
+        return false;
+    }
+    service.addRoute("GET", "/peer", [](const HttpRequest &req) {
+        HttpResponse response;
+        response.body = req.peer.valid ? std::to_string(req.peer.uid) + ":" +
+                                             std::to_string(req.peer.pid)
+                                       : "none";
+        return response;
+    });
+    if (!service.initialize() || !service.start()) {
+        return false;
+    }
+
+    const std::string request =
+        "GET /peer HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+    const std::string expected =
+        "\r\n\r\n" + std::to_string(getuid()) + ":" + std::to_string(getpid());
+
+    bool fileOk =
+        sendRawUnix(filePath, request).find(expected) != std::string::npos;
+    bool abstractOk =
+        sendRawUnix(abstractPath, request).find(expected) != std::string::npos;
+    // TCP clients carry no credentials
+    bool tcpOk = httpGet(service.getPort(), "/peer").find("\r\n\r\nnone") !=
+                 std::string::npos;
+
+    service.stop();
+    bool cleanedUp = access(filePath.c_str(), F_OK) != 0;
+    return fileOk && abstractOk && tcpOk && cleanedUp;
+}
+
+// Opens a loopback connection without sending anything
+static int connectTo(int port) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in server;
+    std::memset(&server, 0, sizeof(server));
+    server.sin_family = AF_INET;
+    server.sin_port = htons(port);
+    server.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (connect(sock, (struct sockaddr *)&server, sizeof(server)) < 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+// Reads one response with a Content-Length body from a kept-alive
+// connection; bytes of any following response stay in pending
+static std::string readResponse(int sock, std::string &pending) {
+    char buffer[4096];
+    while (true) {
+        size_t headerEnd = pending.find("\r\n\r\n");
+        if (headerEnd != std::string::npos) {
+            size_t lengthPos = pending.find("Content-Length: ");
+            size_t length = lengthPos == std::string::npos || lengthPos > headerEnd
+                                ? 0
+                                : std::stoul(pending.substr(lengthPos + 16));
+            if (pending.size() >= headerEnd + 4 + length) {
+                std::string response = pending.substr(0, headerEnd + 4 + length);
+                pending.erase(0, headerEnd + 4 + length);
+                return response;
+            }
+        }
+        ssize_t bytesRead = recv(sock, buffer, sizeof(buffer), 0);
+        if (bytesRead <= 0) {
+            std::string response;
+            response.swap(pending);
+            return response;
+        }
+        pending.append(buffer, bytesRead);
+    }
+}
+
+static std::string readResponse(int sock) {
+    std::string pending;
+    return readResponse(sock, pending);
+}
+
+bool testKeepAliveAndPipelining() {
+    RestApiService service(0);
+    addWhoAmIRoute(service, "alive");
+    service.addRoute("POST", "/echo", [](const HttpRequest &req) {
+        HttpResponse response;
+        response.body = req.body;
+        return response;
+    });
+    if (!service.initialize() || !service.start()) {
+        return false;
+    }
+
+    int sock = connectTo(service.getPort());
+    if (sock < 0) {
+        service.stop();
+        return false;
+    }
+
+    // Two requests on one connection, the second pipelined behind a body
+    std::string requests =
+        "POST /echo HTTP/1.1\r\nContent-Length: 12\r\n\r\nhello\r\nworld"
+        "GET /whoami HTTP/1.1\r\n\r\n";
+    send(sock, requests.c_str(), requests.size(), MSG_NOSIGNAL);
+    std::string pending;
+    std::string first = readResponse(sock, pending);
+    std::string second = readResponse(sock, pending);
+    close(sock);
+    service.stop();
+
+    return first.find("Connection: keep-alive") != std::string::npos &&
+           first.find("\r\n\r\nhello\r\nworld") != std::string::npos &&
+           second.find("\r\n\r\nalive") != std::string::npos;
+}
+
+bool testConnectionDeadlines() {
+    ConnectionTimeouts timeouts;
+    timeouts.headerRead = std::chrono::milliseconds(200);
+    timeouts.idle = std::chrono::milliseconds(200);
+
+    RestApiService service(0);
+    service.setConnectionTimeouts(timeouts);
+    addWhoAmIRoute(service, "deadline");
+    if (!service.initialize() || !service.start()) {
+        return false;
+    }
+
+    // Slowloris: headers never finish, so the server gives up with a 408
+    int slow = connectTo(service.getPort());
+    std::string partial = "GET /whoami HTTP/1.1\r\nX-Slow: ";
+    send(slow, partial.c_str(), partial.size(), MSG_NOSIGNAL);
+    auto start = std::chrono::steady_clock::now();
+    std::string timedOut = readResponse(slow);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    close(slow);
+
+    // Idle keep-alive connections are closed after the idle deadline
+    int idle = connectTo(service.getPort());
+    std::string request = "GET /whoami HTTP/1.1\r\n\r\n";
+    send(idle, request.c_str(), request.size(), MSG_NOSIGNAL);
+    bool answered = readResponse(idle).find("deadline") != std::string::npos;
+    char byte;
+    bool closedWhenIdle = recv(idle, &byte, 1, 0) == 0;
+    close(idle);
+
+    service.stop();
+
+    return timedOut.find("HTTP/1.1 408") == 0 &&
+           elapsed < std::chrono::seconds(2) && answered && closedWhenIdle;
+}
+
+bool testHotUpgradeHandoff() {
+    const std::string controlPath =
+        "/tmp/rest_api_test_upgrade_" + std::to_string(getpid()) + ".sock";
+    const std::string unixPath =
+        "/tmp/rest_api_test_upgrade_" + std::to_string(getpid()) + ".http";
+
+    RestApiService oldService(0);
+    oldService.setHotUpgradePath(controlPath);
+    oldService.addUnixListener(unixPath);
+    oldService.setDrainTimeout(std::chrono::milliseconds(2000));
+    oldService.setHandoffTimeout(std::chrono::milliseconds(500));
+    addWhoAmIRoute(oldService, "old");
+    if (!oldService.initialize() || !oldService.start()) {
+        return false;
+    }
+    int port = oldService.getPort();
+
+    if (httpGet(port, "/whoami").find("\r\n\r\nold") == std::string::npos) {
+        return false;
+    }
+
+    // A peer that connects to the control socket and never asks is given
+    // up on, and the real successor is served after it
+    int silent = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un control;
+    std::memset(&control, 0, sizeof(control));
+    control.sun_family = AF_UNIX;
+    std::memcpy(control.sun_path, controlPath.c_str(), controlPath.size());
+    if (connect(silent, (struct sockaddr *)&control, sizeof(control)) < 0) {
+        close(silent);
+        return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(700));
+
+    // The successor must inherit the port instead of binding its own
+    RestApiService newService(0);
+    newService.setHotUpgradePath(controlPath);
+    newService.addUnixListener(unixPath);
+    addWhoAmIRoute(newService, "new");
+    if (!newService.initialize() || newService.getPort() != port ||
+        !newService.start()) {
+        return false;
+    }
+
+    close(silent);
+
+    // The predecessor stops accepting and finishes draining on its own
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (oldService.isRunning() &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (oldService.isRunning() || !oldService.isDraining()) {
+        return false;
+    }
+    oldService.stop();
+
+    // The shared socket survives the predecessor shutting down
+    bool servedByNew =
+        httpGet(port, "/whoami").find("\r\n\r\nnew") != std::string::npos &&
+        sendRawUnix(unixPath,
+                    "GET /whoami HTTP/1.1\r\nConnection: close\r\n\r\n")
+                .find("\r\n\r\nnew") != std::string::npos;
+
+    newService.stop();
+    unlink(controlPath.c_str());
+    return servedByNew;
+}
+
+bool testHpack() {
+    // RFC 7541 C.4.1: first request of the Huffman-coded example
+    const uint8_t block[] = {0x82, 0x86, 0x84, 0x41, 0x8c, 0xf1, 0xe3, 0xc2, 0xe5,
+                             0xf2, 0x3a, 0x6b, 0xa0, 0xab, 0x90, 0xf4, 0xff};
+    HpackDecoder decoder;
+    HeaderList headers;
+    if (!decoder.decode(block, sizeof(block), headers) || headers.size() != 4 ||
+        headers[0].name != ":method" || headers[0].value != "GET" ||
+        headers[3].name != ":authority" || headers[3].value != "www.example.com") {
+        return false;
+    }
+
+    std::string huffman;
+    Hpack::huffmanEncode("www.example.com", huffman);
+    if (huffman != std::string(reinterpret_cast<const char *>(block) + 5, 12)) {
+        return false;
+    }
+
+    // Round trip through the dynamic table: the second block is all indexes
+    HpackEncoder encoder;
+    HeaderList fields = {{":method", "POST"}, {"x-request-id", "42"}, {"accept", "application/json"}};
+    std::string first;
+    std::string second;
+    encoder.encode(fields, first);
+    encoder.encode(fields, second);
+    HeaderList decodedFirst;
+    HeaderList decodedSecond;
+    return decoder.decode(reinterpret_cast<const uint8_t *>(first.data()), first.size(), decodedFirst) &&
+           decoder.decode(reinterpret_cast<const uint8_t *>(second.data()), second.size(), decodedSecond) &&
+           second.size() == 3 && decodedSecond.size() == 3 &&
+           decodedSecond[1].value == "42" && decodedSecond[2].value == "application/json";
+}
+
+static std::string http2Frame(uint8_t type, uint8_t flags, uint32_t streamId,
+                              const std::string &payload) {
+    std::string frame;
+    frame.push_back(static_cast<char>(payload.size() >> 16));
+    frame.push_back(static_cast<char>(payload.size() >> 8));
+    frame.push_back(static_cast<char>(payload.size()));
+    frame.push_back(static_cast<char>(type));
+    frame.push_back(static_cast<char>(flags));
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        frame.push_back(static_cast<char>(streamId >> shift));
+    }
+    return frame + payload;
+}
+
+bool testHttp2Multiplexing() {
+    RestApiService service(0);
+    service.addRoute("GET", "/slow", [](const HttpRequest &) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        HttpResponse response;
+        response.body = "slow";
+        return response;
+    });
+    service.addRoute("POST", "/echo", [](const HttpRequest &req) {
+        HttpResponse response;
+        response.body = req.body;
+        return response;
+    });
+    if (!service.initialize() || !service.start()) {
+        return false;
+    }
+
+    int sock = connectTo(service.getPort());
+    if (sock < 0) {
+        service.stop();
+        return false;
+    }
+
+    // Prior knowledge: a slow stream, then an echo whose body exceeds the
+    // default 64K stream window, so responses complete out of order
+    HpackEncoder encoder;
+    std::string out(Http2Session::PREFACE, Http2Session::PREFACE_LENGTH);
+    out += http2Frame(0x4, 0, 0, "");
+    std::string block;
+    encoder.encode({{":method", "GET"}, {":path", "/slow"}, {":scheme", "http"}, {":authority", "test"}}, block);
+    out += http2Frame(0x1, 0x5, 1, block);
+    block.clear();
+    encoder.encode({{":method", "POST"}, {":path", "/echo"}, {":scheme", "http"}, {":authority", "test"}}, block);
+    out += http2Frame(0x1, 0x4, 3, block);
+    std::string body(100000, 'x');
+    for (size_t offset = 0; offset < body.size(); offset += 16384) {
+        bool last = offset + 16384 >= body.size();
+        out += http2Frame(0x0, last ? 0x1 : 0x0, 3, body.substr(offset, 16384));
+    }
+    send(sock, out.data(), out.size(), MSG_NOSIGNAL);
+
+    // Read frames, granting window as DATA arrives, until both streams end
+    HpackDecoder decoder;
+    std::map<uint32_t, std::string> statuses;
+    std::map<uint32_t, std::string> bodies;
+    std::vector<uint32_t> finished;
+    std::string pending;
+    char buffer[16384];
+    while (finished.size() < 2) {
+        ssize_t bytesRead = recv(sock, buffer, sizeof(buffer), 0);
+        if (bytesRead <= 0) {
+            break;
+        }
+        pending.append(buffer, bytesRead);
+        while (pending.size() >= 9) {
+            size_t length = (static_cast<uint8_t>(pending[0]) << 16) |
+                            (static_cast<uint8_t>(pending[1]) << 8) | static_cast<uint8_t>(pending[2]);
+            if (pending.size() < 9 + length) {
+                break;
+            }
+            uint8_t type = pending[3];
+            uint8_t flags = pending[4];
+            uint32_t streamId = (static_cast<uint8_t>(pending[5] & 0x7f) << 24) |
+                                (static_cast<uint8_t>(pending[6]) << 16) |
+                                (static_cast<uint8_t>(pending[7]) << 8) | static_cast<uint8_t>(pending[8]);
+            std::string payload = pending.substr(9, length);
+            pending.erase(0, 9 + length);
+
+            if (type == 0x1) {
+                HeaderList headers;
+                decoder.decode(reinterpret_cast<const uint8_t *>(payload.data()), payload.size(), headers);
+                statuses[streamId] = headers.empty() ? "" : headers[0].value;
+            } else if (type == 0x0) {
+                bodies[streamId] += payload;
+                std::string increment = {0, static_cast<char>(length >> 16),
+                                         static_cast<char>(length >> 8), static_cast<char>(length)};
+                std::string windowUpdates = http2Frame(0x8, 0, 0, increment) + http2Frame(0x8, 0, streamId, increment);
+                send(sock, windowUpdates.data(), windowUpdates.size(), MSG_NOSIGNAL);
+            } else if (type == 0x4 && !(flags & 0x1)) {
+                std::string ack = http2Frame(0x4, 0x1, 0, "");
+                send(sock, ack.data(), ack.size(), MSG_NOSIGNAL);
+            }
+            if ((type == 0x0 || type == 0x1) && (flags & 0x1)) {
+                finished.push_back(streamId);
+            }
+        }
+    }
+    close(sock);
+    service.stop();
+
+    return finished.size() == 2 && finished[0] == 3 && finished[1] == 1 &&
+           statuses[1] == "200" && bodies[1] == "slow" &&
+           statuses[3] == "200" && bodies[3] == body;
+}
+
+bool testTracing() {
+    const std::string spansPath = "/tmp/rest_api_test_spans_" + std::to_string(getpid()) + ".jsonl";
+    unlink(spansPath.c_str());
+
+    // Only requests whose caller sampled them are recorded
+    TracingOptions tracing;
+    tracing.endpoint = spansPath;
+    tracing.sampleRatio = 0.0;
+
+    RestApiService service(0);
+    service.setTracing(tracing);
+    std::mutex seenMutex;
+    std::vector<std::string> seen;
+    service.addRoute("GET", "/traced/{id}", [&](const HttpRequest &req) {
+        std::lock_guard<std::mutex> lock(seenMutex);
+        seen.push_back(req.trace.traceparent());
+        return HttpResponse();
+    });
+    if (!service.initialize() || !service.start()) {
+        return false;
+    }
+
+    const std::string sampledTrace = "4bf92f3577b34da6a3ce929d0e0e4736";
+    const std::string unsampledTrace = "0af7651916cd43dd8448eb211c80319c";
+    sendRaw(service.getPort(), "GET /traced/1 HTTP/1.1\r\nConnection: close\r\n"
+                               "traceparent: 00-" + sampledTrace + "-00f067aa0ba902b7-01\r\n\r\n");
+    sendRaw(service.getPort(), "GET /traced/2 HTTP/1.1\r\nConnection: close\r\n"
+                               "traceparent: 00-" + unsampledTrace + "-b7ad6b7169203331-00\r\n\r\n");
+    sendRaw(service.getPort(), "GET /traced/3 HTTP/1.1\r\nConnection: close\r\n\r\n");
+    service.stop(); // flushes the exporter
+
+    std::ifstream file(spansPath);
+    std::string spans((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    unlink(spansPath.c_str());
+
+    // Handlers see the caller's trace with a span id of their own
+    bool propagated = seen.size() == 3 &&
+                      seen[0].compare(0, 36, "00-" + sampledTrace + "-") == 0 &&
+                      seen[0].find("00f067aa0ba902b7") == std::string::npos &&
+                      seen[0].compare(52, 3, "-01") == 0 &&
+                      seen[1].compare(0, 36, "00-" + unsampledTrace + "-") == 0 &&
+                      seen[1].compare(52, 3, "-00") == 0;
+
+    size_t serverSpans = 0;
+    for (size_t pos = spans.find("\"kind\":2"); pos != std::string::npos; pos = spans.find("\"kind\":2", pos + 1)) {
+        ++serverSpans;
+    }
+    bool exported = serverSpans == 1 &&
+                    spans.find(sampledTrace) != std::string::npos &&
+                    spans.find(unsampledTrace) == std::string::npos &&
+                    spans.find("\"parentSpanId\":\"00f067aa0ba902b7\"") != std::string::npos &&
+                    spans.find("\"name\":\"GET /traced/{id}\"") != std::string::npos &&
+                    spans.find("\"name\":\"queue\"") != std::string::npos &&
+                    spans.find("\"name\":\"handler\"") != std::string::npos &&
+                    spans.find("\"name\":\"send\"") != std::string::npos;
+    return propagated && exported;
+}
+
+// Service with its own compile-time route table
+class WidgetRoutes {
+  public:
+    HttpResponse list(const HttpRequest &) {
+        HttpResponse response;
+        response.body = "widgets";
+        return response;
+    }
+    HttpResponse get(const HttpRequest &req) {
+        HttpResponse response;
+        response.body = "widget " + req.pathParams.at("id");
+        return response;
+    }
+    HttpResponse rename(const HttpRequest &req) {
+        HttpResponse response;
+        response.body = req.pathParams.at("id") + "=" + req.body;
+        return response;
+    }
+};
+
+constexpr auto WIDGET_ROUTES = makeStaticRoutes<HttpResponse (WidgetRoutes::*)(const HttpRequest &)>({
+    {"GET", "/widgets", &WidgetRoutes::list},
+    {"GET", "/widgets/{id}", &WidgetRoutes::get},
+    {"PUT", "/widgets/{id}/name", &WidgetRoutes::rename},
+});
+
+bool testStaticRoutes() {
+    RestApiService service(0);
+    WidgetRoutes widgets;
+    service.addStaticRoutes<WIDGET_ROUTES>(widgets);
+    // An exact addRoute() route still beats a static "{id}" pattern
+    service.addRoute("GET", "/widgets/special", [](const HttpRequest &) {
+        HttpResponse response;
+        response.body = "special";
+        return response;
+    });
+    if (!service.initialize() || !service.start()) {
+        return false;
+    }
+
+    int port = service.getPort();
+    std::string list = httpGet(port, "/widgets");
+    std::string widget = httpGet(port, "/widgets/42");
+    std::string special = httpGet(port, "/widgets/special");
+    std::string renamed = sendRaw(port, "PUT /widgets/7/name HTTP/1.1\r\nConnection: close\r\n"
+                                        "Content-Length: 4\r\n\r\nblue");
+    std::string wrongMethod = sendRaw(port, "POST /widgets HTTP/1.1\r\nConnection: close\r\n\r\n");
+    std::string builtin = httpGet(port, "/api/status");
+    std::string missing = httpGet(port, "/widgets/42/color");
+    service.stop();
+
+    // addRoute() replaces a built-in route; a restart keeps one copy of
+    // each table, and tables can no longer be added once initialized
+    service.addRoute("GET", "/api/status", [](const HttpRequest &) {
+        HttpResponse response;
+        response.body = "custom status";
+        return response;
+    });
+    bool restarted = service.initialize() && service.start() &&
+                     !service.addStaticRoutes<WIDGET_ROUTES>(widgets);
+    std::string overridden = restarted ? httpGet(port, "/api/status") : "";
+    std::string again = restarted ? httpGet(port, "/widgets/42") : "";
+    service.stop();
+
+    return restarted && overridden.find("\r\n\r\ncustom status") != std::string::npos &&
+           again.find("\r\n\r\nwidget 42") != std::string::npos &&
+           list.find("\r\n\r\nwidgets") != std::string::npos &&
+           widget.find("\r\n\r\nwidget 42") != std::string::npos &&
+           special.find("\r\n\r\nspecial") != std::string::npos &&
+           renamed.find("\r\n\r\n7=blue") != std::string::npos &&
+           wrongMethod.find("HTTP/1.1 405") == 0 &&
+           builtin.find("HTTP/1.1 200 OK") == 0 &&
+           builtin.find("\"port\": " + std::to_string(port)) != std::string::npos &&
+           missing.find("HTTP/1.1 404") == 0;
+}
+
+// Middleware handing state to the handler through the pipeline context
+struct TenantContext {
+    std::string tenant;
+};
+
+struct TenantMiddleware {
+    std::optional<HttpResponse> before(const HttpRequest &req, TenantContext &context) const {
+        const std::string *tenant = findHeader(req, "x-tenant");
+        if (!tenant) {
+            HttpResponse response;
+            response.statusCode = 400;
+            response.statusText = "Bad Request";
+            return response;
+        }
+        context.tenant = *tenant;
+        return std::nullopt;
+    }
+};
+
+bool testMiddleware() {
+    RestApiService service(0);
+    auto getItem = [](const HttpRequest &req) {
+        HttpResponse response;
+        response.body = "item " + req.pathParams.at("id");
+        return response;
+    };
+    service.addRoute("GET", "/secure/{id}",
+                     withMiddleware(getItem, RequestIdMiddleware{}, CorsMiddleware{"https://example.com"},
+                                    BearerAuthMiddleware{"s3cret"}, TimingMiddleware{}));
+    auto getTenant = [](const HttpRequest &, TenantContext &context) {
+        HttpResponse response;
+        response.body = "tenant " + context.tenant;
+        return response;
+    };
+    service.addRoute("GET", "/tenant", withMiddleware<TenantContext>(getTenant, TenantMiddleware{}));
+    if (!service.initialize() || !service.start()) {
+        return false;
+    }
+
+    int port = service.getPort();
+    std::string denied = sendRaw(port, "GET /secure/1 HTTP/1.1\r\nConnection: close\r\n"
+                                       "X-Request-Id: abc123\r\n\r\n");
+    std::string allowed = sendRaw(port, "GET /secure/2 HTTP/1.1\r\nConnection: close\r\n"
+                                        "authorization: Bearer s3cret\r\n\r\n");
+    std::string tenant = sendRaw(port, "GET /tenant HTTP/1.1\r\nConnection: close\r\n"
+                                       "X-Tenant: acme\r\n\r\n");
+    std::string noTenant = httpGet(port, "/tenant");
+    // Built-in routes still answer 503 without a service manager
+    std::string builtin = httpGet(port, "/api/services/anything");
+    service.stop();
+
+    // Short-circuit: no handler, no timing, but outer hooks still run
+    bool shortCircuited = denied.find("HTTP/1.1 401") == 0 &&
+                          denied.find("X-Request-Id: abc123\r\n") != std::string::npos &&
+                          denied.find("Access-Control-Allow-Origin: https://example.com") != std::string::npos &&
+                          denied.find("Server-Timing") == std::string::npos;
+    bool passed = allowed.find("HTTP/1.1 200 OK") == 0 &&
+                  allowed.find("\r\n\r\nitem 2") != std::string::npos &&
+                  allowed.find("X-Request-Id: ") != std::string::npos &&
+                  allowed.find("Server-Timing: app;dur=") != std::string::npos &&
+                  allowed.find("Vary: Origin") != std::string::npos;
+    return shortCircuited && passed &&
+           tenant.find("\r\n\r\ntenant acme") != std::string::npos &&
+           noTenant.find("HTTP/1.1 400") == 0 &&
+           builtin.find("HTTP/1.1 503") == 0;
+}
+
+// Upstream stand-in for the proxy test: names itself and echoes bodies
+static void addBackendRoutes(RestApiService &backend, const std::string &name) {
+    addWhoAmIRoute(backend, name);
+    backend.addRoute("POST", "/echo", [name](const HttpRequest &req) {
+        HttpResponse response;
+        response.headers["Content-Type"] = "application/octet-stream";
+        response.headers["X-Backend"] = name;
+        response.headers["X-Query"] = req.query;
+        response.body = req.body;
+        return response;
+    });
+}
+
+bool testReverseProxy() {
+    const std::string unixPath = "@rest_api_proxy_test_" + std::to_string(getpid());
+    RestApiService tcpBackend(0);
+    RestApiService unixBackend(0);
+    addBackendRoutes(tcpBackend, "tcp");
+    addBackendRoutes(unixBackend, "unix");
+    if (!unixBackend.addUnixListener(unixPath) || !tcpBackend.initialize() || !tcpBackend.start() ||
+        !unixBackend.initialize() || !unixBackend.start()) {
+        return false;
+    }
+
+    ProxyOptions options;
+    options.upstreams = {"127.0.0.1:" + std::to_string(tcpBackend.getPort()), unixPath};
+    options.stripPrefix = "/workers";
+    auto proxy = std::make_shared<ReverseProxy>(options);
+
+    ProxyOptions deadOptions;
+    deadOptions.upstreams = {"unix:/nonexistent/rest_api_proxy.sock"};
+
+    RestApiService front(0);
+    front.addRoute("GET", "/workers/local", [](const HttpRequest &) {
+        HttpResponse response;
+        response.body = "local";
+        return response;
+    });
+    bool added = front.addProxyRoute("/workers", proxy) &&
+                 front.addProxyRoute("/dead", std::make_shared<ReverseProxy>(deadOptions));
+    if (!added || !front.initialize() || !front.start()) {
+        return false;
+    }
+
+    // Sequential requests tie on outstanding count, so they alternate
+    int port = front.getPort();
+    std::map<std::string, int> served;
+    for (int i = 0; i < 10; ++i) {
+        std::string response = httpGet(port, "/workers/whoami");
+        size_t body = response.find("\r\n\r\n");
+        if (response.find("HTTP/1.1 200 OK") != 0 || body == std::string::npos) {
+            return false;
+        }
+        ++served[response.substr(body + 4)];
+    }
+
+    std::string payload(1 << 20, 'p');
+    std::string echoed = sendRaw(port, "POST /workers/echo?a=1&b=%20 HTTP/1.1\r\nConnection: close\r\n"
+                                       "Content-Length: " + std::to_string(payload.size()) + "\r\n\r\n" +
+                                       payload);
+    std::string local = httpGet(port, "/workers/local");
+    std::string dead = httpGet(port, "/dead/anything");
+    std::string missing = httpGet(port, "/workersx");
+    uint64_t opened = proxy->pool().connectionsOpened();
+
+    front.stop();
+    tcpBackend.stop();
+    unixBackend.stop();
+
+    size_t body = echoed.find("\r\n\r\n");
+    bool echoOk = echoed.find("HTTP/1.1 200 OK") == 0 && body != std::string::npos &&
+                  echoed.compare(body + 4, std::string::npos, payload) == 0 &&
+                  echoed.find("X-Query: a=1&b=%20\r\n") != std::string::npos &&
+                  echoed.find("Content-Type: application/octet-stream") != std::string::npos;
+
+    // Keep-alive: one connection per upstream covers the sequential requests
+    return served["tcp"] == 5 && served["unix"] == 5 && opened == 2 && echoOk &&
+           local.find("\r\n\r\nlocal") != std::string::npos &&
+           dead.find("HTTP/1.1 502") == 0 && missing.find("HTTP/1.1 404") == 0;
+}
+
+bool testStaleUpstreamRetry() {
+    // Upstream that answers the first request on each connection and closes
+    // the connection after reading the second, as after an idle timeout
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = inet_addr("127.0.0.1");
+    socklen_t addressLen = sizeof(address);
+    if (bind(listener, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(listener, 4) < 0 ||
+        getsockname(listener, (struct sockaddr *)&address, &addressLen) < 0) {
+        close(listener);
+        return false;
+    }
+    std::mutex receivedMutex;
+    std::vector<std::string> received;
+    std::thread upstream([&] {
+        int connection;
+        while ((connection = accept(listener, nullptr, nullptr)) >= 0) {
+            struct timeval timeout = {2, 0}; // fail rather than hang
+            setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            std::string pending;
+            for (int request = 0; request < 2; ++request) {
+                std::string message = readResponse(connection, pending);
+                if (message.empty()) {
+                    break;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(receivedMutex);
+                    received.push_back(message.substr(0, message.find("\r\n")));
+                }
+                if (request == 0) {
+                    std::string reply = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok";
+                    send(connection, reply.data(), reply.size(), MSG_NOSIGNAL);
+                }
+            }
+            close(connection);
+        }
+    });
+
+    ProxyOptions options;
+    options.upstreams = {"127.0.0.1:" + std::to_string(ntohs(address.sin_port))};
+    ReverseProxy proxy(options);
+    auto forward = [&proxy](const std::string &method, const std::string &path) {
+        HttpRequest request;
+        request.method = method;
+        request.path = path;
+        request.version = "HTTP/1.1";
+        return proxy.forward(request);
+    };
+
+    // A GET on the dropped connection is sent again on a fresh one; a POST
+    // may already have been acted on, so it fails instead
+    HttpResponse warm = forward("GET", "/warm");
+    HttpResponse get = forward("GET", "/get");
+    HttpResponse post = forward("POST", "/post");
+
+    shutdown(listener, SHUT_RDWR);
+    close(listener);
+    upstream.join();
+
+    std::vector<std::string> expected = {"GET /warm HTTP/1.1", "GET /get HTTP/1.1", "GET /get HTTP/1.1",
+                                         "POST /post HTTP/1.1"};
+    return warm.statusCode == 200 && get.statusCode == 200 && get.body == "ok" && post.statusCode == 502 &&
+           received == expected;
+}
+
+bool testHttpClient() {
+    RestApiService backend(0);
+    addBackendRoutes(backend, "backend");
+    std::atomic<int> slowCalls{0};
+    backend.addRoute("GET", "/slow", [&](const HttpRequest &req) {
+        // Only the first call stalls, so a hedge answers quickly
+        if (slowCalls.fetch_add(1) == 0 || req.query == "always") {
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        }
+        HttpResponse response;
+        response.body = "slow";
+        return response;
+    });
+    if (!backend.initialize() || !backend.start()) {
+        return false;
+    }
+    const std::string address = "127.0.0.1:" + std::to_string(backend.getPort());
+
+    HttpClientOptions options;
+    options.hedgeDelay = std::chrono::milliseconds(100);
+    HttpClient client(options);
+
+    // Keep-alive: sequential calls share one connection
+    bool sequentialOk = true;
+    for (int i = 0; i < 20; ++i) {
+        ClientRequest request;
+        request.address = address;
+        request.target = "/whoami";
+        ClientResult result = client.request(request);
+        sequentialOk = sequentialOk && result.ok() && result.response.body == "backend";
+    }
+    uint64_t openedSequential = client.connectionsOpened();
+
+    // Pipelined GETs, plus a POST that must not be pipelined
+    std::vector<ClientRequest> batch(8);
+    for (auto &request : batch) {
+        ClientRequest::fromUrl("GET", "http://" + address + "/whoami", request);
+    }
+    ClientRequest post;
+    post.method = "POST";
+    post.address = address;
+    post.target = "/echo?batch=1";
+    post.body = "payload";
+    batch.push_back(post);
+    auto futures = client.sendBatch(batch);
+    bool batchOk = true;
+    for (size_t i = 0; i < futures.size(); ++i) {
+        ClientResult result = futures[i].get();
+        std::string expected = i < 8 ? "backend" : "payload";
+        // Pipelined requests are answered on their first attempt
+        batchOk = batchOk && result.ok() && result.response.body == expected && (i >= 8 || result.attempts == 1);
+    }
+    batchOk = batchOk && client.connectionsOpened() <= openedSequential + 2;
+
+    // An upstream that closes after every response leaves the rest of a
+    // pipelined batch to fall back; that is still one attempt per request
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in closing;
+    std::memset(&closing, 0, sizeof(closing));
+    closing.sin_family = AF_INET;
+    closing.sin_addr.s_addr = inet_addr("127.0.0.1");
+    socklen_t closingLen = sizeof(closing);
+    if (bind(listener, (struct sockaddr *)&closing, sizeof(closing)) < 0 || listen(listener, 8) < 0 ||
+        getsockname(listener, (struct sockaddr *)&closing, &closingLen) < 0) {
+        close(listener);
+        backend.stop();
+        return false;
+    }
+    std::thread closingUpstream([listener] {
+        int connection;
+        while ((connection = accept(listener, nullptr, nullptr)) >= 0) {
+            struct timeval timeout = {2, 0}; // fail rather than hang
+            setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            std::string pending;
+            if (!readResponse(connection, pending).empty()) {
+                std::string reply = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\nConnection: close\r\n\r\nok";
+                send(connection, reply.data(), reply.size(), MSG_NOSIGNAL);
+            }
+            close(connection);
+        }
+    });
+    std::vector<ClientRequest> fallbackBatch(3);
+    for (auto &request : fallbackBatch) {
+        request.address = "127.0.0.1:" + std::to_string(ntohs(closing.sin_port));
+    }
+    auto fallbackFutures = client.sendBatch(fallbackBatch);
+    for (auto &future : fallbackFutures) {
+        ClientResult result = future.get();
+        batchOk = batchOk && result.ok() && result.response.body == "ok" && result.attempts == 1;
+    }
+    shutdown(listener, SHUT_RDWR);
+    close(listener);
+    closingUpstream.join();
+
+    // Hedging: the slow first attempt loses to the second
+    ClientRequest slow;
+    slow.address = address;
+    slow.target = "/slow";
+    auto hedgeStart = std::chrono::steady_clock::now();
+    ClientResult hedged = client.request(slow);
+    auto hedgeTime = std::chrono::steady_clock::now() - hedgeStart;
+    bool hedgeOk = hedged.ok() && hedged.attempts == 2 && hedgeTime < std::chrono::milliseconds(400);
+
+    // The hedge goes out even while the only worker is stuck on the first attempt
+    HttpClientOptions oneWorker = options;
+    oneWorker.workerThreads = 1;
+    {
+        HttpClient busyClient(oneWorker);
+        slowCalls.store(0);
+        hedgeStart = std::chrono::steady_clock::now();
+        ClientResult busyHedged = busyClient.request(slow);
+        hedgeTime = std::chrono::steady_clock::now() - hedgeStart;
+        hedgeOk = hedgeOk && busyHedged.ok() && busyHedged.attempts == 2 &&
+                  hedgeTime < std::chrono::milliseconds(400);
+    }
+
+    // Callback completion
+    std::promise<std::string> callbackBody;
+    ClientRequest echo = post;
+    echo.body = "callback";
+    client.send(echo, [&](ClientResult &result) {
+        callbackBody.set_value(result.ok() ? result.response.body : "error");
+    });
+    bool callbackOk = callbackBody.get_future().get() == "callback";
+
+    // Failures: deadline, connect errors (retried once, being idempotent), bad address
+    ClientRequest timedOut = slow;
+    timedOut.target = "/slow?always";
+    timedOut.timeout = std::chrono::milliseconds(150);
+    ClientResult timeoutResult = client.request(timedOut);
+    ClientRequest unreachable;
+    unreachable.address = "unix:/nonexistent/rest_api_client.sock";
+    ClientResult connectResult = client.request(unreachable);
+    ClientRequest invalid;
+    invalid.address = "no-port";
+    ClientResult invalidResult = client.request(invalid);
+    bool failuresOk = timeoutResult.error == ClientError::Timeout &&
+                      connectResult.error == ClientError::Connect && connectResult.attempts == 2 &&
+                      invalidResult.error == ClientError::InvalidRequest;
+
+    backend.stop();
+    return sequentialOk && openedSequential == 1 && batchOk && hedgeOk && callbackOk && failuresOk;
+}
+
+bool testThreadPlacement() {
+    std::vector<int> parsed = ThreadAffinity::parseCpuList("0-2,8,10-11\n");
+    if (parsed != std::vector<int>({0, 1, 2, 8, 10, 11}) ||
+        !ThreadAffinity::parseCpuList("3-1").empty()) {
+        return false;
+    }
+
+    // Workers pinned to one CPU report only that CPU from their handler
+    std::vector<int> allowed = ThreadAffinity::allowedCpus();
+    if (allowed.empty()) {
+        return false;
+    }
+    ThreadPlacement pinned;
+    pinned.cpus = {allowed.back()};
+    pinned.numaNode = 0;
+    ThreadPlacementPolicy policy = ThreadPlacementPolicy::isolateIo(1, 0);
+    policy.set(ThreadRole::Worker, pinned);
+
+    ServiceManager manager;
+    auto service = std::make_unique<RestApiService>(0);
+    RestApiService *api = service.get();
+    manager.addService(std::move(service), "api");
+    if (!manager.setThreadPlacement("api", policy) || manager.setThreadPlacement("missing", policy)) {
+        return false;
+    }
+    api->addRoute("GET", "/cpus", [](const HttpRequest &) {
+        HttpResponse response;
+        for (int cpu : ThreadAffinity::allowedCpus()) {
+            response.body += std::to_string(cpu) + ";";
+        }
+        return response;
+    });
+    if (!manager.initializeAll() || !manager.startAll()) {
+        return false;
+    }
+
+    std::string response = httpGet(api->getPort(), "/cpus");
+    // Threads already placed are not moved, and the caller is told so
+    bool lateRejected = !manager.setThreadPlacement("api", ThreadPlacementPolicy());
+    manager.clear();
+    return lateRejected && response.find("\r\n\r\n" + std::to_string(allowed.back()) + ";") != std::string::npos &&
+           response.back() == ';' && std::count(response.begin(), response.end(), ';') == 1;
+}
+
+bool testPriorityLane() {
+    RestApiService service(0);
+    std::atomic<int> slowStarted{0};
+    service.addRoute("GET", "/slow", [&](const HttpRequest &) {
+        slowStarted.fetch_add(1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(800));
+        return HttpResponse();
+    });
+    addWhoAmIRoute(service, "admin");
+    if (!service.addPriorityRoute("/whoami") || service.addPriorityRoute("whoami")) {
+        return false;
+    }
+    if (!service.initialize() || !service.start()) {
+        return false;
+    }
+    int port = service.getPort();
+
+    // More slow requests than regular workers: the queue backs up
+    std::vector<std::thread> clients;
+    for (int i = 0; i < 14; ++i) {
+        clients.emplace_back([port] { httpGet(port, "/slow"); });
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (slowStarted.load() < 10 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::string status = httpGet(port, "/api/status");
+    std::string admin = httpGet(port, "/whoami?verbose=1");
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    bool queuedBehind = slowStarted.load() <= 12; // the lane never ran /slow
+
+    for (auto &client : clients) {
+        client.join();
+    }
+    service.stop();
+
+    return status.find("HTTP/1.1 200 OK") == 0 && admin.find("\r\n\r\nadmin") != std::string::npos &&
+           elapsed < std::chrono::milliseconds(400) && queuedBehind;
+}
+
+bool testRequestCoalescing() {
+    RestApiService service(0);
+    auto coalescer = std::make_shared<RequestCoalescer>();
+    std::atomic<int> computed{0};
+    auto inventory = [&](const HttpRequest &req) {
+        int run = computed.fetch_add(1) + 1;
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        HttpResponse response;
+        response.body = req.query + "#" + std::to_string(run);
+        return response;
+    };
+    service.addRoute("GET", "/inventory", withMiddleware(inventory, CoalesceMiddleware{coalescer, {"x-tenant"}}));
+    service.setBuiltinCoalescing(true);
+    if (!service.initialize() || !service.start()) {
+        return false;
+    }
+    int port = service.getPort();
+
+    // Eight identical requests plus one for another tenant, all at once
+    std::vector<std::string> responses(9);
+    std::vector<std::thread> clients;
+    for (size_t i = 0; i < responses.size(); ++i) {
+        clients.emplace_back([&, i] {
+            std::string tenant = i == 8 ? "other" : "acme";
+            responses[i] = sendRaw(port, "GET /inventory?page=1 HTTP/1.1\r\nConnection: close\r\n"
+                                         "X-Tenant: " + tenant + "\r\n\r\n");
+        });
+    }
+    for (auto &client : clients) {
+        client.join();
+    }
+    int concurrentRuns = computed.load();
+    std::string shared = responses[0].substr(responses[0].find("\r\n\r\n") + 4);
+    bool sharedOk = shared.compare(0, 7, "page=1#") == 0;
+    for (size_t i = 1; i < 8; ++i) {
+        sharedOk = sharedOk && responses[i].find("\r\n\r\n" + shared) != std::string::npos;
+    }
+    bool tenantApart = responses[8].find("\r\n\r\n" + shared) == std::string::npos;
+
+    // Nothing is cached once the flight lands
+    std::string later = sendRaw(port, "GET /inventory?page=1 HTTP/1.1\r\nConnection: close\r\n"
+                                      "X-Tenant: acme\r\n\r\n");
+    bool fresh = later.find("#" + std::to_string(concurrentRuns + 1)) != std::string::npos;
+    bool builtinOk = httpGet(port, "/api/status").find("HTTP/1.1 200 OK") == 0;
+    service.stop();
+
+    return concurrentRuns == 2 && sharedOk && tenantApart && fresh && builtinOk &&
+           coalescer->coalescedRequests() == 7 && coalescer->inFlight() == 0;
+}
+
+// Service whose health() takes as long as it is told to
+class ProbedService : public IService {
+  public:
+    explicit ProbedService(int delayMs) : m_delayMs(delayMs) {}
+    bool initialize() override { return true; }
+    bool health() override {
+        m_probes.fetch_add(1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(m_delayMs));
+        return true;
+    }
+    bool start() override { return true; }
+    void stop() override {}
+    std::string getName() const override { return "ProbedService"; }
+    bool isRunning() const override { return true; }
+    int probes() const { return m_probes.load(); }
+
+  private:
+    int m_delayMs;
+    std::atomic<int> m_probes{0};
+};
+
+bool testHealthSummary() {
+    ServiceManager manager;
+    auto fast = std::make_unique<ProbedService>(0);
+    auto slow = std::make_unique<ProbedService>(600);
+    ProbedService *fastService = fast.get();
+    ProbedService *slowService = slow.get();
+    manager.addService(std::move(fast), "fast");
+    manager.addService(std::move(slow), "slow");
+
+    HealthCheckOptions options;
+    options.probeTimeout = std::chrono::milliseconds(150);
+    options.freshness = std::chrono::milliseconds(5000);
+    RestApiService service(0);
+    service.setServiceManager(&manager);
+    service.setHealthCheckOptions(options);
+    if (!service.initialize() || !service.start()) {
+        return false;
+    }
+    int port = service.getPort();
+
+    // The slow probe times out without holding up the answer
+    auto start = std::chrono::steady_clock::now();
+    std::string first = httpGet(port, "/api/health");
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    // Within the freshness window the fast result is cached, and the slow
+    // probe still running is not started again
+    std::string second = httpGet(port, "/api/health");
+    int fastProbes = fastService->probes();
+    int slowProbes = slowService->probes();
+
+    // Once the slow probe lands its result is served too
+    std::this_thread::sleep_for(std::chrono::milliseconds(600));
+    std::string third = httpGet(port, "/api/health");
+    service.stop();
+
+    return first.find("HTTP/1.1 503") == 0 && elapsed < std::chrono::milliseconds(400) &&
+           first.find(R"({"name": "fast","healthy": true,"state": "healthy")") != std::string::npos &&
+           first.find(R"({"name": "slow","healthy": false,"state": "timeout")") != std::string::npos &&
+           second.find(R"("slow","healthy": false,"state": "timeout")") != std::string::npos && fastProbes == 1 && slowProbes == 1 &&
+           third.find("HTTP/1.1 200 OK") == 0 && third.find(R"("healthy": true})") != std::string::npos &&
+           third.find(R"("slow","healthy": true)") != std::string::npos;
+}
+
+bool testConcurrentHealthSummary() {
+    ServiceManager manager;
+    manager.addService(std::make_unique<ProbedService>(0), "alpha");
+    manager.addService(std::make_unique<ProbedService>(0), "beta");
+    HealthCheckOptions options;
+    options.freshness = std::chrono::milliseconds(0); // probe on every request
+    RestApiService service(0);
+    service.setServiceManager(&manager);
+    service.setHealthCheckOptions(options);
+    if (!service.initialize() || !service.start()) {
+        return false;
+    }
+    int port = service.getPort();
+
+    // The very first summaries arrive at once, on different workers
+    std::atomic<int> healthy{0};
+    std::vector<std::thread> clients;
+    for (int t = 0; t < 4; ++t) {
+        clients.emplace_back([&healthy, port] {
+            for (int i = 0; i < 5; ++i) {
+                if (httpGet(port, "/api/health").find("HTTP/1.1 200 OK") == 0) {
+                    healthy.fetch_add(1);
+                }
+            }
+        });
+    }
+    for (auto &client : clients) {
+        client.join();
+    }
+
+    // Services the summaries took references to can still be removed
+    bool removed = manager.removeService("beta");
+    std::string after = httpGet(port, "/api/health");
+    service.stop();
+    return healthy.load() == 20 && removed && after.find("HTTP/1.1 200 OK") == 0 &&
+           after.find(R"("beta")") == std::string::npos;
+}
+
+// Service whose health() blocks until released, reporting its destruction
+class HungService : public IService {
+  public:
+    HungService(std::shared_ptr<std::atomic<bool>> released, std::shared_ptr<std::atomic<bool>> destroyed)
+        : m_released(std::move(released)), m_destroyed(std::move(destroyed)) {}
+    ~HungService() override { m_destroyed->store(true); }
+    bool initialize() override { return true; }
+    bool health() override {
+        while (!m_released->load()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return true;
+    }
+    bool start() override { return true; }
+    void stop() override {}
+    std::string getName() const override { return "HungService"; }
+    bool isRunning() const override { return true; }
+
+  private:
+    std::shared_ptr<std::atomic<bool>> m_released;
+    std::shared_ptr<std::atomic<bool>> m_destroyed;
+};
+
+bool testHungHealthProbe() {
+    auto released = std::make_shared<std::atomic<bool>>(false);
+    auto destroyed = std::make_shared<std::atomic<bool>>(false);
+    ServiceManager manager;
+    manager.addService(std::make_unique<HungService>(released, destroyed), "hung");
+    manager.addService(std::make_unique<ProbedService>(0), "fast");
+
+    HealthCheckOptions options;
+    options.probeTimeout = std::chrono::milliseconds(100);
+    options.freshness = std::chrono::milliseconds(5000);
+    options.probeThreads = 1;
+    RestApiService service(0);
+    service.setServiceManager(&manager);
+    service.setHealthCheckOptions(options);
+    if (!service.initialize() || !service.start()) {
+        return false;
+    }
+    int port = service.getPort();
+
+    // The hung probe gives up the only probe thread's place once past the
+    // time limit, so the other service is still probed
+    httpGet(port, "/api/health");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    std::string second = httpGet(port, "/api/health");
+    bool probedOk = second.find(R"("fast","healthy": true)") != std::string::npos &&
+                    second.find(R"("hung","healthy": false,"state": "timeout")") != std::string::npos;
+
+    // Removed while probed, the service lives until its probe returns, and
+    // stopping does not wait for that probe
+    manager.removeService("hung");
+    bool keptAlive = !destroyed->load();
+    auto stopStart = std::chrono::steady_clock::now();
+    service.stop();
+    bool stoppedQuickly = std::chrono::steady_clock::now() - stopStart < std::chrono::milliseconds(500);
+
+    released->store(true);
+    for (int i = 0; i < 100 && !destroyed->load(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return probedOk && keptAlive && stoppedQuickly && destroyed->load();
+}
+
+// Names of the ServiceInfo entries in an RPC ServiceList body
+static std::vector<std::string> rpcServiceNames(const std::string &body) {
+    std::vector<std::string> names;
+    RpcReader list(body);
+    while (list.next()) {
+        if (list.field() != RpcSchema::ServiceList::SERVICE) {
+            continue;
+        }
+        RpcReader entry(list.bytes());
+        while (entry.next()) {
+            if (entry.field() == RpcSchema::ServiceInfo::NAME) {
+                names.emplace_back(entry.bytes());
+            }
+        }
+    }
+    return names;
+}
+
+bool testBinaryRpc() {
+    ServiceManager manager;
+    manager.addService(std::make_unique<ProbedService>(0), "alpha");
+    manager.addService(std::make_unique<ProbedService>(0), "beta");
+    RestApiService service(0);
+    service.setServiceManager(&manager);
+    service.addRoute("POST", "/echo", [](const HttpRequest &req) {
+        HttpResponse response;
+        response.body = req.body;
+        return response;
+    });
+    if (!service.initialize() || !service.start()) {
+        return false;
+    }
+    int port = service.getPort();
+
+    // Several requests in one write, on the same connection as custom routes
+    std::string out(RpcSession::PREFACE, RpcSession::PREFACE_LENGTH);
+    RpcSession::Request request;
+    request.id = 7;
+    request.method = "GET";
+    request.path = "/api/services";
+    RpcSession::appendRequest(out, request);
+    request.id = 3;
+    request.path = "/api/health/alpha";
+    RpcSession::appendRequest(out, request);
+    request.id = 9;
+    request.method = "POST";
+    request.path = "/echo";
+    request.body = "ping";
+    RpcSession::appendRequest(out, request);
+    request.id = 5;
+    request.method = "GET";
+    request.path = "/api/services";
+    request.body.clear();
+    request.headers.push_back({"Accept", "application/json"});
+    RpcSession::appendRequest(out, request);
+
+    int sock = connectTo(port);
+    send(sock, out.data(), out.size(), MSG_NOSIGNAL);
+    std::map<uint32_t, RpcSession::Response> responses;
+    std::string in;
+    char buffer[4096];
+    while (responses.size() < 4) {
+        RpcSession::Response response;
+        if (RpcSession::takeResponse(in, response)) {
+            responses[response.id] = response;
+            continue;
+        }
+        ssize_t bytesRead = recv(sock, buffer, sizeof(buffer), 0);
+        if (bytesRead <= 0) {
+            break;
+        }
+        in.append(buffer, bytesRead);
+    }
+    close(sock);
+
+    bool healthy = false;
+    RpcReader health(responses[3].body);
+    while (health.next()) {
+        healthy = health.field() == RpcSchema::ServiceHealth::HEALTHY && health.integer() == 1;
+    }
+
+    // The same encoding is available over HTTP by content negotiation
+    std::string negotiated = sendRaw(port, "GET /api/services HTTP/1.1\r\nHost: localhost\r\n"
+                                           "Accept: application/x-sf-rpc\r\nConnection: close\r\n\r\n");
+    size_t bodyStart = negotiated.find("\r\n\r\n");
+
+    // A malformed frame gets a GOAWAY and the connection is closed
+    std::string bad(RpcSession::PREFACE, RpcSession::PREFACE_LENGTH);
+    bad += std::string("\0\0\0\0\x09\0\0\0\x01", RpcSession::FRAME_HEADER_LENGTH);
+    std::string goAway = sendRaw(port, bad);
+    service.stop();
+
+    std::vector<std::string> expected{"alpha", "beta"};
+    std::vector<std::string> listed = rpcServiceNames(responses[7].body);
+    std::sort(listed.begin(), listed.end());
+    std::vector<std::string> overHttp =
+        bodyStart == std::string::npos ? std::vector<std::string>() : rpcServiceNames(negotiated.substr(bodyStart + 4));
+    std::sort(overHttp.begin(), overHttp.end());
+    return responses.size() == 4 && responses[7].status == 200 && listed == expected && healthy &&
+           responses[9].status == 200 && responses[9].body == "ping" &&
+           responses[5].body.find(R"({"services": [)") == 0 &&
+           negotiated.find("Content-Type: application/x-sf-rpc") != std::string::npos && overHttp == expected &&
+           goAway.size() == RpcSession::FRAME_HEADER_LENGTH && goAway[4] == RpcSession::FRAME_GOAWAY;
+}
+
+bool testAccessLog() {
+    RestApiService service(0);
+    service.setAccessLog(AccessLogOptions());
+    addWhoAmIRoute(service, "logged");
+    if (!service.initialize() || !service.start()) {
+        return false;
+    }
+
+    // The logger drains the workers' buffers into its output
+    std::ostringstream output;
+    LoggingService logger;
+    logger.setOutput(output);
+    std::shared_ptr<AccessLog> accessLog = service.accessLog();
+    logger.addLogSource([accessLog](std::string &batch) { return accessLog->drain(batch); });
+    logger.initialize();
+    logger.start();
+
+    httpGet(service.getPort(), "/whoami");
+    httpGet(service.getPort(), "/missing");
+    service.stop();
+    logger.stop(); // final flush
+    std::string lines = output.str();
+
+    // Unsampled successes are skipped, errors are kept
+    AccessLogOptions errorsOnly;
+    errorsOnly.sampleRatio = 0.0;
+    AccessLog sampled(errorsOnly, 1);
+    bool sampling = !sampled.sample(0, 200) && sampled.sample(0, 503);
+
+    // A full buffer drops records instead of blocking the worker
+    AccessLogOptions tiny;
+    tiny.bufferRecords = 1;
+    AccessLog bounded(tiny, 1);
+    bounded.record(0, AccessLogRecord());
+    bounded.record(0, AccessLogRecord());
+    std::string batch;
+    bool boundedOk = bounded.drain(batch) == 1 && bounded.droppedRecords() == 1;
+
+    return std::count(lines.begin(), lines.end(), '\n') == 2 &&
+           lines.find("\"method\":\"GET\",\"path\":\"/whoami\",\"protocol\":\"HTTP/1.1\",\"status\":200") !=
+               std::string::npos &&
+           lines.find("\"path\":\"/missing\"") != std::string::npos &&
+           lines.find("\"status\":404") != std::string::npos &&
+           lines.find("\"queueUs\":") != std::string::npos && sampling && boundedOk;
+}
+
+#ifdef SERVICES_FRAMEWORK_TLS
+// Writes a throwaway self-signed certificate and key for localhost
+static bool writeSelfSignedCertificate(const std::string &certFile,
+                                       const std::string &keyFile) {
+    EVP_PKEY *key = EVP_EC_gen("P-256");
+    X509 *cert = X509_new();
+    if (key == nullptr || cert == nullptr) {
+        EVP_PKEY_free(key);
+        X509_free(cert);
+        return false;
+    }
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME *name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                               reinterpret_cast<const unsigned char *>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    bool ok = X509_sign(cert, key, EVP_sha256()) > 0;
+
+    FILE *certOut = fopen(certFile.c_str(), "w");
+    FILE *keyOut = fopen(keyFile.c_str(), "w");
+    ok = ok && certOut && keyOut && PEM_write_X509(certOut, cert) == 1 &&
+         PEM_write_PrivateKey(keyOut, key, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+    if (certOut) {
+        fclose(certOut);
+    }
+    if (keyOut) {
+        fclose(keyOut);
+    }
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return ok;
+}
+
+// Kernel TLS is used only with the kernel's tls module and an OpenSSL built for it
+static bool kernelTlsSupported() {
+#if defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+    return access("/proc/net/tls_stat", F_OK) == 0;
+#else
+    return false;
+#endif
+}
+
+struct TlsExchange {
+    std::string response;
+    std::string alpn;
+    bool reused = false;
+    SSL_SESSION *session = nullptr; // for the next connection, caller frees
+};
+
+// One request over a fresh TLS connection, resuming resumeFrom if given
+static TlsExchange tlsRequest(SSL_CTX *client, int port, const std::string &request,
+                              SSL_SESSION *resumeFrom) {
+    TlsExchange result;
+    int sock = connectTo(port);
+    if (sock < 0) {
+        return result;
+    }
+    SSL *ssl = SSL_new(client);
+    SSL_set_fd(ssl, sock);
+    if (resumeFrom != nullptr) {
+        SSL_set_session(ssl, resumeFrom);
+    }
+    if (SSL_connect(ssl) == 1) {
+        const unsigned char *alpn = nullptr;
+        unsigned int alpnLength = 0;
+        SSL_get0_alpn_selected(ssl, &alpn, &alpnLength);
+        result.alpn.assign(reinterpret_cast<const char *>(alpn), alpn ? alpnLength : 0);
+        result.reused = SSL_session_reused(ssl) == 1;
+
+        SSL_write(ssl, request.data(), static_cast<int>(request.size()));
+        char buffer[4096];
+        int bytesRead;
+        while ((bytesRead = SSL_read(ssl, buffer, sizeof(buffer))) > 0) {
+            result.response.append(buffer, bytesRead);
+            if (result.alpn == "h2") {
+                break; // the server's SETTINGS is all we wait for
+            }
+        }
+        // TLS 1.3 tickets arrive after the handshake, so take it last
+        result.session = SSL_get1_session(ssl);
+        // Freeing an SSL without close_notify marks its session unresumable
+        SSL_shutdown(ssl);
+    }
+    SSL_free(ssl);
+    close(sock);
+    return result;
+}
+
+bool testTls() {
+    std::string certFile = "/tmp/rest_api_test_tls_" + std::to_string(getpid()) + ".crt";
+    std::string keyFile = "/tmp/rest_api_test_tls_" + std::to_string(getpid()) + ".key";
+    if (!writeSelfSignedCertificate(certFile, keyFile)) {
+        return false;
+    }
+
+    TlsOptions options;
+    options.certificateFile = certFile;
+    options.privateKeyFile = keyFile;
+    RestApiService service(0);
+    addWhoAmIRoute(service, "secure");
+    bool enabled = service.enableTls(options);
+    TlsOptions missing = options;
+    missing.privateKeyFile = "/nonexistent.key";
+    RestApiService broken(0);
+    bool brokenEnabled = broken.enableTls(missing);
+    std::remove(certFile.c_str());
+    std::remove(keyFile.c_str());
+    if (!enabled || !service.initialize() || !service.start()) {
+        return false;
+    }
+    int port = service.getPort();
+
+    SSL_CTX *client = SSL_CTX_new(TLS_client_method());
+    SSL_CTX_set_verify(client, SSL_VERIFY_NONE, nullptr); // self-signed
+    const unsigned char http11[] = "\x08http/1.1";
+    SSL_CTX_set_alpn_protos(client, http11, sizeof(http11) - 1);
+
+    const std::string request = "GET /whoami HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+    TlsExchange first = tlsRequest(client, port, request, nullptr);
+    TlsExchange second = tlsRequest(client, port, request, first.session);
+
+    // A client preferring h2 gets it and can start with the preface
+    SSL_CTX *h2Client = SSL_CTX_new(TLS_client_method());
+    const unsigned char h2[] = "\x02h2\x08http/1.1";
+    SSL_CTX_set_alpn_protos(h2Client, h2, sizeof(h2) - 1);
+    TlsExchange third = tlsRequest(h2Client, port,
+                                   std::string("PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n") + http2Frame(0x4, 0, 0, ""),
+                                   nullptr);
+
+    // Plaintext to a TLS port fails the handshake instead of being served
+    std::string plain = httpGet(port, "/whoami");
+    uint64_t kernelTls = service.kernelTlsConnections();
+    service.stop();
+
+    SSL_SESSION_free(first.session);
+    SSL_SESSION_free(second.session);
+    SSL_SESSION_free(third.session);
+    SSL_CTX_free(client);
+    SSL_CTX_free(h2Client);
+
+    return !brokenEnabled && first.alpn == "http/1.1" && !first.reused &&
+           first.response.find("HTTP/1.1 200 OK") == 0 &&
+           first.response.find("\r\n\r\nsecure") != std::string::npos &&
+           second.reused && second.response.find("\r\n\r\nsecure") != std::string::npos &&
+           third.alpn == "h2" && third.response.size() >= 9 && third.response[3] == 0x4 &&
+           plain.find("HTTP/1.1 200") == std::string::npos &&
+           (kernelTlsSupported() ? kernelTls > 0 : kernelTls == 0);
+}
+#endif
+
+int main() {
+    std::cout << "REST API Service Tests" << std::endl;
+    std::cout << "======================" << std::endl;
+
+    TestRunner::runTest("Basic Request", testBasicRequest);
+    TestRunner::runTest("Unix Listeners", testUnixListeners);
+    TestRunner::runTest("Keep-Alive And Pipelining", testKeepAliveAndPipelining);
+    TestRunner::runTest("Connection Deadlines", testConnectionDeadlines);
+    TestRunner::runTest("Hot Upgrade Handoff", testHotUpgradeHandoff);
+    TestRunner::runTest("HPACK", testHpack);
+    TestRunner::runTest("HTTP/2 Multiplexing", testHttp2Multiplexing);
+    TestRunner::runTest("Tracing", testTracing);
+    TestRunner::runTest("Static Routes", testStaticRoutes);
+    TestRunner::runTest("Middleware", testMiddleware);
+    TestRunner::runTest("Reverse Proxy", testReverseProxy);
+    TestRunner::runTest("Stale Upstream Retry", testStaleUpstreamRetry);
+    TestRunner::runTest("HTTP Client", testHttpClient);
+    TestRunner::runTest("Thread Placement", testThreadPlacement);
+    TestRunner::runTest("Priority Lane", testPriorityLane);
+    TestRunner::runTest("Request Coalescing", testRequestCoalescing);
+    TestRunner::runTest("Health Summary", testHealthSummary);
+    TestRunner::runTest("Concurrent Health Summary", testConcurrentHealthSummary);
+    TestRunner::runTest("Hung Health Probe", testHungHealthProbe);
+    TestRunner::runTest("Binary RPC", testBinaryRpc);
+    TestRunner::runTest("Access Log", testAccessLog);
+#ifdef SERVICES_FRAMEWORK_TLS
+    TestRunner::runTest("TLS", testTls);
+#endif
+
+    TestRunner::printResults();
+
+    return TestRunner::allTestsPassed() ? 0 : 1;
+}
@@ -1,10 +1,26 @@
 #include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
 #include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <algorithm>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <cstring>
+#include <cstdlib>
+#include <cstddef>
+#include <cerrno>
+#include "latency_histogram.h"
+
+using ServiceFramework::LatencyHistogram;
 
 class SimpleHttpClient {
 public:
@@ -84,7 +100,7 @@ void testEndpoint(const std::string& method, const std::string& path,
     std::cout << "Response: " << responseBody << std::endl;
 }
 
-int main() {
+int runSmokeTests() {
     std::cout << "=== REST API Test Client ===" << std::endl;
     std::cout << "Make sure the REST API demo is running on port 8080" << std::endl;
     
@@ -111,3 +127,638 @@ int main() {
     std::cout << "\n=== Test completed ===" << std::endl;
     return 0;
 }
+
+// ---------------------------------------------------------------------------
+// Load generation
+// ---------------------------------------------------------------------------
+
+using Clock = std::chrono::steady_clock;
+
+struct LoadOptions {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    std::string unixPath;          // connect over a Unix socket when set
+    int connections = 10;
+    double durationSeconds = 10;
+    double warmupSeconds = 0;
+    double rate = 0;               // total requests/second; 0 = closed loop
+    bool keepAlive = true;
+    int timeoutMs = 5000;
+    std::string mixFile;
+    std::string method = "GET";
+    std::string path = "/api/status";
+    std::string body;
+    unsigned seed = 1;
+    bool json = false;
+};
+
+/**
+ * @brief One entry of the request mix, with its wire form prebuilt
+ */
+struct RequestSpec {
+    int weight = 1;
+    std::string method;
+    std::string path;
+    std::string body;
+    std::string wire;
+};
+
+/**
+ * @brief Per-connection counters, merged once the run ends
+ */
+struct WorkerStats {
+    LatencyHistogram latency;
+    int64_t requests = 0;     // completed inside the measurement window
+    int64_t bytesRead = 0;
+    int64_t status[6] = {0};  // by first digit, 1xx-5xx
+    int64_t connectErrors = 0;
+    int64_t writeErrors = 0;
+    int64_t readErrors = 0;
+    int64_t timeouts = 0;
+    int64_t reconnects = 0;
+
+    void add(const WorkerStats& other) {
+        latency.add(other.latency);
+        requests += other.requests;
+        bytesRead += other.bytesRead;
+        for (int i = 0; i < 6; ++i) {
+            status[i] += other.status[i];
+        }
+        connectErrors += other.connectErrors;
+        writeErrors += other.writeErrors;
+        readErrors += other.readErrors;
+        timeouts += other.timeouts;
+        reconnects += other.reconnects;
+    }
+};
+
+std::string buildWireRequest(const RequestSpec& spec, const LoadOptions& options) {
+    std::string request = spec.method + " " + spec.path + " HTTP/1.1\r\n";
+    if (options.unixPath.empty()) {
+        request += "Host: " + options.host + ":" + std::to_string(options.port) + "\r\n";
+    } else {
+        request += "Host: localhost\r\n";
+    }
+    if (!options.keepAlive) {
+        request += "Connection: close\r\n";
+    }
+    if (!spec.body.empty() || spec.method == "POST" || spec.method == "PUT") {
+        request += "Content-Length: " + std::to_string(spec.body.size()) + "\r\n";
+        request += "Content-Type: application/json\r\n";
+    }
+    request += "\r\n";
+    request += spec.body;
+    return request;
+}
+
+/**
+ * @brief Load a request mix file
+ *
+ * One request per line: "weight METHOD PATH [BODY]", where BODY is the rest
+ * of the line. Blank lines and lines starting with '#' are ignored.
+ */
+bool loadMixFile(const std::string& fileName, std::vector<RequestSpec>& mix) {
+    std::ifstream file(fileName);
+    if (!file) {
+        std::cerr << "Cannot open mix file '" << fileName << "'" << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') {
+            continue;
+        }
+
+        std::istringstream fields(line);
+        RequestSpec spec;
+        if (!(fields >> spec.weight >> spec.method >> spec.path) || spec.weight <= 0 ||
+            spec.path.empty() || spec.path[0] != '/') {
+            std::cerr << fileName << ":" << lineNumber
+                      << ": expected 'weight METHOD PATH [BODY]'" << std::endl;
+            return false;
+        }
+        std::getline(fields >> std::ws, spec.body);
+        if (!spec.body.empty() && spec.body.back() == '\r') {
+            spec.body.pop_back();
+        }
+        mix.push_back(spec);
+    }
+
+    if (mix.empty()) {
+        std::cerr << "Mix file '" << fileName << "' has no requests" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Blocking keep-alive HTTP/1.1 connection for the load generator
+ */
+class LoadConnection {
+public:
+    enum class Result { Ok, Closed, Timeout, Error };
+
+    ~LoadConnection() { disconnect(); }
+
+    bool isConnected() const { return m_socket >= 0; }
+
+    bool connectTo(const LoadOptions& options) {
+        disconnect();
+        if (options.unixPath.empty()) {
+            struct sockaddr_in server;
+            std::memset(&server, 0, sizeof(server));
+            server.sin_family = AF_INET;
+            server.sin_port = htons(options.port);
+            if (inet_pton(AF_INET, options.host.c_str(), &server.sin_addr) != 1) {
+                return false;
+            }
+            m_socket = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (m_socket < 0) {
+                return false;
+            }
+            int noDelay = 1;
+            setsockopt(m_socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+            setTimeouts(options.timeoutMs);
+            if (connect(m_socket, (struct sockaddr*)&server, sizeof(server)) < 0) {
+                disconnect();
+                return false;
+            }
+        } else {
+            struct sockaddr_un server;
+            std::memset(&server, 0, sizeof(server));
+            server.sun_family = AF_UNIX;
+            if (options.unixPath.size() >= sizeof(server.sun_path)) {
+                return false;
+            }
+            std::memcpy(server.sun_path, options.unixPath.c_str(), options.unixPath.size());
+            socklen_t length = sizeof(server);
+            if (server.sun_path[0] == '@') {
+                // Abstract namespace, as accepted by addUnixListener()
+                server.sun_path[0] = '\0';
+                length = offsetof(struct sockaddr_un, sun_path) + options.unixPath.size();
+            }
+            m_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (m_socket < 0) {
+                return false;
+            }
+            setTimeouts(options.timeoutMs);
+            if (connect(m_socket, (struct sockaddr*)&server, length) < 0) {
+                disconnect();
+                return false;
+            }
+        }
+        m_buffer.clear();
+        return true;
+    }
+
+    void disconnect() {
+        if (m_socket >= 0) {
+            close(m_socket);
+            m_socket = -1;
+        }
+    }
+
+    bool sendAll(const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t result = send(m_socket, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (result <= 0) {
+                return false;
+            }
+            sent += static_cast<size_t>(result);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Read one complete response
+     * @param status Receives the status code
+     * @param serverClose Set when the server will close after this response
+     * @param bytes Receives the size of the response on the wire
+     */
+    Result readResponse(int& status, bool& serverClose, size_t& bytes) {
+        size_t headerEnd;
+        while ((headerEnd = m_buffer.find("\r\n\r\n")) == std::string::npos) {
+            Result result = fill();
+            if (result != Result::Ok) {
+                return result;
+            }
+        }
+
+        // "HTTP/1.1 200 OK"
+        status = 0;
+        size_t space = m_buffer.find(' ');
+        if (space != std::string::npos && space < headerEnd) {
+            status = std::atoi(m_buffer.c_str() + space + 1);
+        }
+
+        std::string headers = m_buffer.substr(0, headerEnd);
+        std::transform(headers.begin(), headers.end(), headers.begin(), ::tolower);
+        serverClose = headers.find("\r\nconnection: close") != std::string::npos ||
+                      headers.compare(0, 8, "http/1.0") == 0;
+
+        size_t bodyStart = headerEnd + 4;
+        size_t lengthPos = headers.find("\r\ncontent-length:");
+        if (lengthPos == std::string::npos) {
+            // Delimited by connection close
+            Result result;
+            while ((result = fill()) == Result::Ok) {
+            }
+            if (result != Result::Closed) {
+                return result;
+            }
+            bytes = m_buffer.size();
+            m_buffer.clear();
+            serverClose = true;
+            return Result::Ok;
+        }
+
+        size_t contentLength = std::strtoul(headers.c_str() + lengthPos + 17, nullptr, 10);
+        while (m_buffer.size() < bodyStart + contentLength) {
+            Result result = fill();
+            if (result != Result::Ok) {
+                return result == Result::Closed ? Result::Error : result;
+            }
+        }
+
+        // Anything past this response is the start of the next one
+        bytes = bodyStart + contentLength;
+        m_buffer.erase(0, bytes);
+        return Result::Ok;
+    }
+
+private:
+    void setTimeouts(int timeoutMs) {
+        struct timeval timeout;
+        timeout.tv_sec = timeoutMs / 1000;
+        timeout.tv_usec = (timeoutMs % 1000) * 1000;
+        setsockopt(m_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(m_socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    }
+
+    Result fill() {
+        char buffer[16384];
+        ssize_t bytesRead = recv(m_socket, buffer, sizeof(buffer), 0);
+        if (bytesRead > 0) {
+            m_buffer.append(buffer, static_cast<size_t>(bytesRead));
+            return Result::Ok;
+        }
+        if (bytesRead == 0) {
+            return Result::Closed;
+        }
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? Result::Timeout : Result::Error;
+    }
+
+    int m_socket = -1;
+    std::string m_buffer;
+};
+
+/**
+ * @brief Drive one connection until the run ends
+ *
+ * Closed loop (rate 0) sends the next request as soon as the previous
+ * response arrives. Open loop sends on a fixed schedule and measures each
+ * latency from the request's intended send time rather than from when it was
+ * actually sent, so a stalled server is charged for every request it delayed
+ * (no coordinated omission).
+ */
+void runConnection(const LoadOptions& options, const std::vector<RequestSpec>& mix,
+                   int index, Clock::time_point start, Clock::time_point measureStart,
+                   Clock::time_point end, WorkerStats& stats) {
+    std::mt19937 random(options.seed + static_cast<unsigned>(index));
+    std::vector<int> cumulative;
+    int totalWeight = 0;
+    for (const auto& spec : mix) {
+        totalWeight += spec.weight;
+        cumulative.push_back(totalWeight);
+    }
+    std::uniform_int_distribution<int> pick(1, totalWeight);
+
+    // Each connection carries rate/connections, staggered across the interval
+    Clock::duration interval(0);
+    Clock::time_point next = start;
+    if (options.rate > 0) {
+        interval = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(options.connections / options.rate));
+        next += interval * index / options.connections;
+    }
+
+    // Connect before the start time so setup is not measured
+    LoadConnection connection;
+    if (!connection.connectTo(options)) {
+        ++stats.connectErrors;
+    }
+    std::this_thread::sleep_until(start);
+
+    while (true) {
+        Clock::time_point intended;
+        if (options.rate > 0) {
+            intended = next;
+            next += interval;
+            if (intended >= end) {
+                break;
+            }
+            std::this_thread::sleep_until(intended);
+        } else {
+            intended = Clock::now();
+            if (intended >= end) {
+                break;
+            }
+        }
+        bool measured = intended >= measureStart;
+
+        if (!connection.isConnected()) {
+            if (!connection.connectTo(options)) {
+                ++stats.connectErrors;
+                if (options.rate <= 0) {
+                    // Back off rather than spin against a refusing server
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                }
+                continue;
+            }
+            ++stats.reconnects;
+        }
+
+        const RequestSpec* spec = &mix[0];
+        if (mix.size() > 1) {
+            int roll = pick(random);
+            spec = &mix[std::lower_bound(cumulative.begin(), cumulative.end(), roll) -
+                        cumulative.begin()];
+        }
+
+        if (!connection.sendAll(spec->wire)) {
+            ++stats.writeErrors;
+            connection.disconnect();
+            continue;
+        }
+
+        int status = 0;
+        bool serverClose = false;
+        size_t bytes = 0;
+        LoadConnection::Result result = connection.readResponse(status, serverClose, bytes);
+        Clock::time_point done = Clock::now();
+
+        if (result != LoadConnection::Result::Ok) {
+            if (result == LoadConnection::Result::Timeout) {
+                ++stats.timeouts;
+            } else {
+                ++stats.readErrors;
+            }
+            connection.disconnect();
+            continue;
+        }
+
+        if (measured) {
+            stats.latency.record(
+                std::chrono::duration_cast<std::chrono::microseconds>(done - intended).count());
+            ++stats.requests;
+            stats.bytesRead += static_cast<int64_t>(bytes);
+            if (status >= 100 && status < 600) {
+                ++stats.status[status / 100];
+            }
+        }
+
+        if (!options.keepAlive || serverClose) {
+            connection.disconnect();
+        }
+    }
+}
+
+void printHumanReport(const LoadOptions& options, const WorkerStats& total, double seconds) {
+    const double percentiles[] = {50, 75, 90, 99, 99.9, 99.99, 100};
+    const LatencyHistogram& latency = total.latency;
+
+    std::cout << "=== Load Test Results ===" << std::endl;
+    std::cout << "Target:       "
+              << (options.unixPath.empty() ? options.host + ":" + std::to_string(options.port)
+                                           : "unix:" + options.unixPath)
+              << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    if (options.rate > 0) {
+        std::cout << "Mode:         open loop, " << options.rate << " req/s" << std::endl;
+    } else {
+        std::cout << "Mode:         closed loop" << std::endl;
+    }
+    std::cout << "Connections:  " << options.connections
+              << (options.keepAlive ? " (keep-alive)" : " (new connection per request)") << std::endl;
+    std::cout << "Duration:     " << seconds << " s measured, "
+              << options.warmupSeconds << " s warmup" << std::endl;
+    std::cout << "Requests:     " << total.requests << " ("
+              << (seconds > 0 ? total.requests / seconds : 0.0) << " req/s, "
+              << (seconds > 0 ? total.bytesRead / seconds / 1024.0 : 0.0) << " KiB/s)" << std::endl;
+    std::cout << "Responses:    1xx=" << total.status[1] << " 2xx=" << total.status[2]
+              << " 3xx=" << total.status[3] << " 4xx=" << total.status[4]
+              << " 5xx=" << total.status[5] << std::endl;
+    std::cout << "Errors:       connect=" << total.connectErrors << " write=" << total.writeErrors
+              << " read=" << total.readErrors << " timeout=" << total.timeouts
+              << " (reconnects=" << total.reconnects << ")" << std::endl;
+
+    std::cout << std::setprecision(3);
+    std::cout << "Latency (ms): min=" << latency.min() / 1000.0
+              << " mean=" << latency.mean() / 1000.0
+              << " stddev=" << latency.stddev() / 1000.0
+              << " max=" << latency.max() / 1000.0 << std::endl;
+    std::cout << "Percentiles (ms):" << std::endl;
+    for (double percentile : percentiles) {
+        std::cout << "  " << std::setw(8) << percentile << "%  "
+                  << std::setw(10) << latency.valueAtPercentile(percentile) / 1000.0 << std::endl;
+    }
+}
+
+void printJsonReport(const LoadOptions& options, const WorkerStats& total, double seconds) {
+    const double percentiles[] = {50, 75, 90, 99, 99.9, 99.99, 100};
+    const LatencyHistogram& latency = total.latency;
+
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(3);
+    json << "{";
+    if (options.unixPath.empty()) {
+        json << "\"target\": \"" << options.host << ":" << options.port << "\", ";
+    } else {
+        json << "\"target\": \"unix:" << options.unixPath << "\", ";
+    }
+    json << "\"mode\": \"" << (options.rate > 0 ? "open" : "closed") << "\", ";
+    json << "\"rate\": " << options.rate << ", ";
+    json << "\"connections\": " << options.connections << ", ";
+    json << "\"keep_alive\": " << (options.keepAlive ? "true" : "false") << ", ";
+    json << "\"duration_seconds\": " << seconds << ", ";
+    json << "\"warmup_seconds\": " << options.warmupSeconds << ", ";
+    json << "\"requests\": " << total.requests << ", ";
+    json << "\"requests_per_second\": " << (seconds > 0 ? total.requests / seconds : 0.0) << ", ";
+    json << "\"bytes_read\": " << total.bytesRead << ", ";
+    json << "\"status\": {\"1xx\": " << total.status[1] << ", \"2xx\": " << total.status[2]
+         << ", \"3xx\": " << total.status[3] << ", \"4xx\": " << total.status[4]
+         << ", \"5xx\": " << total.status[5] << "}, ";
+    json << "\"errors\": {\"connect\": " << total.connectErrors
+         << ", \"write\": " << total.writeErrors << ", \"read\": " << total.readErrors
+         << ", \"timeout\": " << total.timeouts << "}, ";
+    json << "\"reconnects\": " << total.reconnects << ", ";
+    json << "\"latency_us\": {\"min\": " << latency.min() << ", \"mean\": " << latency.mean()
+         << ", \"stddev\": " << latency.stddev() << ", \"max\": " << latency.max()
+         << ", \"percentiles\": {";
+    bool first = true;
+    for (double percentile : percentiles) {
+        if (!first) {
+            json << ", ";
+        }
+        first = false;
+        std::ostringstream key;
+        key << percentile;
+        json << "\"" << key.str() << "\": " << latency.valueAtPercentile(percentile);
+    }
+    json << "}}}";
+
+    std::cout << json.str() << std::endl;
+}
+
+int runLoadTest(const LoadOptions& options) {
+    std::vector<RequestSpec> mix;
+    if (!options.mixFile.empty()) {
+        if (!loadMixFile(options.mixFile, mix)) {
+            return 1;
+        }
+    } else {
+        RequestSpec spec;
+        spec.method = options.method;
+        spec.path = options.path;
+        spec.body = options.body;
+        mix.push_back(spec);
+    }
+    for (auto& spec : mix) {
+        spec.wire = buildWireRequest(spec, options);
+    }
+
+    if (!options.json) {
+        std::cout << "Running " << options.durationSeconds << "s load test with "
+                  << options.connections << " connection(s)..." << std::endl;
+    }
+
+    // Give every thread time to connect before the clock starts
+    Clock::time_point start = Clock::now() + std::chrono::milliseconds(200);
+    Clock::time_point measureStart = start + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(options.warmupSeconds));
+    Clock::time_point end = measureStart + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(options.durationSeconds));
+
+    std::vector<WorkerStats> stats(static_cast<size_t>(options.connections));
+    std::vector<std::thread> threads;
+    threads.reserve(stats.size());
+    for (int i = 0; i < options.connections; ++i) {
+        threads.emplace_back(runConnection, std::cref(options), std::cref(mix), i,
+                             start, measureStart, end, std::ref(stats[i]));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    WorkerStats total;
+    for (const auto& workerStats : stats) {
+        total.add(workerStats);
+    }
+
+    double seconds = options.durationSeconds;
+    if (options.json) {
+        printJsonReport(options, total, seconds);
+    } else {
+        printHumanReport(options, total, seconds);
+    }
+    return 0;
+}
+
+void printUsage(const char* program) {
+    std::cout << "Usage:" << std::endl;
+    std::cout << "  " << program << "                 Run the endpoint smoke tests against port 8080" << std::endl;
+    std::cout << "  " << program << " --load [options] Generate load and report latency percentiles" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Load options:" << std::endl;
+    std::cout << "  --host ADDR         IPv4 address of the server (default 127.0.0.1)" << std::endl;
+    std::cout << "  --port N            Server port (default 8080)" << std::endl;
+    std::cout << "  --unix PATH         Connect to a Unix socket instead ('@name' = abstract)" << std::endl;
+    std::cout << "  --connections N     Concurrent connections, one thread each (default 10)" << std::endl;
+    std::cout << "  --duration SECS     Measured duration (default 10)" << std::endl;
+    std::cout << "  --warmup SECS       Unmeasured warmup before the run (default 0)" << std::endl;
+    std::cout << "  --rate N            Open loop at N requests/second in total (default: closed loop)" << std::endl;
+    std::cout << "  --no-keepalive      Open a new connection for every request" << std::endl;
+    std::cout << "  --timeout MS        Per-request socket timeout (default 5000)" << std::endl;
+    std::cout << "  --method M          Request method (default GET)" << std::endl;
+    std::cout << "  --path P            Request path (default /api/status)" << std::endl;
+    std::cout << "  --body B            Request body" << std::endl;
+    std::cout << "  --mix FILE          Weighted request mix, lines of 'weight METHOD PATH [BODY]'" << std::endl;
+    std::cout << "  --seed N            Seed for request mix selection (default 1)" << std::endl;
+    std::cout << "  --json              Print the report as JSON" << std::endl;
+}
+
+bool parseLoadOptions(int argc, char* argv[], LoadOptions& options) {
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--no-keepalive") {
+            options.keepAlive = false;
+        } else if (arg == "--json") {
+            options.json = true;
+        } else if (!hasValue) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return false;
+        } else if (arg == "--host") {
+            options.host = argv[++i];
+        } else if (arg == "--port") {
+            options.port = std::atoi(argv[++i]);
+        } else if (arg == "--unix") {
+            options.unixPath = argv[++i];
+        } else if (arg == "--connections") {
+            options.connections = std::atoi(argv[++i]);
+        } else if (arg == "--duration") {
+            options.durationSeconds = std::atof(argv[++i]);
+        } else if (arg == "--warmup") {
+            options.warmupSeconds = std::atof(argv[++i]);
+        } else if (arg == "--rate") {
+            options.rate = std::atof(argv[++i]);
+        } else if (arg == "--timeout") {
+            options.timeoutMs = std::atoi(argv[++i]);
+        } else if (arg == "--method") {
+            options.method = argv[++i];
+        } else if (arg == "--path") {
+            options.path = argv[++i];
+        } else if (arg == "--body") {
+            options.body = argv[++i];
+        } else if (arg == "--mix") {
+            options.mixFile = argv[++i];
+        } else if (arg == "--seed") {
+            options.seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return false;
+        }
+    }
+
+    if (options.connections <= 0 || options.durationSeconds <= 0 || options.warmupSeconds < 0 ||
+        options.rate < 0 || options.timeoutMs <= 0 || options.port <= 0 || options.port > 65535) {
+        std::cerr << "Invalid load options" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        return runSmokeTests();
+    }
+
+    std::string mode = argv[1];
+    if (mode == "--load") {
+        LoadOptions options;
+        if (!parseLoadOptions(argc, argv, options)) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        return runLoadTest(options);
+    }
+
+    printUsage(argv[0]);
+    return mode == "--help" || mode == "-h" ? 0 : 1;
+}
@@ -0,0 +1,141 @@
+#include "timer_wheel.h"
+#include <algorithm>
+
+namespace ServiceFramework {
+
+TimerWheel::TimerWheel(std::chrono::milliseconds tick)
+    : m_tick(tick.count() > 0 ? tick : std::chrono::milliseconds(1)), m_start(Clock::now()) {
+    for (auto& level : m_slots) {
+        for (auto& sentinel : level) {
+            sentinel.prev = &sentinel;
+            sentinel.next = &sentinel;
+        }
+    }
+}
+
+TimerWheel::~TimerWheel() {
+    // Leave no dangling pointers into the wheel in timers that outlive it
+    for (auto& level : m_slots) {
+        for (auto& sentinel : level) {
+            while (sentinel.next != &sentinel) {
+                unlink(*sentinel.next);
+            }
+        }
+    }
+}
+
+void TimerWheel::schedule(Timer& timer, Clock::time_point deadline) {
+    cancel(timer);
+
+    // Round up so a timer never fires before its deadline
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - m_start);
+    int64_t ticks = elapsed.count() <= 0 ? 0 : (elapsed.count() + m_tick.count() - 1) / m_tick.count();
+    timer.expiry = std::max<uint64_t>(static_cast<uint64_t>(ticks), m_currentTick + 1);
+
+    insert(timer);
+    ++m_size;
+}
+
+void TimerWheel::cancel(Timer& timer) {
+    if (!timer.isArmed()) {
+        return;
+    }
+    unlink(timer);
+    --m_size;
+}
+
+void TimerWheel::advance(Clock::time_point now, std::vector<Timer*>& expired) {
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_start);
+    if (elapsed.count() <= 0) {
+        return;
+    }
+    uint64_t target = static_cast<uint64_t>(elapsed.count() / m_tick.count());
+
+    while (m_currentTick < target) {
+        ++m_currentTick;
+
+        // Refill the lower levels whenever one wraps around
+        uint64_t index = m_currentTick & SLOT_MASK;
+        for (int level = 1; index == 0 && level < LEVELS; ++level) {
+            cascade(level);
+            index = (m_currentTick >> (level * SLOT_BITS)) & SLOT_MASK;
+        }
+
+        Timer& sentinel = m_slots[0][m_currentTick & SLOT_MASK];
+        while (sentinel.next != &sentinel) {
+            Timer* timer = sentinel.next;
+            unlink(*timer);
+            --m_size;
+            expired.push_back(timer);
+        }
+    }
+}
+
+int TimerWheel::millisecondsUntilNextTick(Clock::time_point now) const {
+    if (m_size == 0) {
+        return -1;
+    }
+
+    // Next occupied level-0 slot, or the next cascade if level 0 is empty
+    uint64_t nextTick = (m_currentTick | SLOT_MASK) + 1;
+    for (uint64_t tick = m_currentTick + 1; tick < nextTick; ++tick) {
+        const Timer& sentinel = m_slots[0][tick & SLOT_MASK];
+        if (sentinel.next != &sentinel) {
+            nextTick = tick;
+            break;
+        }
+    }
+
+    auto due = m_start + m_tick * static_cast<int64_t>(nextTick);
+    auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(due - now);
+    return wait.count() <= 0 ? 0 : static_cast<int>(wait.count()) + 1;
+}
+
+void TimerWheel::insert(Timer& timer) {
+    uint64_t delta = timer.expiry > m_currentTick ? timer.expiry - m_currentTick : 0;
+
+    int level = 0;
+    while (level < LEVELS - 1 && delta >= (uint64_t(1) << ((level + 1) * SLOT_BITS))) {
+        ++level;
+    }
+
+    // Beyond the top level's range the timer fires at the range limit
+    uint64_t maxDelta = (uint64_t(1) << (LEVELS * SLOT_BITS)) - 1;
+    if (delta > maxDelta) {
+        timer.expiry = m_currentTick + maxDelta;
+    }
+
+    Timer& sentinel = m_slots[level][(timer.expiry >> (level * SLOT_BITS)) & SLOT_MASK];
+    timer.next = &sentinel;
+    timer.prev = sentinel.prev;
+    sentinel.prev->next = &timer;
+    sentinel.prev = &timer;
+}
+
+void TimerWheel::cascade(int level) {
+    Timer& sentinel = m_slots[level][(m_currentTick >> (level * SLOT_BITS)) & SLOT_MASK];
+    if (sentinel.next == &sentinel) {
+        return;
+    }
+
+    // Detach the whole slot, then re-file each timer closer to expiry
+    Timer* timer = sentinel.next;
+    sentinel.prev->next = nullptr;
+    sentinel.prev = &sentinel;
+    sentinel.next = &sentinel;
+
+    while (timer != nullptr) {
+        Timer* next = timer->next;
+        insert(*timer);
+        timer = next;
+    }
+}
+
+void TimerWheel::unlink(Timer& timer) {
+    timer.prev->next = timer.next;
+    timer.next->prev = timer.prev;
+    timer.prev = nullptr;
+    timer.next = nullptr;
+}
+
+} // namespace ServiceFramework
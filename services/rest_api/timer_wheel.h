@@ -0,0 +1,89 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ServiceFramework {
+
+/**
+ * @brief Hierarchical timing wheel for connection deadlines
+ *
+ * Four levels of 64 slots each. Timers are intrusive, so arming and
+ * cancelling are O(1) with no allocation; expiry costs amortized O(1) per
+ * timer as it cascades down the levels. Not thread-safe: owned by the
+ * I/O loop.
+ */
+class TimerWheel {
+public:
+    /**
+     * @brief Intrusive timer node, embedded in the object it times out
+     */
+    struct Timer {
+        Timer* prev = nullptr;
+        Timer* next = nullptr;
+        uint64_t expiry = 0;     // in ticks
+        void* context = nullptr; // owner, for the expiry handler
+        int kind = 0;            // owner-defined deadline type
+
+        bool isArmed() const { return next != nullptr; }
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    explicit TimerWheel(std::chrono::milliseconds tick = std::chrono::milliseconds(10));
+    ~TimerWheel();
+
+    // Prevent copying (slot lists point into the wheel)
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    /**
+     * @brief Arm (or re-arm) a timer
+     * @param timer Timer node to arm
+     * @param deadline Time at which the timer should expire
+     */
+    void schedule(Timer& timer, Clock::time_point deadline);
+
+    /**
+     * @brief Disarm a timer; no-op if it is not armed
+     */
+    void cancel(Timer& timer);
+
+    /**
+     * @brief Advance the wheel and collect every timer due by now
+     * @param now Current time
+     * @param expired Receives expired (already disarmed) timers
+     */
+    void advance(Clock::time_point now, std::vector<Timer*>& expired);
+
+    /**
+     * @brief Time until the wheel next needs to advance
+     * @return Milliseconds to wait, -1 if no timers are armed
+     */
+    int millisecondsUntilNextTick(Clock::time_point now) const;
+
+    /**
+     * @brief Number of armed timers
+     */
+    size_t size() const { return m_size; }
+
+private:
+    static const int LEVELS = 4;
+    static const int SLOT_BITS = 6;
+    static const int SLOTS = 1 << SLOT_BITS;
+    static const uint64_t SLOT_MASK = SLOTS - 1;
+
+    void insert(Timer& timer);
+    void cascade(int level);
+    static void unlink(Timer& timer);
+
+    std::chrono::milliseconds m_tick;
+    Clock::time_point m_start;
+    uint64_t m_currentTick = 0;
+    size_t m_size = 0;
+    Timer m_slots[LEVELS][SLOTS]; // sentinels of circular lists
+};
+
+} // namespace ServiceFramework
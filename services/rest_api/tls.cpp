@@ -0,0 +1,253 @@
+#include "tls.h"
+#include <cerrno>
+
+#ifdef SERVICES_FRAMEWORK_TLS
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#endif
+
+namespace ServiceFramework {
+
+#ifdef SERVICES_FRAMEWORK_TLS
+
+namespace {
+
+const unsigned char SESSION_ID_CONTEXT[] = "ServiceFramework-REST";
+
+std::string lastError(const char* what) {
+    char buffer[256];
+    unsigned long code = ERR_get_error();
+    if (code == 0) {
+        return what;
+    }
+    ERR_error_string_n(code, buffer, sizeof(buffer));
+    ERR_clear_error();
+    return std::string(what) + ": " + buffer;
+}
+
+// Picks the first protocol of ours the client also offered
+int selectAlpn(SSL* ssl, const unsigned char** out, unsigned char* outLength, const unsigned char* in,
+               unsigned int inLength, void* arg) {
+    (void)ssl;
+    const auto* wire = static_cast<const std::vector<unsigned char>*>(arg);
+    unsigned char* selected = nullptr;
+    if (SSL_select_next_proto(&selected, outLength, wire->data(), static_cast<unsigned int>(wire->size()), in,
+                              inLength) != OPENSSL_NPN_NEGOTIATED) {
+        return SSL_TLSEXT_ERR_NOACK; // carry on without ALPN
+    }
+    *out = selected;
+    return SSL_TLSEXT_ERR_OK;
+}
+
+} // namespace
+
+bool TlsContext::available() {
+    return true;
+}
+
+std::unique_ptr<TlsContext> TlsContext::create(const TlsOptions& options, std::string& error) {
+    std::vector<unsigned char> alpnWire;
+    for (const auto& protocol : options.alpn) {
+        if (protocol.empty() || protocol.size() > 255) {
+            error = "Invalid ALPN protocol '" + protocol + "'";
+            return nullptr;
+        }
+        alpnWire.push_back(static_cast<unsigned char>(protocol.size()));
+        alpnWire.insert(alpnWire.end(), protocol.begin(), protocol.end());
+    }
+
+    ERR_clear_error();
+    SSL_CTX* context = SSL_CTX_new(TLS_server_method());
+    if (context == nullptr) {
+        error = lastError("Failed to create TLS context");
+        return nullptr;
+    }
+
+    SSL_CTX_set_min_proto_version(context, TLS1_2_VERSION);
+    // Writes resume from a moving offset into the connection's output
+    SSL_CTX_set_mode(context, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
+    if (SSL_CTX_use_certificate_chain_file(context, options.certificateFile.c_str()) != 1 ||
+        SSL_CTX_use_PrivateKey_file(context, options.privateKeyFile.c_str(), SSL_FILETYPE_PEM) != 1 ||
+        SSL_CTX_check_private_key(context) != 1) {
+        error = lastError("Failed to load TLS certificate or key");
+        SSL_CTX_free(context);
+        return nullptr;
+    }
+
+    // Resumption skips the key exchange and certificate on reconnects
+    SSL_CTX_set_session_id_context(context, SESSION_ID_CONTEXT, sizeof(SESSION_ID_CONTEXT) - 1);
+    if (options.sessionCacheSize > 0) {
+        SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_SERVER);
+        SSL_CTX_sess_set_cache_size(context, static_cast<long>(options.sessionCacheSize));
+    } else {
+        SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_OFF);
+    }
+    if (!options.sessionTickets) {
+        SSL_CTX_set_options(context, SSL_OP_NO_TICKET);
+    }
+
+#ifdef SSL_OP_ENABLE_KTLS
+    // Used only where both OpenSSL and the kernel support the cipher
+    if (options.kernelTls) {
+        SSL_CTX_set_options(context, SSL_OP_ENABLE_KTLS);
+    }
+#endif
+
+    std::unique_ptr<TlsContext> tls(new TlsContext(context, options, std::move(alpnWire)));
+    if (!tls->m_alpnWire.empty()) {
+        SSL_CTX_set_alpn_select_cb(context, selectAlpn, &tls->m_alpnWire);
+    }
+    return tls;
+}
+
+TlsContext::TlsContext(ssl_ctx_st* context, const TlsOptions& options, std::vector<unsigned char> alpnWire)
+    : m_context(context), m_options(options), m_alpnWire(std::move(alpnWire)) {}
+
+TlsContext::~TlsContext() {
+    SSL_CTX_free(m_context);
+}
+
+TlsConnection::TlsConnection(const TlsContext& context, int socket) : m_ssl(SSL_new(context.native())) {
+    if (m_ssl != nullptr) {
+        SSL_set_fd(m_ssl, socket);
+        SSL_set_accept_state(m_ssl);
+    }
+}
+
+TlsConnection::~TlsConnection() {
+    SSL_free(m_ssl);
+}
+
+TlsConnection::HandshakeResult TlsConnection::handshake() {
+    if (m_ssl == nullptr) {
+        return HandshakeResult::Failed;
+    }
+    ERR_clear_error();
+    int result = SSL_do_handshake(m_ssl);
+    if (result == 1) {
+        m_established = true;
+        return HandshakeResult::Done;
+    }
+    switch (SSL_get_error(m_ssl, result)) {
+    case SSL_ERROR_WANT_READ:
+        return HandshakeResult::WantRead;
+    case SSL_ERROR_WANT_WRITE:
+        return HandshakeResult::WantWrite;
+    default:
+        ERR_clear_error();
+        return HandshakeResult::Failed;
+    }
+}
+
+ssize_t TlsConnection::read(char* buffer, size_t length) {
+    ERR_clear_error();
+    int result = SSL_read(m_ssl, buffer, static_cast<int>(length));
+    if (result > 0) {
+        return result;
+    }
+    switch (SSL_get_error(m_ssl, result)) {
+    case SSL_ERROR_ZERO_RETURN:
+        return 0; // close_notify
+    case SSL_ERROR_WANT_READ:
+    case SSL_ERROR_WANT_WRITE:
+        errno = EAGAIN;
+        return -1;
+    case SSL_ERROR_SYSCALL:
+        if (errno == 0) {
+            return 0; // closed without close_notify
+        }
+        return -1;
+    default:
+        ERR_clear_error();
+        errno = EIO;
+        return -1;
+    }
+}
+
+ssize_t TlsConnection::write(const char* data, size_t length) {
+    ERR_clear_error();
+    int result = SSL_write(m_ssl, data, static_cast<int>(length));
+    if (result > 0) {
+        return result;
+    }
+    switch (SSL_get_error(m_ssl, result)) {
+    case SSL_ERROR_WANT_READ:
+    case SSL_ERROR_WANT_WRITE:
+        errno = EAGAIN;
+        return -1;
+    case SSL_ERROR_SYSCALL:
+        if (errno == 0) {
+            errno = EPIPE;
+        }
+        return -1;
+    default:
+        ERR_clear_error();
+        errno = EIO;
+        return -1;
+    }
+}
+
+void TlsConnection::shutdown() {
+    if (m_ssl != nullptr && m_established) {
+        ERR_clear_error();
+        SSL_shutdown(m_ssl);
+        ERR_clear_error();
+    }
+}
+
+bool TlsConnection::kernelTlsSend() const {
+    return BIO_get_ktls_send(SSL_get_wbio(m_ssl)) == 1;
+}
+
+#else // !SERVICES_FRAMEWORK_TLS
+
+bool TlsContext::available() {
+    return false;
+}
+
+std::unique_ptr<TlsContext> TlsContext::create(const TlsOptions& options, std::string& error) {
+    (void)options;
+    error = "TLS support was not compiled in (build with OpenSSL)";
+    return nullptr;
+}
+
+TlsContext::TlsContext(ssl_ctx_st* context, const TlsOptions& options, std::vector<unsigned char> alpnWire)
+    : m_context(context), m_options(options), m_alpnWire(std::move(alpnWire)) {}
+
+TlsContext::~TlsContext() = default;
+
+TlsConnection::TlsConnection(const TlsContext& context, int socket) : m_ssl(nullptr) {
+    (void)context;
+    (void)socket;
+}
+
+TlsConnection::~TlsConnection() = default;
+
+TlsConnection::HandshakeResult TlsConnection::handshake() {
+    return HandshakeResult::Failed;
+}
+
+ssize_t TlsConnection::read(char* buffer, size_t length) {
+    (void)buffer;
+    (void)length;
+    errno = EIO;
+    return -1;
+}
+
+ssize_t TlsConnection::write(const char* data, size_t length) {
+    (void)data;
+    (void)length;
+    errno = EIO;
+    return -1;
+}
+
+void TlsConnection::shutdown() {}
+
+bool TlsConnection::kernelTlsSend() const {
+    return false;
+}
+
+#endif // SERVICES_FRAMEWORK_TLS
+
+} // namespace ServiceFramework
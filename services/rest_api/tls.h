@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+// OpenSSL handles, so this header does not pull in OpenSSL
+struct ssl_st;
+struct ssl_ctx_st;
+
+namespace ServiceFramework {
+
+/**
+ * @brief Server-side TLS settings of a listener
+ */
+struct TlsOptions {
+    std::string certificateFile; // PEM, leaf first, then intermediates
+    std::string privateKeyFile;  // PEM
+    std::vector<std::string> alpn{"h2", "http/1.1"}; // in server preference order
+    bool sessionTickets = true;    // stateless resumption (TLS 1.2 and 1.3)
+    size_t sessionCacheSize = 20480; // stateful resumption cache, 0 disables
+    bool kernelTls = true;         // hand record encryption to the kernel when it supports it
+};
+
+/**
+ * @brief A TLS server configuration: certificate, key, ALPN and session cache
+ *
+ * Built only when the framework is compiled with SERVICES_FRAMEWORK_TLS
+ * (OpenSSL found); otherwise create() always fails. Shared by all
+ * connections of a listener.
+ */
+class TlsContext {
+public:
+    /**
+     * @brief Load the certificate and key and set up resumption and ALPN
+     * @param error Set to a description of the failure
+     * @return nullptr on failure
+     */
+    static std::unique_ptr<TlsContext> create(const TlsOptions& options, std::string& error);
+
+    /**
+     * @brief Whether this build has TLS support at all
+     */
+    static bool available();
+
+    ~TlsContext();
+
+    // Prevent copying (owns the SSL_CTX)
+    TlsContext(const TlsContext&) = delete;
+    TlsContext& operator=(const TlsContext&) = delete;
+
+    ssl_ctx_st* native() const { return m_context; }
+    const TlsOptions& options() const { return m_options; }
+
+private:
+    TlsContext(ssl_ctx_st* context, const TlsOptions& options, std::vector<unsigned char> alpnWire);
+
+    ssl_ctx_st* m_context;
+    TlsOptions m_options;
+    std::vector<unsigned char> m_alpnWire; // length-prefixed protocol list for ALPN selection
+};
+
+/**
+ * @brief Server side of one TLS connection over a non-blocking socket
+ *
+ * read() and write() behave like recv() and send(): they return -1 with
+ * errno EAGAIN when the socket would block (in either direction, as TLS
+ * may need to write while reading and vice versa) and 0 for a clean close.
+ */
+class TlsConnection {
+public:
+    enum class HandshakeResult { Done, WantRead, WantWrite, Failed };
+
+    TlsConnection(const TlsContext& context, int socket);
+    ~TlsConnection();
+
+    // Prevent copying (owns the SSL)
+    TlsConnection(const TlsConnection&) = delete;
+    TlsConnection& operator=(const TlsConnection&) = delete;
+
+    HandshakeResult handshake();
+    bool established() const { return m_established; }
+
+    ssize_t read(char* buffer, size_t length);
+    ssize_t write(const char* data, size_t length);
+
+    /**
+     * @brief Send close_notify, best-effort and without blocking
+     */
+    void shutdown();
+
+    // Valid once established: records are encrypted by the kernel
+    bool kernelTlsSend() const;
+
+private:
+    ssl_st* m_ssl;
+    bool m_established = false;
+};
+
+} // namespace ServiceFramework
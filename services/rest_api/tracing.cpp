@@ -0,0 +1,398 @@
+#include "tracing.h"
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace ServiceFramework {
+
+namespace {
+
+const char HEX_DIGITS[] = "0123456789abcdef";
+
+template <size_t N>
+void appendHex(std::string& out, const std::array<uint8_t, N>& bytes) {
+    for (uint8_t byte : bytes) {
+        out.push_back(HEX_DIGITS[byte >> 4]);
+        out.push_back(HEX_DIGITS[byte & 0x0f]);
+    }
+}
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1; // the spec only allows lowercase
+}
+
+// Lowercase hex at text[offset, offset + 2 * size) into bytes
+bool parseHex(const std::string& text, size_t offset, uint8_t* bytes, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        int high = hexValue(text[offset + 2 * i]);
+        int low = hexValue(text[offset + 2 * i + 1]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        bytes[i] = static_cast<uint8_t>((high << 4) | low);
+    }
+    return true;
+}
+
+template <size_t N>
+bool isZero(const std::array<uint8_t, N>& bytes) {
+    for (uint8_t byte : bytes) {
+        if (byte != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint64_t randomWord() {
+    thread_local std::mt19937_64 generator(std::random_device{}());
+    return generator();
+}
+
+template <size_t N>
+void fillRandom(std::array<uint8_t, N>& bytes) {
+    do {
+        for (size_t i = 0; i < N; i += 8) {
+            uint64_t word = randomWord();
+            std::memcpy(bytes.data() + i, &word, std::min<size_t>(8, N - i));
+        }
+    } while (isZero(bytes));
+}
+
+void appendJsonString(std::string& out, const std::string& value) {
+    out.push_back('"');
+    for (char c : value) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out += escaped;
+            } else {
+                out.push_back(c);
+            }
+        }
+    }
+    out.push_back('"');
+}
+
+void appendAttribute(std::string& out, const SpanAttribute& attribute) {
+    out += "{\"key\":";
+    appendJsonString(out, attribute.key);
+    if (attribute.isInt) {
+        // OTLP JSON carries 64-bit integers as strings
+        out += ",\"value\":{\"intValue\":\"" + std::to_string(attribute.intValue) + "\"}}";
+    } else {
+        out += ",\"value\":{\"stringValue\":";
+        appendJsonString(out, attribute.stringValue);
+        out += "}}";
+    }
+}
+
+} // namespace
+
+bool TraceContext::valid() const {
+    return !isZero(traceId) && !isZero(spanId);
+}
+
+std::string TraceContext::traceparent() const {
+    std::string header = "00-";
+    header.reserve(55);
+    appendHex(header, traceId);
+    header.push_back('-');
+    appendHex(header, spanId);
+    header.push_back('-');
+    header.push_back(HEX_DIGITS[flags >> 4]);
+    header.push_back(HEX_DIGITS[flags & 0x0f]);
+    return header;
+}
+
+bool TraceContext::parse(const std::string& header, TraceContext& context) {
+    // version "-" trace-id "-" parent-id "-" flags; later versions may append fields
+    if (header.size() < 55 || header[2] != '-' || header[35] != '-' || header[52] != '-') {
+        return false;
+    }
+    uint8_t version;
+    if (!parseHex(header, 0, &version, 1) || version == 0xff ||
+        (version == 0 && header.size() != 55) || (header.size() > 55 && header[55] != '-')) {
+        return false;
+    }
+
+    TraceContext parsed;
+    if (!parseHex(header, 3, parsed.traceId.data(), parsed.traceId.size()) ||
+        !parseHex(header, 36, parsed.spanId.data(), parsed.spanId.size()) ||
+        !parseHex(header, 53, &parsed.flags, 1) || !parsed.valid()) {
+        return false;
+    }
+    context = parsed;
+    return true;
+}
+
+Tracer::Tracer(const TracingOptions& options)
+    : m_options(options) {
+    double ratio = std::min(std::max(options.sampleRatio, 0.0), 1.0);
+    m_sampleThreshold = ratio >= 1.0 ? UINT64_MAX : static_cast<uint64_t>(std::ldexp(ratio, 64));
+
+    auto system = std::chrono::system_clock::now().time_since_epoch();
+    auto steady = Clock::now().time_since_epoch();
+    m_epochOffsetNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(system).count() -
+                         std::chrono::duration_cast<std::chrono::nanoseconds>(steady).count();
+}
+
+Tracer::~Tracer() {
+    stop();
+}
+
+bool Tracer::start() {
+    const std::string& endpoint = m_options.endpoint;
+    if (endpoint.compare(0, 7, "http://") == 0) {
+        std::string authority = endpoint.substr(7);
+        size_t slash = authority.find('/');
+        m_collectorPath = slash == std::string::npos ? "/v1/traces" : authority.substr(slash);
+        authority = authority.substr(0, slash);
+        size_t colon = authority.rfind(':');
+        m_collectorHost = authority.substr(0, colon);
+        m_collectorPort = colon == std::string::npos ? "4318" : authority.substr(colon + 1);
+        if (m_collectorHost.empty()) {
+            std::cerr << "Tracer: Invalid collector endpoint '" << endpoint << "'" << std::endl;
+            return false;
+        }
+    } else {
+        m_file = fopen(endpoint.c_str(), "a");
+        if (m_file == nullptr) {
+            std::cerr << "Tracer: Failed to open '" << endpoint << "': " << strerror(errno) << std::endl;
+            return false;
+        }
+    }
+
+    m_stopping = false;
+    m_exportThread = std::thread(&Tracer::exportLoop, this);
+    return true;
+}
+
+void Tracer::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_condition.notify_one();
+    if (m_exportThread.joinable()) {
+        m_exportThread.join();
+    }
+    if (m_file != nullptr) {
+        fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+TraceContext Tracer::startSpan(const TraceContext* parent) const {
+    TraceContext context;
+    if (parent != nullptr && parent->valid()) {
+        // Stay in the caller's trace and honour its sampling decision
+        context.traceId = parent->traceId;
+        context.flags = parent->flags;
+    } else {
+        fillRandom(context.traceId);
+        uint64_t low = 0;
+        for (size_t i = 8; i < 16; ++i) {
+            low = (low << 8) | context.traceId[i];
+        }
+        context.flags = low < m_sampleThreshold || m_sampleThreshold == UINT64_MAX ? 0x01 : 0x00;
+    }
+    context.spanId = newSpanId();
+    return context;
+}
+
+std::array<uint8_t, 8> Tracer::newSpanId() {
+    std::array<uint8_t, 8> spanId;
+    fillRandom(spanId);
+    return spanId;
+}
+
+void Tracer::submit(std::vector<SpanRecord>& spans) {
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_queue.size() + spans.size() > m_options.maxQueuedSpans) {
+            m_droppedSpans.fetch_add(spans.size());
+            spans.clear();
+            return;
+        }
+        for (auto& span : spans) {
+            m_queue.push_back(std::move(span));
+        }
+        wake = m_queue.size() >= EXPORT_BATCH_SIZE;
+    }
+    spans.clear();
+    if (wake) {
+        m_condition.notify_one();
+    }
+}
+
+int64_t Tracer::toUnixNanos(Clock::time_point time) const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count() +
+           m_epochOffsetNanos;
+}
+
+void Tracer::exportLoop() {
+    std::vector<SpanRecord> batch;
+    while (true) {
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait_for(lock, m_options.exportInterval, [this] {
+                return m_stopping || m_queue.size() >= EXPORT_BATCH_SIZE;
+            });
+            stopping = m_stopping;
+            batch.swap(m_queue);
+        }
+
+        if (!batch.empty()) {
+            exportBatch(batch);
+            batch.clear();
+        }
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+void Tracer::exportBatch(const std::vector<SpanRecord>& spans) {
+    std::string json = toOtlpJson(spans);
+    bool exported;
+    if (m_file != nullptr) {
+        json.push_back('\n');
+        exported = fwrite(json.data(), 1, json.size(), m_file) == json.size() && fflush(m_file) == 0;
+    } else {
+        exported = postToCollector(json);
+    }
+
+    if (!exported && !m_exportFailing) {
+        std::cerr << "Tracer: Failed to export " << spans.size() << " span(s) to "
+                  << m_options.endpoint << std::endl;
+    }
+    m_exportFailing = !exported;
+}
+
+std::string Tracer::toOtlpJson(const std::vector<SpanRecord>& spans) const {
+    std::string out;
+    out.reserve(256 + spans.size() * 320);
+    out += "{\"resourceSpans\":[{\"resource\":{\"attributes\":[";
+    appendAttribute(out, SpanAttribute{"service.name", m_options.serviceName, 0, false});
+    out += "]},\"scopeSpans\":[{\"scope\":{\"name\":\"ServiceFramework.RestApiService\"},\"spans\":[";
+
+    for (size_t i = 0; i < spans.size(); ++i) {
+        const SpanRecord& span = spans[i];
+        if (i > 0) {
+            out.push_back(',');
+        }
+        out += "{\"traceId\":\"";
+        appendHex(out, span.traceId);
+        out += "\",\"spanId\":\"";
+        appendHex(out, span.spanId);
+        out += "\"";
+        if (!isZero(span.parentSpanId)) {
+            out += ",\"parentSpanId\":\"";
+            appendHex(out, span.parentSpanId);
+            out += "\"";
+        }
+        out += ",\"name\":";
+        appendJsonString(out, span.name);
+        out += span.server ? ",\"kind\":2" : ",\"kind\":1";
+        out += ",\"startTimeUnixNano\":\"" + std::to_string(span.startUnixNanos) + "\"";
+        out += ",\"endTimeUnixNano\":\"" + std::to_string(span.endUnixNanos) + "\"";
+        if (!span.attributes.empty()) {
+            out += ",\"attributes\":[";
+            for (size_t a = 0; a < span.attributes.size(); ++a) {
+                if (a > 0) {
+                    out.push_back(',');
+                }
+                appendAttribute(out, span.attributes[a]);
+            }
+            out += "]";
+        }
+        if (span.error) {
+            out += ",\"status\":{\"code\":2}";
+        }
+        out += "}";
+    }
+    out += "]}]}]}";
+    return out;
+}
+
+bool Tracer::postToCollector(const std::string& body) {
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* addresses = nullptr;
+    if (getaddrinfo(m_collectorHost.c_str(), m_collectorPort.c_str(), &hints, &addresses) != 0) {
+        return false;
+    }
+
+    int sock = -1;
+    for (struct addrinfo* address = addresses; address != nullptr; address = address->ai_next) {
+        sock = socket(address->ai_family, address->ai_socktype | SOCK_CLOEXEC, address->ai_protocol);
+        if (sock < 0) {
+            continue;
+        }
+        struct timeval timeout = {2, 0};
+        setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        if (connect(sock, address->ai_addr, address->ai_addrlen) == 0) {
+            break;
+        }
+        close(sock);
+        sock = -1;
+    }
+    freeaddrinfo(addresses);
+    if (sock < 0) {
+        return false;
+    }
+
+    std::string request = "POST " + m_collectorPath + " HTTP/1.1\r\n"
+                          "Host: " + m_collectorHost + ":" + m_collectorPort + "\r\n"
+                          "Content-Type: application/json\r\n"
+                          "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                          "Connection: close\r\n\r\n" + body;
+    size_t offset = 0;
+    while (offset < request.size()) {
+        ssize_t sent = send(sock, request.data() + offset, request.size() - offset, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            close(sock);
+            return false;
+        }
+        offset += static_cast<size_t>(sent);
+    }
+
+    // Only the status line matters (any 2xx accepts the batch), but read
+    // to the end so closing doesn't reset the collector's side
+    std::string response;
+    char buffer[1024];
+    ssize_t received;
+    while (response.size() < 64 * 1024 && (received = recv(sock, buffer, sizeof(buffer), 0)) > 0) {
+        response.append(buffer, static_cast<size_t>(received));
+    }
+    close(sock);
+    return response.size() >= 12 && response.compare(0, 7, "HTTP/1.") == 0 && response[9] == '2';
+}
+
+} // namespace ServiceFramework
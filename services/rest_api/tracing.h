@@ -0,0 +1,159 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ServiceFramework {
+
+/**
+ * @brief W3C Trace Context of one span (the traceparent header)
+ *
+ * All-zero ids mean "no context": no tracing and no incoming traceparent.
+ */
+struct TraceContext {
+    std::array<uint8_t, 16> traceId{};
+    std::array<uint8_t, 8> spanId{};
+    uint8_t flags = 0; // bit 0: sampled
+
+    bool valid() const;
+    bool sampled() const { return (flags & 0x01) != 0; }
+
+    /**
+     * @brief Header value for propagating this context to a downstream call
+     */
+    std::string traceparent() const;
+
+    /**
+     * @brief Parse a traceparent header value
+     * @return false if malformed; context is left untouched
+     */
+    static bool parse(const std::string& header, TraceContext& context);
+};
+
+/**
+ * @brief Key/value attached to a span (string or integer)
+ */
+struct SpanAttribute {
+    std::string key;
+    std::string stringValue;
+    int64_t intValue = 0;
+    bool isInt = false;
+};
+
+/**
+ * @brief One finished span, ready for export
+ */
+struct SpanRecord {
+    std::string name;
+    std::array<uint8_t, 16> traceId{};
+    std::array<uint8_t, 8> spanId{};
+    std::array<uint8_t, 8> parentSpanId{}; // all zero for a root span
+    bool server = false;                   // SPAN_KIND_SERVER, else INTERNAL
+    bool error = false;
+    int64_t startUnixNanos = 0;
+    int64_t endUnixNanos = 0;
+    std::vector<SpanAttribute> attributes;
+};
+
+/**
+ * @brief Where and how much to trace
+ */
+struct TracingOptions {
+    // Path of a file to append OTLP JSON lines to, or an OTLP/HTTP collector
+    // as "http://host:port[/path]" (path defaults to /v1/traces)
+    std::string endpoint;
+    double sampleRatio = 0.01; // for requests without a sampled/unsampled parent
+    std::string serviceName = "rest_api";
+    size_t maxQueuedSpans = 8192; // spans beyond this are dropped, not blocked on
+    std::chrono::milliseconds exportInterval{1000};
+};
+
+/**
+ * @brief Span sampling and export
+ *
+ * Sampling is parent-based: an incoming traceparent's sampled flag is
+ * followed, and new traces are sampled by trace id against the ratio.
+ * Finished spans are queued by submit() and written by a background thread
+ * in OTLP JSON (one ExportTraceServiceRequest per batch), so request threads
+ * never wait on the exporter.
+ */
+class Tracer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit Tracer(const TracingOptions& options);
+    ~Tracer();
+
+    // Prevent copying (owns the exporter thread)
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    /**
+     * @brief Open the endpoint and start the exporter thread
+     */
+    bool start();
+
+    /**
+     * @brief Export whatever is queued and stop the exporter thread
+     */
+    void stop();
+
+    /**
+     * @brief Context for a new server span
+     * @param parent Incoming context, or nullptr to start a new trace
+     */
+    TraceContext startSpan(const TraceContext* parent) const;
+
+    /**
+     * @brief Fresh random span id
+     */
+    static std::array<uint8_t, 8> newSpanId();
+
+    /**
+     * @brief Queue finished spans for export (thread-safe); moves them out
+     */
+    void submit(std::vector<SpanRecord>& spans);
+
+    /**
+     * @brief Convert a steady clock reading to Unix epoch nanoseconds
+     */
+    int64_t toUnixNanos(Clock::time_point time) const;
+
+    uint64_t droppedSpans() const { return m_droppedSpans.load(); }
+
+private:
+    void exportLoop();
+    void exportBatch(const std::vector<SpanRecord>& spans);
+    std::string toOtlpJson(const std::vector<SpanRecord>& spans) const;
+    bool postToCollector(const std::string& body);
+
+    TracingOptions m_options;
+    uint64_t m_sampleThreshold; // trace ids below this are sampled
+    int64_t m_epochOffsetNanos; // system_clock - steady_clock at construction
+
+    // Exporter target
+    FILE* m_file = nullptr;
+    std::string m_collectorHost;
+    std::string m_collectorPort;
+    std::string m_collectorPath;
+
+    std::thread m_exportThread;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::vector<SpanRecord> m_queue;
+    bool m_stopping = false;
+    bool m_exportFailing = false; // log once per failure streak
+    std::atomic<uint64_t> m_droppedSpans{0};
+
+    static const size_t EXPORT_BATCH_SIZE = 512;
+};
+
+} // namespace ServiceFramework
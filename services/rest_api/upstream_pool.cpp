@@ -0,0 +1,517 @@
+#include "upstream_pool.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <netdb.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <strings.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace ServiceFramework {
+
+namespace {
+
+// Wait until fd is ready for events or the deadline passes
+bool waitFor(int fd, short events, UpstreamPool::Clock::time_point deadline) {
+    while (true) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - UpstreamPool::Clock::now());
+        if (remaining.count() <= 0) {
+            return false;
+        }
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = events;
+        pfd.revents = 0;
+        int ready = poll(&pfd, 1, static_cast<int>(remaining.count()) + 1);
+        if (ready > 0) {
+            return true;
+        }
+        if (ready < 0 && errno != EINTR) {
+            return false;
+        }
+    }
+}
+
+// True if an idle connection has been closed (or sent stray data) by the upstream
+bool idleConnectionBroken(int fd) {
+    char byte;
+    ssize_t result = recv(fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+    return result >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+}
+
+const size_t MAX_HEADER_LINE = 64 * 1024;
+
+} // namespace
+
+UpstreamPool::UpstreamPool(const std::vector<std::string>& addresses, size_t maxIdlePerUpstream)
+    : m_maxIdle(maxIdlePerUpstream) {
+    for (const auto& address : addresses) {
+        auto upstream = std::make_unique<Upstream>();
+        upstream->address = address;
+        if (!resolve(address, *upstream)) {
+            std::cerr << "UpstreamPool: Invalid upstream address '" << address << "'" << std::endl;
+            m_valid = false;
+        }
+        m_upstreams.push_back(std::move(upstream));
+    }
+    m_valid = m_valid && !m_upstreams.empty();
+}
+
+UpstreamPool::~UpstreamPool() {
+    for (auto& upstream : m_upstreams) {
+        for (int fd : upstream->idle) {
+            close(fd);
+        }
+    }
+}
+
+bool UpstreamPool::resolve(const std::string& address, Upstream& upstream) {
+    std::memset(&upstream.sockaddr, 0, sizeof(upstream.sockaddr));
+
+    // Unix domain sockets: "unix:/path" or "@abstract"
+    if (address.compare(0, 5, "unix:") == 0 || (!address.empty() && address[0] == '@')) {
+        std::string path = address[0] == '@' ? address : address.substr(5);
+        struct sockaddr_un* unixAddress = reinterpret_cast<struct sockaddr_un*>(&upstream.sockaddr);
+        if (path.empty() || path == "@" || path.size() >= sizeof(unixAddress->sun_path)) {
+            return false;
+        }
+        unixAddress->sun_family = AF_UNIX;
+        std::memcpy(unixAddress->sun_path, path.c_str(), path.size());
+        if (path[0] == '@') {
+            unixAddress->sun_path[0] = '\0';
+            upstream.sockaddrLen = offsetof(struct sockaddr_un, sun_path) + path.size();
+        } else {
+            upstream.sockaddrLen = sizeof(struct sockaddr_un);
+        }
+        return true;
+    }
+
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos || colon == 0 || colon + 1 == address.size()) {
+        return false;
+    }
+    std::string host = address.substr(0, colon);
+    if (host.size() > 2 && host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);
+    }
+
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), address.c_str() + colon + 1, &hints, &result) != 0 || !result) {
+        return false;
+    }
+    std::memcpy(&upstream.sockaddr, result->ai_addr, result->ai_addrlen);
+    upstream.sockaddrLen = result->ai_addrlen;
+    freeaddrinfo(result);
+    return true;
+}
+
+int UpstreamPool::connectTo(const Upstream& upstream, Clock::time_point deadline) {
+    int family = upstream.sockaddr.ss_family;
+    int fd = socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (family != AF_UNIX) {
+        int noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    }
+
+    if (connect(fd, reinterpret_cast<const struct sockaddr*>(&upstream.sockaddr), upstream.sockaddrLen) < 0) {
+        if (errno != EINPROGRESS || !waitFor(fd, POLLOUT, deadline)) {
+            close(fd);
+            return -1;
+        }
+        int error = 0;
+        socklen_t errorLen = sizeof(error);
+        if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &errorLen) < 0 || error != 0) {
+            close(fd);
+            return -1;
+        }
+    }
+
+    m_connectionsOpened.fetch_add(1);
+    return fd;
+}
+
+bool UpstreamPool::acquire(Lease& lease, Clock::time_point deadline, bool allowIdle) {
+    // Least outstanding requests; start the scan at a rotating index so
+    // ties spread across upstreams instead of piling onto the first
+    size_t count = m_upstreams.size();
+    size_t start = m_next.fetch_add(1) % count;
+    size_t best = start;
+    for (size_t i = 1; i < count; ++i) {
+        size_t candidate = (start + i) % count;
+        if (m_upstreams[candidate]->outstanding.load() < m_upstreams[best]->outstanding.load()) {
+            best = candidate;
+        }
+    }
+
+    Upstream& upstream = *m_upstreams[best];
+    upstream.outstanding.fetch_add(1);
+    lease.upstream = best;
+    lease.fd = -1;
+    lease.reused = false;
+
+    if (allowIdle) {
+        std::lock_guard<std::mutex> lock(upstream.mutex);
+        while (!upstream.idle.empty()) {
+            int fd = upstream.idle.back();
+            upstream.idle.pop_back();
+            if (!idleConnectionBroken(fd)) {
+                lease.fd = fd;
+                lease.reused = true;
+                return true;
+            }
+            close(fd);
+        }
+    }
+
+    lease.fd = connectTo(upstream, deadline);
+    if (lease.fd < 0) {
+        upstream.outstanding.fetch_sub(1);
+        return false;
+    }
+    return true;
+}
+
+void UpstreamPool::release(Lease& lease, bool reusable) {
+    if (lease.fd < 0) {
+        return;
+    }
+
+    Upstream& upstream = *m_upstreams[lease.upstream];
+    upstream.outstanding.fetch_sub(1);
+    if (reusable) {
+        std::lock_guard<std::mutex> lock(upstream.mutex);
+        if (upstream.idle.size() < m_maxIdle) {
+            upstream.idle.push_back(lease.fd);
+            lease.fd = -1;
+            return;
+        }
+    }
+    close(lease.fd);
+    lease.fd = -1;
+}
+
+namespace Http1 {
+
+Status ResponseReader::fill(UpstreamPool::Clock::time_point deadline) {
+    // Compact once everything before the read position has been consumed
+    if (m_offset == m_buffer.size()) {
+        m_buffer.clear();
+        m_offset = 0;
+    }
+
+    char buffer[16384];
+    while (true) {
+        ssize_t bytesRead = recv(m_fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (bytesRead > 0) {
+            m_buffer.append(buffer, bytesRead);
+            m_receivedBytes = true;
+            return Status::Ok;
+        }
+        if (bytesRead == 0) {
+            return Status::Closed;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            return Status::Closed;
+        }
+        if (!waitFor(m_fd, POLLIN, deadline)) {
+            return Status::Timeout;
+        }
+    }
+}
+
+Status ResponseReader::line(std::string& out, size_t limit, UpstreamPool::Clock::time_point deadline) {
+    size_t searchFrom = m_offset;
+    while (true) {
+        size_t end = m_buffer.find("\r\n", searchFrom);
+        if (end != std::string::npos) {
+            out.assign(m_buffer, m_offset, end - m_offset);
+            m_offset = end + 2;
+            return Status::Ok;
+        }
+        if (m_buffer.size() - m_offset > limit) {
+            return Status::Malformed;
+        }
+        // Rescan only the last byte already seen, in case it was the '\r'
+        size_t scanned = m_buffer.size() - m_offset;
+        Status status = fill(deadline);
+        if (status != Status::Ok) {
+            return status;
+        }
+        searchFrom = m_offset + (scanned > 0 ? scanned - 1 : 0);
+    }
+}
+
+Status ResponseReader::append(std::string& out, size_t count, UpstreamPool::Clock::time_point deadline) {
+    while (count > 0) {
+        if (m_offset == m_buffer.size()) {
+            Status status = fill(deadline);
+            if (status != Status::Ok) {
+                return status;
+            }
+        }
+        size_t take = std::min(count, m_buffer.size() - m_offset);
+        out.append(m_buffer, m_offset, take);
+        m_offset += take;
+        count -= take;
+    }
+    return Status::Ok;
+}
+
+Status ResponseReader::appendToEof(std::string& out, size_t limit, UpstreamPool::Clock::time_point deadline) {
+    while (true) {
+        out.append(m_buffer, m_offset, std::string::npos);
+        m_offset = m_buffer.size();
+        if (out.size() > limit) {
+            return Status::Malformed;
+        }
+        Status status = fill(deadline);
+        if (status == Status::Closed) {
+            return Status::Ok;
+        }
+        if (status != Status::Ok) {
+            return status;
+        }
+    }
+}
+
+Status writeAll(int fd, struct iovec* iov, int count, UpstreamPool::Clock::time_point deadline) {
+    while (count > 0) {
+        if (iov->iov_len == 0) {
+            ++iov;
+            --count;
+            continue;
+        }
+
+        struct msghdr message;
+        std::memset(&message, 0, sizeof(message));
+        message.msg_iov = iov;
+        message.msg_iovlen = count;
+        ssize_t written = sendmsg(fd, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return Status::Closed;
+            }
+            if (!waitFor(fd, POLLOUT, deadline)) {
+                return Status::Timeout;
+            }
+            continue;
+        }
+
+        size_t remaining = static_cast<size_t>(written);
+        while (count > 0 && remaining >= iov->iov_len) {
+            remaining -= iov->iov_len;
+            iov->iov_len = 0;
+            ++iov;
+            --count;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + remaining;
+            iov->iov_len -= remaining;
+        }
+    }
+    return Status::Ok;
+}
+
+Status exchange(UpstreamPool& pool, const std::string& head, const std::string& body,
+                UpstreamPool::Clock::time_point connectDeadline, UpstreamPool::Clock::time_point deadline,
+                bool headRequest, bool idempotent, size_t maxBodyBytes, HttpResponse& response) {
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        UpstreamPool::Lease lease;
+        if (!pool.acquire(lease, connectDeadline, attempt == 0)) {
+            return Status::ConnectFailed;
+        }
+
+        struct iovec iov[2];
+        iov[0].iov_base = const_cast<char*>(head.data());
+        iov[0].iov_len = head.size();
+        iov[1].iov_base = const_cast<char*>(body.data());
+        iov[1].iov_len = body.size();
+        Status status = writeAll(lease.fd, iov, 2, deadline);
+        bool sentNothing = status == Status::Closed && iov[0].iov_len == head.size();
+
+        ResponseReader reader(lease.fd);
+        bool keepAlive = false;
+        if (status == Status::Ok || status == Status::Closed) {
+            // Upstreams may answer (e.g. 413) and close before reading the whole body
+            status = readResponse(reader, deadline, headRequest, maxBodyBytes, response, keepAlive);
+        }
+        if (status == Status::Ok) {
+            // Bytes past the response mean the connection is out of step
+            pool.release(lease, keepAlive && reader.drained());
+            return status;
+        }
+
+        // A pooled connection that closed without answering was most likely
+        // stale, but the upstream may still have acted on what it received
+        pool.release(lease, false);
+        if (status != Status::Closed || !lease.reused || reader.receivedBytes() ||
+            !(idempotent || sentNothing)) {
+            return status;
+        }
+    }
+    return Status::Closed;
+}
+
+bool isIdempotent(const std::string& method) {
+    return method == "GET" || method == "HEAD" || method == "OPTIONS" || method == "PUT" || method == "DELETE";
+}
+
+bool isHopByHopHeader(const std::string& name) {
+    static const char* const HOP_BY_HOP[] = {"connection", "keep-alive", "proxy-connection", "te", "trailer",
+                                             "transfer-encoding", "upgrade", "http2-settings", "content-length"};
+    for (const char* header : HOP_BY_HOP) {
+        if (strcasecmp(name.c_str(), header) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Status readResponse(ResponseReader& reader, UpstreamPool::Clock::time_point deadline, bool headRequest,
+                    size_t maxBodyBytes, HttpResponse& response, bool& keepAlive) {
+    keepAlive = false;
+
+    std::string line;
+    bool http10 = false;
+    bool chunked = false;
+    bool closeRequested = false;
+    bool keepAliveRequested = false;
+    long long contentLength = -1;
+    while (true) {
+        Status status = reader.line(line, MAX_HEADER_LINE, deadline);
+        if (status != Status::Ok) {
+            return status;
+        }
+
+        // Status line: "HTTP/1.1 200 OK"
+        if (line.size() < 12 || line.compare(0, 7, "HTTP/1.") != 0 || line[8] != ' ') {
+            return Status::Malformed;
+        }
+        http10 = line[7] == '0';
+        response.statusCode = std::atoi(line.c_str() + 9);
+        response.statusText = line.size() > 13 ? line.substr(13) : "";
+        response.headers.clear();
+
+        while (true) {
+            status = reader.line(line, MAX_HEADER_LINE, deadline);
+            if (status != Status::Ok) {
+                return status;
+            }
+            if (line.empty()) {
+                break;
+            }
+            size_t colon = line.find(':');
+            if (colon == std::string::npos || colon == 0) {
+                return Status::Malformed;
+            }
+            std::string name = line.substr(0, colon);
+            size_t valueStart = line.find_first_not_of(" \t", colon + 1);
+            size_t valueEnd = line.find_last_not_of(" \t");
+            std::string value = valueStart == std::string::npos ? "" : line.substr(valueStart, valueEnd - valueStart + 1);
+
+            if (strcasecmp(name.c_str(), "content-length") == 0) {
+                char* end = nullptr;
+                contentLength = std::strtoll(value.c_str(), &end, 10);
+                if (end == value.c_str() || *end != '\0' || contentLength < 0) {
+                    return Status::Malformed;
+                }
+            } else if (strcasecmp(name.c_str(), "transfer-encoding") == 0) {
+                chunked = strcasestr(value.c_str(), "chunked") != nullptr;
+            } else if (strcasecmp(name.c_str(), "connection") == 0) {
+                closeRequested = strcasestr(value.c_str(), "close") != nullptr;
+                keepAliveRequested = strcasestr(value.c_str(), "keep-alive") != nullptr;
+            }
+            if (!isHopByHopHeader(name)) {
+                std::string& field = response.headers[name];
+                field = field.empty() ? value : field + ", " + value;
+            }
+        }
+
+        // Interim responses (100 Continue, 103 Early Hints) precede the real one
+        if (response.statusCode >= 200 || response.statusCode == 101) {
+            break;
+        }
+        contentLength = -1;
+        chunked = false;
+    }
+
+    response.body.clear();
+    bool bodyless = headRequest || response.statusCode == 204 || response.statusCode == 304;
+    bool delimitedByClose = false;
+    if (bodyless) {
+        // Nothing follows the headers
+    } else if (chunked) {
+        while (true) {
+            Status status = reader.line(line, MAX_HEADER_LINE, deadline);
+            if (status != Status::Ok) {
+                return status;
+            }
+            char* end = nullptr;
+            unsigned long long chunkSize = std::strtoull(line.c_str(), &end, 16);
+            if (end == line.c_str()) {
+                return Status::Malformed;
+            }
+            if (chunkSize == 0) {
+                // Trailers are dropped; read up to the blank line
+                do {
+                    status = reader.line(line, MAX_HEADER_LINE, deadline);
+                    if (status != Status::Ok) {
+                        return status;
+                    }
+                } while (!line.empty());
+                break;
+            }
+            if (response.body.size() + chunkSize > maxBodyBytes) {
+                return Status::Malformed;
+            }
+            status = reader.append(response.body, chunkSize, deadline);
+            if (status == Status::Ok) {
+                status = reader.line(line, 2, deadline);
+            }
+            if (status != Status::Ok || !line.empty()) {
+                return status != Status::Ok ? status : Status::Malformed;
+            }
+        }
+    } else if (contentLength >= 0) {
+        if (static_cast<unsigned long long>(contentLength) > maxBodyBytes) {
+            return Status::Malformed;
+        }
+        response.body.reserve(contentLength);
+        Status status = reader.append(response.body, static_cast<size_t>(contentLength), deadline);
+        if (status != Status::Ok) {
+            return status;
+        }
+    } else {
+        Status status = reader.appendToEof(response.body, maxBodyBytes, deadline);
+        if (status != Status::Ok) {
+            return status;
+        }
+        delimitedByClose = true;
+    }
+
+    keepAlive = !delimitedByClose && !closeRequested && (!http10 || keepAliveRequested) &&
+                response.statusCode != 101;
+    return Status::Ok;
+}
+
+} // namespace Http1
+
+} // namespace ServiceFramework
@@ -0,0 +1,188 @@
+#pragma once
+
+#include "rest_api_service.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+namespace ServiceFramework {
+
+/**
+ * @brief Keep-alive connections to a fixed set of upstream servers
+ *
+ * Addresses are "host:port", "unix:/path/to.sock" or "@abstract". acquire()
+ * picks the upstream with the fewest requests in flight (rotating between
+ * ties) and hands out one of its idle connections when it has one, so
+ * steady traffic pays no connect per request.
+ */
+class UpstreamPool {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief A connection checked out of the pool; give it back with release()
+     */
+    struct Lease {
+        size_t upstream = 0;
+        int fd = -1;
+        bool reused = false; // idle connection the upstream may have closed meanwhile
+    };
+
+    UpstreamPool(const std::vector<std::string>& addresses, size_t maxIdlePerUpstream);
+    ~UpstreamPool();
+
+    // Prevent copying (owns the idle connections)
+    UpstreamPool(const UpstreamPool&) = delete;
+    UpstreamPool& operator=(const UpstreamPool&) = delete;
+
+    /**
+     * @brief True if every address parsed and resolved
+     */
+    bool valid() const { return m_valid; }
+
+    size_t size() const { return m_upstreams.size(); }
+    const std::string& address(size_t upstream) const { return m_upstreams[upstream]->address; }
+    size_t outstanding(size_t upstream) const { return m_upstreams[upstream]->outstanding.load(); }
+
+    /**
+     * @brief Connections opened so far (reuse keeps this flat)
+     */
+    uint64_t connectionsOpened() const { return m_connectionsOpened.load(); }
+
+    /**
+     * @brief Check out a connection to the least loaded upstream
+     * @param allowIdle false forces a fresh connection (retrying a stale one)
+     * @return false if connecting failed; the lease is released already
+     */
+    bool acquire(Lease& lease, Clock::time_point deadline, bool allowIdle = true);
+
+    /**
+     * @brief Return a connection; it is kept for reuse only if reusable
+     */
+    void release(Lease& lease, bool reusable);
+
+private:
+    struct Upstream {
+        std::string address;
+        struct sockaddr_storage sockaddr;
+        socklen_t sockaddrLen = 0;
+        std::atomic<size_t> outstanding{0};
+        std::mutex mutex;
+        std::vector<int> idle; // most recently used last
+    };
+
+    static bool resolve(const std::string& address, Upstream& upstream);
+    int connectTo(const Upstream& upstream, Clock::time_point deadline);
+
+    std::vector<std::unique_ptr<Upstream>> m_upstreams;
+    size_t m_maxIdle;
+    bool m_valid = true;
+    std::atomic<size_t> m_next{0};
+    std::atomic<uint64_t> m_connectionsOpened{0};
+};
+
+/**
+ * @brief HTTP/1.1 message exchange on a pooled (non-blocking) connection
+ */
+namespace Http1 {
+
+enum class Status {
+    Ok,
+    ConnectFailed, // no connection could be made
+    Closed,        // peer closed or reset before a complete response
+    Timeout,       // deadline passed
+    Malformed      // unparseable or oversized response
+};
+
+/**
+ * @brief Write all of iov, waiting for the socket as needed
+ *
+ * Entries are trimmed as they are sent, so on failure iov holds what was
+ * not written.
+ */
+Status writeAll(int fd, struct iovec* iov, int count, UpstreamPool::Clock::time_point deadline);
+
+/**
+ * @brief Buffered reads from one connection
+ *
+ * Keep one reader per connection across pipelined responses: bytes of the
+ * next response that arrive with the current one stay in its buffer.
+ */
+class ResponseReader {
+public:
+    explicit ResponseReader(int fd) : m_fd(fd) {}
+
+    /**
+     * @brief Next CRLF-terminated line, without the CRLF
+     */
+    Status line(std::string& out, size_t limit, UpstreamPool::Clock::time_point deadline);
+
+    /**
+     * @brief Append exactly count bytes to out
+     */
+    Status append(std::string& out, size_t count, UpstreamPool::Clock::time_point deadline);
+
+    /**
+     * @brief Append everything up to the peer closing the connection
+     */
+    Status appendToEof(std::string& out, size_t limit, UpstreamPool::Clock::time_point deadline);
+
+    /**
+     * @brief True if nothing received is left unread
+     */
+    bool drained() const { return m_offset == m_buffer.size(); }
+
+    /**
+     * @brief True if the peer sent anything at all (no safe retry then)
+     */
+    bool receivedBytes() const { return m_receivedBytes; }
+
+private:
+    Status fill(UpstreamPool::Clock::time_point deadline);
+
+    int m_fd;
+    std::string m_buffer;
+    size_t m_offset = 0;
+    bool m_receivedBytes = false;
+};
+
+/**
+ * @brief Read one response (skipping 1xx), decoding chunked bodies
+ * @param headRequest The request was HEAD, so no body follows
+ * @param response Receives status, end-to-end headers and body
+ * @param keepAlive Set if the connection can carry another request
+ */
+Status readResponse(ResponseReader& reader, UpstreamPool::Clock::time_point deadline, bool headRequest,
+                    size_t maxBodyBytes, HttpResponse& response, bool& keepAlive);
+
+/**
+ * @brief Send one request on a pooled connection and read its response
+ * @param idempotent The request may safely be sent twice (see isIdempotent())
+ *
+ * When a reused idle connection turns out to be closed, the request is
+ * retried once on a fresh one if it is idempotent or none of it was sent;
+ * otherwise the upstream may have acted on it, so Closed is returned. The
+ * body is written straight from the caller's buffer.
+ */
+Status exchange(UpstreamPool& pool, const std::string& head, const std::string& body,
+                UpstreamPool::Clock::time_point connectDeadline, UpstreamPool::Clock::time_point deadline,
+                bool headRequest, bool idempotent, size_t maxBodyBytes, HttpResponse& response);
+
+/**
+ * @brief True for methods a request can be repeated with (RFC 9110 9.2.2)
+ */
+bool isIdempotent(const std::string& method);
+
+/**
+ * @brief True for headers that describe one connection, not the message
+ */
+bool isHopByHopHeader(const std::string& name);
+
+} // namespace Http1
+
+} // namespace ServiceFramework
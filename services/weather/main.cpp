@@ -10,9 +10,14 @@
 
 using namespace ServiceFramework;
 
+// Service types this binary creates, resolved at compile time
+constexpr auto SERVICES =
+    makeStaticServices<WeatherService, LoggingService>();
+
 int main() {
     std::cout << "Custom Service Example" << std::endl;
     std::cout << "======================" << std::endl;
+    ServiceFactory::getInstance().addStaticServices(SERVICES);
 
     try {
         // Create service manager
@@ -37,8 +42,7 @@ int main() {
         std::cout << "\n--- Using Custom Services ---" << std::endl;
 
         // Get the weather service
-        auto *weather = dynamic_cast<WeatherService *>(
-            manager.getService("weather_monitor"));
+        auto *weather = manager.getService<WeatherService>("weather_monitor");
         if (weather) {
             std::cout << "Weather Report: " << weather->getWeatherReport()
                       << std::endl;
@@ -50,15 +54,14 @@ int main() {
         }
 
         // Get and use logging service
-        auto *logger =
-            dynamic_cast<LoggingService *>(manager.getService("logger"));
+        auto *logger = manager.getService<LoggingService>("logger");
         if (logger) {
             logger->logMessage("LoggingService started successfully");
         }
 
         // Get the file monitor service
-        auto* fileMonitor =
-        dynamic_cast<FileMonitorService*>(manager.getService("file_watcher"));
+        auto *fileMonitor =
+            manager.getService<FileMonitorService>("file_watcher");
         if (fileMonitor) {
             fileMonitor->addFileToWatch("/tmp/test1.txt");
             fileMonitor->addFileToWatch("/tmp/test2.txt");
@@ -16,6 +16,8 @@ using namespace ServiceFramework;
  */
 class WeatherService : public IService {
   public:
+    static constexpr std::string_view SERVICE_TYPE = "WeatherService";
+
     WeatherService() : m_running(false), m_temperature(20.0f) {}
 
     bool initialize() override {
@@ -34,6 +36,7 @@ class WeatherService : public IService {
 
         // Start background monitoring thread (simplified example)
         m_monitoringThread = std::thread([this]() {
+            ThreadAffinity::apply(m_placement);
             while (m_running) {
                 // Simulate temperature reading
                 m_temperature =
@@ -55,6 +58,18 @@ class WeatherService : public IService {
         }
     }
 
+    bool setThreadPlacement(const ThreadPlacementPolicy &policy) override {
+        // The monitoring thread reads it as it starts
+        if (m_running) {
+            std::cerr << "WeatherService: Thread placement must be set "
+                         "before start()"
+                      << std::endl;
+            return false;
+        }
+        m_placement = policy.get(ThreadRole::Background);
+        return true;
+    }
+
     std::string getName() const override { return "WeatherService"; }
 
     bool isRunning() const override { return m_running; }
@@ -84,19 +99,5 @@ class WeatherService : public IService {
     std::atomic<bool> m_running;
     std::atomic<float> m_temperature;
     std::thread m_monitoringThread;
+    ThreadPlacement m_placement;
 };
-
-// Register the custom services
-namespace {
-struct CustomServiceRegistrations {
-    CustomServiceRegistrations() {
-        auto &factory = ServiceFactory::getInstance();
-
-        factory.registerService("WeatherService", []() -> ServicePtr {
-            return std::make_unique<WeatherService>();
-        });
-    }
-};
-
-static CustomServiceRegistrations g_customServiceRegistrations;
-} // namespace